@@ -0,0 +1,86 @@
+// <copyright file="file_store.cpp" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#include "pch.h"
+#include "file_store.h"
+
+#if !defined(_WIN32)
+
+
+/*
+ * file_store::read
+ */
+file_store::value_type file_store::read(_In_ const key_type& key) const {
+    if (key.empty()) {
+        return value_type();
+    }
+
+    std::ifstream stream(key, std::ios::binary);
+    if (!stream) {
+        return value_type();
+    }
+
+    std::ostringstream retval;
+    retval << stream.rdbuf();
+    return retval.str();
+}
+
+
+/*
+ * file_store::write
+ */
+void file_store::write(_In_ const std::array<key_type, 2>& keys,
+        _In_ const std::array<value_type, 2>& values) const {
+    // A 32-bit application only reads the WOW64 file, so it never sees the
+    // pinned native runtime along with a foreign WOW64 one if we write the
+    // native file last.
+    for (std::size_t i = keys.size(); i > 0; --i) {
+        this->write(keys[i - 1], values[i - 1]);
+    }
+}
+
+
+/*
+ * file_store::write
+ */
+void file_store::write(_In_ const key_type& key,
+        _In_ const value_type& value) const {
+    // Every write wakes any program watching the file, so writes that would
+    // not change anything are skipped.
+    if (key.empty() || (this->read(key) == value)) {
+        return;
+    }
+
+    if (value.empty()) {
+        if ((::unlink(key.c_str()) != 0) && (errno != ENOENT)) {
+            throw std::system_error(errno, std::system_category());
+        }
+        return;
+    }
+
+    // The temporary file must be unique to this process, because another
+    // instance might be restoring the same file.
+    const auto temp = key + "." + std::to_string(::getpid()) + ".tmp";
+    try {
+        {
+            std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+            stream << value;
+            stream.close();
+            if (!stream) {
+                throw std::system_error(EIO, std::system_category());
+            }
+        }
+
+        if (::rename(temp.c_str(), key.c_str()) != 0) {
+            throw std::system_error(errno, std::system_category());
+        }
+    } catch (...) {
+        ::unlink(temp.c_str());
+        throw;
+    }
+}
+
+#endif /* !defined(_WIN32) */
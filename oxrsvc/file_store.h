@@ -0,0 +1,66 @@
+// <copyright file="file_store.h" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#if !defined(_OXRSVC_FILE_STORE_H)
+#define _OXRSVC_FILE_STORE_H
+#pragma once
+
+#if !defined(_WIN32)
+
+
+/// <summary>
+/// Reads and writes the active runtime as the content of the
+/// <c>active_runtime.json</c> files for the <see cref="runtime_pin" />.
+/// </summary>
+/// <remarks>
+/// Each file is replaced by renaming a new one over it, such that readers
+/// never see a partially written file. The two files cannot be replaced at
+/// once, though, so the native one is written last.
+/// </remarks>
+class file_store final {
+
+public:
+
+    /// <summary>
+    /// The path of the file holding the active runtime.
+    /// </summary>
+    typedef std::string key_type;
+
+    /// <summary>
+    /// The content of the file holding the active runtime.
+    /// </summary>
+    typedef std::string value_type;
+
+    /// <summary>
+    /// Reads the active runtime from the given file.
+    /// </summary>
+    /// <param name="key">The path of the file, which may be empty.</param>
+    /// <returns>The content of the file or an empty string if the file does
+    /// not exist.</returns>
+    value_type read(_In_ const key_type& key) const;
+
+    /// <summary>
+    /// Writes the active runtimes of both files.
+    /// </summary>
+    /// <param name="keys">The paths of the native and the WOW64 file, which
+    /// may be empty.</param>
+    /// <param name="values">The new content of the files, which are deleted
+    /// if empty.</param>
+    void write(_In_ const std::array<key_type, 2>& keys,
+        _In_ const std::array<value_type, 2>& values) const;
+
+private:
+
+    /// <summary>
+    /// Replaces or deletes a single file unless it already has the requested
+    /// content.
+    /// </summary>
+    void write(_In_ const key_type& key, _In_ const value_type& value) const;
+};
+
+#endif /* !defined(_WIN32) */
+
+#endif /* !defined(_OXRSVC_FILE_STORE_H) */
@@ -0,0 +1,170 @@
+// <copyright file="inotify_watcher.cpp" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#include "pch.h"
+#include "inotify_watcher.h"
+
+#if !defined(_WIN32)
+
+
+/*
+ * inotify_watcher::inotify_watcher
+ */
+inotify_watcher::inotify_watcher(_In_ const std::vector<std::string>& paths)
+        : _inotify(-1) {
+    constexpr auto events = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE
+        | IN_MOVED_FROM | IN_MOVED_TO;
+    this->_wake[0] = this->_wake[1] = -1;
+
+    try {
+        if (::pipe2(this->_wake, O_CLOEXEC | O_NONBLOCK) != 0) {
+            throw std::system_error(errno, std::system_category());
+        }
+
+        this->_inotify = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if (this->_inotify < 0) {
+            throw std::system_error(errno, std::system_category());
+        }
+
+        this->_targets.reserve(paths.size());
+        for (auto& p : paths) {
+            if (p.empty()) {
+                this->_targets.push_back({ std::string(), -1 });
+                continue;
+            }
+
+            const auto sep = p.find_last_of('/');
+            const auto dir = (sep == std::string::npos)
+                ? std::string(".")
+                : (sep == 0) ? std::string("/") : p.substr(0, sep);
+
+            // Files in the same directory share the same watch descriptor,
+            // so we tell them apart by their names.
+            const auto watch = ::inotify_add_watch(this->_inotify,
+                dir.c_str(),
+                events);
+            if (watch < 0) {
+                throw std::system_error(errno, std::system_category());
+            }
+
+            this->_targets.push_back({ p.substr(sep + 1), watch });
+        }
+    } catch (...) {
+        this->release();
+        throw;
+    }
+}
+
+
+/*
+ * inotify_watcher::~inotify_watcher
+ */
+inotify_watcher::~inotify_watcher(void) {
+    this->release();
+}
+
+
+/*
+ * inotify_watcher::stop
+ */
+void inotify_watcher::stop(void) noexcept {
+    const char wake = 1;
+    // If the pipe is full, the watcher is already about to stop.
+    (void) ::write(this->_wake[1], &wake, sizeof(wake));
+}
+
+
+/*
+ * inotify_watcher::wait
+ */
+bool inotify_watcher::wait(_Out_ std::size_t& file) {
+    while (this->_changed.empty()) {
+        pollfd fds[2];
+        fds[0].fd = this->_inotify;
+        fds[0].events = POLLIN;
+        fds[1].fd = this->_wake[0];
+        fds[1].events = POLLIN;
+
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::system_category());
+        }
+
+        if ((fds[1].revents & POLLIN) != 0) {
+            return false;
+        }
+
+        if ((fds[0].revents & POLLIN) != 0) {
+            this->read();
+        }
+    }
+
+    file = this->_changed.front();
+    this->_changed.pop_front();
+    return true;
+}
+
+
+/*
+ * inotify_watcher::read
+ */
+void inotify_watcher::read(void) {
+    alignas(inotify_event) char buffer[4096];
+
+    while (true) {
+        const auto cnt = ::read(this->_inotify, buffer, sizeof(buffer));
+        if (cnt < 0) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                return;
+            } else if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::system_category());
+        }
+
+        for (ssize_t o = 0; o < cnt;) {
+            auto e = reinterpret_cast<const inotify_event *>(buffer + o);
+            o += sizeof(inotify_event) + e->len;
+
+            if (e->len == 0) {
+                continue;
+            }
+
+            for (std::size_t i = 0; i < this->_targets.size(); ++i) {
+                auto& t = this->_targets[i];
+                if ((t.watch == e->wd) && (t.name == e->name)) {
+                    // Report a burst of events for the same file only once.
+                    if (std::find(this->_changed.begin(), this->_changed.end(),
+                            i) == this->_changed.end()) {
+                        this->_changed.push_back(i);
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+/*
+ * inotify_watcher::release
+ */
+void inotify_watcher::release(void) noexcept {
+    if (this->_inotify >= 0) {
+        ::close(this->_inotify);
+        this->_inotify = -1;
+    }
+
+    for (auto& w : this->_wake) {
+        if (w >= 0) {
+            ::close(w);
+            w = -1;
+        }
+    }
+}
+
+#endif /* !defined(_WIN32) */
@@ -0,0 +1,87 @@
+// <copyright file="inotify_watcher.h" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#if !defined(_OXRSVC_INOTIFY_WATCHER_H)
+#define _OXRSVC_INOTIFY_WATCHER_H
+#pragma once
+
+#if !defined(_WIN32)
+
+
+/// <summary>
+/// Waits for a set of files to be changed using inotify.
+/// </summary>
+/// <remarks>
+/// <para>The watcher provides the same interface as the
+/// <see cref="registry_watcher" />.</para>
+/// <para>The watcher observes the directories containing the files rather
+/// than the files themselves, because most tools replace a file by renaming a
+/// new one over it, which would silently end a watch on the file.</para>
+/// </remarks>
+class inotify_watcher final {
+
+public:
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="paths">The paths of the files to be watched, whose
+    /// directories must exist. Empty paths are ignored.</param>
+    explicit inotify_watcher(_In_ const std::vector<std::string>& paths);
+
+    inotify_watcher(const inotify_watcher&) = delete;
+
+    /// <summary>
+    /// Finalises the instance.
+    /// </summary>
+    ~inotify_watcher(void);
+
+    /// <summary>
+    /// Makes <see cref="wait" /> return <see langword="false" />.
+    /// </summary>
+    void stop(void) noexcept;
+
+    /// <summary>
+    /// Blocks until any of the files has been changed.
+    /// </summary>
+    /// <param name="file">Receives the index of the file that changed.
+    /// </param>
+    /// <returns><see langword="true" /> if a file changed,
+    /// <see langword="false" /> if the watcher has been stopped.</returns>
+    bool wait(_Out_ std::size_t& file);
+
+    inotify_watcher& operator =(const inotify_watcher&) = delete;
+
+private:
+
+    /// <summary>
+    /// A file being watched.
+    /// </summary>
+    struct target final {
+        std::string name;
+        int watch;
+    };
+
+    /// <summary>
+    /// Reads all pending events and queues the indices of the files they
+    /// refer to.
+    /// </summary>
+    void read(void);
+
+    /// <summary>
+    /// Closes all descriptors.
+    /// </summary>
+    void release(void) noexcept;
+
+    std::deque<std::size_t> _changed;
+    int _inotify;
+    std::vector<target> _targets;
+    int _wake[2];
+};
+
+#endif /* !defined(_WIN32) */
+
+#endif /* !defined(_OXRSVC_INOTIFY_WATCHER_H) */
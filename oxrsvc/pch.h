@@ -9,21 +9,93 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cassert>
+#include <cctype>
+#include <chrono>
 #include <cinttypes>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <cwctype>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <initializer_list>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <stack>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#if defined(_WIN32)
 #include <winsdkver.h>
 #include <Windows.h>
 #include <aclapi.h>
+#include <ktmw32.h>
 #include <sddl.h>
 #include <tchar.h>
 
+#include <wil/filesystem.h>
 #include <wil/registry.h>
 #include <wil/resource.h>
 #include <wil/result.h>
 
+// The discovery of the switcher, which the service shares, parses the
+// manifests of the runtimes.
+#include <nlohmann/json.hpp>
+
+#else /* defined(_WIN32) */
+// Only the server loop, the socket transport, the file watcher, the merging
+// of the catalogue and the shared state are available on other platforms,
+// which allows for testing these on Linux.
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// The SAL annotations are only available with the Windows SDK.
+#define _In_
+#define _In_opt_
+#define _In_opt_z_
+#define _In_reads_(s)
+#define _In_reads_bytes_(s)
+#define _In_z_
+#define _Inout_
+#define _Out_
+#define _Out_opt_
+#define _Out_writes_(s)
+#define _Out_writes_bytes_(s)
+#define _Success_(c)
+#endif /* defined(_WIN32) */
+
 #endif /* !defined(_OXRSVC_PCH_H) */
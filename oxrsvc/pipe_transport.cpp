@@ -0,0 +1,302 @@
+// <copyright file="pipe_transport.cpp" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#include "pch.h"
+#include "pipe_transport.h"
+
+
+/*
+ * pipe_transport::pipe_transport
+ */
+pipe_transport::pipe_transport(_In_z_ const wchar_t *name,
+        _In_ const std::size_t instances) : _notified(false) {
+    assert(name != nullptr);
+    THROW_WIN32_IF(ERROR_INVALID_PARAMETER, (instances < 1)
+        || (instances >= PIPE_UNLIMITED_INSTANCES));
+
+    this->_port.reset(::CreateIoCompletionPort(INVALID_HANDLE_VALUE,
+        NULL,
+        0,
+        1));
+    THROW_LAST_ERROR_IF(!this->_port);
+
+    this->_instances.reserve(instances);
+    for (std::size_t i = 0; i < instances; ++i) {
+        std::unique_ptr<pipe_instance> p(new pipe_instance());
+        ::ZeroMemory(&p->read, sizeof(p->read));
+        ::ZeroMemory(&p->write, sizeof(p->write));
+        p->read.instance = i;
+        p->write.instance = i;
+
+        // Only the first instance may create the pipe, which makes sure that
+        // nobody else has taken over our name.
+        const DWORD flags = PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED
+            | WRITE_DAC | ((i == 0) ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0);
+        p->pipe.reset(::CreateNamedPipeW(name,
+            flags,
+            PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+            static_cast<DWORD>(instances),
+            sizeof(HRESULT),
+            MAX_PATH * sizeof(wchar_t),
+            NMPWAIT_USE_DEFAULT_WAIT,
+            NULL));
+        THROW_LAST_ERROR_IF(!p->pipe);
+        adjust_dacl(p->pipe);
+
+        THROW_LAST_ERROR_IF_NULL(::CreateIoCompletionPort(p->pipe.get(),
+            this->_port.get(),
+            static_cast<ULONG_PTR>(i),
+            0));
+
+        this->_instances.push_back(std::move(p));
+    }
+}
+
+
+/*
+ * pipe_transport::~pipe_transport
+ */
+pipe_transport::~pipe_transport(void) {
+    for (auto& i : this->_instances) {
+        ::CancelIoEx(i->pipe.get(), nullptr);
+
+        for (auto r : { &i->read, &i->write }) {
+            if (r->pending) {
+                DWORD cnt;
+                ::GetOverlappedResult(i->pipe.get(), r, &cnt, TRUE);
+            }
+        }
+    }
+}
+
+
+/*
+ * pipe_transport::accept
+ */
+void pipe_transport::accept(_In_ const std::size_t instance) {
+    auto& i = *this->_instances.at(instance);
+    prepare(i.read, transport_operation::accept);
+
+    if (!::ConnectNamedPipe(i.pipe.get(), &i.read)) {
+        const auto error = ::GetLastError();
+        switch (error) {
+            case ERROR_IO_PENDING:
+                break;
+
+            case ERROR_PIPE_CONNECTED:
+                // The client connected between creating the instance and the
+                // call, in which case no completion packet is queued.
+                this->post(i.read, ERROR_SUCCESS);
+                break;
+
+            default:
+                this->post(i.read, error);
+                break;
+        }
+    }
+}
+
+
+/*
+ * pipe_transport::cancel
+ */
+void pipe_transport::cancel(_In_ const std::size_t instance) noexcept {
+    assert(instance < this->_instances.size());
+    ::CancelIoEx(this->_instances[instance]->pipe.get(), nullptr);
+}
+
+
+/*
+ * pipe_transport::disconnect
+ */
+void pipe_transport::disconnect(_In_ const std::size_t instance) noexcept {
+    assert(instance < this->_instances.size());
+    ::DisconnectNamedPipe(this->_instances[instance]->pipe.get());
+}
+
+
+/*
+ * pipe_transport::read
+ */
+void pipe_transport::read(_In_ const std::size_t instance,
+        _Out_writes_bytes_(cnt) void *dst,
+        _In_ const std::size_t cnt) {
+    auto& i = *this->_instances.at(instance);
+    prepare(i.read, transport_operation::read);
+
+    // Note: the completion packet is queued even if the call succeeds
+    // immediately, so we only need to handle failures here.
+    if (!::ReadFile(i.pipe.get(),
+            dst,
+            static_cast<DWORD>(cnt),
+            nullptr,
+            &i.read)) {
+        const auto error = ::GetLastError();
+        if (error != ERROR_IO_PENDING) {
+            this->post(i.read, error);
+        }
+    }
+}
+
+
+/*
+ * pipe_transport::notify
+ */
+void pipe_transport::notify(void) noexcept {
+    // Only queue a packet if the previous one has been dequeued, which
+    // coalesces bursts of notifications.
+    if (!this->_notified.exchange(true, std::memory_order_acq_rel)) {
+        ::PostQueuedCompletionStatus(this->_port.get(),
+            0,
+            notify_key,
+            nullptr);
+    }
+}
+
+
+/*
+ * pipe_transport::stop
+ */
+void pipe_transport::stop(void) noexcept {
+    ::PostQueuedCompletionStatus(this->_port.get(), 0, stop_key, nullptr);
+}
+
+
+/*
+ * pipe_transport::wait
+ */
+bool pipe_transport::wait(_Out_ transport_completion& completion) {
+    DWORD cnt = 0;
+    ULONG_PTR key = 0;
+    LPOVERLAPPED overlapped = nullptr;
+
+    const auto succeeded = ::GetQueuedCompletionStatus(this->_port.get(),
+        &cnt,
+        &key,
+        &overlapped,
+        INFINITE);
+    if (overlapped == nullptr) {
+        // If there is no OVERLAPPED, the port itself failed or we have been
+        // notified or stopped.
+        THROW_LAST_ERROR_IF(!succeeded);
+
+        if (key == notify_key) {
+            this->_notified.store(false, std::memory_order_release);
+            completion.cnt = 0;
+            completion.error = 0;
+            completion.instance = 0;
+            completion.operation = transport_operation::notify;
+            return true;
+        }
+
+        assert(key == stop_key);
+        return false;
+    }
+
+    auto& r = *static_cast<request *>(overlapped);
+    r.pending = false;
+    completion.cnt = cnt;
+    completion.error = succeeded ? r.error : ::GetLastError();
+    completion.instance = r.instance;
+    completion.operation = r.operation;
+    return true;
+}
+
+
+/*
+ * pipe_transport::write
+ */
+void pipe_transport::write(_In_ const std::size_t instance,
+        _In_reads_bytes_(cnt) const void *src,
+        _In_ const std::size_t cnt) {
+    auto& i = *this->_instances.at(instance);
+    prepare(i.write, transport_operation::write);
+
+    if (!::WriteFile(i.pipe.get(),
+            src,
+            static_cast<DWORD>(cnt),
+            nullptr,
+            &i.write)) {
+        const auto error = ::GetLastError();
+        if (error != ERROR_IO_PENDING) {
+            this->post(i.write, error);
+        }
+    }
+}
+
+
+/*
+ * pipe_transport::adjust_dacl
+ */
+void pipe_transport::adjust_dacl(_In_ wil::unique_hfile& pipe) {
+    assert(pipe);
+
+    wil::unique_hlocal sd;
+    PACL existing_acl = nullptr;
+    THROW_IF_WIN32_ERROR(::GetSecurityInfo(pipe.get(),
+        SE_KERNEL_OBJECT,
+        DACL_SECURITY_INFORMATION,
+        nullptr,
+        nullptr,
+        &existing_acl,
+        nullptr,
+        sd.put()));
+
+    SID_IDENTIFIER_AUTHORITY nt_auth = SECURITY_NT_AUTHORITY;
+    wil::unique_sid auth_users;
+    THROW_LAST_ERROR_IF(!::AllocateAndInitializeSid(&nt_auth, 1,
+        SECURITY_AUTHENTICATED_USER_RID,
+        0, 0, 0, 0, 0, 0, 0,
+        auth_users.put()));
+
+    EXPLICIT_ACCESS ea;
+    ::ZeroMemory(&ea, sizeof(ea));
+    ea.grfAccessPermissions = GENERIC_READ | GENERIC_WRITE
+        | STANDARD_RIGHTS_READ | STANDARD_RIGHTS_WRITE;
+    ea.grfAccessMode = SET_ACCESS;// GRANT_ACCESS??
+    ea.grfInheritance = NO_INHERITANCE;
+    ea.Trustee.TrusteeForm = TRUSTEE_IS_SID;
+    ea.Trustee.TrusteeType = TRUSTEE_IS_GROUP;
+    ea.Trustee.ptstrName = reinterpret_cast<LPWSTR>(auth_users.get());
+
+    wil::unique_hlocal new_acl;
+    THROW_IF_WIN32_ERROR(::SetEntriesInAclW(1, &ea, existing_acl,
+        reinterpret_cast<PACL *>(new_acl.put())));
+
+    THROW_IF_WIN32_ERROR(::SetSecurityInfo(pipe.get(),
+        SE_KERNEL_OBJECT,
+        DACL_SECURITY_INFORMATION,
+        nullptr,
+        nullptr,
+        static_cast<PACL>(new_acl.get()),
+        nullptr));
+}
+
+
+/*
+ * pipe_transport::prepare
+ */
+void pipe_transport::prepare(_Inout_ request& request,
+        _In_ const transport_operation operation) noexcept {
+    assert(!request.pending);
+    // Reset the OVERLAPPED part, but keep our own bookkeeping.
+    ::ZeroMemory(static_cast<OVERLAPPED *>(&request), sizeof(OVERLAPPED));
+    request.error = ERROR_SUCCESS;
+    request.operation = operation;
+    request.pending = true;
+}
+
+
+/*
+ * pipe_transport::post
+ */
+void pipe_transport::post(_Inout_ request& request, _In_ const DWORD error) {
+    request.error = error;
+    THROW_LAST_ERROR_IF(!::PostQueuedCompletionStatus(this->_port.get(),
+        0,
+        static_cast<ULONG_PTR>(request.instance),
+        &request));
+}
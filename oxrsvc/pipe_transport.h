@@ -0,0 +1,171 @@
+// <copyright file="pipe_transport.h" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#if !defined(_OXRSVC_PIPE_TRANSPORT_H)
+#define _OXRSVC_PIPE_TRANSPORT_H
+#pragma once
+
+#include "transport.h"
+
+
+/// <summary>
+/// Implements the transport of the <see cref="server" /> using overlapped I/O
+/// on multiple instances of a named pipe, which all report to a single I/O
+/// completion port.
+/// </summary>
+class pipe_transport final {
+
+public:
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="name">The name of the pipe.</param>
+    /// <param name="instances">The number of pipe instances, which is the
+    /// number of clients that can be served concurrently.</param>
+    pipe_transport(_In_z_ const wchar_t *name,
+        _In_ const std::size_t instances);
+
+    pipe_transport(const pipe_transport&) = delete;
+
+    /// <summary>
+    /// Finalises the instance.
+    /// </summary>
+    /// <remarks>
+    /// The destructor cancels all pending I/O and waits for it to complete,
+    /// because the kernel might otherwise write to freed memory.
+    /// </remarks>
+    ~pipe_transport(void);
+
+    /// <summary>
+    /// Starts waiting for a client to connect to the given pipe instance.
+    /// </summary>
+    /// <param name="instance"></param>
+    void accept(_In_ const std::size_t instance);
+
+    /// <summary>
+    /// Cancels all pending I/O on the given pipe instance.
+    /// </summary>
+    /// <param name="instance"></param>
+    void cancel(_In_ const std::size_t instance) noexcept;
+
+    /// <summary>
+    /// Disconnects the client from the given pipe instance.
+    /// </summary>
+    /// <param name="instance"></param>
+    void disconnect(_In_ const std::size_t instance) noexcept;
+
+    /// <summary>
+    /// Answer the number of pipe instances.
+    /// </summary>
+    /// <returns></returns>
+    inline std::size_t instances(void) const noexcept {
+        return this->_instances.size();
+    }
+
+    /// <summary>
+    /// Wakes the thread waiting for completions with a notification.
+    /// </summary>
+    void notify(void) noexcept;
+
+    /// <summary>
+    /// Starts reading from the given pipe instance.
+    /// </summary>
+    /// <param name="instance"></param>
+    /// <param name="dst"></param>
+    /// <param name="cnt"></param>
+    void read(_In_ const std::size_t instance,
+        _Out_writes_bytes_(cnt) void *dst,
+        _In_ const std::size_t cnt);
+
+    /// <summary>
+    /// Makes <see cref="wait" /> return <see langword="false" />.
+    /// </summary>
+    void stop(void) noexcept;
+
+    /// <summary>
+    /// Waits for the next I/O operation to complete.
+    /// </summary>
+    /// <param name="completion"></param>
+    /// <returns><see langword="true" /> if an operation completed,
+    /// <see langword="false" /> if the transport was stopped.</returns>
+    bool wait(_Out_ transport_completion& completion);
+
+    /// <summary>
+    /// Starts writing to the given pipe instance.
+    /// </summary>
+    /// <param name="instance"></param>
+    /// <param name="src"></param>
+    /// <param name="cnt"></param>
+    void write(_In_ const std::size_t instance,
+        _In_reads_bytes_(cnt) const void *src,
+        _In_ const std::size_t cnt);
+
+    pipe_transport& operator =(const pipe_transport&) = delete;
+
+private:
+
+    /// <summary>
+    /// The state of a single overlapped operation.
+    /// </summary>
+    struct request final : public OVERLAPPED {
+        DWORD error;
+        std::size_t instance;
+        transport_operation operation;
+        bool pending;
+    };
+
+    /// <summary>
+    /// The state of a single pipe instance.
+    /// </summary>
+    struct pipe_instance final {
+        wil::unique_hfile pipe;
+        request read;
+        request write;
+    };
+
+    /// <summary>
+    /// Adjust the DACL of the given named pipe such that normal users can write
+    /// to it.
+    /// </summary>
+    /// <param name="pipe"></param>
+    static void adjust_dacl(_In_ wil::unique_hfile& pipe);
+
+    /// <summary>
+    /// Prepares <paramref name="request" /> for a new operation.
+    /// </summary>
+    /// <param name="request"></param>
+    /// <param name="operation"></param>
+    static void prepare(_Inout_ request& request,
+        _In_ const transport_operation operation) noexcept;
+
+    /// <summary>
+    /// The completion key that signals <see cref="notify" />.
+    /// </summary>
+    static constexpr ULONG_PTR notify_key
+        = (std::numeric_limits<ULONG_PTR>::max)() - 1;
+
+    /// <summary>
+    /// The completion key that signals <see cref="stop" />.
+    /// </summary>
+    static constexpr ULONG_PTR stop_key
+        = (std::numeric_limits<ULONG_PTR>::max)();
+
+    /// <summary>
+    /// Queues the completion of <paramref name="request" /> ourselves, which
+    /// is required if an overlapped call finished without queuing a
+    /// completion packet, for instance because it failed immediately.
+    /// </summary>
+    /// <param name="request"></param>
+    /// <param name="error"></param>
+    void post(_Inout_ request& request, _In_ const DWORD error);
+
+    std::vector<std::unique_ptr<pipe_instance>> _instances;
+    std::atomic<bool> _notified;
+    wil::unique_handle _port;
+};
+
+#endif /* !defined(_OXRSVC_PIPE_TRANSPORT_H) */
@@ -0,0 +1,349 @@
+// <copyright file="protocol.cpp" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#include "pch.h"
+#include "protocol.h"
+
+
+/// <summary>
+/// Answer whether <paramref name="c" /> is the leading half of a UTF-16
+/// surrogate pair.
+/// </summary>
+static inline bool is_high_surrogate(_In_ const std::uint32_t c) noexcept {
+    return (c >= 0xD800) && (c <= 0xDBFF);
+}
+
+
+/// <summary>
+/// Answer whether <paramref name="c" /> is the trailing half of a UTF-16
+/// surrogate pair.
+/// </summary>
+static inline bool is_low_surrogate(_In_ const std::uint32_t c) noexcept {
+    return (c >= 0xDC00) && (c <= 0xDFFF);
+}
+
+
+/// <summary>
+/// Answer the number of UTF-16 code units needed to encode
+/// <paramref name="str" />.
+/// </summary>
+static std::size_t encoded_size(_In_ const std::wstring& str) noexcept {
+    // Only a 32-bit wchar_t can hold characters beyond the BMP, which need
+    // a surrogate pair.
+    return str.size() + std::count_if(str.begin(), str.end(),
+        [](const wchar_t c) {
+            return (static_cast<std::uint32_t>(c) > 0xFFFF);
+        });
+}
+
+
+/// <summary>
+/// Reads <paramref name="cnt" /> UTF-16 code units at
+/// <paramref name="offset" /> into <paramref name="dst" />.
+/// </summary>
+/// <remarks>
+/// Surrogate pairs are combined if <c>wchar_t</c> has 32 bits. Anything else
+/// is copied as it is, which preserves the paths of old clients on Windows
+/// even if they are not valid UTF-16.
+/// </remarks>
+static void read_string(_In_ const ring_buffer& input,
+        _In_ const std::size_t offset,
+        _In_ const std::size_t cnt,
+        _Out_ std::wstring& dst) {
+    std::u16string units(cnt, u'\0');
+    if (cnt > 0) {
+        input.peek(offset, &units[0], cnt * sizeof(char16_t));
+    }
+
+    dst.clear();
+    dst.reserve(cnt);
+
+    for (std::size_t i = 0; i < cnt; ++i) {
+        std::uint32_t c = units[i];
+        if ((sizeof(wchar_t) > sizeof(char16_t))
+                && is_high_surrogate(c)
+                && (i + 1 < cnt)
+                && is_low_surrogate(units[i + 1])) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (units[++i] - 0xDC00);
+        }
+        dst.push_back(static_cast<wchar_t>(c));
+    }
+}
+
+
+/// <summary>
+/// Appends <paramref name="cnt" /> bytes at <paramref name="src" /> to
+/// <paramref name="output" />.
+/// </summary>
+static void write_bytes(_Inout_ std::vector<std::uint8_t>& output,
+        _In_reads_bytes_(cnt) const void *src,
+        _In_ const std::size_t cnt) {
+    auto s = static_cast<const std::uint8_t *>(src);
+    output.insert(output.end(), s, s + cnt);
+}
+
+
+/// <summary>
+/// Appends a frame header for a payload of <paramref name="length" /> bytes
+/// to <paramref name="output" />.
+/// </summary>
+static void write_header(_Inout_ std::vector<std::uint8_t>& output,
+        _In_ const message_type type,
+        _In_ const std::size_t length) {
+    frame_header header;
+    header.magic = frame_magic;
+    header.version = frame_version;
+    header.type = type;
+    header.length = static_cast<std::uint32_t>(length);
+    write_bytes(output, &header, sizeof(header));
+}
+
+
+/// <summary>
+/// Appends <paramref name="str" /> as UTF-16 code units to
+/// <paramref name="output" />.
+/// </summary>
+static void write_string(_Inout_ std::vector<std::uint8_t>& output,
+        _In_ const std::wstring& str) {
+    std::u16string units;
+    units.reserve(encoded_size(str));
+
+    for (auto c : str) {
+        auto u = static_cast<std::uint32_t>(c);
+        if (u > 0xFFFF) {
+            u -= 0x10000;
+            units.push_back(static_cast<char16_t>(0xD800 + (u >> 10)));
+            units.push_back(static_cast<char16_t>(0xDC00 + (u & 0x3FF)));
+        } else {
+            units.push_back(static_cast<char16_t>(u));
+        }
+    }
+
+    write_bytes(output, units.data(), units.size() * sizeof(char16_t));
+}
+
+
+/// <summary>
+/// Appends the lengths of <paramref name="runtime" /> and
+/// <paramref name="wow_runtime" /> followed by their characters to
+/// <paramref name="output" />, which is the layout of the payload of
+/// <see cref="message_type::activate" />.
+/// </summary>
+static void write_paths(_Inout_ std::vector<std::uint8_t>& output,
+        _In_ const std::wstring& runtime,
+        _In_ const std::wstring& wow_runtime) {
+    const std::uint32_t counts[] = {
+        static_cast<std::uint32_t>(encoded_size(runtime)),
+        static_cast<std::uint32_t>(encoded_size(wow_runtime))
+    };
+    write_bytes(output, counts, sizeof(counts));
+    write_string(output, runtime);
+    write_string(output, wow_runtime);
+}
+
+
+/// <summary>
+/// Parses a request in the old format, which is a list of two zero-terminated
+/// UTF-16 paths that is terminated by an empty string.
+/// </summary>
+/// <remarks>
+/// Only the data after <paramref name="scanned" /> are searched for the end
+/// of the request, which keeps the cost linear in the size of the request
+/// if it arrives in many small parts.
+/// </remarks>
+static std::size_t parse_legacy(_In_ const ring_buffer& input,
+        _Inout_ std::size_t& scanned,
+        _Out_ request& request) {
+    constexpr auto size_unit = sizeof(char16_t);
+    const auto cnt = input.size() / size_unit;
+
+    // The request ends at the first pair of consecutive terminators, which
+    // is the empty string following the second path or an empty second path.
+    // Anything between the second terminator and the end is ignored, like
+    // the original implementation did. The last unit scanned before must be
+    // checked again, because it might be the first of the pair.
+    auto i = scanned / size_unit;
+    char16_t previous = (i > 0)
+        ? input.peek<char16_t>((i - 1) * size_unit)
+        : 1;
+    for (; i < cnt; ++i) {
+        const auto current = input.peek<char16_t>(i * size_unit);
+        if ((current == 0) && (previous == 0)) {
+            break;
+        }
+        previous = current;
+    }
+
+    if (i >= cnt) {
+        if (input.size() >= max_frame_size) {
+            throw std::invalid_argument("The request exceeds the maximum "
+                "size.");
+        }
+
+        scanned = cnt * size_unit;
+        return 0;
+    }
+
+    // The request is complete, so we can afford searching the terminators of
+    // the paths once.
+    std::size_t first = 0;
+    while (input.peek<char16_t>(first * size_unit) != 0) {
+        ++first;
+    }
+
+    auto second = first + 1;
+    while (input.peek<char16_t>(second * size_unit) != 0) {
+        ++second;
+    }
+
+    request.id = catalogue_entry::invalid_id;
+    request.legacy = true;
+    request.type = message_type::activate;
+    request.version = 0;
+    read_string(input, 0, first, request.runtime);
+    read_string(input, (first + 1) * size_unit, second - first - 1,
+        request.wow_runtime);
+
+    scanned = 0;
+    return (i + 1) * size_unit;
+}
+
+
+/*
+ * ::parse_request
+ */
+std::size_t parse_request(_In_ const ring_buffer& input,
+        _Inout_ std::size_t& scanned,
+        _Out_ request& request) {
+    // We need at least the magic number to decide on the format. The shortest
+    // valid request in the old format, which is two empty strings, has the
+    // same size.
+    if (input.size() < sizeof(frame_magic)) {
+        return 0;
+    }
+
+    if (input.peek<std::uint32_t>(0) != frame_magic) {
+        return parse_legacy(input, scanned, request);
+    }
+
+    if (input.size() < sizeof(frame_header)) {
+        return 0;
+    }
+
+    const auto header = input.peek<frame_header>(0);
+    if (header.length > max_frame_size - sizeof(frame_header)) {
+        throw std::invalid_argument("The frame exceeds the maximum size.");
+    }
+
+    const auto retval = sizeof(frame_header) + header.length;
+    if (input.size() < retval) {
+        return 0;
+    }
+
+    request.id = catalogue_entry::invalid_id;
+    request.legacy = false;
+    request.runtime.clear();
+    request.type = header.type;
+    request.version = header.version;
+    request.wow_runtime.clear();
+
+    const auto has_paths = (header.type == message_type::activate)
+        || (header.type == message_type::pin);
+    if ((header.version == frame_version) && has_paths) {
+        constexpr auto size_counts = 2 * sizeof(std::uint32_t);
+        if (header.length < size_counts) {
+            throw std::invalid_argument("The activation request is "
+                "truncated.");
+        }
+
+        auto offset = sizeof(frame_header);
+        const std::size_t cnt_rt = input.peek<std::uint32_t>(offset);
+        offset += sizeof(std::uint32_t);
+        const std::size_t cnt_wow = input.peek<std::uint32_t>(offset);
+        offset += sizeof(std::uint32_t);
+
+        // Check the counts individually to prevent any overflow.
+        const auto rem = (header.length - size_counts) / sizeof(char16_t);
+        if ((cnt_rt > rem) || (cnt_wow > rem - cnt_rt)) {
+            throw std::invalid_argument("The paths exceed the activation "
+                "request.");
+        }
+
+        read_string(input, offset, cnt_rt, request.runtime);
+        offset += cnt_rt * sizeof(char16_t);
+        read_string(input, offset, cnt_wow, request.wow_runtime);
+
+    } else if ((header.version == frame_version)
+            && (header.type == message_type::activate_id)) {
+        if (header.length < sizeof(request.id)) {
+            throw std::invalid_argument("The activation request is "
+                "truncated.");
+        }
+
+        request.id = input.peek<std::uint32_t>(sizeof(frame_header));
+    }
+
+    return retval;
+}
+
+
+/*
+ * ::write_catalogue
+ */
+std::size_t write_catalogue(_Inout_ std::vector<std::uint8_t>& output,
+        _In_ const std::vector<catalogue_entry>& entries) {
+    constexpr auto max_length = max_frame_size - sizeof(frame_header);
+    std::uint32_t cnt = 0;
+    std::size_t length = sizeof(cnt);
+    for (auto& e : entries) {
+        const auto size = sizeof(e.id) + 2 * sizeof(std::uint32_t)
+            + (encoded_size(e.path) + encoded_size(e.wow_path))
+            * sizeof(char16_t);
+        if (size > max_length - length) {
+            break;
+        }
+
+        length += size;
+        ++cnt;
+    }
+
+    write_header(output, message_type::catalogue, length);
+    write_bytes(output, &cnt, sizeof(cnt));
+    for (std::uint32_t i = 0; i < cnt; ++i) {
+        auto& e = entries[i];
+        write_bytes(output, &e.id, sizeof(e.id));
+        write_paths(output, e.path, e.wow_path);
+    }
+
+    return cnt;
+}
+
+
+/*
+ * ::write_changed
+ */
+void write_changed(_Inout_ std::vector<std::uint8_t>& output,
+        _In_ const std::wstring& runtime,
+        _In_ const std::wstring& wow_runtime) {
+    write_header(output, message_type::changed, 2 * sizeof(std::uint32_t)
+        + (encoded_size(runtime) + encoded_size(wow_runtime))
+        * sizeof(char16_t));
+    write_paths(output, runtime, wow_runtime);
+}
+
+
+/*
+ * ::write_result
+ */
+void write_result(_Inout_ std::vector<std::uint8_t>& output,
+        _In_ const request& request,
+        _In_ const std::int32_t status) {
+    if (!request.legacy) {
+        write_header(output, message_type::result, sizeof(status));
+    }
+
+    write_bytes(output, &status, sizeof(status));
+}
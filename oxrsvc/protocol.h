@@ -0,0 +1,240 @@
+// <copyright file="protocol.h" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#if !defined(_OXRSVC_PROTOCOL_H)
+#define _OXRSVC_PROTOCOL_H
+#pragma once
+
+#include "ring_buffer.h"
+#include "runtime_catalogue.h"
+
+
+/// <summary>
+/// The magic number at the begin of each frame.
+/// </summary>
+/// <remarks>
+/// The first two bytes form the UTF-16 non-character U+FFFF, which cannot
+/// occur at the begin of a path, so frames can be told apart from the
+/// zero-terminated requests of old clients.
+/// </remarks>
+constexpr std::uint32_t frame_magic = 0x5258FFFF;
+
+/// <summary>
+/// The version of the protocol implemented by the service.
+/// </summary>
+constexpr std::uint16_t frame_version = 1;
+
+/// <summary>
+/// The maximum size of a frame including its header, which is also the
+/// maximum size of an old zero-terminated request.
+/// </summary>
+constexpr std::size_t max_frame_size = 64 * 1024;
+
+
+/// <summary>
+/// The status reported if a request has been accepted, but the registry will
+/// only be changed once the coalescing window of the service has elapsed.
+/// </summary>
+/// <remarks>
+/// This is <c>MAKE_HRESULT(SEVERITY_SUCCESS, FACILITY_WIN32,
+/// ERROR_IO_PENDING)</c>, so clients that only check for a failure accept it
+/// like <c>S_OK</c>, whereas other clients can wait for the change
+/// notification.
+/// </remarks>
+constexpr std::int32_t status_pending = 0x000703E5;
+
+
+/// <summary>
+/// Identifies the type of message in a frame.
+/// </summary>
+enum class message_type : std::uint16_t {
+
+    /// <summary>
+    /// Sets the active runtime. The payload comprises the number of UTF-16
+    /// code units of the path of the native runtime and of the WOW64 runtime
+    /// as 32-bit integers, followed by the code units of both paths without
+    /// any terminators.
+    /// </summary>
+    activate = 1,
+
+    /// <summary>
+    /// The response of the service, whose payload is a 32-bit status code,
+    /// which is an <c>HRESULT</c> reported by the Windows service or
+    /// <see cref="status_pending" /> if the change has been deferred.
+    /// </summary>
+    result = 2,
+
+    /// <summary>
+    /// Sets the active runtime like <see cref="activate" /> and keeps it
+    /// active by restoring it whenever another program changes it. The
+    /// payload is the same as for <see cref="activate" />.
+    /// </summary>
+    pin = 3,
+
+    /// <summary>
+    /// Stops keeping the pinned runtime active without changing the active
+    /// runtime. The payload is empty.
+    /// </summary>
+    unpin = 4,
+
+    /// <summary>
+    /// Asks the service to send a <see cref="changed" /> message whenever the
+    /// active runtime changes. The payload is empty. The first message is sent
+    /// right after the result and reflects the state at this point.
+    /// </summary>
+    subscribe = 5,
+
+    /// <summary>
+    /// Notifies a subscriber about the active runtime. The payload is the same
+    /// as for <see cref="activate" />.
+    /// </summary>
+    changed = 6,
+
+    /// <summary>
+    /// Asks for the runtimes the service knows. The payload is empty, and
+    /// the response is a <see cref="catalogue" /> message.
+    /// </summary>
+    list = 7,
+
+    /// <summary>
+    /// The response to <see cref="list" />. The payload comprises the number
+    /// of runtimes as 32-bit integer followed by the runtimes. Each runtime
+    /// comprises its identifier as 32-bit integer followed by the same data
+    /// as the payload of <see cref="activate" />.
+    /// </summary>
+    catalogue = 8,
+
+    /// <summary>
+    /// Sets the active runtime by the identifier the service reported in its
+    /// <see cref="catalogue" />. The payload is the identifier as 32-bit
+    /// integer.
+    /// </summary>
+    activate_id = 9
+};
+
+
+/// <summary>
+/// The header of a frame, which is followed by <see cref="length" /> bytes
+/// of payload. All numbers are little endian, and all strings are UTF-16
+/// regardless of the size of <c>wchar_t</c> on the platform.
+/// </summary>
+struct frame_header final {
+    std::uint32_t magic;
+    std::uint16_t version;
+    message_type type;
+    std::uint32_t length;
+};
+
+static_assert(sizeof(frame_header) == 12, "The frame header must be packed.");
+
+
+/// <summary>
+/// A request of a client.
+/// </summary>
+struct request final {
+
+    /// <summary>
+    /// The identifier of the runtime, which is only set for
+    /// <see cref="message_type::activate_id" />.
+    /// </summary>
+    std::uint32_t id;
+
+    /// <summary>
+    /// Indicates whether the request has been received in the old
+    /// zero-terminated format, which requires the response in the old format,
+    /// too.
+    /// </summary>
+    bool legacy;
+
+    /// <summary>
+    /// The path of the native runtime, which has been converted from UTF-16
+    /// and is only set for
+    /// <see cref="message_type::activate" /> and
+    /// <see cref="message_type::pin" />.
+    /// </summary>
+    std::wstring runtime;
+
+    /// <summary>
+    /// The type of the request.
+    /// </summary>
+    message_type type;
+
+    /// <summary>
+    /// The protocol version the client used.
+    /// </summary>
+    std::uint16_t version;
+
+    /// <summary>
+    /// The path of the WOW64 runtime, which may be empty.
+    /// </summary>
+    std::wstring wow_runtime;
+};
+
+
+/// <summary>
+/// Parses the request at the head of <paramref name="input" />.
+/// </summary>
+/// <remarks>
+/// The request is parsed in place. Frames of unknown versions or types are
+/// consumed and returned as they are, such that the caller can reject them.
+/// </remarks>
+/// <param name="input">The data received from the client.</param>
+/// <param name="scanned">The number of bytes at the head of
+/// <paramref name="input" /> that previous calls have searched for the end of
+/// an old zero-terminated request, which must be zero for a new connection.
+/// The variable is updated if the request is incomplete and reset once it is
+/// complete, so the data of a request arriving in many small parts are only
+/// scanned once.</param>
+/// <param name="request">Receives the request if it is complete.</param>
+/// <returns>The size of the request in bytes or zero if it is not yet
+/// complete.</returns>
+/// <exception cref="std::invalid_argument">If the data cannot be a valid
+/// request.</exception>
+std::size_t parse_request(_In_ const ring_buffer& input,
+    _Inout_ std::size_t& scanned,
+    _Out_ request& request);
+
+/// <summary>
+/// Appends a <see cref="message_type::catalogue" /> message to
+/// <paramref name="output" />.
+/// </summary>
+/// <remarks>
+/// The message is capped at <see cref="max_frame_size" />, which clients
+/// reject any larger frame against. If not all runtimes fit, the ones with
+/// the lowest identifiers are reported.
+/// </remarks>
+/// <param name="output"></param>
+/// <param name="entries">The runtimes to be reported in the order of their
+/// identifiers.</param>
+/// <returns>The number of runtimes that have been written.</returns>
+std::size_t write_catalogue(_Inout_ std::vector<std::uint8_t>& output,
+    _In_ const std::vector<catalogue_entry>& entries);
+
+/// <summary>
+/// Appends a <see cref="message_type::changed" /> message to
+/// <paramref name="output" />.
+/// </summary>
+/// <param name="output"></param>
+/// <param name="runtime">The path of the active native runtime.</param>
+/// <param name="wow_runtime">The path of the active WOW64 runtime, which may
+/// be empty.</param>
+void write_changed(_Inout_ std::vector<std::uint8_t>& output,
+    _In_ const std::wstring& runtime,
+    _In_ const std::wstring& wow_runtime);
+
+/// <summary>
+/// Appends the response to <paramref name="request" /> to
+/// <paramref name="output" />.
+/// </summary>
+/// <param name="output"></param>
+/// <param name="request"></param>
+/// <param name="status">The status code of the request, which is an
+/// <c>HRESULT</c> on Windows.</param>
+void write_result(_Inout_ std::vector<std::uint8_t>& output,
+    _In_ const request& request,
+    _In_ const std::int32_t status);
+
+#endif /* !defined(_OXRSVC_PROTOCOL_H) */
@@ -0,0 +1,47 @@
+// <copyright file="registry_store.cpp" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#include "pch.h"
+#include "registry_store.h"
+
+#include "../oxrswitch/registry_transaction.h"
+
+#if defined(_WIN32)
+
+
+/*
+ * registry_store::registry_store
+ */
+registry_store::registry_store(_In_z_ const wchar_t *value) : _value(value) {
+    assert(value != nullptr);
+}
+
+
+/*
+ * registry_store::read
+ */
+registry_store::value_type registry_store::read(
+        _In_opt_ const key_type key) const {
+    return registry_transaction::get_value(key, this->_value);
+}
+
+
+/*
+ * registry_store::write
+ */
+void registry_store::write(_In_ const std::array<key_type, 2>& keys,
+        _In_ const std::array<value_type, 2>& values) const {
+    registry_transaction transaction;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        registry_transaction::update_value(
+            transaction.open(keys[i]).get(),
+            this->_value,
+            values[i]);
+    }
+    transaction.commit();
+}
+
+#endif /* defined(_WIN32) */
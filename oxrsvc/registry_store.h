@@ -0,0 +1,65 @@
+// <copyright file="registry_store.h" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#if !defined(_OXRSVC_REGISTRY_STORE_H)
+#define _OXRSVC_REGISTRY_STORE_H
+#pragma once
+
+#if defined(_WIN32)
+
+
+/// <summary>
+/// Reads and writes the active runtime in the registry for the
+/// <see cref="runtime_pin" />.
+/// </summary>
+class registry_store final {
+
+public:
+
+    /// <summary>
+    /// The OpenXR key holding the active runtime.
+    /// </summary>
+    typedef HKEY key_type;
+
+    /// <summary>
+    /// The path of the manifest of the active runtime.
+    /// </summary>
+    typedef std::wstring value_type;
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="value">The name of the value holding the active runtime,
+    /// which must remain valid as long as the instance exists.</param>
+    explicit registry_store(_In_z_ const wchar_t *value);
+
+    /// <summary>
+    /// Reads the active runtime from the given key.
+    /// </summary>
+    /// <param name="key">The key, which may be <see langword="NULL" />.
+    /// </param>
+    /// <returns>The active runtime or an empty string if there is none.
+    /// </returns>
+    value_type read(_In_opt_ const key_type key) const;
+
+    /// <summary>
+    /// Writes the active runtimes of both keys in a single transaction.
+    /// </summary>
+    /// <param name="keys">The native and the WOW64 key, which may be
+    /// <see langword="NULL" />.</param>
+    /// <param name="values">The active runtimes, which are deleted if
+    /// empty.</param>
+    void write(_In_ const std::array<key_type, 2>& keys,
+        _In_ const std::array<value_type, 2>& values) const;
+
+private:
+
+    const wchar_t *_value;
+};
+
+#endif /* defined(_WIN32) */
+
+#endif /* !defined(_OXRSVC_REGISTRY_STORE_H) */
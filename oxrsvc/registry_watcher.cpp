@@ -0,0 +1,82 @@
+// <copyright file="registry_watcher.cpp" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#include "pch.h"
+#include "registry_watcher.h"
+
+
+/*
+ * registry_watcher::registry_watcher
+ */
+registry_watcher::registry_watcher(_In_ std::vector<HKEY> keys)
+        : _keys(std::move(keys)) {
+    if (this->_keys.size() >= MAXIMUM_WAIT_OBJECTS) {
+        throw std::invalid_argument("Too many keys for a single watcher.");
+    }
+
+    this->_stop.create(wil::EventOptions::ManualReset);
+
+    this->_events.resize(this->_keys.size());
+    this->_handles.reserve(this->_keys.size() + 1);
+    for (std::size_t i = 0; i < this->_keys.size(); ++i) {
+        this->_events[i].create(wil::EventOptions::None);
+        this->_handles.push_back(this->_events[i].get());
+        this->arm(i);
+    }
+
+    this->_handles.push_back(this->_stop.get());
+}
+
+
+/*
+ * registry_watcher::stop
+ */
+void registry_watcher::stop(void) noexcept {
+    this->_stop.SetEvent();
+}
+
+
+/*
+ * registry_watcher::wait
+ */
+bool registry_watcher::wait(_Out_ std::size_t& key) {
+    const auto cnt = static_cast<DWORD>(this->_handles.size());
+    const auto status = ::WaitForMultipleObjects(cnt,
+        this->_handles.data(),
+        FALSE,
+        INFINITE);
+    THROW_LAST_ERROR_IF(status == WAIT_FAILED);
+
+    key = static_cast<std::size_t>(status - WAIT_OBJECT_0);
+    if (key >= this->_keys.size()) {
+        // This is the stop event.
+        return false;
+    }
+
+    // Re-arm before the caller inspects the key, such that we do not miss
+    // any change happening in the meantime.
+    this->arm(key);
+    return true;
+}
+
+
+/*
+ * registry_watcher::arm
+ */
+void registry_watcher::arm(_In_ const std::size_t key) {
+    if (this->_keys[key] == NULL) {
+        return;
+    }
+
+    // The notification must not be bound to the calling thread, because it
+    // would otherwise be signalled as soon as that thread exits.
+    THROW_IF_WIN32_ERROR(::RegNotifyChangeKeyValue(this->_keys[key],
+        TRUE,
+        REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET
+        | REG_NOTIFY_THREAD_AGNOSTIC,
+        this->_events[key].get(),
+        TRUE));
+}
@@ -0,0 +1,78 @@
+// <copyright file="registry_watcher.h" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#if !defined(_OXRSVC_REGISTRY_WATCHER_H)
+#define _OXRSVC_REGISTRY_WATCHER_H
+#pragma once
+
+
+/// <summary>
+/// Waits for values of a set of registry keys or their subkeys to be changed.
+/// </summary>
+/// <remarks>
+/// <para>A watcher observes a fixed number of targets and must provide the
+/// following methods:</para>
+/// <list type="bullet">
+/// <item><c>bool wait(std::size_t&amp; target)</c> blocks until any of the
+/// targets changed and returns its zero-based index, or returns
+/// <see langword="false" /> if the watcher has been stopped.</item>
+/// <item><c>void stop(void)</c> makes <c>wait</c> return
+/// <see langword="false" />, which may be called from any thread.</item>
+/// </list>
+/// <para>The watcher is re-armed before <c>wait</c> returns, so a change
+/// happening while the caller is reacting to the previous one is not missed.
+/// </para>
+/// <para>The <see cref="inotify_watcher" /> provides the same interface for
+/// files on Linux.</para>
+/// </remarks>
+class registry_watcher final {
+
+public:
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="keys">The keys to be watched, which must have been opened
+    /// with <c>KEY_NOTIFY</c> and must remain open as long as the watcher
+    /// exists. <see langword="NULL" /> keys are ignored.</param>
+    explicit registry_watcher(_In_ std::vector<HKEY> keys);
+
+    registry_watcher(const registry_watcher&) = delete;
+
+    /// <summary>
+    /// Makes <see cref="wait" /> return <see langword="false" />.
+    /// </summary>
+    void stop(void) noexcept;
+
+    /// <summary>
+    /// Blocks until a value or a subkey of any of the keys changed.
+    /// </summary>
+    /// <param name="key">Receives the index of the key that changed.</param>
+    /// <returns><see langword="true" /> if a key changed,
+    /// <see langword="false" /> if the watcher has been stopped.</returns>
+    bool wait(_Out_ std::size_t& key);
+
+    registry_watcher& operator =(const registry_watcher&) = delete;
+
+private:
+
+    /// <summary>
+    /// Requests a notification for the next change of the given key.
+    /// </summary>
+    /// <param name="key"></param>
+    void arm(_In_ const std::size_t key);
+
+    /// <summary>
+    /// One event per key followed by the event signalling a stop request,
+    /// which is the order <c>WaitForMultipleObjects</c> needs.
+    /// </summary>
+    std::vector<HANDLE> _handles;
+    std::vector<wil::unique_event> _events;
+    std::vector<HKEY> _keys;
+    wil::unique_event _stop;
+};
+
+#endif /* !defined(_OXRSVC_REGISTRY_WATCHER_H) */
@@ -0,0 +1,88 @@
+// <copyright file="ring_buffer.cpp" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#include "pch.h"
+#include "ring_buffer.h"
+
+
+/*
+ * ring_buffer::ring_buffer
+ */
+ring_buffer::ring_buffer(_In_ const std::size_t capacity)
+        : _head(0), _mask(0), _tail(0) {
+    if (capacity > 0) {
+        std::size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+
+        this->_data.reset(new std::uint8_t[size]);
+        this->_mask = size - 1;
+    }
+}
+
+
+/*
+ * ring_buffer::commit
+ */
+void ring_buffer::commit(_In_ const std::size_t cnt) noexcept {
+    assert(cnt <= this->available());
+    this->_tail += cnt;
+}
+
+
+/*
+ * ring_buffer::consume
+ */
+void ring_buffer::consume(_In_ const std::size_t cnt) noexcept {
+    assert(cnt <= this->size());
+    this->_head += cnt;
+
+    // Rewind if the buffer is empty, which maximises the contiguous space for
+    // the next read.
+    if (this->_head == this->_tail) {
+        this->_head = this->_tail = 0;
+    }
+}
+
+
+/*
+ * ring_buffer::contiguous
+ */
+const std::uint8_t *ring_buffer::contiguous(_In_ const std::size_t offset,
+        _In_ const std::size_t cnt) const noexcept {
+    assert(offset + cnt <= this->size());
+    const auto begin = (this->_head + offset) & this->_mask;
+    return (begin + cnt <= this->capacity())
+        ? this->_data.get() + begin
+        : nullptr;
+}
+
+
+/*
+ * ring_buffer::peek
+ */
+void ring_buffer::peek(_In_ const std::size_t offset,
+        _Out_writes_bytes_(cnt) void *dst,
+        _In_ const std::size_t cnt) const noexcept {
+    assert(offset + cnt <= this->size());
+    const auto begin = (this->_head + offset) & this->_mask;
+    const auto first = (std::min)(cnt, this->capacity() - begin);
+    auto d = static_cast<std::uint8_t *>(dst);
+
+    std::copy(this->_data.get() + begin, this->_data.get() + begin + first, d);
+    std::copy(this->_data.get(), this->_data.get() + (cnt - first), d + first);
+}
+
+
+/*
+ * ring_buffer::writable
+ */
+std::pair<std::uint8_t *, std::size_t> ring_buffer::writable(void) noexcept {
+    const auto begin = this->_tail & this->_mask;
+    const auto cnt = (std::min)(this->available(), this->capacity() - begin);
+    return std::make_pair(this->_data.get() + begin, cnt);
+}
@@ -0,0 +1,139 @@
+// <copyright file="ring_buffer.h" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#if !defined(_OXRSVC_RING_BUFFER_H)
+#define _OXRSVC_RING_BUFFER_H
+#pragma once
+
+
+/// <summary>
+/// A fixed-size byte buffer that is written at its tail and consumed from its
+/// head without ever moving the data that are still unconsumed.
+/// </summary>
+/// <remarks>
+/// All offsets passed to the accessors are relative to the head of the
+/// buffer, and the accessors take care of data that wrap around the end of
+/// the underlying storage.
+/// </remarks>
+class ring_buffer final {
+
+public:
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="capacity">The minimum capacity in bytes, which is rounded
+    /// up to the next power of two.</param>
+    explicit ring_buffer(_In_ const std::size_t capacity = 0);
+
+    /// <summary>
+    /// Answer the number of bytes that can be written before the buffer is
+    /// full.
+    /// </summary>
+    /// <returns></returns>
+    inline std::size_t available(void) const noexcept {
+        return this->capacity() - this->size();
+    }
+
+    /// <summary>
+    /// Answer the capacity of the buffer in bytes.
+    /// </summary>
+    /// <returns></returns>
+    inline std::size_t capacity(void) const noexcept {
+        return this->_data ? (this->_mask + 1) : 0;
+    }
+
+    /// <summary>
+    /// Discards all data in the buffer.
+    /// </summary>
+    inline void clear(void) noexcept {
+        this->_head = this->_tail = 0;
+    }
+
+    /// <summary>
+    /// Marks <paramref name="cnt" /> bytes written to the region returned by
+    /// <see cref="writable" /> as valid.
+    /// </summary>
+    /// <param name="cnt"></param>
+    void commit(_In_ const std::size_t cnt) noexcept;
+
+    /// <summary>
+    /// Removes <paramref name="cnt" /> bytes from the head of the buffer.
+    /// </summary>
+    /// <param name="cnt"></param>
+    void consume(_In_ const std::size_t cnt) noexcept;
+
+    /// <summary>
+    /// Gets a pointer to the given range if it does not wrap around the end
+    /// of the underlying storage.
+    /// </summary>
+    /// <param name="offset"></param>
+    /// <param name="cnt"></param>
+    /// <returns>A pointer to the data or <see langword="nullptr" /> if the
+    /// range is not contiguous.</returns>
+    const std::uint8_t *contiguous(_In_ const std::size_t offset,
+        _In_ const std::size_t cnt) const noexcept;
+
+    /// <summary>
+    /// Answer whether the buffer holds no data.
+    /// </summary>
+    /// <returns></returns>
+    inline bool empty(void) const noexcept {
+        return (this->_head == this->_tail);
+    }
+
+    /// <summary>
+    /// Copies <paramref name="cnt" /> bytes starting at
+    /// <paramref name="offset" /> to <paramref name="dst" />.
+    /// </summary>
+    /// <param name="offset"></param>
+    /// <param name="dst"></param>
+    /// <param name="cnt"></param>
+    void peek(_In_ const std::size_t offset,
+        _Out_writes_bytes_(cnt) void *dst,
+        _In_ const std::size_t cnt) const noexcept;
+
+    /// <summary>
+    /// Reads a value of type <typeparamref name="TValue" /> at
+    /// <paramref name="offset" />.
+    /// </summary>
+    /// <typeparam name="TValue">A trivially copyable type.</typeparam>
+    /// <param name="offset"></param>
+    /// <returns></returns>
+    template<class TValue>
+    inline TValue peek(_In_ const std::size_t offset) const noexcept {
+        static_assert(std::is_trivially_copyable<TValue>::value,
+            "Only trivially copyable types can be read from the buffer.");
+        TValue retval;
+        this->peek(offset, &retval, sizeof(retval));
+        return retval;
+    }
+
+    /// <summary>
+    /// Answer the number of bytes in the buffer.
+    /// </summary>
+    /// <returns></returns>
+    inline std::size_t size(void) const noexcept {
+        return this->_tail - this->_head;
+    }
+
+    /// <summary>
+    /// Gets the largest contiguous region at the tail of the buffer that can
+    /// be written to.
+    /// </summary>
+    /// <returns>The begin and the size of the region, which is empty if the
+    /// buffer is full.</returns>
+    std::pair<std::uint8_t *, std::size_t> writable(void) noexcept;
+
+private:
+
+    std::unique_ptr<std::uint8_t[]> _data;
+    std::size_t _head;
+    std::size_t _mask;
+    std::size_t _tail;
+};
+
+#endif /* !defined(_OXRSVC_RING_BUFFER_H) */
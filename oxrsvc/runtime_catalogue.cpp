@@ -0,0 +1,228 @@
+// <copyright file="runtime_catalogue.cpp" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#include "pch.h"
+#include "runtime_catalogue.h"
+
+#include "../oxrswitch/util.h"
+
+#if defined(_WIN32)
+#include "../oxrswitch/registry_transaction.h"
+#endif /* defined(_WIN32) */
+
+
+/// <summary>
+/// Answer whether <paramref name="lhs" /> and <paramref name="rhs" />
+/// designate the same file, which ignores the case on Windows.
+/// </summary>
+static bool is_same_path(_In_ const std::wstring& lhs,
+        _In_ const std::wstring& rhs) noexcept {
+#if defined(_WIN32)
+    return (::CompareStringOrdinal(lhs.c_str(),
+        static_cast<int>(lhs.size()),
+        rhs.c_str(),
+        static_cast<int>(rhs.size()),
+        TRUE) == CSTR_EQUAL);
+#else /* defined(_WIN32) */
+    return (lhs == rhs);
+#endif /* defined(_WIN32) */
+}
+
+
+/*
+ * ::rebuild_catalogue
+ */
+void rebuild_catalogue(_Inout_ std::vector<catalogue_entry>& entries,
+        _Inout_ std::uint32_t& next_id,
+        _In_ const std::vector<std::wstring>& paths,
+        _In_ const std::vector<std::wstring>& wow_paths,
+        _In_ const std::vector<std::pair<std::wstring, std::wstring>>&
+            discovered) {
+    const std::wstring no_wow;
+    std::vector<catalogue_entry> retval;
+    retval.reserve(paths.size() + discovered.size());
+
+    const auto add = [&](const std::wstring& path,
+            const std::wstring& wow_path) {
+        const auto is_path = [&path](const catalogue_entry& e) {
+            return is_same_path(e.path, path);
+        };
+
+        if (std::any_of(retval.begin(), retval.end(), is_path)) {
+            return;
+        }
+
+        // We have validated the native runtime before, but the entry is only
+        // the same if it has the same WOW64 runtime, too. A WOW64 runtime
+        // that did not exist before must be checked again, because it might
+        // have been installed in the meantime.
+        auto known = std::find_if(entries.begin(), entries.end(), is_path);
+        if ((known != entries.end())
+                && (is_same_path(known->wow_path, wow_path)
+                || (known->wow_path.empty() && !::file_exists(wow_path.c_str())))) {
+            retval.push_back(std::move(*known));
+
+        } else if (::file_exists(path.c_str())) {
+            const auto has_wow = !wow_path.empty()
+                && ::file_exists(wow_path.c_str());
+            retval.push_back({ next_id++,
+                path,
+                has_wow ? wow_path : std::wstring() });
+        }
+    };
+
+    for (auto& p : paths) {
+        auto w = std::find_if(wow_paths.begin(),
+            wow_paths.end(),
+            [&p](const std::wstring& w) { return ::is_same_directory(p, w); });
+        add(p, (w != wow_paths.end()) ? *w : no_wow);
+    }
+
+    // The registered runtimes come first, because they win if a discovered
+    // one designates the same file.
+    for (auto& d : discovered) {
+        add(d.first, d.second);
+    }
+
+    std::sort(retval.begin(), retval.end(),
+        [](const catalogue_entry& l, const catalogue_entry& r) {
+            return (l.id < r.id);
+        });
+    entries = std::move(retval);
+}
+
+
+#if defined(_WIN32)
+
+
+/*
+ * runtime_catalogue::runtime_catalogue
+ */
+runtime_catalogue::runtime_catalogue(_In_ const HKEY key,
+        _In_opt_ const HKEY wow_key,
+        _In_z_ const wchar_t *value)
+        : _keys({ key, wow_key }),
+        _next_id(catalogue_entry::invalid_id + 1),
+        _value(value) {
+    assert(key != NULL);
+    assert(value != nullptr);
+    for (std::size_t i = 0; i < this->_keys.size(); ++i) {
+        this->refresh(i);
+    }
+}
+
+
+/*
+ * runtime_catalogue::entries
+ */
+std::vector<catalogue_entry> runtime_catalogue::entries(void) const {
+    std::lock_guard<std::mutex> l(this->_lock);
+    return this->_entries;
+}
+
+
+/*
+ * runtime_catalogue::find
+ */
+_Success_(return) bool runtime_catalogue::find(_In_ const std::uint32_t id,
+        _Out_ catalogue_entry& entry) const {
+    std::lock_guard<std::mutex> l(this->_lock);
+
+    // The entries are sorted by their identifiers, because new ones are
+    // always appended with the next identifier.
+    auto it = std::lower_bound(this->_entries.begin(),
+        this->_entries.end(),
+        id,
+        [](const catalogue_entry& e, const std::uint32_t i) {
+            return (e.id < i);
+        });
+    if ((it == this->_entries.end()) || (it->id != id)) {
+        return false;
+    }
+
+    entry = *it;
+    return true;
+}
+
+
+/*
+ * runtime_catalogue::refresh
+ */
+void runtime_catalogue::refresh(_In_ const std::size_t key) {
+    std::vector<std::wstring> paths;
+    get_available_runtimes(this->_keys.at(key), this->_value, paths);
+
+    // Windows Mixed Reality does not register itself as available.
+    {
+        std::array<wchar_t, MAX_PATH> dir;
+        const auto cnt = ::GetSystemWindowsDirectoryW(dir.data(),
+            static_cast<UINT>(dir.size()));
+        if ((cnt > 0) && (cnt < dir.size())) {
+            std::wstring d(dir.data(), cnt);
+            paths.push_back(d + ((key == 0)
+                ? L"\\System32\\MixedRealityRuntime.json"
+                : L"\\SysWOW64\\MixedRealityRuntime.json"));
+        }
+    }
+
+    // The other key has not changed, so we reuse what we have read before.
+    std::lock_guard<std::mutex> l(this->_lock);
+    this->_registered[key] = std::move(paths);
+    this->rebuild();
+}
+
+
+/*
+ * runtime_catalogue::update_discovered
+ */
+void runtime_catalogue::update_discovered(
+        _Inout_ std::vector<std::pair<std::wstring, std::wstring>>&& runtimes) {
+    std::lock_guard<std::mutex> l(this->_lock);
+    this->_discovered = std::move(runtimes);
+    this->rebuild();
+}
+
+
+/*
+ * runtime_catalogue::get_available_runtimes
+ */
+void runtime_catalogue::get_available_runtimes(_In_opt_ const HKEY key,
+        _In_z_ const wchar_t *value,
+        _Inout_ std::vector<std::wstring>& paths) {
+    if (key == NULL) {
+        return;
+    }
+
+    // The active runtime might not be registered as available.
+    auto active = registry_transaction::get_value(key, value);
+    if (!active.empty()) {
+        paths.push_back(std::move(active));
+    }
+
+    try {
+        auto k = wil::reg::open_unique_key(key, L"AvailableRuntimes");
+        std::transform(wil::reg::value_iterator(k.get()),
+            wil::reg::value_iterator(),
+            std::back_inserter(paths),
+            [](const decltype(*wil::reg::value_iterator())& d) {
+                return d.name;
+            });
+    } catch (...) { /* The "AvailableRuntimes" subkey might be inexistent. */ }
+}
+
+
+/*
+ * runtime_catalogue::rebuild
+ */
+void runtime_catalogue::rebuild(void) {
+    ::rebuild_catalogue(this->_entries,
+        this->_next_id,
+        this->_registered[0],
+        this->_registered[1],
+        this->_discovered);
+}
+
+#endif /* defined(_WIN32) */
@@ -0,0 +1,171 @@
+// <copyright file="runtime_catalogue.h" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#if !defined(_OXRSVC_RUNTIME_CATALOGUE_H)
+#define _OXRSVC_RUNTIME_CATALOGUE_H
+#pragma once
+
+
+/// <summary>
+/// A runtime in the <see cref="runtime_catalogue" />.
+/// </summary>
+struct catalogue_entry final {
+
+    /// <summary>
+    /// The identifier that is never assigned to a runtime.
+    /// </summary>
+    static constexpr std::uint32_t invalid_id = 0;
+
+    /// <summary>
+    /// The identifier of the runtime, which does not change as long as the
+    /// service is running and the runtime remains installed.
+    /// </summary>
+    std::uint32_t id;
+
+    /// <summary>
+    /// The path to the JSON file of the native runtime.
+    /// </summary>
+    std::wstring path;
+
+    /// <summary>
+    /// The path to the JSON file of the WOW64 runtime, which is empty if
+    /// there is none.
+    /// </summary>
+    std::wstring wow_path;
+};
+
+
+/// <summary>
+/// Merges the registered and the discovered runtimes into the entries of a
+/// <see cref="runtime_catalogue" />.
+/// </summary>
+/// <remarks>
+/// <para>A previous entry is only reused if both of its paths are the same,
+/// such that its identifier never designates another pair of runtimes. All
+/// other runtimes are validated and receive a new identifier, whereas
+/// runtimes that have disappeared are removed and their identifiers are not
+/// reused.</para>
+/// <para>The registered runtimes win if a discovered one designates the same
+/// file.</para>
+/// </remarks>
+/// <param name="entries">The previous entries, which are replaced by the
+/// merged ones in the order of their identifiers.</param>
+/// <param name="next_id">The identifier of the next new runtime, which is
+/// updated.</param>
+/// <param name="paths">The paths of the registered native runtimes.</param>
+/// <param name="wow_paths">The paths of the registered WOW64 runtimes, which
+/// are paired with the native runtimes in the same directory.</param>
+/// <param name="discovered">The paths of the native runtimes found in the
+/// installation folders and of their WOW64 counterparts, which are empty if
+/// there is none.</param>
+void rebuild_catalogue(_Inout_ std::vector<catalogue_entry>& entries,
+    _Inout_ std::uint32_t& next_id,
+    _In_ const std::vector<std::wstring>& paths,
+    _In_ const std::vector<std::wstring>& wow_paths,
+    _In_ const std::vector<std::pair<std::wstring, std::wstring>>& discovered);
+
+
+#if defined(_WIN32)
+/// <summary>
+/// Maintains the list of runtimes the service can activate.
+/// </summary>
+/// <remarks>
+/// <para>The catalogue comprises the runtimes registered as available with
+/// the OpenXR loader, Windows Mixed Reality, which is not registered, the
+/// active runtime and the runtimes found in the installation folders. All
+/// paths are validated once when they are added, so clients can activate a
+/// runtime by its identifier without the service checking the files again.
+/// </para>
+/// <para>The catalogue is thread-safe.</para>
+/// </remarks>
+class runtime_catalogue final {
+
+public:
+
+    /// <summary>
+    /// Initialises a new instance and fills the catalogue.
+    /// </summary>
+    /// <param name="key">The OpenXR key of the native runtimes, which must
+    /// remain open as long as the instance exists.</param>
+    /// <param name="wow_key">The OpenXR key of the WOW64 runtimes, which may
+    /// be <see langword="NULL" />.</param>
+    /// <param name="value">The name of the value holding the active runtime.
+    /// </param>
+    runtime_catalogue(_In_ const HKEY key,
+        _In_opt_ const HKEY wow_key,
+        _In_z_ const wchar_t *value);
+
+    runtime_catalogue(const runtime_catalogue&) = delete;
+
+    /// <summary>
+    /// Gets a copy of all runtimes in the order of their identifiers.
+    /// </summary>
+    /// <returns></returns>
+    std::vector<catalogue_entry> entries(void) const;
+
+    /// <summary>
+    /// Finds the runtime with the given identifier.
+    /// </summary>
+    /// <param name="id"></param>
+    /// <param name="entry">Receives the runtime if it was found.</param>
+    /// <returns><see langword="true" /> if the runtime was found,
+    /// <see langword="false" /> otherwise.</returns>
+    _Success_(return) bool find(_In_ const std::uint32_t id,
+        _Out_ catalogue_entry& entry) const;
+
+    /// <summary>
+    /// Updates the catalogue from the given key in the registry.
+    /// </summary>
+    /// <remarks>
+    /// Runtimes that are already known keep their identifier and are not
+    /// validated again. Runtimes that have disappeared are removed, and their
+    /// identifiers are not reused.
+    /// </remarks>
+    /// <param name="key">The index of the key that has changed, which is zero
+    /// for the native and one for the WOW64 key.</param>
+    void refresh(_In_ const std::size_t key);
+
+    /// <summary>
+    /// Replaces the runtimes found in the installation folders.
+    /// </summary>
+    /// <remarks>
+    /// Identifiers are preserved like in <see cref="refresh" />.
+    /// </remarks>
+    /// <param name="runtimes">The paths of the native runtimes and of their
+    /// WOW64 counterparts, which are empty if there is none.</param>
+    void update_discovered(
+        _Inout_ std::vector<std::pair<std::wstring, std::wstring>>&& runtimes);
+
+    runtime_catalogue& operator =(const runtime_catalogue&) = delete;
+
+private:
+
+    /// <summary>
+    /// Adds the runtimes registered under the given key to
+    /// <paramref name="paths" />.
+    /// </summary>
+    static void get_available_runtimes(_In_opt_ const HKEY key,
+        _In_z_ const wchar_t *value,
+        _Inout_ std::vector<std::wstring>& paths);
+
+    /// <summary>
+    /// Merges the registered and the discovered runtimes into the entries of
+    /// the catalogue using <see cref="rebuild_catalogue" />, which requires
+    /// the caller to hold the lock.
+    /// </summary>
+    void rebuild(void);
+
+    std::vector<std::pair<std::wstring, std::wstring>> _discovered;
+    std::vector<catalogue_entry> _entries;
+    std::array<HKEY, 2> _keys;
+    mutable std::mutex _lock;
+    std::uint32_t _next_id;
+    std::array<std::vector<std::wstring>, 2> _registered;
+    const wchar_t *_value;
+};
+#endif /* defined(_WIN32) */
+
+#endif /* !defined(_OXRSVC_RUNTIME_CATALOGUE_H) */
@@ -0,0 +1,131 @@
+// <copyright file="runtime_pin.h" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#if !defined(_OXRSVC_RUNTIME_PIN_H)
+#define _OXRSVC_RUNTIME_PIN_H
+#pragma once
+
+
+/// <summary>
+/// Keeps the active runtime at a chosen value by restoring it whenever
+/// another program changes it.
+/// </summary>
+/// <remarks>
+/// Vendor tools like SteamVR or the Oculus app make themselves the active
+/// runtime when they start. While a runtime is pinned, a background thread
+/// watches the native and the WOW64 location and writes the pinned value back
+/// as soon as the watcher reports a change.
+/// </remarks>
+/// <typeparam name="TWatcher">The watcher reporting changes of the keys, which
+/// must provide the interface described for <see cref="registry_watcher" />
+/// and must be constructible from a <c>std::vector</c> of keys. This is the
+/// <see cref="registry_watcher" /> on Windows and the
+/// <see cref="inotify_watcher" /> on Linux.</typeparam>
+/// <typeparam name="TStore">The type reading and writing the active runtime,
+/// which must define the <c>key_type</c> and the <c>value_type</c>, and
+/// provide two methods: <c>value_type read(key_type key)</c> returns the
+/// active runtime stored at <c>key</c>, which is empty if there is none.
+/// <c>void write(const std::array&lt;key_type, 2&gt;&amp; keys,
+/// const std::array&lt;value_type, 2&gt;&amp; values)</c> stores both values at
+/// once, removing the empty ones. This is the <see cref="registry_store" /> on
+/// Windows and the <see cref="file_store" /> on Linux.</typeparam>
+template<class TWatcher, class TStore> class runtime_pin final {
+
+public:
+
+    /// <summary>
+    /// The callback that is invoked on the watcher thread whenever the
+    /// active runtime may have changed, which must not throw.
+    /// </summary>
+    /// <remarks>
+    /// The callback receives the index of the key that has changed, which is
+    /// zero for the native and one for the WOW64 key.
+    /// </remarks>
+    typedef std::function<void(const std::size_t)> changed_callback;
+
+    /// <summary>
+    /// The type identifying where an active runtime is stored.
+    /// </summary>
+    typedef typename TStore::key_type key_type;
+
+    /// <summary>
+    /// The type of the active runtime.
+    /// </summary>
+    typedef typename TStore::value_type value_type;
+
+    /// <summary>
+    /// Initialises a new instance and starts watching the keys.
+    /// </summary>
+    /// <param name="keys">The location of the native runtime, which must
+    /// remain valid as long as the instance exists, followed by the one of
+    /// the WOW64 runtime, which may be empty.</param>
+    /// <param name="store">The store reading and writing the keys.</param>
+    /// <param name="on_changed">An optional callback that is invoked after
+    /// any change of the keys has been handled.</param>
+    runtime_pin(_In_ const std::array<key_type, 2>& keys,
+        _In_ TStore store,
+        _In_ changed_callback on_changed = nullptr);
+
+    runtime_pin(const runtime_pin&) = delete;
+
+    /// <summary>
+    /// Finalises the instance.
+    /// </summary>
+    ~runtime_pin(void);
+
+    /// <summary>
+    /// Pins the given runtimes, which must have been made the active ones
+    /// before.
+    /// </summary>
+    /// <param name="runtime">The native runtime.</param>
+    /// <param name="wow_runtime">The WOW64 runtime or an empty value if the
+    /// WOW64 runtime should be absent.</param>
+    void pin(_In_ const value_type& runtime,
+        _In_ const value_type& wow_runtime);
+
+    /// <summary>
+    /// Answer whether a runtime is pinned.
+    /// </summary>
+    /// <returns></returns>
+    bool pinned(void) const;
+
+    /// <summary>
+    /// Stops restoring the active runtime.
+    /// </summary>
+    /// <remarks>
+    /// Once the method returns, the pin will not write to the store anymore,
+    /// so the caller can safely change the active runtime.
+    /// </remarks>
+    void unpin(void);
+
+    runtime_pin& operator =(const runtime_pin&) = delete;
+
+private:
+
+    /// <summary>
+    /// Restores the pinned values of both keys at once if any of them has
+    /// been changed.
+    /// </summary>
+    void restore(void);
+
+    /// <summary>
+    /// Restores the keys whenever they change until the watcher is stopped.
+    /// </summary>
+    void run(void) noexcept;
+
+    std::array<key_type, 2> _keys;
+    mutable std::mutex _lock;
+    changed_callback _on_changed;
+    bool _pinned;
+    std::array<value_type, 2> _runtimes;
+    TStore _store;
+    std::thread _thread;
+    TWatcher _watcher;
+};
+
+#include "runtime_pin.inl"
+
+#endif /* !defined(_OXRSVC_RUNTIME_PIN_H) */
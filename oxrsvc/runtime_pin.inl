@@ -0,0 +1,148 @@
+// <copyright file="runtime_pin.inl" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+
+/*
+ * runtime_pin<TWatcher, TStore>::runtime_pin
+ */
+template<class TWatcher, class TStore>
+runtime_pin<TWatcher, TStore>::runtime_pin(
+        _In_ const std::array<key_type, 2>& keys,
+        _In_ TStore store,
+        _In_ changed_callback on_changed)
+    : _keys(keys),
+        _on_changed(std::move(on_changed)),
+        _pinned(false),
+        _store(std::move(store)),
+        _watcher(std::vector<key_type>(keys.begin(), keys.end())) {
+    this->_thread = std::thread(&runtime_pin::run, this);
+}
+
+
+/*
+ * runtime_pin<TWatcher, TStore>::~runtime_pin
+ */
+template<class TWatcher, class TStore>
+runtime_pin<TWatcher, TStore>::~runtime_pin(void) {
+    this->_watcher.stop();
+    if (this->_thread.joinable()) {
+        this->_thread.join();
+    }
+}
+
+
+/*
+ * runtime_pin<TWatcher, TStore>::pin
+ */
+template<class TWatcher, class TStore>
+void runtime_pin<TWatcher, TStore>::pin(_In_ const value_type& runtime,
+        _In_ const value_type& wow_runtime) {
+    {
+        std::lock_guard<std::mutex> l(this->_lock);
+        this->_runtimes[0] = runtime;
+        this->_runtimes[1] = wow_runtime;
+        this->_pinned = true;
+    }
+
+    // Someone might have been faster than us between activating the runtime
+    // and pinning it, in which case the notification has already been
+    // ignored.
+    this->restore();
+}
+
+
+/*
+ * runtime_pin<TWatcher, TStore>::pinned
+ */
+template<class TWatcher, class TStore>
+bool runtime_pin<TWatcher, TStore>::pinned(void) const {
+    std::lock_guard<std::mutex> l(this->_lock);
+    return this->_pinned;
+}
+
+
+/*
+ * runtime_pin<TWatcher, TStore>::unpin
+ */
+template<class TWatcher, class TStore>
+void runtime_pin<TWatcher, TStore>::unpin(void) {
+    std::lock_guard<std::mutex> l(this->_lock);
+    this->_pinned = false;
+}
+
+
+/*
+ * runtime_pin<TWatcher, TStore>::restore
+ */
+template<class TWatcher, class TStore>
+void runtime_pin<TWatcher, TStore>::restore(void) {
+    const auto begin = std::chrono::steady_clock::now();
+
+    // Hold the lock while writing, such that 'unpin' cannot return while we
+    // are about to overwrite a change the switcher is going to make.
+    std::lock_guard<std::mutex> l(this->_lock);
+    if (!this->_pinned) {
+        return;
+    }
+
+    std::array<value_type, 2> actual;
+    for (std::size_t i = 0; i < this->_keys.size(); ++i) {
+        actual[i] = this->_store.read(this->_keys[i]);
+    }
+
+    // Our own write triggers another notification, which ends here.
+    if (actual == this->_runtimes) {
+        return;
+    }
+
+    // Another program might have changed only one of the values, but we
+    // restore both of them at once, such that a 32-bit application never
+    // sees the pinned native runtime along with a foreign WOW64 one.
+    this->_store.write(this->_keys, this->_runtimes);
+
+#if defined(_WIN32)
+    const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - begin);
+    std::wostringstream msg;
+    msg << L"Restored the pinned runtimes after " << latency.count()
+        << L" us.\r\n";
+    ::OutputDebugStringW(msg.str().c_str());
+#else /* defined(_WIN32) */
+    (void) begin;
+#endif /* defined(_WIN32) */
+}
+
+
+/*
+ * runtime_pin<TWatcher, TStore>::run
+ */
+template<class TWatcher, class TStore>
+void runtime_pin<TWatcher, TStore>::run(void) noexcept {
+    try {
+        std::size_t key;
+        while (this->_watcher.wait(key)) {
+            try {
+                this->restore();
+            } catch (const std::exception& ex) {
+                // If we cannot restore the value, we let the other program
+                // win this time, but keep watching.
+#if defined(_WIN32)
+                ::OutputDebugStringA(ex.what());
+#else /* defined(_WIN32) */
+                (void) ex;
+#endif /* defined(_WIN32) */
+            }
+
+            if (this->_on_changed) {
+                this->_on_changed(key);
+            }
+        }
+    } catch (...) {
+#if defined(_WIN32)
+        ::OutputDebugString(_T("Watching the active runtime failed.\r\n"));
+#endif /* defined(_WIN32) */
+    }
+}
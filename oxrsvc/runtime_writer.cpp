@@ -0,0 +1,147 @@
+// <copyright file="runtime_writer.cpp" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#include "pch.h"
+#include "runtime_writer.h"
+
+#include "../oxrswitch/registry_transaction.h"
+
+
+/*
+ * runtime_writer::runtime_writer
+ */
+runtime_writer::runtime_writer(_In_ const HKEY key,
+        _In_opt_ const HKEY wow_key,
+        _In_z_ const wchar_t *value,
+        _In_ const clock_type::duration window,
+        _In_ written_callback on_written)
+    : _keys({ key, wow_key }),
+        _last(clock_type::now() - window),
+        _on_written(std::move(on_written)),
+        _pending(false),
+        _performed(0),
+        _requested(0),
+        _running(true),
+        _value(value),
+        _window(window) {
+    assert(key != NULL);
+    assert(value != nullptr);
+    this->_thread = std::thread(&runtime_writer::run, this);
+}
+
+
+/*
+ * runtime_writer::~runtime_writer
+ */
+runtime_writer::~runtime_writer(void) {
+    {
+        std::lock_guard<std::mutex> l(this->_lock);
+        this->_running = false;
+    }
+
+    this->_signal.notify_one();
+    if (this->_thread.joinable()) {
+        this->_thread.join();
+    }
+}
+
+
+/*
+ * runtime_writer::write
+ */
+bool runtime_writer::write(_In_ const std::wstring& runtime,
+        _In_ const std::wstring& wow_runtime) {
+    this->_requested.fetch_add(1, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> l(this->_lock);
+    const auto now = clock_type::now();
+
+    if (!this->_pending && (now - this->_last >= this->_window)) {
+        // Nothing has been written recently, so there is no burst to be
+        // coalesced. Writing on the caller's thread allows us to report
+        // errors to the client.
+        this->_last = now;
+        this->apply({ runtime, wow_runtime });
+        return true;
+    }
+
+    // A deferred request that has not been written yet is simply replaced,
+    // as only the last one matters.
+    this->_runtimes[0] = runtime;
+    this->_runtimes[1] = wow_runtime;
+    this->_pending = true;
+    this->_signal.notify_one();
+    return false;
+}
+
+
+/*
+ * runtime_writer::apply
+ */
+bool runtime_writer::apply(_In_ const std::array<std::wstring, 2>& runtimes) {
+    auto retval = false;
+
+    // A 32-bit application starting while we are switching must not see the
+    // new native runtime along with the old WOW64 one. If anything fails, the
+    // transaction is rolled back and neither value is changed.
+    registry_transaction transaction;
+
+    for (std::size_t i = 0; i < this->_keys.size(); ++i) {
+        auto key = transaction.open(this->_keys[i]);
+        if (registry_transaction::update_value(key.get(), this->_value,
+                runtimes[i])) {
+            retval = true;
+        }
+    }
+
+    if (retval) {
+        transaction.commit();
+        this->_performed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return retval;
+}
+
+
+/*
+ * runtime_writer::run
+ */
+void runtime_writer::run(void) noexcept {
+    std::unique_lock<std::mutex> l(this->_lock);
+
+    while (this->_running || this->_pending) {
+        if (!this->_pending) {
+            this->_signal.wait(l);
+            continue;
+        }
+
+        // If we are being destroyed, we do not wait for the window to
+        // elapse, but the request must not be lost.
+        const auto due = this->_last + this->_window;
+        if (this->_running && (clock_type::now() < due)) {
+            this->_signal.wait_until(l, due);
+            continue;
+        }
+
+        this->_last = clock_type::now();
+        this->_pending = false;
+
+        auto changed = false;
+        try {
+            changed = this->apply(this->_runtimes);
+        } catch (wil::ResultException ex) {
+            // The client has already been told that the request succeeded,
+            // so all we can do is logging the problem.
+            ::OutputDebugStringA(ex.what());
+        }
+
+        if (changed && this->_on_written) {
+            l.unlock();
+            this->_on_written();
+            l.lock();
+        }
+    }
+}
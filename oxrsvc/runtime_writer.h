@@ -0,0 +1,129 @@
+// <copyright file="runtime_writer.h" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#if !defined(_OXRSVC_RUNTIME_WRITER_H)
+#define _OXRSVC_RUNTIME_WRITER_H
+#pragma once
+
+
+/// <summary>
+/// Writes the active runtime to the registry, skipping writes that would not
+/// change anything and coalescing bursts of requests.
+/// </summary>
+/// <remarks>
+/// <para>Every write of the active runtime wakes all vendor software watching
+/// the OpenXR keys. A request arriving after a quiet period is written
+/// immediately. Requests arriving within the window after a write are held
+/// back and only the last of them is written once the window has elapsed, so
+/// there is at most one write per window.</para>
+/// <para>The writer is thread-safe.</para>
+/// </remarks>
+class runtime_writer final {
+
+public:
+
+    /// <summary>
+    /// The clock used to measure the window.
+    /// </summary>
+    typedef std::chrono::steady_clock clock_type;
+
+    /// <summary>
+    /// The callback that is invoked on the writer thread after a deferred
+    /// write has changed the registry, which must not throw.
+    /// </summary>
+    typedef std::function<void(void)> written_callback;
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="key">The OpenXR key of the native runtime, which must
+    /// remain open as long as the instance exists.</param>
+    /// <param name="wow_key">The OpenXR key of the WOW64 runtime, which may be
+    /// <see langword="NULL" />.</param>
+    /// <param name="value">The name of the value holding the active runtime.
+    /// </param>
+    /// <param name="window">The minimum time between two writes.</param>
+    /// <param name="on_written">An optional callback that is invoked after a
+    /// deferred write.</param>
+    runtime_writer(_In_ const HKEY key,
+        _In_opt_ const HKEY wow_key,
+        _In_z_ const wchar_t *value,
+        _In_ const clock_type::duration window,
+        _In_ written_callback on_written = nullptr);
+
+    runtime_writer(const runtime_writer&) = delete;
+
+    /// <summary>
+    /// Finalises the instance.
+    /// </summary>
+    /// <remarks>
+    /// A write that is still being held back is performed before the
+    /// destructor returns.
+    /// </remarks>
+    ~runtime_writer(void);
+
+    /// <summary>
+    /// Answer the number of requests that have changed the registry.
+    /// </summary>
+    /// <returns></returns>
+    inline std::uint64_t performed(void) const noexcept {
+        return this->_performed.load(std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// Answer the number of requests passed to <see cref="write" />.
+    /// </summary>
+    /// <returns></returns>
+    inline std::uint64_t requested(void) const noexcept {
+        return this->_requested.load(std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// Requests the given runtimes to become the active ones.
+    /// </summary>
+    /// <param name="runtime">The path of the native runtime.</param>
+    /// <param name="wow_runtime">The path of the WOW64 runtime or an empty
+    /// string if the WOW64 value should be removed.</param>
+    /// <returns><see langword="true" /> if the request has been handled
+    /// immediately, <see langword="false" /> if it has been deferred.
+    /// </returns>
+    bool write(_In_ const std::wstring& runtime,
+        _In_ const std::wstring& wow_runtime);
+
+    runtime_writer& operator =(const runtime_writer&) = delete;
+
+private:
+
+    /// <summary>
+    /// Writes the given runtimes in a single transaction unless they are
+    /// already active.
+    /// </summary>
+    /// <param name="runtimes">The native and the WOW64 runtime.</param>
+    /// <returns><see langword="true" /> if the registry has been changed.
+    /// </returns>
+    bool apply(_In_ const std::array<std::wstring, 2>& runtimes);
+
+    /// <summary>
+    /// Performs deferred writes until the writer is destroyed.
+    /// </summary>
+    void run(void) noexcept;
+
+    std::array<HKEY, 2> _keys;
+    clock_type::time_point _last;
+    std::mutex _lock;
+    written_callback _on_written;
+    bool _pending;
+    std::atomic<std::uint64_t> _performed;
+    std::atomic<std::uint64_t> _requested;
+    bool _running;
+    std::array<std::wstring, 2> _runtimes;
+    std::condition_variable _signal;
+    std::thread _thread;
+    const wchar_t *_value;
+    clock_type::duration _window;
+};
+
+#endif /* !defined(_OXRSVC_RUNTIME_WRITER_H) */
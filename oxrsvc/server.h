@@ -0,0 +1,179 @@
+// <copyright file="server.h" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#if !defined(_OXRSVC_SERVER_H)
+#define _OXRSVC_SERVER_H
+#pragma once
+
+#include "ring_buffer.h"
+#include "server_statistics.h"
+#include "transport.h"
+
+
+/// <summary>
+/// Implements an event loop that serves multiple clients concurrently on a
+/// single thread.
+/// </summary>
+/// <remarks>
+/// <para>The server keeps all instances of the transport listening, reads
+/// requests from every connected client as the data arrive and writes the
+/// responses without ever blocking on a single client. A client that is slow
+/// or stuck therefore only occupies its own instance.</para>
+/// <para>Clients can subscribe to notifications, which the server sends
+/// whenever the transport has been notified. If a subscriber has not yet
+/// received the previous notification, the new one replaces it, so a burst of
+/// notifications results in a single message with the latest state.</para>
+/// </remarks>
+/// <typeparam name="TTransport">The transport, which must provide the methods
+/// described for <see cref="transport_completion" />.</typeparam>
+/// <typeparam name="THandler">The type processing the requests, which must
+/// provide two methods: <c>std::size_t process(const ring_buffer&amp; input,
+/// std::size_t&amp; scanned, std::vector&lt;std::uint8_t&gt;&amp; output,
+/// bool&amp; subscribe)</c> appends the response to the request at the head
+/// of <c>input</c> to <c>output</c> and returns the size of the request,
+/// which is zero if the request is not yet complete. <c>scanned</c> is kept
+/// per connection and allows the handler to remember how far it has searched
+/// an incomplete request. It sets <c>subscribe</c> if the client
+/// subscribed to notifications. If the method throws, the client is
+/// disconnected. <c>void notify(std::vector&lt;std::uint8_t&gt;&amp; output)
+/// </c> appends a notification to <c>output</c>.</typeparam>
+template<class TTransport, class THandler> class server final {
+
+public:
+
+    /// <summary>
+    /// The default size of the largest request the server accepts.
+    /// </summary>
+    static constexpr std::size_t default_max_request = 64 * 1024;
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="transport">The transport, which must live as long as the
+    /// server.</param>
+    /// <param name="handler">The functor processing requests.</param>
+    /// <param name="max_request">The size of the largest request in bytes,
+    /// which is the size of the receive buffer of each client. Clients sending
+    /// larger requests are disconnected.</param>
+    server(_In_ TTransport& transport,
+        _In_ THandler handler,
+        _In_ const std::size_t max_request = default_max_request);
+
+    server(const server&) = delete;
+
+    /// <summary>
+    /// Runs the event loop until the transport is stopped.
+    /// </summary>
+    void operator ()(void);
+
+    server& operator =(const server&) = delete;
+
+    /// <summary>
+    /// Answer the statistics of the requests processed so far.
+    /// </summary>
+    /// <remarks>
+    /// The statistics must not be accessed while the event loop is running
+    /// on another thread.
+    /// </remarks>
+    /// <returns></returns>
+    inline const server_statistics& statistics(void) const noexcept {
+        return this->_statistics;
+    }
+
+private:
+
+    /// <summary>
+    /// The clock used to measure the round-trip times.
+    /// </summary>
+    typedef server_statistics::clock_type clock_type;
+
+    /// <summary>
+    /// The state of the connection on a single instance of the transport.
+    /// </summary>
+    struct connection final {
+        bool closing;
+        std::size_t cnt_sent;
+        bool draining;
+        ring_buffer input;
+        bool notifying;
+        std::vector<std::uint8_t> output;
+        std::vector<clock_type::time_point> output_times;
+        bool reading;
+        std::size_t scanned;
+        std::vector<std::uint8_t> sending;
+        std::vector<clock_type::time_point> sending_times;
+        bool subscribed;
+        bool writing;
+    };
+
+    /// <summary>
+    /// Starts accepting a new client on <paramref name="instance" />.
+    /// </summary>
+    /// <param name="instance"></param>
+    void accept(_In_ const std::size_t instance);
+
+    /// <summary>
+    /// Closes the connection on <paramref name="instance" /> once all of its
+    /// pending operations have completed and starts accepting a new client.
+    /// </summary>
+    /// <param name="instance"></param>
+    void close(_In_ const std::size_t instance);
+
+    /// <summary>
+    /// Marks all subscribers as waiting for a notification and starts
+    /// sending it to the ones that are not busy.
+    /// </summary>
+    void notify(void);
+
+    /// <summary>
+    /// Processes the completion of an operation.
+    /// </summary>
+    /// <param name="completion"></param>
+    void on_completed(_In_ const transport_completion& completion);
+
+    /// <summary>
+    /// Continues with <paramref name="instance" /> after a read or write
+    /// completed, which either starts the next read or closes a connection
+    /// that is draining once its output has been written.
+    /// </summary>
+    /// <param name="instance"></param>
+    void proceed(_In_ const std::size_t instance);
+
+    /// <summary>
+    /// Processes all complete requests in the input buffer of
+    /// <paramref name="instance" />, which have been received at
+    /// <paramref name="received" />.
+    /// </summary>
+    /// <param name="instance"></param>
+    /// <param name="received"></param>
+    void process(_In_ const std::size_t instance,
+        _In_ const clock_type::time_point received);
+
+    /// <summary>
+    /// Starts reading on <paramref name="instance" /> unless a read is already
+    /// pending.
+    /// </summary>
+    /// <param name="instance"></param>
+    void read(_In_ const std::size_t instance);
+
+    /// <summary>
+    /// Starts writing the queued output of <paramref name="instance" /> unless
+    /// a write is already pending. A pending notification is created at this
+    /// point, such that it reflects the latest state.
+    /// </summary>
+    /// <param name="instance"></param>
+    void write(_In_ const std::size_t instance);
+
+    std::vector<connection> _connections;
+    THandler _handler;
+    std::size_t _max_request;
+    server_statistics _statistics;
+    TTransport& _transport;
+};
+
+#include "server.inl"
+
+#endif /* !defined(_OXRSVC_SERVER_H) */
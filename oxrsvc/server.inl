@@ -0,0 +1,294 @@
+// <copyright file="server.inl" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+
+/*
+ * server<TTransport, THandler>::server
+ */
+template<class TTransport, class THandler>
+server<TTransport, THandler>::server(_In_ TTransport& transport,
+        _In_ THandler handler,
+        _In_ const std::size_t max_request)
+    : _connections(transport.instances()),
+        _handler(std::move(handler)),
+        _max_request(max_request),
+        _transport(transport) { }
+
+
+/*
+ * server<TTransport, THandler>::operator ()
+ */
+template<class TTransport, class THandler>
+void server<TTransport, THandler>::operator ()(void) {
+    for (std::size_t i = 0; i < this->_connections.size(); ++i) {
+        this->accept(i);
+    }
+
+    this->_statistics.start();
+
+    transport_completion completion;
+    while (this->_transport.wait(completion)) {
+        this->on_completed(completion);
+    }
+
+    this->_statistics.stop();
+}
+
+
+/*
+ * server<TTransport, THandler>::accept
+ */
+template<class TTransport, class THandler>
+void server<TTransport, THandler>::accept(_In_ const std::size_t instance) {
+    auto& c = this->_connections[instance];
+    c.closing = false;
+    c.cnt_sent = 0;
+    c.draining = false;
+    c.notifying = false;
+    if (c.input.capacity() < this->_max_request) {
+        c.input = ring_buffer(this->_max_request);
+    } else {
+        c.input.clear();
+    }
+    c.output.clear();
+    c.output_times.clear();
+    c.scanned = 0;
+    c.sending.clear();
+    c.sending_times.clear();
+    c.subscribed = false;
+    c.writing = false;
+
+    // While waiting for the client, the instance is treated as reading, which
+    // prevents it from being recycled twice if the accept fails.
+    c.reading = true;
+    this->_transport.accept(instance);
+}
+
+
+/*
+ * server<TTransport, THandler>::close
+ */
+template<class TTransport, class THandler>
+void server<TTransport, THandler>::close(_In_ const std::size_t instance) {
+    auto& c = this->_connections[instance];
+
+    if (c.reading || c.writing) {
+        // Abort the pending operations. We will be called again once they
+        // have completed.
+        if (!c.closing) {
+            c.closing = true;
+            this->_transport.cancel(instance);
+        }
+
+    } else {
+        this->_transport.disconnect(instance);
+        this->accept(instance);
+    }
+}
+
+
+/*
+ * server<TTransport, THandler>::notify
+ */
+template<class TTransport, class THandler>
+void server<TTransport, THandler>::notify(void) {
+    for (std::size_t i = 0; i < this->_connections.size(); ++i) {
+        auto& c = this->_connections[i];
+        if (c.subscribed && !c.closing && !c.draining) {
+            c.notifying = true;
+            this->write(i);
+        }
+    }
+}
+
+
+/*
+ * server<TTransport, THandler>::on_completed
+ */
+template<class TTransport, class THandler>
+void server<TTransport, THandler>::on_completed(
+        _In_ const transport_completion& completion) {
+    const auto i = completion.instance;
+    auto& c = this->_connections[i];
+
+    switch (completion.operation) {
+        case transport_operation::notify:
+            this->notify();
+            break;
+
+        case transport_operation::accept:
+            c.reading = false;
+            if ((completion.error != 0) || c.closing) {
+                this->close(i);
+            } else {
+                this->read(i);
+            }
+            break;
+
+        case transport_operation::read:
+            c.reading = false;
+            if ((completion.error != 0) || (completion.cnt == 0)
+                    || c.closing) {
+                // Zero bytes indicate that the client closed the connection.
+                this->close(i);
+            } else {
+                c.input.commit(completion.cnt);
+                try {
+                    this->process(i, clock_type::now());
+                } catch (...) {
+                    // The client sent something we do not understand, so we
+                    // give up on it after sending what we have so far.
+                    this->_statistics.failed();
+                    c.draining = true;
+                }
+                this->write(i);
+                this->proceed(i);
+            }
+            break;
+
+        case transport_operation::write:
+            c.writing = false;
+            if ((completion.error != 0) || c.closing) {
+                this->close(i);
+
+            } else {
+                c.cnt_sent += completion.cnt;
+                if (c.cnt_sent < c.sending.size()) {
+                    // Continue with the rest of the data.
+                    c.writing = true;
+                    this->_transport.write(i,
+                        c.sending.data() + c.cnt_sent,
+                        c.sending.size() - c.cnt_sent);
+
+                } else {
+                    const auto now = clock_type::now();
+                    for (auto t : c.sending_times) {
+                        this->_statistics.completed(now - t);
+                    }
+
+                    c.sending.clear();
+                    c.sending_times.clear();
+                    c.cnt_sent = 0;
+                    this->write(i);
+                    this->proceed(i);
+                }
+            }
+            break;
+    }
+}
+
+
+/*
+ * server<TTransport, THandler>::proceed
+ */
+template<class TTransport, class THandler>
+void server<TTransport, THandler>::proceed(_In_ const std::size_t instance) {
+    auto& c = this->_connections[instance];
+
+    if (!c.draining) {
+        this->read(instance);
+    } else if (!c.writing) {
+        this->close(instance);
+    }
+}
+
+
+/*
+ * server<TTransport, THandler>::process
+ */
+template<class TTransport, class THandler>
+void server<TTransport, THandler>::process(_In_ const std::size_t instance,
+        _In_ const clock_type::time_point received) {
+    auto& c = this->_connections[instance];
+
+    // The handler parses the requests directly from the ring buffer, so an
+    // incomplete request remains where it is until the rest has arrived.
+    while (!c.input.empty()) {
+        auto subscribe = false;
+        const auto consumed = this->_handler.process(
+            static_cast<const ring_buffer&>(c.input),
+            c.scanned,
+            c.output,
+            subscribe);
+        if (consumed == 0) {
+            break;
+        }
+
+        assert(consumed <= c.input.size());
+        c.input.consume(consumed);
+        c.output_times.push_back(received);
+
+        // A new subscriber gets the current state right after the response,
+        // so it cannot miss a change that happened before it subscribed.
+        if (subscribe && !c.subscribed) {
+            c.notifying = true;
+            c.subscribed = true;
+        }
+    }
+}
+
+
+/*
+ * server<TTransport, THandler>::read
+ */
+template<class TTransport, class THandler>
+void server<TTransport, THandler>::read(_In_ const std::size_t instance) {
+    auto& c = this->_connections[instance];
+
+    if (c.reading || c.closing || c.draining) {
+        return;
+    }
+
+    // Stop reading from a client that does not read its responses until
+    // these have been written, which bounds the memory we use per client.
+    if (c.output.size() + c.sending.size() > this->_max_request) {
+        return;
+    }
+
+    const auto dst = c.input.writable();
+    if (dst.second == 0) {
+        // The buffer is full, but does not contain a complete request, so we
+        // assume that the client is misbehaving.
+        this->_statistics.failed();
+        this->close(instance);
+        return;
+    }
+
+    c.reading = true;
+    this->_transport.read(instance, dst.first, dst.second);
+}
+
+
+/*
+ * server<TTransport, THandler>::write
+ */
+template<class TTransport, class THandler>
+void server<TTransport, THandler>::write(_In_ const std::size_t instance) {
+    auto& c = this->_connections[instance];
+
+    if (c.writing || c.closing) {
+        return;
+    }
+
+    if (c.notifying) {
+        this->_handler.notify(c.output);
+        c.notifying = false;
+    }
+
+    if (c.output.empty()) {
+        return;
+    }
+
+    // Swap the buffers such that the handler can append new responses while
+    // the previous ones are being written.
+    assert(c.sending.empty());
+    c.sending.swap(c.output);
+    c.sending_times.swap(c.output_times);
+    c.cnt_sent = 0;
+
+    c.writing = true;
+    this->_transport.write(instance, c.sending.data(), c.sending.size());
+}
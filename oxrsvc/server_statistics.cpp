@@ -0,0 +1,155 @@
+// <copyright file="server_statistics.cpp" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#include "pch.h"
+#include "server_statistics.h"
+
+
+/*
+ * server_statistics::server_statistics
+ */
+server_statistics::server_statistics(void) noexcept {
+    this->start();
+}
+
+
+/*
+ * server_statistics::completed
+ */
+void server_statistics::completed(
+        _In_ const clock_type::duration latency) noexcept {
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+        latency).count();
+    ++this->_buckets[bucket((us > 0) ? static_cast<std::uint64_t>(us) : 0)];
+    ++this->_requests;
+}
+
+
+/*
+ * server_statistics::elapsed
+ */
+server_statistics::clock_type::duration server_statistics::elapsed(
+        void) const noexcept {
+    const auto end = (this->_stopped < this->_started)
+        ? clock_type::now()
+        : this->_stopped;
+    return end - this->_started;
+}
+
+
+/*
+ * server_statistics::percentile
+ */
+std::chrono::microseconds server_statistics::percentile(
+        _In_ const double fraction) const {
+    if ((fraction < 0.0) || (fraction > 1.0)) {
+        throw std::invalid_argument("The fraction must be within [0, 1].");
+    }
+
+    if (this->_requests == 0) {
+        return std::chrono::microseconds::zero();
+    }
+
+    // Find the first bucket at which the cumulative count reaches the rank
+    // of the requested percentile.
+    const auto rank = (std::max)(static_cast<std::uint64_t>(1),
+        static_cast<std::uint64_t>(std::ceil(fraction * this->_requests)));
+    std::uint64_t cnt = 0;
+
+    for (std::size_t i = 0; i < this->_buckets.size(); ++i) {
+        cnt += this->_buckets[i];
+        if (cnt >= rank) {
+            return std::chrono::microseconds(upper_bound(i));
+        }
+    }
+
+    return std::chrono::microseconds(upper_bound(this->_buckets.size() - 1));
+}
+
+
+/*
+ * server_statistics::start
+ */
+void server_statistics::start(void) noexcept {
+    this->_buckets.fill(0);
+    this->_failures = 0;
+    this->_requests = 0;
+    this->_started = clock_type::now();
+    this->_stopped = clock_type::time_point::min();
+}
+
+
+/*
+ * server_statistics::stop
+ */
+void server_statistics::stop(void) noexcept {
+    this->_stopped = clock_type::now();
+}
+
+
+/*
+ * server_statistics::throughput
+ */
+double server_statistics::throughput(void) const noexcept {
+    const auto elapsed = std::chrono::duration<double>(this->elapsed());
+    return (elapsed.count() > 0.0)
+        ? this->_requests / elapsed.count()
+        : 0.0;
+}
+
+
+/*
+ * server_statistics::to_string
+ */
+std::wstring server_statistics::to_string(void) const {
+    std::wostringstream retval;
+    retval << this->_requests << L" requests, "
+        << this->_failures << L" failures, "
+        << this->throughput() << L" requests/s, p50 "
+        << this->percentile(0.5).count() << L" us, p99 "
+        << this->percentile(0.99).count() << L" us, p99.9 "
+        << this->percentile(0.999).count() << L" us";
+    return retval.str();
+}
+
+
+/*
+ * server_statistics::bucket
+ */
+std::size_t server_statistics::bucket(_In_ const std::uint64_t us) noexcept {
+    // The first buckets hold a single value each. Beyond, each power of two
+    // is split into 'sub_buckets' ranges of equal width.
+    if (us < sub_buckets) {
+        return static_cast<std::size_t>(us);
+    }
+
+    std::size_t exponent = 0;
+    for (auto v = us; v > 1; v >>= 1) {
+        ++exponent;
+    }
+
+    // 'sub_buckets' is 4, so the two bits below the leading one select the
+    // range within the power of two.
+    const auto shift = exponent - 2;
+    const auto sub = static_cast<std::size_t>(us >> shift) & (sub_buckets - 1);
+    const auto retval = sub_buckets + shift * sub_buckets + sub;
+    return (std::min)(retval, cnt_buckets - 1);
+}
+
+
+/*
+ * server_statistics::upper_bound
+ */
+std::uint64_t server_statistics::upper_bound(
+        _In_ const std::size_t bucket) noexcept {
+    if (bucket < sub_buckets) {
+        return bucket;
+    }
+
+    const auto shift = (bucket - sub_buckets) / sub_buckets;
+    const auto sub = (bucket - sub_buckets) % sub_buckets;
+    return ((static_cast<std::uint64_t>(sub_buckets + sub + 1)) << shift) - 1;
+}
@@ -0,0 +1,139 @@
+// <copyright file="server_statistics.h" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#if !defined(_OXRSVC_SERVER_STATISTICS_H)
+#define _OXRSVC_SERVER_STATISTICS_H
+#pragma once
+
+
+/// <summary>
+/// Collects the number of requests a <see cref="server" /> processed and the
+/// distribution of their round-trip times.
+/// </summary>
+/// <remarks>
+/// The round-trip time of a request is measured from the moment its last
+/// byte has been received until its response has been written completely.
+/// The times are recorded in a histogram with four buckets per power of two,
+/// so any percentile is reported with an error of less than 25 per cent
+/// without storing the individual samples.
+/// </remarks>
+class server_statistics final {
+
+public:
+
+    /// <summary>
+    /// The clock used for all measurements.
+    /// </summary>
+    typedef std::chrono::steady_clock clock_type;
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    server_statistics(void) noexcept;
+
+    /// <summary>
+    /// Records a request that has been answered after
+    /// <paramref name="latency" />.
+    /// </summary>
+    /// <param name="latency"></param>
+    void completed(_In_ const clock_type::duration latency) noexcept;
+
+    /// <summary>
+    /// Answer how long the server has been running, which is measured until
+    /// <see cref="stop" /> if the server has stopped.
+    /// </summary>
+    /// <returns></returns>
+    clock_type::duration elapsed(void) const noexcept;
+
+    /// <summary>
+    /// Records a client that has been disconnected because of an invalid
+    /// request.
+    /// </summary>
+    inline void failed(void) noexcept {
+        ++this->_failures;
+    }
+
+    /// <summary>
+    /// Answer the number of clients that have been disconnected because of an
+    /// invalid request.
+    /// </summary>
+    /// <returns></returns>
+    inline std::uint64_t failures(void) const noexcept {
+        return this->_failures;
+    }
+
+    /// <summary>
+    /// Answer the round-trip time below which the given fraction of all
+    /// requests has been answered.
+    /// </summary>
+    /// <param name="fraction">The fraction of requests, which must be within
+    /// [0, 1].</param>
+    /// <returns>The upper bound of the round-trip time or zero if no request
+    /// has been answered yet.</returns>
+    std::chrono::microseconds percentile(_In_ const double fraction) const;
+
+    /// <summary>
+    /// Answer the number of requests that have been answered.
+    /// </summary>
+    /// <returns></returns>
+    inline std::uint64_t requests(void) const noexcept {
+        return this->_requests;
+    }
+
+    /// <summary>
+    /// Resets all counters and starts measuring the running time.
+    /// </summary>
+    void start(void) noexcept;
+
+    /// <summary>
+    /// Stops measuring the running time.
+    /// </summary>
+    void stop(void) noexcept;
+
+    /// <summary>
+    /// Answer the number of requests answered per second.
+    /// </summary>
+    /// <returns></returns>
+    double throughput(void) const noexcept;
+
+    /// <summary>
+    /// Formats the statistics as a single line of text.
+    /// </summary>
+    /// <returns></returns>
+    std::wstring to_string(void) const;
+
+private:
+
+    /// <summary>
+    /// The number of buckets per power of two.
+    /// </summary>
+    static constexpr std::size_t sub_buckets = 4;
+
+    /// <summary>
+    /// The number of buckets, which covers round-trip times of more than two
+    /// hours. Anything longer is recorded in the last bucket.
+    /// </summary>
+    static constexpr std::size_t cnt_buckets = sub_buckets * 32;
+
+    /// <summary>
+    /// Answer the bucket that records <paramref name="us" /> microseconds.
+    /// </summary>
+    static std::size_t bucket(_In_ const std::uint64_t us) noexcept;
+
+    /// <summary>
+    /// Answer the largest number of microseconds recorded in the given
+    /// bucket.
+    /// </summary>
+    static std::uint64_t upper_bound(_In_ const std::size_t bucket) noexcept;
+
+    std::array<std::uint64_t, cnt_buckets> _buckets;
+    std::uint64_t _failures;
+    std::uint64_t _requests;
+    clock_type::time_point _started;
+    clock_type::time_point _stopped;
+};
+
+#endif /* !defined(_OXRSVC_SERVER_STATISTICS_H) */
@@ -7,7 +7,7 @@
 #include "pch.h"
 #include "service.h"
 
-#include "util.h"
+#include "../oxrswitch/util.h"
 
 
 /*
@@ -0,0 +1,321 @@
+// <copyright file="shared_state.cpp" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#include "pch.h"
+#include "shared_state.h"
+
+
+/// <summary>
+/// Copies <paramref name="src" /> into the fixed-size array
+/// <paramref name="dst" /> if it fits.
+/// </summary>
+/// <returns><see langword="true" /> if the string fits, in which case it has
+/// been copied, <see langword="false" /> if it does not, in which case
+/// <paramref name="dst" /> has been cleared.</returns>
+static bool copy_path(_Out_writes_(max_state_path) wchar_t *dst,
+        _In_ const std::wstring& src) noexcept {
+    const auto retval = (src.size() < max_state_path);
+    const auto cnt = retval ? src.size() : 0;
+    std::copy(src.begin(), src.begin() + cnt, dst);
+    std::fill(dst + cnt, dst + max_state_path, L'\0');
+    return retval;
+}
+
+
+/// <summary>
+/// Answer whether the fixed-size array <paramref name="lhs" /> holds
+/// <paramref name="rhs" />.
+/// </summary>
+static bool equals_path(_In_reads_(max_state_path) const wchar_t *lhs,
+        _In_ const std::wstring& rhs) noexcept {
+    return (rhs.size() < max_state_path)
+        && std::equal(rhs.begin(), rhs.end(), lhs)
+        && (lhs[rhs.size()] == L'\0');
+}
+
+
+#if defined(_WIN32)
+/*
+ * state_publisher::state_publisher
+ */
+state_publisher::state_publisher(_In_z_ const wchar_t *name)
+        : _state(nullptr) {
+    assert(name != nullptr);
+
+    // The service and administrators may do anything, but all other users
+    // may only read the state.
+    wil::unique_hlocal_security_descriptor sd;
+    THROW_LAST_ERROR_IF(!::ConvertStringSecurityDescriptorToSecurityDescriptorW(
+        L"D:P(A;;GA;;;SY)(A;;GA;;;BA)(A;;GR;;;AU)",
+        SDDL_REVISION_1,
+        sd.put(),
+        nullptr));
+
+    SECURITY_ATTRIBUTES sa;
+    sa.nLength = sizeof(sa);
+    sa.lpSecurityDescriptor = sd.get();
+    sa.bInheritHandle = FALSE;
+
+    this->_section.reset(::CreateFileMappingW(INVALID_HANDLE_VALUE,
+        &sa,
+        PAGE_READWRITE,
+        0,
+        static_cast<DWORD>(sizeof(shared_state)),
+        name));
+    const auto error = ::GetLastError();
+    THROW_LAST_ERROR_IF(!this->_section);
+
+    // If someone else has created the section before us, we cannot trust
+    // its permissions, so we refuse to publish anything.
+    THROW_WIN32_IF(ERROR_ALREADY_EXISTS, error == ERROR_ALREADY_EXISTS);
+
+    this->_state = static_cast<shared_state *>(::MapViewOfFile(
+        this->_section.get(),
+        FILE_MAP_WRITE,
+        0,
+        0,
+        sizeof(shared_state)));
+    THROW_LAST_ERROR_IF_NULL(this->_state);
+}
+
+#else /* defined(_WIN32) */
+/*
+ * state_publisher::state_publisher
+ */
+state_publisher::state_publisher(_In_z_ const char *name)
+        : _name(name), _state(nullptr) {
+    assert(name != nullptr);
+
+    // Remove any leftovers of a publisher that crashed, which would otherwise
+    // make us fail to create the object.
+    ::shm_unlink(name);
+
+    const auto fd = ::shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        throw std::system_error(errno, std::system_category());
+    }
+
+    if (::ftruncate(fd, sizeof(shared_state)) != 0) {
+        const auto error = errno;
+        ::close(fd);
+        ::shm_unlink(name);
+        throw std::system_error(error, std::system_category());
+    }
+
+    auto state = ::mmap(nullptr,
+        sizeof(shared_state),
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        fd,
+        0);
+    const auto error = errno;
+    ::close(fd);
+
+    if (state == MAP_FAILED) {
+        ::shm_unlink(name);
+        throw std::system_error(error, std::system_category());
+    }
+
+    this->_state = static_cast<shared_state *>(state);
+}
+#endif /* defined(_WIN32) */
+
+
+/*
+ * state_publisher::~state_publisher
+ */
+state_publisher::~state_publisher(void) {
+    this->release();
+}
+
+
+/*
+ * state_publisher::publish
+ */
+bool state_publisher::publish(_In_ const std::wstring& runtime,
+        _In_ const std::wstring& wow_runtime) {
+    assert(this->_state != nullptr);
+    std::lock_guard<std::mutex> l(this->_lock);
+    auto& s = *this->_state;
+
+    // As we are the only writer, we can read without the sequence lock.
+    if (equals_path(s.runtime, runtime)
+            && equals_path(s.wow_runtime, wow_runtime)) {
+        return false;
+    }
+
+    const auto timestamp = std::chrono::duration_cast<
+        std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    const auto sequence = s.sequence.load(std::memory_order_relaxed);
+    s.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto fits = copy_path(s.runtime, runtime);
+    fits = copy_path(s.wow_runtime, wow_runtime) && fits;
+    s.truncated = fits ? 0 : 1;
+    ++s.generation;
+    s.timestamp = timestamp;
+
+    s.sequence.store(sequence + 2, std::memory_order_release);
+    return true;
+}
+
+
+/*
+ * state_publisher::release
+ */
+void state_publisher::release(void) noexcept {
+    if (this->_state != nullptr) {
+#if defined(_WIN32)
+        ::UnmapViewOfFile(this->_state);
+#else /* defined(_WIN32) */
+        ::munmap(this->_state, sizeof(shared_state));
+        ::shm_unlink(this->_name.c_str());
+#endif /* defined(_WIN32) */
+        this->_state = nullptr;
+    }
+}
+
+
+#if defined(_WIN32)
+/*
+ * state_reader::state_reader
+ */
+state_reader::state_reader(_In_z_ const wchar_t *name) : _state(nullptr) {
+    assert(name != nullptr);
+    this->_section.reset(::OpenFileMappingW(FILE_MAP_READ, FALSE, name));
+    THROW_LAST_ERROR_IF(!this->_section);
+
+    this->_state = static_cast<const shared_state *>(::MapViewOfFile(
+        this->_section.get(),
+        FILE_MAP_READ,
+        0,
+        0,
+        sizeof(shared_state)));
+    THROW_LAST_ERROR_IF_NULL(this->_state);
+}
+
+#else /* defined(_WIN32) */
+/*
+ * state_reader::state_reader
+ */
+state_reader::state_reader(_In_z_ const char *name) : _state(nullptr) {
+    assert(name != nullptr);
+
+    const auto fd = ::shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        throw std::system_error(errno, std::system_category());
+    }
+
+    struct stat info;
+    if ((::fstat(fd, &info) != 0)
+            || (static_cast<std::size_t>(info.st_size)
+                < sizeof(shared_state))) {
+        ::close(fd);
+        throw std::system_error(EINVAL, std::system_category());
+    }
+
+    auto state = ::mmap(nullptr, sizeof(shared_state), PROT_READ, MAP_SHARED,
+        fd, 0);
+    const auto error = errno;
+    ::close(fd);
+
+    if (state == MAP_FAILED) {
+        throw std::system_error(error, std::system_category());
+    }
+
+    this->_state = static_cast<const shared_state *>(state);
+}
+#endif /* defined(_WIN32) */
+
+
+/*
+ * state_reader::~state_reader
+ */
+state_reader::~state_reader(void) {
+    this->release();
+}
+
+
+/*
+ * state_reader::generation
+ */
+std::uint64_t state_reader::generation(void) const noexcept {
+    assert(this->_state != nullptr);
+    auto& s = *this->_state;
+
+    while (true) {
+        const auto before = s.sequence.load(std::memory_order_acquire);
+        const auto retval = s.generation;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const auto after = s.sequence.load(std::memory_order_relaxed);
+
+        if (((before & 1) == 0) && (before == after)) {
+            return retval;
+        }
+
+        std::this_thread::yield();
+    }
+}
+
+
+/*
+ * state_reader::read
+ */
+void state_reader::read(_Out_ state_snapshot& snapshot) const {
+    assert(this->_state != nullptr);
+    auto& s = *this->_state;
+    std::array<wchar_t, max_state_path> runtime;
+    std::array<wchar_t, max_state_path> wow_runtime;
+
+    while (true) {
+        const auto before = s.sequence.load(std::memory_order_acquire);
+        if ((before & 1) != 0) {
+            // The publisher is just changing the state.
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Copy everything before looking at it, because the data might be
+        // garbage if the publisher changed them while we were copying.
+        std::copy(s.runtime, s.runtime + max_state_path, runtime.begin());
+        std::copy(s.wow_runtime, s.wow_runtime + max_state_path,
+            wow_runtime.begin());
+        snapshot.generation = s.generation;
+        snapshot.timestamp = s.timestamp;
+        snapshot.truncated = (s.truncated != 0);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.sequence.load(std::memory_order_relaxed) == before) {
+            break;
+        }
+    }
+
+    // The copies are consistent now, but we still do not rely on them being
+    // terminated.
+    auto end = std::find(runtime.begin(), runtime.end(), L'\0');
+    snapshot.runtime.assign(runtime.begin(), end);
+    end = std::find(wow_runtime.begin(), wow_runtime.end(), L'\0');
+    snapshot.wow_runtime.assign(wow_runtime.begin(), end);
+}
+
+
+/*
+ * state_reader::release
+ */
+void state_reader::release(void) noexcept {
+    if (this->_state != nullptr) {
+#if defined(_WIN32)
+        ::UnmapViewOfFile(this->_state);
+#else /* defined(_WIN32) */
+        ::munmap(const_cast<shared_state *>(this->_state),
+            sizeof(shared_state));
+#endif /* defined(_WIN32) */
+        this->_state = nullptr;
+    }
+}
@@ -0,0 +1,229 @@
+// <copyright file="shared_state.h" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#if !defined(_OXRSVC_SHARED_STATE_H)
+#define _OXRSVC_SHARED_STATE_H
+#pragma once
+
+
+/// <summary>
+/// The maximum number of characters of a path in the
+/// <see cref="shared_state" /> including the terminator.
+/// </summary>
+constexpr std::size_t max_state_path = 1024;
+
+
+/// <summary>
+/// The layout of the shared memory section the service publishes the active
+/// runtime in.
+/// </summary>
+/// <remarks>
+/// <para>The section is guarded by a sequence lock: The publisher increments
+/// <see cref="sequence" /> to an odd number before it changes anything and
+/// to the next even number afterwards. A reader copies the data and retries
+/// if the sequence was odd or has changed in the meantime, so readers never
+/// block the publisher or each other.</para>
+/// <para>The paths are zero-terminated. A path that does not fit into the
+/// section is published as empty and flagged in <see cref="truncated" />, in
+/// which case the reader must fall back to the registry.</para>
+/// </remarks>
+struct shared_state final {
+
+    /// <summary>
+    /// The sequence number of the lock, which is odd while the state is being
+    /// changed.
+    /// </summary>
+    std::atomic<std::uint32_t> sequence;
+
+    /// <summary>
+    /// Non-zero if any of the paths was too long to be published.
+    /// </summary>
+    std::uint32_t truncated;
+
+    /// <summary>
+    /// A counter that is incremented whenever the active runtime changes.
+    /// </summary>
+    std::uint64_t generation;
+
+    /// <summary>
+    /// The time of the last change in microseconds since the Unix epoch.
+    /// </summary>
+    std::int64_t timestamp;
+
+    /// <summary>
+    /// The path of the active native runtime.
+    /// </summary>
+    wchar_t runtime[max_state_path];
+
+    /// <summary>
+    /// The path of the active WOW64 runtime, which is empty if there is none.
+    /// </summary>
+    wchar_t wow_runtime[max_state_path];
+};
+
+static_assert(std::is_standard_layout<shared_state>::value,
+    "The shared state must be usable across process boundaries.");
+static_assert(ATOMIC_INT_LOCK_FREE == 2,
+    "The sequence lock must not rely on a lock.");
+
+
+/// <summary>
+/// A consistent copy of the <see cref="shared_state" />.
+/// </summary>
+struct state_snapshot final {
+    std::uint64_t generation;
+    std::wstring runtime;
+    std::int64_t timestamp;
+    bool truncated;
+    std::wstring wow_runtime;
+};
+
+
+/// <summary>
+/// Creates the shared memory section and publishes the active runtime in it.
+/// </summary>
+/// <remarks>
+/// The publisher is the only writer of the section. It is safe to call
+/// <see cref="publish" /> from multiple threads.
+/// </remarks>
+class state_publisher final {
+
+public:
+
+#if defined(_WIN32)
+    /// <summary>
+    /// The name of the section, which is in the global namespace such that it
+    /// is visible to all sessions.
+    /// </summary>
+    static constexpr const wchar_t *const default_name
+        = L"Global\\oxrswitch.state";
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="name">The name of the section, which all authenticated
+    /// users can read, but only the service can write.</param>
+    explicit state_publisher(_In_z_ const wchar_t *name = default_name);
+
+#else /* defined(_WIN32) */
+    /// <summary>
+    /// The name of the POSIX shared memory object.
+    /// </summary>
+    static constexpr const char *const default_name = "/oxrswitch.state";
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="name">The name of the shared memory object, which all
+    /// users can read, but only the owner can write.</param>
+    explicit state_publisher(_In_z_ const char *name = default_name);
+#endif /* defined(_WIN32) */
+
+    state_publisher(const state_publisher&) = delete;
+
+    /// <summary>
+    /// Finalises the instance.
+    /// </summary>
+    ~state_publisher(void);
+
+    /// <summary>
+    /// Publishes the given runtimes.
+    /// </summary>
+    /// <remarks>
+    /// If the runtimes are the ones already published, nothing is changed, so
+    /// the same change can safely be published more than once.
+    /// </remarks>
+    /// <param name="runtime"></param>
+    /// <param name="wow_runtime"></param>
+    /// <returns><see langword="true" /> if the state has changed,
+    /// <see langword="false" /> otherwise.</returns>
+    bool publish(_In_ const std::wstring& runtime,
+        _In_ const std::wstring& wow_runtime);
+
+    state_publisher& operator =(const state_publisher&) = delete;
+
+private:
+
+    /// <summary>
+    /// Unmaps the section.
+    /// </summary>
+    void release(void) noexcept;
+
+    std::mutex _lock;
+#if defined(_WIN32)
+    wil::unique_handle _section;
+#else /* defined(_WIN32) */
+    std::string _name;
+#endif /* defined(_WIN32) */
+    shared_state *_state;
+};
+
+
+/// <summary>
+/// Provides lock-free read access to the <see cref="shared_state" />
+/// published by the service.
+/// </summary>
+class state_reader final {
+
+public:
+
+#if defined(_WIN32)
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="name">The name of the section.</param>
+    explicit state_reader(
+        _In_z_ const wchar_t *name = state_publisher::default_name);
+
+#else /* defined(_WIN32) */
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="name">The name of the shared memory object.</param>
+    explicit state_reader(
+        _In_z_ const char *name = state_publisher::default_name);
+#endif /* defined(_WIN32) */
+
+    state_reader(const state_reader&) = delete;
+
+    /// <summary>
+    /// Finalises the instance.
+    /// </summary>
+    ~state_reader(void);
+
+    /// <summary>
+    /// Answer the current generation of the state.
+    /// </summary>
+    /// <remarks>
+    /// This is the cheapest way of detecting a change, which only requires
+    /// the full state to be read if the generation differs from the last one
+    /// the caller has seen.
+    /// </remarks>
+    /// <returns></returns>
+    std::uint64_t generation(void) const noexcept;
+
+    /// <summary>
+    /// Reads a consistent copy of the state.
+    /// </summary>
+    /// <param name="snapshot"></param>
+    void read(_Out_ state_snapshot& snapshot) const;
+
+    state_reader& operator =(const state_reader&) = delete;
+
+private:
+
+    /// <summary>
+    /// Unmaps the section.
+    /// </summary>
+    void release(void) noexcept;
+
+#if defined(_WIN32)
+    wil::unique_handle _section;
+#endif /* defined(_WIN32) */
+    const shared_state *_state;
+};
+
+#endif /* !defined(_OXRSVC_SHARED_STATE_H) */
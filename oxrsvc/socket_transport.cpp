@@ -0,0 +1,340 @@
+// <copyright file="socket_transport.cpp" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#include "pch.h"
+#include "socket_transport.h"
+
+#if !defined(_WIN32)
+
+
+/*
+ * socket_transport::socket_transport
+ */
+socket_transport::socket_transport(_In_z_ const char *path,
+        _In_ const std::size_t instances)
+        : _listener(-1), _notified(false), _path(path) {
+    assert(path != nullptr);
+    this->_wake[0] = this->_wake[1] = -1;
+
+    if (instances < 1) {
+        throw std::invalid_argument("At least one instance is required.");
+    }
+
+    sockaddr_un address;
+    ::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (this->_path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("The socket path is too long.");
+    }
+    std::copy(this->_path.begin(), this->_path.end(), address.sun_path);
+
+    this->_instances.resize(instances, { false, 0, 0, nullptr, false, -1,
+        nullptr, false });
+
+    try {
+        if (::pipe2(this->_wake, O_CLOEXEC | O_NONBLOCK) != 0) {
+            throw std::system_error(errno, std::system_category());
+        }
+
+        this->_listener = ::socket(AF_UNIX,
+            SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+            0);
+        if (this->_listener < 0) {
+            throw std::system_error(errno, std::system_category());
+        }
+
+        ::unlink(path);
+        if (::bind(this->_listener,
+                reinterpret_cast<sockaddr *>(&address),
+                sizeof(address)) != 0) {
+            throw std::system_error(errno, std::system_category());
+        }
+
+        if (::listen(this->_listener, static_cast<int>(instances)) != 0) {
+            throw std::system_error(errno, std::system_category());
+        }
+    } catch (...) {
+        this->release();
+        throw;
+    }
+}
+
+
+/*
+ * socket_transport::~socket_transport
+ */
+socket_transport::~socket_transport(void) {
+    this->release();
+}
+
+
+/*
+ * socket_transport::accept
+ */
+void socket_transport::accept(_In_ const std::size_t instance) {
+    auto& i = this->_instances.at(instance);
+    assert(i.socket < 0);
+    assert(!i.accepting && !i.reading);
+    i.accepting = true;
+}
+
+
+/*
+ * socket_transport::cancel
+ */
+void socket_transport::cancel(_In_ const std::size_t instance) noexcept {
+    assert(instance < this->_instances.size());
+    auto& i = this->_instances[instance];
+
+    try {
+        if (i.accepting) {
+            i.accepting = false;
+            this->complete(instance, transport_operation::accept, 0,
+                ECANCELED);
+        }
+        if (i.reading) {
+            i.reading = false;
+            this->complete(instance, transport_operation::read, 0, ECANCELED);
+        }
+        if (i.writing) {
+            i.writing = false;
+            this->complete(instance, transport_operation::write, 0,
+                ECANCELED);
+        }
+    } catch (...) {
+        // The only thing that could fail is the allocation in the deque, in
+        // which case there is nothing we could do.
+        std::terminate();
+    }
+}
+
+
+/*
+ * socket_transport::disconnect
+ */
+void socket_transport::disconnect(_In_ const std::size_t instance) noexcept {
+    assert(instance < this->_instances.size());
+    auto& i = this->_instances[instance];
+    if (i.socket >= 0) {
+        ::close(i.socket);
+        i.socket = -1;
+    }
+}
+
+
+/*
+ * socket_transport::read
+ */
+void socket_transport::read(_In_ const std::size_t instance,
+        _Out_writes_bytes_(cnt) void *dst,
+        _In_ const std::size_t cnt) {
+    auto& i = this->_instances.at(instance);
+    assert(!i.accepting && !i.reading);
+    i.cnt_read = cnt;
+    i.dst = dst;
+    i.reading = true;
+}
+
+
+/*
+ * socket_transport::notify
+ */
+void socket_transport::notify(void) noexcept {
+    // Only wake the loop if it has not yet been woken for a notification,
+    // which coalesces bursts and keeps the pipe from filling up.
+    if (!this->_notified.exchange(true, std::memory_order_acq_rel)) {
+        const char c = 1;
+        auto w = ::write(this->_wake[1], &c, sizeof(c));
+        (void) w;
+    }
+}
+
+
+/*
+ * socket_transport::stop
+ */
+void socket_transport::stop(void) noexcept {
+    const char c = 0;
+    auto w = ::write(this->_wake[1], &c, sizeof(c));
+    (void) w;
+}
+
+
+/*
+ * socket_transport::wait
+ */
+bool socket_transport::wait(_Out_ transport_completion& completion) {
+    while (this->_completed.empty()) {
+        if (!this->poll()) {
+            return false;
+        }
+    }
+
+    completion = this->_completed.front();
+    this->_completed.pop_front();
+    return true;
+}
+
+
+/*
+ * socket_transport::write
+ */
+void socket_transport::write(_In_ const std::size_t instance,
+        _In_reads_bytes_(cnt) const void *src,
+        _In_ const std::size_t cnt) {
+    auto& i = this->_instances.at(instance);
+    assert(!i.writing);
+    i.cnt_write = cnt;
+    i.src = src;
+    i.writing = true;
+}
+
+
+/*
+ * socket_transport::complete
+ */
+void socket_transport::complete(_In_ const std::size_t instance,
+        _In_ const transport_operation operation,
+        _In_ const std::size_t cnt,
+        _In_ const int error) {
+    this->_completed.push_back({ cnt,
+        static_cast<std::uint32_t>(error),
+        instance,
+        operation });
+}
+
+
+/*
+ * socket_transport::poll
+ */
+bool socket_transport::poll(void) {
+    std::vector<pollfd> fds;
+    std::vector<std::size_t> owners;
+    fds.reserve(this->_instances.size() + 2);
+    owners.reserve(this->_instances.size());
+
+    fds.push_back({ this->_wake[0], POLLIN, 0 });
+
+    const auto accepting = std::any_of(this->_instances.begin(),
+        this->_instances.end(),
+        [](const socket_instance& i) { return i.accepting; });
+    fds.push_back({ accepting ? this->_listener : -1, POLLIN, 0 });
+
+    for (std::size_t i = 0; i < this->_instances.size(); ++i) {
+        auto& s = this->_instances[i];
+        if ((s.socket >= 0) && (s.reading || s.writing)) {
+            short events = 0;
+            if (s.reading) {
+                events |= POLLIN;
+            }
+            if (s.writing) {
+                events |= POLLOUT;
+            }
+            fds.push_back({ s.socket, events, 0 });
+            owners.push_back(i);
+        }
+    }
+
+    if (::poll(fds.data(), fds.size(), -1) < 0) {
+        if (errno == EINTR) {
+            return true;
+        }
+        throw std::system_error(errno, std::system_category());
+    }
+
+    if ((fds[0].revents & POLLIN) != 0) {
+        // A zero byte asks us to stop, anything else is a notification.
+        char c;
+        while (::read(this->_wake[0], &c, sizeof(c)) == sizeof(c)) {
+            if (c == 0) {
+                return false;
+            }
+        }
+
+        if (this->_notified.exchange(false, std::memory_order_acq_rel)) {
+            this->complete(0, transport_operation::notify, 0, 0);
+        }
+    }
+
+    // Hand out new connections to the instances waiting for them in order.
+    if ((fds[1].revents & POLLIN) != 0) {
+        for (std::size_t i = 0; i < this->_instances.size(); ++i) {
+            auto& s = this->_instances[i];
+            if (s.accepting) {
+                const auto socket = ::accept4(this->_listener,
+                    nullptr,
+                    nullptr,
+                    SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (socket < 0) {
+                    break;
+                }
+
+                s.accepting = false;
+                s.socket = socket;
+                this->complete(i, transport_operation::accept, 0, 0);
+            }
+        }
+    }
+
+    for (std::size_t f = 2; f < fds.size(); ++f) {
+        const auto i = owners[f - 2];
+        auto& s = this->_instances[i];
+        const auto revents = fds[f].revents;
+
+        if (s.reading && ((revents & (POLLIN | POLLHUP | POLLERR)) != 0)) {
+            const auto cnt = ::recv(s.socket, s.dst, s.cnt_read, 0);
+            if ((cnt >= 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK))) {
+                s.reading = false;
+                this->complete(i,
+                    transport_operation::read,
+                    (cnt > 0) ? static_cast<std::size_t>(cnt) : 0,
+                    (cnt < 0) ? errno : 0);
+            }
+        }
+
+        if (s.writing && ((revents & (POLLOUT | POLLHUP | POLLERR)) != 0)) {
+            const auto cnt = ::send(s.socket, s.src, s.cnt_write,
+                MSG_NOSIGNAL);
+            if ((cnt >= 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK))) {
+                s.writing = false;
+                this->complete(i,
+                    transport_operation::write,
+                    (cnt > 0) ? static_cast<std::size_t>(cnt) : 0,
+                    (cnt < 0) ? errno : 0);
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/*
+ * socket_transport::release
+ */
+void socket_transport::release(void) noexcept {
+    for (auto& i : this->_instances) {
+        if (i.socket >= 0) {
+            ::close(i.socket);
+            i.socket = -1;
+        }
+    }
+
+    if (this->_listener >= 0) {
+        ::close(this->_listener);
+        ::unlink(this->_path.c_str());
+        this->_listener = -1;
+    }
+
+    for (auto& w : this->_wake) {
+        if (w >= 0) {
+            ::close(w);
+            w = -1;
+        }
+    }
+}
+
+#endif /* !defined(_WIN32) */
@@ -0,0 +1,162 @@
+// <copyright file="socket_transport.h" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#if !defined(_OXRSVC_SOCKET_TRANSPORT_H)
+#define _OXRSVC_SOCKET_TRANSPORT_H
+#pragma once
+
+#if !defined(_WIN32)
+#include "transport.h"
+
+
+/// <summary>
+/// Implements the transport of the <see cref="server" /> using Unix domain
+/// sockets, which allows for running the server loop on Linux, for instance
+/// for load tests.
+/// </summary>
+/// <remarks>
+/// The sockets are non-blocking and multiplexed using <c>poll</c>. Each
+/// operation is performed as soon as the socket is ready and then reported
+/// as completed, which emulates the semantics of an I/O completion port.
+/// </remarks>
+class socket_transport final {
+
+public:
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="path">The path of the socket, which will be removed if
+    /// it exists.</param>
+    /// <param name="instances">The number of clients that can be served
+    /// concurrently.</param>
+    socket_transport(_In_z_ const char *path,
+        _In_ const std::size_t instances);
+
+    socket_transport(const socket_transport&) = delete;
+
+    /// <summary>
+    /// Finalises the instance.
+    /// </summary>
+    ~socket_transport(void);
+
+    /// <summary>
+    /// Starts waiting for a client to connect to the given instance.
+    /// </summary>
+    /// <param name="instance"></param>
+    void accept(_In_ const std::size_t instance);
+
+    /// <summary>
+    /// Cancels all pending operations on the given instance.
+    /// </summary>
+    /// <param name="instance"></param>
+    void cancel(_In_ const std::size_t instance) noexcept;
+
+    /// <summary>
+    /// Closes the connection of the given instance.
+    /// </summary>
+    /// <param name="instance"></param>
+    void disconnect(_In_ const std::size_t instance) noexcept;
+
+    /// <summary>
+    /// Answer the number of instances.
+    /// </summary>
+    /// <returns></returns>
+    inline std::size_t instances(void) const noexcept {
+        return this->_instances.size();
+    }
+
+    /// <summary>
+    /// Wakes the thread waiting for completions with a notification.
+    /// </summary>
+    void notify(void) noexcept;
+
+    /// <summary>
+    /// Starts reading from the given instance.
+    /// </summary>
+    /// <param name="instance"></param>
+    /// <param name="dst"></param>
+    /// <param name="cnt"></param>
+    void read(_In_ const std::size_t instance,
+        _Out_writes_bytes_(cnt) void *dst,
+        _In_ const std::size_t cnt);
+
+    /// <summary>
+    /// Makes <see cref="wait" /> return <see langword="false" />.
+    /// </summary>
+    void stop(void) noexcept;
+
+    /// <summary>
+    /// Waits for the next operation to complete.
+    /// </summary>
+    /// <param name="completion"></param>
+    /// <returns><see langword="true" /> if an operation completed,
+    /// <see langword="false" /> if the transport was stopped.</returns>
+    bool wait(_Out_ transport_completion& completion);
+
+    /// <summary>
+    /// Starts writing to the given instance.
+    /// </summary>
+    /// <param name="instance"></param>
+    /// <param name="src"></param>
+    /// <param name="cnt"></param>
+    void write(_In_ const std::size_t instance,
+        _In_reads_bytes_(cnt) const void *src,
+        _In_ const std::size_t cnt);
+
+    socket_transport& operator =(const socket_transport&) = delete;
+
+private:
+
+    /// <summary>
+    /// The state of a single connection.
+    /// </summary>
+    struct socket_instance final {
+        bool accepting;
+        std::size_t cnt_read;
+        std::size_t cnt_write;
+        void *dst;
+        bool reading;
+        int socket;
+        const void *src;
+        bool writing;
+    };
+
+    /// <summary>
+    /// Queues the completion of an operation.
+    /// </summary>
+    /// <param name="instance"></param>
+    /// <param name="operation"></param>
+    /// <param name="cnt"></param>
+    /// <param name="error"></param>
+    void complete(_In_ const std::size_t instance,
+        _In_ const transport_operation operation,
+        _In_ const std::size_t cnt,
+        _In_ const int error);
+
+    /// <summary>
+    /// Polls all sockets once and performs the operations they are ready for.
+    /// </summary>
+    /// <returns><see langword="false" /> if the transport was stopped.
+    /// </returns>
+    bool poll(void);
+
+    /// <summary>
+    /// Closes all sockets.
+    /// </summary>
+    void release(void) noexcept;
+
+    std::deque<transport_completion> _completed;
+    std::vector<socket_instance> _instances;
+    int _listener;
+    std::atomic<bool> _notified;
+    std::string _path;
+    int _wake[2];
+};
+
+#endif /* !defined(_WIN32) */
+
+#endif /* !defined(_OXRSVC_SOCKET_TRANSPORT_H) */
@@ -7,7 +7,10 @@
 #include "pch.h"
 #include "switcher.h"
 
-#include "util.h"
+#include "protocol.h"
+#include "server.h"
+
+#include "../oxrswitch/registry_transaction.h"
 
 
 /*
@@ -19,24 +22,81 @@ switcher::switcher(void) : _handle(NULL) {
 }
 
 
+/*
+ * switcher::~switcher
+ */
+switcher::~switcher(void) {
+    this->_discovery.reset();
+    this->_writer.reset();
+    this->_pin.reset();
+}
+
+
 /*
  * switcher::initialise
  */
 void switcher::initialise(void) {
-    this->_pipe.reset(::CreateNamedPipeW(pipe_name,
-        PIPE_ACCESS_DUPLEX | FILE_FLAG_FIRST_PIPE_INSTANCE | WRITE_DAC,
-        PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
-        2,
-        sizeof(HRESULT),
-        MAX_PATH * sizeof(wchar_t),
-        NMPWAIT_USE_DEFAULT_WAIT,
-        NULL));
-    THROW_LAST_ERROR_IF(!this->_pipe);
-    adjust_dacl(this->_pipe);
+    this->_transport.reset(new pipe_transport(pipe_name, pipe_instances));
 
     this->_key = get_openxr_key(openxr_key, false);
     this->_wow_key = get_openxr_key(wow_key, true);
 
+    try {
+        this->_state.reset(new state_publisher());
+    } catch (wil::ResultException ex) {
+        // Clients can still read the registry, so this is not fatal. Most
+        // likely, we are running in foreground without the privilege to
+        // create global objects.
+        ::OutputDebugStringA(ex.what());
+    }
+
+    this->_catalogue.reset(new runtime_catalogue(this->_key.get(),
+        this->_wow_key.get(),
+        active_runtime_value));
+
+    // The watcher also reports changes of the available runtimes, which we
+    // use to keep the catalogue up to date.
+    this->_pin.reset(new runtime_pin<registry_watcher, registry_store>(
+        { this->_key.get(), this->_wow_key.get() },
+        registry_store(active_runtime_value),
+        [this](const std::size_t key) {
+            this->publish();
+            try {
+                this->_catalogue->refresh(key);
+            } catch (...) {
+                ::OutputDebugString(_T("Refreshing the runtime catalogue ")
+                    _T("failed.\r\n"));
+            }
+        }));
+    this->_writer.reset(new runtime_writer(this->_key.get(),
+        this->_wow_key.get(),
+        active_runtime_value,
+        write_window,
+        [this](void) { this->publish(); }));
+    this->publish();
+
+    // Search the installation folders in the background like the application
+    // does, such that clients can also activate runtimes that have not been
+    // registered with the loader.
+    this->_discovery.reset(new runtime_manager(runtime_manager::no_discovery));
+    this->_discovery->watch([this](const runtime_manager::snapshot_type& s) {
+        try {
+            std::vector<std::pair<std::wstring, std::wstring>> runtimes;
+            runtimes.reserve(s->size());
+            for (auto& r : *s) {
+                runtimes.emplace_back(r.path(), r.wow_path());
+            }
+            this->_catalogue->update_discovered(std::move(runtimes));
+        } catch (...) {
+            ::OutputDebugString(_T("Updating the discovered runtimes ")
+                _T("failed.\r\n"));
+        }
+    }, [](std::exception_ptr) {
+        // The catalogue keeps the runtimes discovered so far, but they are
+        // not updated anymore.
+        ::OutputDebugString(_T("Watching the runtimes failed.\r\n"));
+    });
+
     this->_running = true;
 }
 
@@ -88,16 +148,9 @@ void switcher::status(void) {
  */
 void switcher::stop(void) noexcept {
     this->_running.store(false, std::memory_order_release);
-    // "Unblock" the connect as described on
-    // https://stackoverflow.com/questions/1353263/how-to-unblock-connectnamedpipe-and-readfile-c
-    wil::unique_hfile pipe(::CreateFileW(pipe_name,
-        FILE_GENERIC_READ,
-        0,
-        nullptr,
-        OPEN_EXISTING,
-        0,
-        NULL));
-    pipe.reset();
+    if (this->_transport) {
+        this->_transport->stop();
+    }
 }
 
 
@@ -105,123 +158,47 @@ void switcher::stop(void) noexcept {
  * switcher::operator ()
  */
 void switcher::operator ()(void) {
-    std::vector<std::uint8_t> req(2 * MAX_PATH);
+    assert(this->_transport);
+    if (!this->_running.load(std::memory_order_acquire)) {
+        return;
+    }
 
-    while (this->_running.load(std::memory_order_acquire)) {
-        ::OutputDebugString(_T("Waiting for client to connect.\r\n"));
-        THROW_LAST_ERROR_IF(!::ConnectNamedPipe(this->_pipe.get(), nullptr));
+    ::OutputDebugString(_T("Waiting for clients to connect.\r\n"));
+    server<pipe_transport, handler> loop(*this->_transport,
+        handler { this },
+        max_frame_size);
+    loop();
 
-        try {
-            std::size_t cnt_req = 0;
-
-            while (this->_running.load(std::memory_order_acquire)) {
-                ::OutputDebugString(_T("Reading from named pipe.\r\n"));
-                cnt_req += read(this->_pipe, req, cnt_req);
-
-                // Search for consecutive binary zeros which mark the end of the
-                // request.
-                std::size_t end;
-                if (scan(req.begin(), req.begin() + cnt_req, end)) {
-                    // We have a full request, so process it.
-                    auto hr = S_OK;
-                    auto rt = reinterpret_cast<const wchar_t *>(req.data());
-                    auto wow = rt + ::wcslen(rt) + 1;
-
-                    try {
-                        THROW_WIN32_IF(ERROR_NOT_FOUND, !::file_exists(rt));
-                        wil::reg::set_value(this->_key.get(),
-                            active_runtime_value,
-                            rt);
-
-                        if (this->_wow_key) {
-                            if (::file_exists(wow)) {
-                                wil::reg::set_value(this->_wow_key.get(),
-                                    active_runtime_value,
-                                    wow);
-
-                            } else {
-                                ::RegDeleteValueW(this->_wow_key.get(),
-                                    active_runtime_value);
-                                // This may fail if no 32-bit runtime was installed
-                                // in the first place, which is fine. We therefore
-                                // do not check this error.
-                            }
-                        }
-                    } catch (wil::ResultException ex) {
-                        hr = ex.GetErrorCode();
-                    }
-
-                    ::OutputDebugString(_T("Writing response.\r\n"));
-                    write(this->_pipe, &hr, sizeof(hr));
-
-                    // Erase the request we have processed, but keep whatever there
-                    // might already be in the buffer from the next request.
-                    const auto overflow = cnt_req - end;
-                    req.erase(req.begin(), req.begin() + cnt_req);
-                    req.resize(cnt_req);
-                    cnt_req = overflow;
-
-                } else {
-                    // We do not have enough data to process the request.
-                    req.resize(req.size() + cnt_req / 2);
-                }
-            }
-        } catch (...) {
-            ::DisconnectNamedPipe(this->_pipe.get());
-        }
-    }
+    ::OutputDebugStringW((loop.statistics().to_string() + L"\r\n").c_str());
+
+    std::wostringstream msg;
+    msg << L"Activations: " << this->_writer->requested() << L" requested, "
+        << this->_writer->performed() << L" written.\r\n";
+    ::OutputDebugStringW(msg.str().c_str());
 }
 
 
 /*
- * switcher::adjust_dacl
+ * switcher::activate
  */
-void switcher::adjust_dacl(_In_ wil::unique_hfile& pipe) {
-    assert(pipe);
-
-    //wil::unique_hlocal existing_acl;
-    wil::unique_hlocal sd;
-    PACL existing_acl = nullptr;
-    THROW_IF_WIN32_ERROR(::GetSecurityInfo(pipe.get(),
-        SE_KERNEL_OBJECT,
-        DACL_SECURITY_INFORMATION,
-        nullptr,
-        nullptr,
-        &existing_acl,
-        nullptr,
-        sd.put()));
-
-    SID_IDENTIFIER_AUTHORITY nt_auth = SECURITY_NT_AUTHORITY;
-    wil::unique_sid auth_users;
-    THROW_LAST_ERROR_IF(!::AllocateAndInitializeSid(&nt_auth, 1,
-        SECURITY_AUTHENTICATED_USER_RID,
-        0, 0, 0, 0, 0, 0, 0,
-        auth_users.put()));
-
-    EXPLICIT_ACCESS ea;
-    ::ZeroMemory(&ea, sizeof(ea));
-    ea.grfAccessPermissions = GENERIC_READ | GENERIC_WRITE
-        | STANDARD_RIGHTS_READ | STANDARD_RIGHTS_WRITE;
-    ea.grfAccessMode = SET_ACCESS;// GRANT_ACCESS??
-    ea.grfInheritance = NO_INHERITANCE;
-    ea.Trustee.TrusteeForm = TRUSTEE_IS_SID;
-    ea.Trustee.TrusteeType = TRUSTEE_IS_GROUP;
-    ea.Trustee.ptstrName = reinterpret_cast<LPWSTR>(auth_users.get());
-
-    wil::unique_hlocal new_acl;
-    THROW_IF_WIN32_ERROR(::SetEntriesInAclW(1, &ea, existing_acl,
-        reinterpret_cast<PACL *>(new_acl.put())));
-
-    //THROW_IF_WIN32_ERROR(::SetSecurityDescriptorDacl(
-    //    static_cast<PSECURITY_DESCRIPTOR>(sd.get()), TRUE,
-    //    static_cast<PACL>(new_acl.get()), FALSE));
-    THROW_IF_WIN32_ERROR(::SetSecurityInfo(pipe.get(),
-        SE_KERNEL_OBJECT,
-        DACL_SECURITY_INFORMATION,
-        nullptr,
-        nullptr,
-        static_cast<PACL>(new_acl.get()),
-        nullptr));
+bool switcher::activate(_In_ const std::wstring& runtime,
+        _In_ const std::wstring& wow_runtime,
+        _In_ const bool pin) {
+    // A pinned runtime would revert the change, so it must be released
+    // before the change is made.
+    this->_pin->unpin();
+
+    // If the write is deferred, pinning writes the runtimes immediately, and
+    // the deferred write will find nothing to do.
+    const auto retval = this->_writer->write(runtime, wow_runtime);
+
+    if (pin) {
+        this->_pin->pin(runtime,
+            this->_wow_key ? wow_runtime : std::wstring());
+        return true;
+    }
+
+    return retval;
 }
 
 
@@ -260,50 +237,138 @@ wil::unique_hkey switcher::get_openxr_key(
 
 
 /*
- * switcher::read
+ * switcher::notify
  */
-std::size_t switcher::read(_In_ wil::unique_hfile& handle,
-        _Out_writes_bytes_(cnt) void *data,
-        _In_ const std::size_t cnt) {
-    auto dst = static_cast<std::uint8_t *>(data);
-    auto rem = static_cast<DWORD>(cnt);
-    DWORD retval;
-    THROW_LAST_ERROR_IF(!::ReadFile(handle.get(), dst, rem, &retval, nullptr));
-    return retval;
+void switcher::notify(_Inout_ std::vector<std::uint8_t>& output) {
+    std::lock_guard<std::mutex> l(this->_lock);
+    ::write_changed(output, this->_active.first, this->_active.second);
 }
 
 
 /*
- * switcher::read
+ * switcher::process
  */
-std::size_t switcher::read(_In_ wil::unique_hfile& handle,
-        _Inout_ std::vector<std::uint8_t>& data,
-        _In_ const std::size_t offset) {
-    auto dst = data.data() + offset;
-    auto cnt = data.size();
-    if (cnt < offset) {
+std::size_t switcher::process(_In_ const ring_buffer& input,
+        _Inout_ std::size_t& scanned,
+        _Inout_ std::vector<std::uint8_t>& response,
+        _Out_ bool& subscribe) {
+    subscribe = false;
+
+    request req;
+    const auto retval = ::parse_request(input, scanned, req);
+    if (retval == 0) {
         return 0;
     }
 
-    cnt -= offset;
-    return read(handle, dst, cnt);
+    const auto supported = (req.legacy || (req.version == frame_version))
+        && ((req.type == message_type::activate)
+        || (req.type == message_type::activate_id)
+        || (req.type == message_type::list)
+        || (req.type == message_type::pin)
+        || (req.type == message_type::subscribe)
+        || (req.type == message_type::unpin));
+    if (!supported) {
+        ::OutputDebugString(_T("Rejecting unsupported request.\r\n"));
+        ::write_result(response, req,
+            HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED));
+        return retval;
+    }
+
+    // The catalogue is the response itself rather than a result.
+    if (req.type == message_type::list) {
+        const auto entries = this->_catalogue->entries();
+        const auto cnt = ::write_catalogue(response, entries);
+        if (cnt < entries.size()) {
+            ::OutputDebugString(_T("The runtime catalogue exceeds the ")
+                _T("maximum frame size and has been truncated.\r\n"));
+        }
+        return retval;
+    }
+
+    // We have a full request, so process it.
+    auto hr = S_OK;
+
+    try {
+        switch (req.type) {
+            case message_type::activate:
+            case message_type::pin: {
+                THROW_WIN32_IF(ERROR_NOT_FOUND,
+                    !::file_exists(req.runtime.c_str()));
+                const auto& wow = ::file_exists(req.wow_runtime.c_str())
+                    ? req.wow_runtime
+                    : std::wstring();
+                if (!this->activate(req.runtime, wow,
+                        (req.type == message_type::pin))) {
+                    hr = status_pending;
+                }
+                } break;
+
+            case message_type::activate_id: {
+                // The catalogue has validated the runtime before.
+                catalogue_entry entry;
+                THROW_WIN32_IF(ERROR_NOT_FOUND,
+                    !this->_catalogue->find(req.id, entry));
+                if (!this->activate(entry.path, entry.wow_path, false)) {
+                    hr = status_pending;
+                }
+                } break;
+
+            case message_type::subscribe:
+                subscribe = true;
+                break;
+
+            case message_type::unpin:
+                this->_pin->unpin();
+                break;
+        }
+    } catch (wil::ResultException ex) {
+        hr = ex.GetErrorCode();
+    } catch (...) {
+        hr = E_UNEXPECTED;
+    }
+
+    // The registry watcher will publish the change, too, but we want clients
+    // to see it as soon as they have received the response. A deferred write
+    // is published by the writer once it has been performed.
+    if ((hr == S_OK) && (req.type != message_type::subscribe)) {
+        this->publish();
+    }
+
+    ::OutputDebugString(_T("Writing response.\r\n"));
+    ::write_result(response, req, hr);
+
+    return retval;
 }
 
 
 /*
- * switcher::write
+ * switcher::publish
  */
-void switcher::write(_In_ wil::unique_hfile& handle,
-        _In_reads_bytes_(cnt) const void *data,
-        _In_ const std::size_t cnt) {
-    auto rem = static_cast<DWORD>(cnt);
-    auto src = static_cast<const std::uint8_t *>(data);
-
-    while (rem > 0) {
-        DWORD w;
-        THROW_LAST_ERROR_IF(!::WriteFile(handle.get(), src, rem, &w, nullptr));
-        assert(rem >= w);
-        src += w;
-        rem -= w;
+void switcher::publish(void) noexcept {
+    try {
+        auto active = std::make_pair(
+            registry_transaction::get_value(this->_key.get(),
+                active_runtime_value),
+            registry_transaction::get_value(this->_wow_key.get(),
+                active_runtime_value));
+
+        std::lock_guard<std::mutex> l(this->_lock);
+        if (active == this->_active) {
+            return;
+        }
+
+        this->_active = std::move(active);
+
+        if (this->_state) {
+            this->_state->publish(this->_active.first, this->_active.second);
+        }
+
+        // The transport coalesces the notifications, and the server builds
+        // the messages only when it can send them.
+        if (this->_transport) {
+            this->_transport->notify();
+        }
+    } catch (...) {
+        ::OutputDebugString(_T("Publishing the active runtime failed.\r\n"));
     }
 }
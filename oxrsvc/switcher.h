@@ -8,6 +8,17 @@
 #define _OXRSVC_SWITCHER_H
 #pragma once
 
+#include "pipe_transport.h"
+#include "registry_store.h"
+#include "registry_watcher.h"
+#include "ring_buffer.h"
+#include "runtime_catalogue.h"
+#include "runtime_pin.h"
+#include "runtime_writer.h"
+#include "shared_state.h"
+
+#include "../oxrswitch/runtime_manager.h"
+
 
 /// <summary>
 /// Implements the switcher that listens on a named pipe for change requests and
@@ -24,6 +35,15 @@ public:
 
     switcher(const switcher&) = delete;
 
+    /// <summary>
+    /// Finalises the instance.
+    /// </summary>
+    /// <remarks>
+    /// The thread watching the registry uses the keys and the shared state,
+    /// so it must be stopped before any of these are released.
+    /// </remarks>
+    ~switcher(void);
+
     /// <summary>
     /// Allocates all the necessary resources.
     /// </summary>
@@ -67,13 +87,13 @@ public:
     void status(void);
 
     /// <summary>
-    /// Asks the service to exit by closing the named pipe.
+    /// Asks the service to exit by stopping the server loop.
     /// </summary>
     void stop(void) noexcept;
 
     /// <summary>
-    /// Runs the server loop that is waiting for requests on the named pipe and
-    /// changes the registry accordingly.
+    /// Runs the server loop that is waiting for requests on all instances of
+    /// the named pipe and changes the registry accordingly.
     /// </summary>
     void operator ()(void);
 
@@ -92,11 +112,38 @@ public:
 private:
 
     /// <summary>
-    /// Adjust the DACL of the given named pipe such that normal users can write
-    /// to it.
+    /// Forwards the requests of the <see cref="server" /> to the switcher.
     /// </summary>
-    /// <param name="pipe"></param>
-    static void adjust_dacl(_In_ wil::unique_hfile& pipe);
+    struct handler final {
+        switcher *owner;
+
+        inline void notify(_Inout_ std::vector<std::uint8_t>& output) {
+            this->owner->notify(output);
+        }
+
+        inline std::size_t process(_In_ const ring_buffer& input,
+                _Inout_ std::size_t& scanned,
+                _Inout_ std::vector<std::uint8_t>& output,
+                _Out_ bool& subscribe) {
+            return this->owner->process(input, scanned, output, subscribe);
+        }
+    };
+
+    /// <summary>
+    /// Makes the given runtimes the active ones.
+    /// </summary>
+    /// <param name="runtime">The path of the native runtime, which must have
+    /// been validated.</param>
+    /// <param name="wow_runtime">The path of the WOW64 runtime, which must
+    /// have been validated, or an empty string to remove the WOW64 runtime.
+    /// </param>
+    /// <param name="pin">If <see langword="true" />, the runtimes are kept
+    /// active until another runtime is activated.</param>
+    /// <returns><see langword="true" /> if the registry has been updated,
+    /// <see langword="false" /> if the write has been deferred.</returns>
+    bool activate(_In_ const std::wstring& runtime,
+        _In_ const std::wstring& wow_runtime,
+        _In_ const bool pin);
 
     /// <summary>
     /// Gets the registry key of the latest OpenXR installation.
@@ -111,80 +158,91 @@ private:
         _In_ const bool lenient);
 
     /// <summary>
-    /// Read at most <paramref name="cnt" /> bytes from
-    /// <paramref name="handle" />.
+    /// The name of the registry value that stores the active runtime.
     /// </summary>
-    /// <param name="handle"></param>
-    /// <param name="data"></param>
-    /// <param name="cnt"></param>
-    /// <returns>The number of bytes actually read.</returns>
-    static std::size_t read(_In_ wil::unique_hfile& handle,
-        _Out_writes_bytes_(cnt) void *data,
-        _In_ const std::size_t cnt);
+    static constexpr const wchar_t *const active_runtime_value
+        = L"ActiveRuntime";
 
     /// <summary>
-    /// Read into <paramref name="data" /> at <paramref name="offset" />.
+    /// The path in the registry where the OpenXR stuff is stored.
     /// </summary>
-    /// <param name="handle"></param>
-    /// <param name="data"></param>
-    /// <param name="offset"></param>
-    /// <returns></returns>
-    static std::size_t read(_In_ wil::unique_hfile& handle,
-        _Inout_ std::vector<std::uint8_t>& data,
-        _In_ const std::size_t offset = 0);
+    static constexpr const wchar_t *const openxr_key = L"SOFTWARE\\Khronos\\"
+        L"OpenXR";
 
     /// <summary>
-    /// Scans the given input range for the end of a request.
+    /// The name of the named pipe we use to communicate with the tool.
     /// </summary>
-    /// <typeparam name="TIterator"></typeparam>
-    /// <param name="begin"></param>
-    /// <param name="end"></param>
-    /// <param name="length"></param>
-    /// <returns></returns>
-    template<class TIterator> static bool scan(_In_ const TIterator begin,
-        _In_ const TIterator end, _Out_ std::size_t& length);
+    static constexpr const wchar_t *const pipe_name = L"\\\\.\\pipe\\oxrswitch";
 
     /// <summary>
-    /// Write all <paramref name="cnt" /> bytes to <paramref name="handle" />.
+    /// The number of instances of the named pipe, which is the number of
+    /// clients that can be served concurrently. Each subscriber occupies an
+    /// instance as long as it is connected.
     /// </summary>
-    /// <param name="handle"></param>
-    /// <param name="data"></param>
-    /// <param name="cnt"></param>
-    static void write(_In_ wil::unique_hfile& handle,
-        _In_reads_bytes_(cnt) const void *data,
-        _In_ const std::size_t cnt);
+    static constexpr std::size_t pipe_instances = 16;
 
     /// <summary>
-    /// The name of the registry value that stores the active runtime.
+    /// The path in the registry to the 32-bit stuff of OpenXR.
     /// </summary>
-    static constexpr const wchar_t *const active_runtime_value
-        = L"ActiveRuntime";
+    static constexpr const wchar_t *const wow_key = L"SOFTWARE\\WOW6432Node\\"
+        "Khronos\\OpenXR";
 
     /// <summary>
-    /// The path in the registry where the OpenXR stuff is stored.
+    /// The minimum time between two writes of the active runtime. Requests
+    /// arriving faster are coalesced such that only the last one is written.
     /// </summary>
-    static constexpr const wchar_t *const openxr_key = L"SOFTWARE\\Khronos\\"
-        L"OpenXR";
+    static constexpr std::chrono::milliseconds write_window
+        = std::chrono::milliseconds(50);
 
     /// <summary>
-    /// The name of the named pipe we use to communicate with the tool.
+    /// Appends a notification about the active runtime to
+    /// <paramref name="output" />.
     /// </summary>
-    static constexpr const wchar_t *const pipe_name = L"\\\\.\\pipe\\oxrswitch";
+    /// <param name="output"></param>
+    void notify(_Inout_ std::vector<std::uint8_t>& output);
 
     /// <summary>
-    /// The path in the registry to the 32-bit stuff of OpenXR.
+    /// Processes the request at the begin of <paramref name="input" /> if it
+    /// is complete.
     /// </summary>
-    static constexpr const wchar_t *const wow_key = L"SOFTWARE\\WOW6432Node\\"
-        "Khronos\\OpenXR";
+    /// <param name="input"></param>
+    /// <param name="scanned">The part of <paramref name="input" /> that has
+    /// already been searched for the end of the request.</param>
+    /// <param name="response">Receives the result of the request.</param>
+    /// <param name="subscribe">Set if the client subscribed to changes.
+    /// </param>
+    /// <returns>The size of the request in bytes or zero if the request is
+    /// not yet complete.</returns>
+    /// <exception cref="std::invalid_argument">If the input is not a valid
+    /// request.</exception>
+    std::size_t process(_In_ const ring_buffer& input,
+        _Inout_ std::size_t& scanned,
+        _Inout_ std::vector<std::uint8_t>& response,
+        _Out_ bool& subscribe);
+
+    /// <summary>
+    /// Publishes the active runtimes from the registry in the shared state
+    /// and notifies the subscribers if they have changed.
+    /// </summary>
+    /// <remarks>
+    /// This method is called from the server loop and from the thread
+    /// watching the registry.
+    /// </remarks>
+    void publish(void) noexcept;
 
+    std::pair<std::wstring, std::wstring> _active;
+    std::unique_ptr<runtime_catalogue> _catalogue;
+    std::unique_ptr<runtime_manager> _discovery;
     SERVICE_STATUS_HANDLE _handle;
     wil::unique_hkey _key;
-    wil::unique_hfile _pipe;
+    std::mutex _lock;
+    std::unique_ptr<runtime_pin<registry_watcher, registry_store>> _pin;
     std::atomic<bool> _running;
+    std::unique_ptr<state_publisher> _state;
     SERVICE_STATUS _status;
+    std::unique_ptr<pipe_transport> _transport;
     wil::unique_hkey _wow_key;
+    std::unique_ptr<runtime_writer> _writer;
 };
 
-#include "switcher.inl"
-
 #endif /* !defined(_OXRSVC_SWITCHER_H) */
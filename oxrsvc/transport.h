@@ -0,0 +1,98 @@
+// <copyright file="transport.h" company="Visualisierungsinstitut der Universitt Stuttgart">
+// Copyright  2025 Visualisierungsinstitut der Universitt Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Mller</author>
+
+#if !defined(_OXRSVC_TRANSPORT_H)
+#define _OXRSVC_TRANSPORT_H
+#pragma once
+
+
+/// <summary>
+/// Identifies the asynchronous operations a transport of the
+/// <see cref="server" /> can perform.
+/// </summary>
+enum class transport_operation {
+
+    /// <summary>
+    /// Waiting for a client to connect to an instance.
+    /// </summary>
+    accept,
+
+    /// <summary>
+    /// Reading data from the client.
+    /// </summary>
+    read,
+
+    /// <summary>
+    /// Writing data to the client.
+    /// </summary>
+    write,
+
+    /// <summary>
+    /// Someone called <c>notify</c> on the transport. The instance of such a
+    /// completion is meaningless.
+    /// </summary>
+    notify
+};
+
+
+/// <summary>
+/// Describes the completion of an asynchronous operation of a transport.
+/// </summary>
+/// <remarks>
+/// <para>A transport manages a fixed number of instances, each of which can
+/// be connected to one client at a time. A transport must provide the
+/// following methods:</para>
+/// <list type="bullet">
+/// <item><c>std::size_t instances(void) const</c> returns the number of
+/// instances.</item>
+/// <item><c>void accept(std::size_t instance)</c> starts waiting for a client
+/// to connect to the instance.</item>
+/// <item><c>void read(std::size_t instance, void *dst, std::size_t cnt)
+/// </c> starts reading at most <c>cnt</c> bytes.</item>
+/// <item><c>void write(std::size_t instance, const void *src,
+/// std::size_t cnt)</c> starts writing at most <c>cnt</c> bytes.</item>
+/// <item><c>void cancel(std::size_t instance)</c> aborts all pending
+/// operations of the instance, which still complete with an error.</item>
+/// <item><c>void disconnect(std::size_t instance)</c> closes the connection
+/// of an instance without pending operations.</item>
+/// <item><c>bool wait(transport_completion&amp; completion)</c> blocks until
+/// any operation completed or returns <see langword="false" /> if the
+/// transport has been stopped.</item>
+/// <item><c>void stop(void)</c> makes <c>wait</c> return
+/// <see langword="false" />, which may be called from any thread.</item>
+/// <item><c>void notify(void)</c> makes <c>wait</c> report a completion of
+/// <see cref="transport_operation::notify" />, which may be called from any
+/// thread. Calls made before the completion has been reported are coalesced
+/// into a single one.</item>
+/// </list>
+/// <para>Every operation that has been started must be reported exactly once
+/// by <c>wait</c>, including the ones that failed immediately, and at most one
+/// read or accept and one write may be pending per instance.</para>
+/// </remarks>
+struct transport_completion final {
+
+    /// <summary>
+    /// The number of bytes transferred.
+    /// </summary>
+    std::size_t cnt;
+
+    /// <summary>
+    /// A platform-specific error code or zero in case of success.
+    /// </summary>
+    std::uint32_t error;
+
+    /// <summary>
+    /// The zero-based index of the instance the operation was started on.
+    /// </summary>
+    std::size_t instance;
+
+    /// <summary>
+    /// The operation that completed.
+    /// </summary>
+    transport_operation operation;
+};
+
+#endif /* !defined(_OXRSVC_TRANSPORT_H) */
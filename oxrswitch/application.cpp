@@ -21,6 +21,21 @@
 #endif /* defined(_M_IX86) */
 
 
+/*
+ * application::~application
+ */
+application::~application(void) {
+    if (this->_discovery) {
+        this->_discovery->cancel();
+        this->_discovery.reset();
+    }
+
+    if (this->_disposer.joinable()) {
+        this->_disposer.join();
+    }
+}
+
+
 /*
  * application::run
  */
@@ -91,22 +106,8 @@ int application::run(_In_ const int show_command) {
             Button_SetElevationRequiredState(btn_permissions, TRUE);
         }
 
-        // Populate the runtimes.
-        HWND cb = ::GetDlgItem(this->_dlg.get(), IDC_COMBO_RUNTIMES);
-        THROW_LAST_ERROR_IF(!cb);
-
-        for (auto& r : this->_manager) {
-            ::SendMessageW(cb,
-                CB_ADDSTRING,
-                0,
-                reinterpret_cast<LPARAM>(r.name().c_str()));
-        }
-
-        int selected = -1;
-        try {
-            this->_manager.active_runtime(&selected);
-        } catch (...) { /* Just select nothing in this case. */ }
-        ::SendMessageW(cb, CB_SETCURSEL, selected, 0);
+        // Populate the runtimes while the window is already visible.
+        this->discover_runtimes();
 
         ::ShowWindow(this->_dlg.get(), SW_SHOW);
 
@@ -214,6 +215,72 @@ LRESULT CALLBACK application::about_proc(
 }
 
 
+/*
+ * application::activate
+ */
+void application::activate(_In_ const runtime& runtime) {
+    // The identifiers are only valid as long as the service is running, so
+    // we must not use the ones from the last time we asked.
+    this->load_catalogue();
+
+    auto it = std::find_if(this->_catalogue.begin(),
+        this->_catalogue.end(),
+        [&runtime](const runtime_manager::service_runtime& r) {
+            return ::equals(r.second.path(), runtime.path(), false);
+        });
+    if ((it != this->_catalogue.end())
+            && runtime_manager::activate_in_service(it->first)) {
+        return;
+    }
+
+    // The service is not running or does not know the runtime, so we try to
+    // change the registry ourselves.
+    this->_manager.active_runtime(runtime);
+}
+
+
+/*
+ * application::add_runtime
+ */
+void application::add_runtime(_Inout_ runtime&& runtime) {
+    HWND cb = ::GetDlgItem(this->_dlg.get(), IDC_COMBO_RUNTIMES);
+    THROW_LAST_ERROR_IF(!cb);
+
+    // The catalogue of the service and the discovery report most runtimes
+    // both.
+    if (std::any_of(this->_runtimes.begin(),
+            this->_runtimes.end(),
+            [&runtime](const ::runtime& r) {
+                return ::equals(r.path(), runtime.path(), false);
+            })) {
+        return;
+    }
+
+    // The item data refer to our copy of the runtimes, because the index in
+    // the combo box is not necessarily the order in which we found them.
+    const auto index = ::SendMessageW(cb,
+        CB_ADDSTRING,
+        0,
+        reinterpret_cast<LPARAM>(runtime.name().c_str()));
+    if ((index == CB_ERR) || (index == CB_ERRSPACE)) {
+        return;
+    }
+
+    ::SendMessageW(cb,
+        CB_SETITEMDATA,
+        index,
+        static_cast<LPARAM>(this->_runtimes.size()));
+    this->_runtimes.push_back(std::move(runtime));
+
+    // Select the active runtime unless the user has already chosen another
+    // one while we were still searching.
+    if (::equals(this->_runtimes.back().path(), this->_active, false)
+            && (::SendMessageW(cb, CB_GETCURSEL, 0, 0) == CB_ERR)) {
+        ::SendMessageW(cb, CB_SETCURSEL, index, 0);
+    }
+}
+
+
 /*
  * application::authenticated_users
  */
@@ -243,6 +310,43 @@ LRESULT CALLBACK application::dlg_proc(
         case WM_INITDIALOG:
             return TRUE;
 
+        // Messages from a previous discovery might still be queued after a
+        // new one has been started, in which case we only free their data.
+        case msg_runtime_found: {
+            std::unique_ptr<runtime> r(reinterpret_cast<runtime *>(lparam));
+            if (wparam == that->_generation) {
+                try {
+                    that->add_runtime(std::move(*r));
+                } catch (...) { /* Just skip the runtime in this case. */ }
+            }
+            } return TRUE;
+
+        case msg_discovery_completed: {
+            std::unique_ptr<std::exception_ptr> e(
+                reinterpret_cast<std::exception_ptr *>(lparam));
+            if (wparam == that->_generation) {
+                that->discovery_completed(*e);
+            }
+            } return TRUE;
+
+        case msg_runtimes_changed: {
+            std::unique_ptr<runtime_manager::snapshot_type> r(
+                reinterpret_cast<runtime_manager::snapshot_type *>(lparam));
+            if (wparam == that->_generation) {
+                try {
+                    that->update_runtimes(*r);
+                } catch (...) { /* Keep the previous list in this case. */ }
+            }
+            } return TRUE;
+
+        case msg_watch_failed: {
+            std::unique_ptr<std::exception_ptr> e(
+                reinterpret_cast<std::exception_ptr *>(lparam));
+            if (wparam == that->_generation) {
+                that->watch_failed(*e);
+            }
+            } return TRUE;
+
         case WM_COMMAND:
             switch (LOWORD(wparam)) {
                 case IDCLOSE:
@@ -254,9 +358,15 @@ LRESULT CALLBACK application::dlg_proc(
                         // If the selection in the combobox changes, notify the
                         // runtime manager to update the active runtime.
                         try {
-                            that->_manager.active_runtime(static_cast<int>(
-                                ::SendMessageW(reinterpret_cast<HWND>(lparam),
-                                    CB_GETCURSEL, 0, 0)));
+                            auto cb = reinterpret_cast<HWND>(lparam);
+                            auto sel = ::SendMessageW(cb, CB_GETCURSEL, 0, 0);
+                            if (sel != CB_ERR) {
+                                auto& r = that->_runtimes.at(
+                                    static_cast<std::size_t>(::SendMessageW(cb,
+                                        CB_GETITEMDATA, sel, 0)));
+                                that->activate(r);
+                                that->_active = r.path();
+                            }
                         } catch (std::exception& ex) {
                             ::MessageBoxA(that->_wnd.get(), ex.what(), nullptr,
                                 MB_OK | MB_ICONERROR);
@@ -291,8 +401,13 @@ LRESULT CALLBACK application::dlg_proc(
                                 execute.hProcess, &exit_code));
                             THROW_IF_WIN32_ERROR(exit_code);
 
-                            // Recreate the manager with proper access.
-                            that->_manager = runtime_manager();
+                            // Recreate the manager with proper access and
+                            // search again, because the runtimes registered
+                            // with OpenXR might not have been accessible
+                            // before.
+                            that->_manager = runtime_manager(
+                                runtime_manager::no_discovery);
+                            that->discover_runtimes();
                         }
                     } catch (std::exception& ex) {
                         ::MessageBoxA(that->_wnd.get(), ex.what(), nullptr,
@@ -307,6 +422,125 @@ LRESULT CALLBACK application::dlg_proc(
 }
 
 
+/*
+ * application::discover_runtimes
+ */
+void application::discover_runtimes(void) {
+    HWND cb = ::GetDlgItem(this->_dlg.get(), IDC_COMBO_RUNTIMES);
+    THROW_LAST_ERROR_IF(!cb);
+    ::SendMessageW(cb, CB_RESETCONTENT, 0, 0);
+    this->_runtimes.clear();
+
+    try {
+        this->_active = this->_manager.active_path();
+    } catch (...) { /* Just select nothing in this case. */ }
+
+    // The service has searched the system before, so its catalogue fills the
+    // list right away. The discovery only adds what the service cannot see,
+    // because the list skips runtimes it already has.
+    this->load_catalogue();
+    try {
+        this->merge_catalogue();
+    } catch (...) { /* The discovery will find the runtimes anyway. */ }
+
+    // Stopping the previous discovery waits for its threads, which might be
+    // searching the system right now, so this must not block the message
+    // loop. Cancelling it keeps it from reporting anything else, and
+    // anything it already posted is dropped due to its old generation. The
+    // disposer also joins its predecessor, such that only the last one needs
+    // to be joined when the application exits.
+    if (this->_discovery) {
+        this->_discovery->cancel();
+        this->_disposer = std::thread([](
+                std::unique_ptr<runtime_discovery> discovery,
+                std::thread previous) {
+            discovery.reset();
+            if (previous.joinable()) {
+                previous.join();
+            }
+        }, std::move(this->_discovery), std::move(this->_disposer));
+    }
+
+    // The callbacks run on background threads, so we post everything to the
+    // dialog. If posting fails, the dialog is gone and we must free the data.
+    const auto dlg = this->_dlg.get();
+    const auto generation = ++this->_generation;
+    this->_discovery.reset(new runtime_discovery(
+        [dlg, generation](const runtime& r) {
+            std::unique_ptr<runtime> data(new runtime(r));
+            if (::PostMessageW(dlg,
+                    msg_runtime_found,
+                    generation,
+                    reinterpret_cast<LPARAM>(data.get()))) {
+                data.release();
+            }
+        },
+        [dlg, generation](std::exception_ptr e) {
+            std::unique_ptr<std::exception_ptr> data(
+                new std::exception_ptr(std::move(e)));
+            if (::PostMessageW(dlg,
+                    msg_discovery_completed,
+                    generation,
+                    reinterpret_cast<LPARAM>(data.get()))) {
+                data.release();
+            }
+        },
+        [dlg, generation](const runtime_manager::snapshot_type& s) {
+            std::unique_ptr<runtime_manager::snapshot_type> data(
+                new runtime_manager::snapshot_type(s));
+            if (::PostMessageW(dlg,
+                    msg_runtimes_changed,
+                    generation,
+                    reinterpret_cast<LPARAM>(data.get()))) {
+                data.release();
+            }
+        },
+        [dlg, generation](std::exception_ptr e) {
+            std::unique_ptr<std::exception_ptr> data(
+                new std::exception_ptr(std::move(e)));
+            if (::PostMessageW(dlg,
+                    msg_watch_failed,
+                    generation,
+                    reinterpret_cast<LPARAM>(data.get()))) {
+                data.release();
+            }
+        }));
+}
+
+
+/*
+ * application::discovery_completed
+ */
+void application::discovery_completed(_In_ const std::exception_ptr& error) {
+    {
+        using namespace std::chrono;
+        const auto first = duration_cast<milliseconds>(
+            this->_discovery->time_to_first());
+        const auto complete = duration_cast<milliseconds>(
+            this->_discovery->time_to_complete());
+        const auto msg = L"Runtime discovery: first runtime after "
+            + std::to_wstring(first.count())
+            + L" ms, completed after "
+            + std::to_wstring(complete.count())
+            + L" ms.\n";
+        ::OutputDebugStringW(msg.c_str());
+    }
+
+    if (error) {
+        try {
+            std::rethrow_exception(error);
+        } catch (std::exception& ex) {
+            ::MessageBoxA(this->_wnd.get(), ex.what(), nullptr,
+                MB_OK | MB_ICONERROR);
+        } catch (...) {
+            auto msg = ::load_wstring(this->_instance, IDS_ERROR_UNEXPECTED);
+            ::MessageBoxW(this->_wnd.get(), msg.c_str(), nullptr,
+                MB_OK | MB_ICONERROR);
+        }
+    }
+}
+
+
 /*
  * application::is_ace
  */
@@ -331,6 +565,29 @@ bool application::is_ace(_In_ const PACE_HEADER ace,
 }
 
 
+/*
+ * application::load_catalogue
+ */
+void application::load_catalogue(void) {
+    try {
+        runtime_manager::get_service_runtimes(this->_catalogue);
+    } catch (...) {
+        // We change the registry ourselves if we cannot talk to the service.
+        this->_catalogue.clear();
+    }
+}
+
+
+/*
+ * application::merge_catalogue
+ */
+void application::merge_catalogue(void) {
+    for (auto& r : this->_catalogue) {
+        this->add_runtime(runtime(r.second));
+    }
+}
+
+
 /*
  * application::remove_ace
  */
@@ -390,6 +647,54 @@ int application::remove_ace(_In_ wil::unique_hkey& key) {
 }
 
 
+/*
+ * application::update_runtimes
+ */
+void application::update_runtimes(
+        _In_ const runtime_manager::snapshot_type& runtimes) {
+    assert(runtimes != nullptr);
+    HWND cb = ::GetDlgItem(this->_dlg.get(), IDC_COMBO_RUNTIMES);
+    THROW_LAST_ERROR_IF(!cb);
+
+    // The active runtime might have been removed or changed by the installer
+    // of a runtime, so we select what is in the registry now.
+    try {
+        this->_active = this->_manager.active_path();
+    } catch (...) {
+        this->_active.clear();
+    }
+
+    ::SendMessageW(cb, CB_RESETCONTENT, 0, 0);
+    this->_runtimes.clear();
+    this->_runtimes.reserve(runtimes->size());
+
+    for (auto& r : *runtimes) {
+        this->add_runtime(runtime(r));
+    }
+
+    // The service watches the same things, so its catalogue has most likely
+    // changed, too.
+    this->load_catalogue();
+    this->merge_catalogue();
+}
+
+
+/*
+ * application::watch_failed
+ */
+void application::watch_failed(_In_ const std::exception_ptr& error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (std::exception& ex) {
+        ::OutputDebugStringA(ex.what());
+    } catch (...) { /* The details are only for debugging anyway. */ }
+
+    auto msg = ::load_wstring(this->_instance, IDS_ERROR_WATCH);
+    ::MessageBoxW(this->_wnd.get(), msg.c_str(), nullptr,
+        MB_OK | MB_ICONWARNING);
+}
+
+
 /*
  * application::wnd_proc
  */
@@ -8,6 +8,7 @@
 #define _OXRSWITCH_APPLICATION_H
 #pragma once
 
+#include "runtime_discovery.h"
 #include "runtime_manager.h"
 
 
@@ -48,11 +49,22 @@ public:
     /// Initialises a new instance.
     /// </summary>
     /// <param name="instance">The instance handle of the application.</param>
-    inline application(_In_ const HINSTANCE instance) noexcept
-        : _instance(instance) { }
+    inline application(_In_ const HINSTANCE instance)
+        : _generation(0),
+        _instance(instance),
+        _manager(runtime_manager::no_discovery) { }
 
     application(const application&) = delete;
 
+    /// <summary>
+    /// Finalises the instance.
+    /// </summary>
+    /// <remarks>
+    /// The destructor cancels the discovery and waits for it and for any
+    /// discovery that is still being disposed of.
+    /// </remarks>
+    ~application(void);
+
     /// <summary>
     /// Runs the message loop.
     /// </summary>
@@ -64,6 +76,39 @@ public:
 
 private:
 
+    /// <summary>
+    /// The message posted to the dialog for each runtime found. The
+    /// <c>WPARAM</c> is the generation of the discovery and the <c>LPARAM</c>
+    /// is a heap-allocated <see cref="runtime" /> that the receiver takes
+    /// ownership of.
+    /// </summary>
+    static constexpr UINT msg_runtime_found = WM_APP + 1;
+
+    /// <summary>
+    /// The message posted to the dialog once the discovery has completed. The
+    /// <c>WPARAM</c> is the generation of the discovery and the <c>LPARAM</c>
+    /// is a heap-allocated <c>std::exception_ptr</c> that the receiver takes
+    /// ownership of.
+    /// </summary>
+    static constexpr UINT msg_discovery_completed = WM_APP + 2;
+
+    /// <summary>
+    /// The message posted to the dialog whenever the runtimes have changed
+    /// after the discovery has completed. The <c>WPARAM</c> is the generation
+    /// of the discovery and the <c>LPARAM</c> is a heap-allocated
+    /// <see cref="runtime_manager::snapshot_type" /> that the receiver takes
+    /// ownership of.
+    /// </summary>
+    static constexpr UINT msg_runtimes_changed = WM_APP + 3;
+
+    /// <summary>
+    /// The message posted to the dialog if watching the system failed. The
+    /// <c>WPARAM</c> is the generation of the discovery and the <c>LPARAM</c>
+    /// is a heap-allocated <c>std::exception_ptr</c> that the receiver takes
+    /// ownership of.
+    /// </summary>
+    static constexpr UINT msg_watch_failed = WM_APP + 4;
+
     static constexpr const wchar_t *const window_class = L"OXRSWITCHWND";
 
     static int add_ace(_In_ wil::unique_hkey& key);
@@ -85,14 +130,83 @@ private:
 
     static int remove_ace(_In_ wil::unique_hkey& key);
 
+    /// <summary>
+    /// Makes <paramref name="runtime" /> the active runtime, preferably by
+    /// asking the service, which does not require the ACLs of the keys to be
+    /// adjusted.
+    /// </summary>
+    /// <param name="runtime"></param>
+    void activate(_In_ const runtime& runtime);
+
+    /// <summary>
+    /// Adds a runtime that has been found to the combo box and selects it if
+    /// it is the active one.
+    /// </summary>
+    /// <remarks>
+    /// Runtimes that are already in the combo box are ignored.
+    /// </remarks>
+    /// <param name="runtime"></param>
+    void add_runtime(_Inout_ runtime&& runtime);
+
+    /// <summary>
+    /// Fills the list of runtimes from the catalogue of the service and
+    /// starts searching the runtimes in the background, which adds the ones
+    /// the service does not know, after which the system is watched for
+    /// changes.
+    /// </summary>
+    void discover_runtimes(void);
+
+    /// <summary>
+    /// Handles the completion of the discovery.
+    /// </summary>
+    /// <param name="error"></param>
+    void discovery_completed(_In_ const std::exception_ptr& error);
+
+    /// <summary>
+    /// Retrieves the catalogue of the service, which remains empty if the
+    /// service is not running.
+    /// </summary>
+    void load_catalogue(void);
+
+    /// <summary>
+    /// Adds the runtimes from the catalogue of the service that are not yet
+    /// in the list, which includes the ones the user cannot access.
+    /// </summary>
+    void merge_catalogue(void);
+
+    /// <summary>
+    /// Replaces the runtimes in the combo box with
+    /// <paramref name="runtimes" />.
+    /// </summary>
+    /// <param name="runtimes"></param>
+    void update_runtimes(_In_ const runtime_manager::snapshot_type& runtimes);
+
+    /// <summary>
+    /// Tells the user that the list of runtimes is not updated anymore,
+    /// because watching the system failed.
+    /// </summary>
+    /// <param name="error"></param>
+    void watch_failed(_In_ const std::exception_ptr& error);
+
     static LRESULT CALLBACK wnd_proc(_In_ const HWND wnd,
         _In_ const UINT message,
         _In_ const WPARAM wparam,
         _In_ const LPARAM lparam);
 
+    std::wstring _active;
+    std::vector<runtime_manager::service_runtime> _catalogue;
+    std::unique_ptr<runtime_discovery> _discovery;
+
+    /// <summary>
+    /// The thread disposing of the discoveries that have been replaced,
+    /// which must be joined before the application exits.
+    /// </summary>
+    std::thread _disposer;
     wil::unique_hwnd _dlg;
+    WPARAM _generation;
     HINSTANCE _instance;
     runtime_manager _manager;
+    std::vector<runtime> _runtimes;
     wil::unique_hwnd _wnd;
 };
 
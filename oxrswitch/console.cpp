@@ -0,0 +1,489 @@
+﻿// <copyright file="console.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+#include "console.h"
+
+#include "resource.h"
+
+
+#if defined(_WIN32)
+/// <summary>
+/// Quotes <paramref name="arg" /> such that <c>CommandLineToArgvW</c> yields
+/// the original string.
+/// </summary>
+static std::wstring quote(_In_ const std::wstring& arg) {
+    if (!arg.empty() && (arg.find_first_of(L" \t\n\v\"") == arg.npos)) {
+        return arg;
+    }
+
+    std::wstring retval(1, L'"');
+    std::size_t backslashes = 0;
+
+    for (auto c : arg) {
+        if (c == L'\\') {
+            ++backslashes;
+            continue;
+        }
+
+        // Backslashes are only special if they precede a quote, in which case
+        // each of them must be escaped along with the quote itself.
+        if (c == L'"') {
+            retval.append(2 * backslashes + 1, L'\\');
+        } else {
+            retval.append(backslashes, L'\\');
+        }
+
+        retval.push_back(c);
+        backslashes = 0;
+    }
+
+    // The backslashes at the end precede our closing quote.
+    retval.append(2 * backslashes, L'\\');
+    retval.push_back(L'"');
+    return retval;
+}
+
+#else /* defined(_WIN32) */
+/// <summary>
+/// Creates the null-terminated array of pointers to
+/// <paramref name="strings" /> that <c>posix_spawn</c> expects for the
+/// arguments and the environment.
+/// </summary>
+static std::vector<char *> to_argv(_In_ std::vector<std::string>& strings) {
+    std::vector<char *> retval;
+    retval.reserve(strings.size() + 1);
+    for (auto& s : strings) {
+        retval.push_back(s.data());
+    }
+    retval.push_back(nullptr);
+    return retval;
+}
+#endif /* defined(_WIN32) */
+
+
+#if defined(_WIN32)
+/*
+ * console::console
+ */
+console::console(void) : _output(nullptr) {
+    int cnt = 0;
+    wil::unique_hlocal_ptr<LPWSTR> args(::CommandLineToArgvW(
+        ::GetCommandLineW(), &cnt));
+    THROW_LAST_ERROR_IF_NULL(args);
+
+    // Skip the name of the executable.
+    for (int i = 1; i < cnt; ++i) {
+        this->_args.emplace_back(args.get()[i]);
+    }
+}
+#endif /* defined(_WIN32) */
+
+
+/*
+ * console::console
+ */
+console::console(_In_ const std::vector<std::wstring>& args,
+        _In_opt_ std::ostream *output)
+    : _args(args), _output(output) { }
+
+
+/*
+ * console::headless
+ */
+bool console::headless(void) const noexcept {
+    if (this->_args.empty()) {
+        return false;
+    }
+
+    auto& c = this->_args.front();
+    return (::equals(c, L"/list", false)
+        || ::equals(c, L"/get", false)
+        || ::equals(c, L"/launch", false)
+        || ::equals(c, L"/set", false));
+}
+
+
+/*
+ * console::run
+ */
+int console::run(void) noexcept {
+    try {
+        auto& c = this->_args.front();
+
+        if (::equals(c, L"/list", false)) {
+            return this->list();
+        } else if (::equals(c, L"/get", false)) {
+            return this->get();
+        } else if (::equals(c, L"/launch", false)) {
+            return this->launch();
+        } else {
+            return this->set();
+        }
+
+    } catch (std::exception& ex) {
+        this->write({ { "error", ex.what() } });
+        return exit_failure;
+    } catch (...) {
+#if defined(_WIN32)
+        this->write({ { "error", ::load_string(NULL, IDS_ERROR_UNEXPECTED) } });
+#else /* defined(_WIN32) */
+        this->write({ { "error", "An unexpected error occurred." } });
+#endif /* defined(_WIN32) */
+        return exit_failure;
+    }
+}
+
+
+/*
+ * console::find
+ */
+std::vector<runtime>::const_iterator console::find(
+        _In_ const std::vector<runtime>::const_iterator begin,
+        _In_ const std::vector<runtime>::const_iterator end,
+        _In_ const std::wstring& requested,
+        _Out_ bool& ambiguous) {
+    ambiguous = false;
+
+    auto retval = std::find_if(begin,
+        end,
+        [&requested](const runtime& r) {
+            return ::equals(r.path(), requested, false);
+        });
+
+    if (retval == end) {
+        const auto is_match = [&requested](const runtime& r) {
+            return ::equals(r.name(), requested, false);
+        };
+
+        retval = std::find_if(begin, end, is_match);
+
+        if ((retval != end)
+                && (std::find_if(retval + 1, end, is_match) != end)) {
+            ambiguous = true;
+            retval = end;
+        }
+    }
+
+    return retval;
+}
+
+
+/*
+ * console::to_json
+ */
+nlohmann::json console::to_json(_In_ const runtime& runtime,
+        _In_ const bool active) {
+    nlohmann::json retval;
+    retval["name"] = ::to_utf8(runtime.name());
+    retval["path"] = ::to_utf8(runtime.path());
+    if (runtime.wow_path().empty()) {
+        retval["wowPath"] = nullptr;
+    } else {
+        retval["wowPath"] = ::to_utf8(runtime.wow_path());
+    }
+    retval["active"] = active;
+    return retval;
+}
+
+
+/*
+ * console::get_active
+ */
+int console::get_active(_In_ const runtime_manager& manager) noexcept {
+    try {
+        int retval = -1;
+        manager.active_runtime(&retval);
+        return retval;
+    } catch (...) {
+        // There is no active runtime or it is not one we know.
+        return -1;
+    }
+}
+
+
+/*
+ * console::get
+ */
+int console::get(void) {
+    if (this->_args.size() != 1) {
+        this->write({ { "error", "Usage: /get" } });
+        return exit_usage;
+    }
+
+    runtime_manager manager;
+    const auto active = get_active(manager);
+
+    if (active < 0) {
+        this->write(nullptr);
+        return exit_not_found;
+    }
+
+    this->write(to_json(manager.snapshot()->at(active), true));
+    return exit_success;
+}
+
+
+/*
+ * console::launch
+ */
+int console::launch(void) {
+    if (this->_args.size() < 3) {
+        this->write({ { "error", "Usage: /launch <name|path> <executable> "
+            "[arguments]" } });
+        return exit_usage;
+    }
+
+    auto& requested = this->_args[1];
+    bool ambiguous = false;
+    runtime rt;
+
+    // Starting the application should not be delayed by the discovery, so if
+    // the previous discovery has found the runtime and it is still there, we
+    // use it right away. This does not check whether any new runtime with the
+    // same name has been installed in the meantime.
+    {
+        const auto cache = discovery_cache::load(
+            discovery_cache::default_path());
+        auto& runtimes = cache.runtimes();
+        auto it = find(runtimes.begin(), runtimes.end(), requested, ambiguous);
+        if ((it != runtimes.end()) && ::file_exists(it->path().c_str())) {
+            rt = *it;
+        }
+    }
+
+    if (rt.path().empty()) {
+        runtime_manager manager;
+        const auto runtimes = manager.snapshot();
+        auto it = find(runtimes->begin(), runtimes->end(), requested,
+            ambiguous);
+
+        if (ambiguous) {
+            this->write({ { "error", "The runtime name is ambiguous. "
+                "Specify the path instead." } });
+            return exit_not_found;
+        }
+
+        if (it == runtimes->end()) {
+            this->write({ { "error", "The runtime was not found." } });
+            return exit_not_found;
+        }
+
+        rt = *it;
+    }
+
+#if defined(_WIN32)
+    // The loader of a 32-bit application must be pointed to the WOW64 version
+    // of the runtime, because it cannot load the 64-bit one.
+    auto executable = this->_args[2];
+    {
+        std::vector<wchar_t> path(MAX_PATH);
+        const auto len = ::SearchPathW(nullptr,
+            executable.c_str(),
+            L".exe",
+            static_cast<DWORD>(path.size()),
+            path.data(),
+            nullptr);
+        if ((len > 0) && (len < path.size())) {
+            executable.assign(path.data(), len);
+        }
+    }
+
+    DWORD type = 0;
+    const auto is_wow = ::GetBinaryTypeW(executable.c_str(), &type)
+        && (type == SCS_32BIT_BINARY);
+    auto& manifest = is_wow ? rt.wow_path() : rt.path();
+    if (manifest.empty()) {
+        this->write({ { "error", "The runtime has no 32-bit version." } });
+        return exit_not_found;
+    }
+
+    // The child inherits our environment, which we do not need for anything
+    // else, as we exit right after starting it.
+    THROW_LAST_ERROR_IF(!::SetEnvironmentVariableW(runtime_variable,
+        manifest.c_str()));
+
+    auto cmd_line = quote(executable);
+    for (auto it = this->_args.begin() + 3; it != this->_args.end(); ++it) {
+        cmd_line += L' ';
+        cmd_line += quote(*it);
+    }
+
+    STARTUPINFOW si;
+    ::ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    wil::unique_process_information pi;
+    THROW_LAST_ERROR_IF(!::CreateProcessW(executable.c_str(),
+        cmd_line.data(),
+        nullptr,
+        nullptr,
+        FALSE,
+        0,
+        nullptr,
+        nullptr,
+        &si,
+        &pi));
+
+    auto retval = to_json(rt, false);
+    retval["processId"] = pi.dwProcessId;
+    retval["runtimeJson"] = ::to_utf8(manifest);
+    this->write(retval);
+    return exit_success;
+
+#else /* defined(_WIN32) */
+    // There is no WOW64 on Linux, so the manifest is always the native one.
+    auto& manifest = rt.path();
+
+    // The child gets a copy of our environment with the variable replaced
+    // instead of us changing our own environment, which is not thread-safe.
+    const auto prefix = ::to_utf8(runtime_variable) + "=";
+    std::vector<std::string> env;
+    for (auto e = environ; *e != nullptr; ++e) {
+        if (std::strncmp(*e, prefix.c_str(), prefix.size()) != 0) {
+            env.emplace_back(*e);
+        }
+    }
+    env.push_back(prefix + ::to_utf8(manifest));
+
+    std::vector<std::string> args;
+    for (auto it = this->_args.begin() + 2; it != this->_args.end(); ++it) {
+        args.push_back(::to_utf8(*it));
+    }
+
+    auto argv = to_argv(args);
+    auto envp = to_argv(env);
+    pid_t pid = 0;
+    THROW_IF_WIN32_ERROR(::posix_spawnp(&pid,
+        argv.front(),
+        nullptr,
+        nullptr,
+        argv.data(),
+        envp.data()));
+
+    auto retval = to_json(rt, false);
+    retval["processId"] = pid;
+    retval["runtimeJson"] = ::to_utf8(manifest);
+    this->write(retval);
+    return exit_success;
+#endif /* defined(_WIN32) */
+}
+
+
+/*
+ * console::list
+ */
+int console::list(void) {
+    if (this->_args.size() != 1) {
+        this->write({ { "error", "Usage: /list" } });
+        return exit_usage;
+    }
+
+    runtime_manager manager;
+    const auto active = get_active(manager);
+
+    auto retval = nlohmann::json::array();
+    int i = 0;
+    for (auto& r : *manager.snapshot()) {
+        retval.push_back(to_json(r, (i++ == active)));
+    }
+
+    this->write(retval);
+    return exit_success;
+}
+
+
+/*
+ * console::set
+ */
+int console::set(void) {
+    if (this->_args.size() != 2) {
+        this->write({ { "error", "Usage: /set <name|path>" } });
+        return exit_usage;
+    }
+
+    runtime_manager manager;
+    bool ambiguous;
+    const auto runtimes = manager.snapshot();
+    auto it = find(runtimes->begin(), runtimes->end(), this->_args[1],
+        ambiguous);
+
+    if (ambiguous) {
+        this->write({ { "error", "The runtime name is ambiguous. "
+            "Specify the path instead." } });
+        return exit_not_found;
+    }
+
+    if (it == runtimes->end()) {
+        this->write({ { "error", "The runtime was not found." } });
+        return exit_not_found;
+    }
+
+    manager.active_runtime(*it);
+    this->write(to_json(*it, true));
+    return exit_success;
+}
+
+
+/*
+ * console::write
+ */
+void console::write(_In_ const nlohmann::json& json) noexcept {
+    try {
+        const auto str = json.dump(2) + "\n";
+
+        if (this->_output != nullptr) {
+            *this->_output << str << std::flush;
+            return;
+        }
+
+#if defined(_WIN32)
+        // If the output has been redirected, we have a valid handle and can
+        // write UTF-8 to it. Otherwise, we try to use the console of the
+        // process that started us, which is usually a shell.
+        auto handle = ::GetStdHandle(STD_OUTPUT_HANDLE);
+        wil::unique_hfile conout;
+        if ((handle == NULL) || (handle == INVALID_HANDLE_VALUE)) {
+            if (!::AttachConsole(ATTACH_PARENT_PROCESS)) {
+                return;
+            }
+
+            conout.reset(::CreateFileW(L"CONOUT$",
+                GENERIC_READ | GENERIC_WRITE,
+                FILE_SHARE_WRITE,
+                nullptr,
+                OPEN_EXISTING,
+                0,
+                NULL));
+            if (!conout) {
+                return;
+            }
+
+            handle = conout.get();
+        }
+
+        DWORD mode = 0;
+        DWORD written = 0;
+        if (::GetConsoleMode(handle, &mode)) {
+            // The console expects UTF-16 regardless of its code page.
+            const auto wstr = ::from_utf8(str);
+            ::WriteConsoleW(handle,
+                wstr.data(),
+                static_cast<DWORD>(wstr.size()),
+                &written,
+                nullptr);
+        } else {
+            ::WriteFile(handle,
+                str.data(),
+                static_cast<DWORD>(str.size()),
+                &written,
+                nullptr);
+        }
+
+#else /* defined(_WIN32) */
+        std::cout << str << std::flush;
+#endif /* defined(_WIN32) */
+    } catch (...) { /* There is nowhere to report this to. */ }
+}
@@ -0,0 +1,184 @@
+﻿// <copyright file="console.h" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#if !defined(_OXRSWITCH_CONSOLE_H)
+#define _OXRSWITCH_CONSOLE_H
+#pragma once
+
+#include "runtime_manager.h"
+
+
+/// <summary>
+/// Implements the headless command-line interface, which allows scripts to
+/// list and switch runtimes without creating any window.
+/// </summary>
+/// <remarks>
+/// <para>The following commands are supported:</para>
+/// <list type="bullet">
+/// <item><c>/list</c> prints all runtimes found on the system.</item>
+/// <item><c>/get</c> prints the active runtime.</item>
+/// <item><c>/set &lt;name|path&gt;</c> activates the runtime with the given
+/// name or the given path of its JSON file.</item>
+/// <item><c>/launch &lt;name|path&gt; &lt;executable&gt; [arguments]</c>
+/// starts the executable on the given runtime by means of the
+/// <c>XR_RUNTIME_JSON</c> environment variable, which leaves the active
+/// runtime of the system untouched.</item>
+/// </list>
+/// <para>All output is written as UTF-8 encoded JSON to the standard output,
+/// or to the console of the parent process if the standard output has not
+/// been redirected.</para>
+/// <para>On Linux, the commands operate on the XDG directories like the
+/// <see cref="runtime_manager" /> does, and <c>/launch</c> searches the
+/// executable in the <c>PATH</c>.</para>
+/// </remarks>
+class console final {
+
+public:
+
+    /// <summary>
+    /// The exit code if the command has been executed successfully.
+    /// </summary>
+    static constexpr int exit_success = 0;
+
+    /// <summary>
+    /// The exit code if the command line is malformed.
+    /// </summary>
+    static constexpr int exit_usage = 1;
+
+    /// <summary>
+    /// The exit code if the requested runtime does not exist or is
+    /// ambiguous.
+    /// </summary>
+    static constexpr int exit_not_found = 2;
+
+    /// <summary>
+    /// The exit code if the command failed for any other reason.
+    /// </summary>
+    static constexpr int exit_failure = -1;
+
+#if defined(_WIN32)
+    /// <summary>
+    /// Initialises a new instance from the command line of the process.
+    /// </summary>
+    console(void);
+#endif /* defined(_WIN32) */
+
+    /// <summary>
+    /// Initialises a new instance from the given arguments.
+    /// </summary>
+    /// <param name="args">The command line arguments without the name of
+    /// the executable.</param>
+    /// <param name="output">The stream to write the output to, or
+    /// <see langword="nullptr" /> for writing to the standard output. The
+    /// caller must keep the stream alive as long as the instance is used.
+    /// </param>
+    explicit console(_In_ const std::vector<std::wstring>& args,
+        _In_opt_ std::ostream *output = nullptr);
+
+    console(const console&) = delete;
+
+    /// <summary>
+    /// Answer whether the command line requests any of the headless commands.
+    /// </summary>
+    /// <returns></returns>
+    bool headless(void) const noexcept;
+
+    /// <summary>
+    /// Executes the command.
+    /// </summary>
+    /// <remarks>
+    /// This method never throws, but reports all errors as JSON object with
+    /// an &quot;error&quot; member.
+    /// </remarks>
+    /// <returns>The exit code of the application.</returns>
+    int run(void) noexcept;
+
+    console& operator =(const console&) = delete;
+
+private:
+
+    /// <summary>
+    /// The name of the environment variable that overrides the active runtime
+    /// for a single process.
+    /// </summary>
+    static constexpr const wchar_t *const runtime_variable
+        = L"XR_RUNTIME_JSON";
+
+    /// <summary>
+    /// Searches the runtimes in the range
+    /// [<paramref name="begin" />, <paramref name="end" />[ for the one
+    /// identified by <paramref name="requested" />.
+    /// </summary>
+    /// <remarks>
+    /// A path identifies the runtime unambiguously, so it takes precedence
+    /// over the name, which might be the same for multiple installations.
+    /// </remarks>
+    /// <param name="begin"></param>
+    /// <param name="end"></param>
+    /// <param name="requested">The name of the runtime or the path to its
+    /// JSON file.</param>
+    /// <param name="ambiguous">Set if multiple runtimes have the requested
+    /// name.</param>
+    /// <returns>The runtime or <paramref name="end" /> if it was not found or
+    /// is ambiguous.</returns>
+    static std::vector<runtime>::const_iterator find(
+        _In_ const std::vector<runtime>::const_iterator begin,
+        _In_ const std::vector<runtime>::const_iterator end,
+        _In_ const std::wstring& requested,
+        _Out_ bool& ambiguous);
+
+    /// <summary>
+    /// Converts <paramref name="runtime" /> into its JSON representation.
+    /// </summary>
+    /// <param name="runtime"></param>
+    /// <param name="active"></param>
+    /// <returns></returns>
+    static nlohmann::json to_json(_In_ const runtime& runtime,
+        _In_ const bool active);
+
+    /// <summary>
+    /// Gets the zero-based index of the active runtime or -1 if the active
+    /// runtime is not set or unknown.
+    /// </summary>
+    /// <param name="manager"></param>
+    /// <returns></returns>
+    static int get_active(_In_ const runtime_manager& manager) noexcept;
+
+    /// <summary>
+    /// Implements the &quot;/get&quot; command.
+    /// </summary>
+    /// <returns></returns>
+    int get(void);
+
+    /// <summary>
+    /// Implements the &quot;/launch&quot; command.
+    /// </summary>
+    /// <returns></returns>
+    int launch(void);
+
+    /// <summary>
+    /// Implements the &quot;/list&quot; command.
+    /// </summary>
+    /// <returns></returns>
+    int list(void);
+
+    /// <summary>
+    /// Implements the &quot;/set&quot; command.
+    /// </summary>
+    /// <returns></returns>
+    int set(void);
+
+    /// <summary>
+    /// Writes <paramref name="json" /> followed by a line break to the output.
+    /// </summary>
+    /// <param name="json"></param>
+    void write(_In_ const nlohmann::json& json) noexcept;
+
+    std::vector<std::wstring> _args;
+    std::ostream *_output;
+};
+
+#endif /* !defined(_OXRSWITCH_CONSOLE_H) */
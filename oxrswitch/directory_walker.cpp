@@ -0,0 +1,95 @@
+﻿// <copyright file="directory_walker.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+#include "directory_walker.h"
+
+
+/*
+ * walk_options::walk_options
+ */
+walk_options::walk_options(void)
+    : budget(std::chrono::seconds(5)),
+        extension(L".json"),
+        max_depth(unlimited_depth),
+        threads((std::min)(4u, (std::max)(1u,
+            std::thread::hardware_concurrency()))) { }
+
+
+/*
+ * walk_options::walk_options
+ */
+walk_options::walk_options(_In_ const std::size_t max_depth,
+        _In_ std::initializer_list<const wchar_t *> excludes)
+        : walk_options() {
+    this->max_depth = max_depth;
+    this->excludes.assign(excludes.begin(), excludes.end());
+}
+
+
+/*
+ * walk_options::is_excluded
+ */
+bool walk_options::is_excluded(_In_z_ const wchar_t *name) const noexcept {
+    return std::any_of(this->excludes.begin(),
+        this->excludes.end(),
+        [name](const std::wstring& e) { return ::equals(e, name, false); });
+}
+
+
+/*
+ * walk_options::is_relevant
+ */
+bool walk_options::is_relevant(_In_ const std::wstring& path,
+        _In_ const bool content) const {
+    auto begin = path.begin();
+    std::size_t depth = 0;
+
+    while (true) {
+        const auto end = std::find_if(begin, path.end(), [](const wchar_t c) {
+            return ::is_directory_separator(c);
+        });
+        const std::wstring name(begin, end);
+
+        if (end == path.end()) {
+            // We do not know whether a removed entry has been a file or a
+            // directory, so only the names of excluded directories that
+            // cannot be a manifest are ignored.
+            const auto match = ::ends_with(name, this->extension.c_str(),
+                false);
+            return match || (!content && !this->is_excluded(name.c_str()));
+        }
+
+        // The walker only enters a directory on the way to the entry if it
+        // is neither excluded nor too deep.
+        if ((depth >= this->max_depth) || this->is_excluded(name.c_str())) {
+            return false;
+        }
+
+        ++depth;
+        begin = end + 1;
+    }
+}
+
+
+/*
+ * walk_options::merge
+ */
+walk_options& walk_options::merge(_In_ const walk_options& other) {
+    this->budget = (std::max)(this->budget, other.budget);
+    this->max_depth = (std::max)(this->max_depth, other.max_depth);
+    this->threads = (std::max)(this->threads, other.threads);
+
+    // Only directories that are excluded by both remain excluded.
+    auto end = std::remove_if(this->excludes.begin(),
+        this->excludes.end(),
+        [&other](const std::wstring& e) {
+            return !other.is_excluded(e.c_str());
+        });
+    this->excludes.erase(end, this->excludes.end());
+
+    return *this;
+}
@@ -0,0 +1,263 @@
+﻿// <copyright file="directory_walker.h" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#if !defined(_OXRSWITCH_DIRECTORY_WALKER_H)
+#define _OXRSWITCH_DIRECTORY_WALKER_H
+#pragma once
+
+#include "util.h"
+
+
+/// <summary>
+/// Configures how deep and how long a <see cref="directory_walker" /> searches
+/// an installation folder.
+/// </summary>
+struct walk_options final {
+
+    /// <summary>
+    /// The value of <see cref="max_depth" /> which does not restrict the
+    /// depth of the search.
+    /// </summary>
+    static constexpr std::size_t unlimited_depth
+        = (std::numeric_limits<std::size_t>::max)();
+
+    /// <summary>
+    /// The maximum time spent on a single installation folder. Any directory
+    /// that has not been searched when the time is up is skipped.
+    /// </summary>
+    std::chrono::milliseconds budget;
+
+    /// <summary>
+    /// The names of directories that are not searched, which are compared
+    /// case-insensitively.
+    /// </summary>
+    std::vector<std::wstring> excludes;
+
+    /// <summary>
+    /// The extension of the files to be returned.
+    /// </summary>
+    std::wstring extension;
+
+    /// <summary>
+    /// The maximum number of directory levels below the root that are
+    /// searched.
+    /// </summary>
+    std::size_t max_depth;
+
+    /// <summary>
+    /// The number of threads searching the directory tree.
+    /// </summary>
+    unsigned int threads;
+
+    /// <summary>
+    /// Initialises the default options, which search for JSON files without
+    /// any restriction of the depth.
+    /// </summary>
+    walk_options(void);
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="max_depth">The maximum depth of the search.</param>
+    /// <param name="excludes">The names of the directories that are not
+    /// searched.</param>
+    walk_options(_In_ const std::size_t max_depth,
+        _In_ std::initializer_list<const wchar_t *> excludes);
+
+    /// <summary>
+    /// Answer whether the directory <paramref name="name" /> must not be
+    /// searched.
+    /// </summary>
+    /// <param name="name"></param>
+    /// <returns></returns>
+    bool is_excluded(_In_z_ const wchar_t *name) const noexcept;
+
+    /// <summary>
+    /// Answer whether a change of the file system entry at
+    /// <paramref name="path" /> could change the result of walking the root
+    /// directory with these options.
+    /// </summary>
+    /// <remarks>
+    /// Adding, removing or renaming an entry is relevant unless the walker
+    /// would not search the directory it is in, because the directory is
+    /// excluded or too deep. Changing the content of a file is only relevant
+    /// if the walker returns the file.
+    /// </remarks>
+    /// <param name="path">The path of the entry relative to the root.
+    /// </param>
+    /// <param name="content"><see langword="true" /> if the content of the
+    /// entry has changed, <see langword="false" /> if it has been added,
+    /// removed or renamed.</param>
+    /// <returns></returns>
+    bool is_relevant(_In_ const std::wstring& path,
+        _In_ const bool content) const;
+
+    /// <summary>
+    /// Combines the options such that everything that would be searched by
+    /// one of the two is searched.
+    /// </summary>
+    /// <param name="other"></param>
+    /// <returns><c>*this</c>.</returns>
+    walk_options& merge(_In_ const walk_options& other);
+};
+
+
+#if defined(_WIN32)
+/// <summary>
+/// Provides access to the Win32 file system for the
+/// <see cref="directory_walker" />.
+/// </summary>
+/// <remarks>
+/// Any other type providing an <see cref="enumerate" /> method with the same
+/// semantics can be used to run the walker against a stand-in for the file
+/// system.
+/// </remarks>
+class win32_file_system final {
+
+public:
+
+    /// <summary>
+    /// Invokes <paramref name="callback" /> with the name of each entry in
+    /// <paramref name="directory" /> and whether it is a directory.
+    /// </summary>
+    /// <remarks>
+    /// The entries &quot;.&quot; and &quot;..&quot; as well as junctions and
+    /// symbolic links to directories are not reported, which prevents the
+    /// walker from running in circles.
+    /// </remarks>
+    /// <typeparam name="TCallback">A functor accepting the name of the entry
+    /// as <c>const wchar_t *</c> and a <see langword="bool" /> indicating
+    /// whether the entry is a directory.</typeparam>
+    /// <param name="directory"></param>
+    /// <param name="callback"></param>
+    template<class TCallback>
+    void enumerate(_In_ const std::wstring& directory,
+        _In_ TCallback&& callback) const;
+};
+
+/// <summary>
+/// The file system the <see cref="directory_walker" /> searches by default.
+/// </summary>
+typedef win32_file_system native_file_system;
+
+#else /* defined(_WIN32) */
+/// <summary>
+/// Provides access to a POSIX file system for the
+/// <see cref="directory_walker" />.
+/// </summary>
+class posix_file_system final {
+
+public:
+
+    /// <summary>
+    /// Invokes <paramref name="callback" /> with the name of each entry in
+    /// <paramref name="directory" /> and whether it is a directory.
+    /// </summary>
+    /// <remarks>
+    /// The entries &quot;.&quot; and &quot;..&quot; as well as symbolic
+    /// links to directories are not reported, which prevents the walker
+    /// from running in circles. Symbolic links to files are reported as
+    /// files. Entries whose names are not valid UTF-8 are skipped.
+    /// </remarks>
+    /// <typeparam name="TCallback">A functor accepting the name of the entry
+    /// as <c>const wchar_t *</c> and a <see langword="bool" /> indicating
+    /// whether the entry is a directory.</typeparam>
+    /// <param name="directory"></param>
+    /// <param name="callback"></param>
+    template<class TCallback>
+    void enumerate(_In_ const std::wstring& directory,
+        _In_ TCallback&& callback) const;
+};
+
+/// <summary>
+/// The file system the <see cref="directory_walker" /> searches by default.
+/// </summary>
+typedef posix_file_system native_file_system;
+#endif /* defined(_WIN32) */
+
+
+/// <summary>
+/// Searches a directory tree for files with a specific extension using a pool
+/// of work-stealing threads.
+/// </summary>
+/// <typeparam name="TFileSystem">The type providing access to the file system,
+/// which must be compatible with <see cref="win32_file_system" />.
+/// </typeparam>
+template<class TFileSystem = native_file_system>
+class directory_walker final {
+
+public:
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="options">Restricts the search.</param>
+    /// <param name="file_system">The file system to be searched.</param>
+    explicit directory_walker(_In_ const walk_options& options,
+        _In_ TFileSystem file_system = TFileSystem());
+
+    /// <summary>
+    /// Searches the directory <paramref name="root" />.
+    /// </summary>
+    /// <typeparam name="TFileIterator">An output iterator for the paths of the
+    /// files found.</typeparam>
+    /// <typeparam name="TDirIterator">An output iterator for the paths of the
+    /// directories that have been searched.</typeparam>
+    /// <param name="root"></param>
+    /// <param name="files"></param>
+    /// <param name="directories"></param>
+    /// <returns><see langword="true" /> if the whole tree has been searched,
+    /// <see langword="false" /> if the search was aborted because the time
+    /// budget was exceeded.</returns>
+    template<class TFileIterator, class TDirIterator>
+    bool operator ()(_In_ const std::wstring& root,
+        _In_ TFileIterator files,
+        _In_ TDirIterator directories) const;
+
+private:
+
+    /// <summary>
+    /// A directory waiting to be searched.
+    /// </summary>
+    struct item final {
+        std::size_t depth;
+        std::wstring path;
+    };
+
+    /// <summary>
+    /// The queue of a single worker. The owner takes work from the back while
+    /// other workers steal from the front.
+    /// </summary>
+    struct queue final {
+        std::deque<item> items;
+        std::mutex lock;
+    };
+
+    /// <summary>
+    /// The output of a single worker.
+    /// </summary>
+    struct result final {
+        std::vector<std::wstring> directories;
+        std::exception_ptr error;
+        std::vector<std::wstring> files;
+    };
+
+    /// <summary>
+    /// Gets the next directory for the worker <paramref name="owner" />,
+    /// stealing from other workers if its own queue is empty.
+    /// </summary>
+    static bool pop(_In_reads_(cnt) queue *queues,
+        _In_ const std::size_t cnt,
+        _In_ const std::size_t owner,
+        _Out_ item& retval);
+
+    TFileSystem _file_system;
+    walk_options _options;
+};
+
+#include "directory_walker.inl"
+
+#endif /* !defined(_OXRSWITCH_DIRECTORY_WALKER_H) */
@@ -0,0 +1,247 @@
+﻿// <copyright file="directory_walker.inl" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+
+#if defined(_WIN32)
+/*
+ * win32_file_system::enumerate
+ */
+template<class TCallback>
+void win32_file_system::enumerate(_In_ const std::wstring& directory,
+        _In_ TCallback&& callback) const {
+    WIN32_FIND_DATAW fd;
+    const auto query = directory + L"\\*";
+    wil::unique_hfind find(::FindFirstFileExW(query.c_str(),
+        FindExInfoBasic,
+        &fd,
+        FindExSearchNameMatch,
+        nullptr,
+        FIND_FIRST_EX_LARGE_FETCH));
+    if (!find) {
+        return;
+    }
+
+    do {
+        if (::equals(fd.cFileName, L".") || ::equals(fd.cFileName, L"..")) {
+            continue;
+        }
+
+        const auto is_directory = ((fd.dwFileAttributes
+            & FILE_ATTRIBUTE_DIRECTORY) != 0);
+        if (is_directory
+                && ((fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0)) {
+            continue;
+        }
+
+        callback(static_cast<const wchar_t *>(fd.cFileName), is_directory);
+    } while (::FindNextFileW(find.get(), &fd) != 0);
+}
+
+#else /* defined(_WIN32) */
+/*
+ * posix_file_system::enumerate
+ */
+template<class TCallback>
+void posix_file_system::enumerate(_In_ const std::wstring& directory,
+        _In_ TCallback&& callback) const {
+    const auto path = ::to_utf8(directory);
+    std::unique_ptr<DIR, void (*)(DIR *)> dir(::opendir(path.c_str()),
+        [](DIR *d) { ::closedir(d); });
+    if (!dir) {
+        return;
+    }
+
+    while (auto entry = ::readdir(dir.get())) {
+        if (::equals(entry->d_name, ".") || ::equals(entry->d_name, "..")) {
+            continue;
+        }
+
+        auto is_directory = (entry->d_type == DT_DIR);
+        if ((entry->d_type == DT_LNK) || (entry->d_type == DT_UNKNOWN)) {
+            // Follow the link to find out whether it is a file we need to
+            // report. Some file systems do not report the type at all.
+            const auto p = path + "/" + entry->d_name;
+            struct stat link;
+            struct stat target;
+            if ((::lstat(p.c_str(), &link) != 0)
+                    || (::stat(p.c_str(), &target) != 0)) {
+                continue;
+            }
+
+            is_directory = S_ISDIR(target.st_mode);
+            if (is_directory && S_ISLNK(link.st_mode)) {
+                continue;
+            }
+        }
+
+        std::wstring name;
+        try {
+            name = ::from_utf8(entry->d_name);
+        } catch (...) {
+            continue;
+        }
+
+        callback(static_cast<const wchar_t *>(name.c_str()), is_directory);
+    }
+}
+#endif /* defined(_WIN32) */
+
+
+/*
+ * directory_walker<TFileSystem>::directory_walker
+ */
+template<class TFileSystem>
+directory_walker<TFileSystem>::directory_walker(
+        _In_ const walk_options& options,
+        _In_ TFileSystem file_system)
+    : _file_system(std::move(file_system)), _options(options) { }
+
+
+/*
+ * directory_walker<TFileSystem>::operator ()
+ */
+template<class TFileSystem>
+template<class TFileIterator, class TDirIterator>
+bool directory_walker<TFileSystem>::operator ()(_In_ const std::wstring& root,
+        _In_ TFileIterator files,
+        _In_ TDirIterator directories) const {
+    const auto cnt = static_cast<std::size_t>((std::max)(1u,
+        this->_options.threads));
+    const auto deadline = std::chrono::steady_clock::now()
+        + this->_options.budget;
+    std::unique_ptr<queue[]> queues(new queue[cnt]);
+    std::vector<result> results(cnt);
+
+    // 'pending' counts the directories that have been found, but not yet
+    // been searched, which allows the workers to detect that they are done.
+    std::atomic<std::size_t> pending(1);
+    std::atomic<bool> timed_out(false);
+    queues[0].items.push_back({ 0, root });
+
+    auto worker = [&](const std::size_t owner) {
+        auto& r = results[owner];
+        item cur;
+
+        try {
+            while (true) {
+                if (!pop(queues.get(), cnt, owner, cur)) {
+                    if (pending.load(std::memory_order_acquire) == 0) {
+                        return;
+                    }
+
+                    // Someone else is still searching and might produce more
+                    // work, so we need to wait for it.
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                if (std::chrono::steady_clock::now() > deadline) {
+                    timed_out.store(true, std::memory_order_relaxed);
+                }
+
+                // If the time is up, we just drain the queues.
+                if (!timed_out.load(std::memory_order_relaxed)) {
+                    r.directories.push_back(cur.path);
+
+                    this->_file_system.enumerate(cur.path,
+                            [&](const wchar_t *name, const bool is_directory) {
+                        auto path = ::combine_path(cur.path, name);
+
+                        if (is_directory) {
+                            if ((cur.depth < this->_options.max_depth)
+                                    && !this->_options.is_excluded(name)) {
+                                pending.fetch_add(1, std::memory_order_acq_rel);
+                                auto& q = queues[owner];
+                                std::lock_guard<std::mutex> l(q.lock);
+                                q.items.push_back({ cur.depth + 1,
+                                    std::move(path) });
+                            }
+
+                        } else if (::ends_with(path,
+                                this->_options.extension.c_str(), false)) {
+                            r.files.push_back(std::move(path));
+                        }
+                    });
+                }
+
+                pending.fetch_sub(1, std::memory_order_acq_rel);
+            }
+        } catch (...) {
+            // Make all other workers stop as soon as possible and report the
+            // problem to the caller.
+            r.error = std::current_exception();
+            timed_out.store(true, std::memory_order_relaxed);
+            pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    };
+
+    {
+        std::vector<std::thread> threads;
+        threads.reserve(cnt - 1);
+        for (std::size_t i = 1; i < cnt; ++i) {
+            threads.emplace_back(worker, i);
+        }
+
+        worker(0);
+
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    for (auto& r : results) {
+        if (r.error) {
+            std::rethrow_exception(r.error);
+        }
+    }
+
+    for (auto& r : results) {
+        directories = std::move(r.directories.begin(), r.directories.end(),
+            directories);
+        files = std::move(r.files.begin(), r.files.end(), files);
+    }
+
+    return !timed_out.load(std::memory_order_relaxed);
+}
+
+
+/*
+ * directory_walker<TFileSystem>::pop
+ */
+template<class TFileSystem>
+bool directory_walker<TFileSystem>::pop(_In_reads_(cnt) queue *queues,
+        _In_ const std::size_t cnt,
+        _In_ const std::size_t owner,
+        _Out_ item& retval) {
+    assert(queues != nullptr);
+    assert(owner < cnt);
+
+    // Prefer the most recently found directory of our own, which keeps the
+    // walk depth-first and the queue short.
+    {
+        auto& q = queues[owner];
+        std::lock_guard<std::mutex> l(q.lock);
+        if (!q.items.empty()) {
+            retval = std::move(q.items.back());
+            q.items.pop_back();
+            return true;
+        }
+    }
+
+    // Steal the oldest directory of someone else, which is the one closest to
+    // the root and therefore most likely the largest chunk of work.
+    for (std::size_t i = 1; i < cnt; ++i) {
+        auto& q = queues[(owner + i) % cnt];
+        std::lock_guard<std::mutex> l(q.lock);
+        if (!q.items.empty()) {
+            retval = std::move(q.items.front());
+            q.items.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,322 @@
+﻿// <copyright file="discovery_cache.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+#include "discovery_cache.h"
+
+#include "registry.h"
+#include "util.h"
+
+
+/// <summary>
+/// Reads the runtimes in the JSON array <paramref name="json" />.
+/// </summary>
+static std::vector<runtime> load_runtimes(_In_ const nlohmann::json& json) {
+    std::vector<runtime> retval;
+    retval.reserve(json.size());
+
+    for (auto& r : json) {
+        retval.emplace_back(
+            ::from_utf8(r.at("name").get<std::string>()),
+            ::from_utf8(r.at("path").get<std::string>()),
+            ::from_utf8(r.at("wow_path").get<std::string>()));
+    }
+
+    return retval;
+}
+
+
+/// <summary>
+/// Reads the time stamps in the JSON array <paramref name="json" />.
+/// </summary>
+static std::vector<discovery_cache::stamp> load_stamps(
+        _In_ const nlohmann::json& json) {
+    std::vector<discovery_cache::stamp> retval;
+    retval.reserve(json.size());
+
+    for (auto& s : json) {
+        retval.push_back({
+            static_cast<discovery_cache::source_type>(s.at("type").get<int>()),
+            ::from_utf8(s.at("path").get<std::string>()),
+            s.at("time").get<std::uint64_t>() });
+    }
+
+    return retval;
+}
+
+
+/// <summary>
+/// Converts <paramref name="runtimes" /> into a JSON array.
+/// </summary>
+static nlohmann::json save_runtimes(_In_ const std::vector<runtime>& runtimes) {
+    auto retval = nlohmann::json::array();
+
+    for (auto& r : runtimes) {
+        retval.push_back({
+            { "name", ::to_utf8(r.name()) },
+            { "path", ::to_utf8(r.path()) },
+            { "wow_path", ::to_utf8(r.wow_path()) }
+        });
+    }
+
+    return retval;
+}
+
+
+/// <summary>
+/// Converts <paramref name="stamps" /> into a JSON array.
+/// </summary>
+static nlohmann::json save_stamps(
+        _In_ const std::vector<discovery_cache::stamp>& stamps) {
+    auto retval = nlohmann::json::array();
+
+    for (auto& s : stamps) {
+        retval.push_back({
+            { "type", static_cast<int>(s.type) },
+            { "path", ::to_utf8(s.path) },
+            { "time", s.time }
+        });
+    }
+
+    return retval;
+}
+
+
+/*
+ * discovery_cache::default_path
+ */
+std::wstring discovery_cache::default_path(void) {
+#if defined(_WIN32)
+    return ::expand_environment_variables(L"%LOCALAPPDATA%\\OpenXR Runtime "
+        L"Switcher\\discovery.json");
+#else /* defined(_WIN32) */
+    const auto cache = ::get_environment_variable("XDG_CACHE_HOME",
+        ::get_environment_variable("HOME") + L"/.cache");
+    return cache + L"/oxrswitch/discovery.json";
+#endif /* defined(_WIN32) */
+}
+
+
+/*
+ * discovery_cache::get_stamp
+ */
+std::uint64_t discovery_cache::get_stamp(_In_ const source_type type,
+        _In_ const std::wstring& path) noexcept {
+#if defined(_WIN32)
+    FILETIME time { 0, 0 };
+
+    switch (type) {
+        case source_type::registry: {
+            win32_registry registry;
+            return registry.last_write_time(registry.root(), path.c_str());
+            }
+
+        case source_type::file_system: {
+            WIN32_FILE_ATTRIBUTE_DATA data;
+            if (!::GetFileAttributesExW(path.c_str(), GetFileExInfoStandard,
+                    &data)) {
+                return 0;
+            }
+
+            time = data.ftLastWriteTime;
+            } break;
+
+        default:
+            return 0;
+    }
+
+    return (static_cast<std::uint64_t>(time.dwHighDateTime) << 32)
+        | time.dwLowDateTime;
+
+#else /* defined(_WIN32) */
+    // There is no registry, so only the file system can change.
+    if (type != source_type::file_system) {
+        return 0;
+    }
+
+    struct stat s;
+    try {
+        if (::stat(::to_utf8(path).c_str(), &s) != 0) {
+            return 0;
+        }
+    } catch (...) {
+        return 0;
+    }
+
+    return static_cast<std::uint64_t>(s.st_mtim.tv_sec) * 1000000000
+        + s.st_mtim.tv_nsec;
+#endif /* defined(_WIN32) */
+}
+
+
+/*
+ * discovery_cache::load
+ */
+discovery_cache discovery_cache::load(_In_ std::istream& stream) noexcept {
+    discovery_cache retval;
+
+    try {
+        const auto json = nlohmann::json::parse(stream);
+
+        if (json.at("version").get<unsigned int>() != version) {
+            // The cache was written by an incompatible version, which is the
+            // same as not having a cache at all.
+            return retval;
+        }
+
+        retval._runtimes = load_runtimes(json.at("runtimes"));
+        retval._stamps = load_stamps(json.at("stamps"));
+
+        for (auto& s : json.at("segments")) {
+            retval._segments.push_back({
+                s.at("complete").get<bool>(),
+                ::from_utf8(s.at("folder").get<std::string>()),
+                s.at("mask").get<std::uint64_t>(),
+                load_runtimes(s.at("runtimes")),
+                load_stamps(s.at("stamps")),
+                static_cast<segment_type>(s.at("type").get<int>()) });
+        }
+
+    } catch (...) {
+        // Any corrupt cache is treated as no cache.
+        retval._runtimes.clear();
+        retval._segments.clear();
+        retval._stamps.clear();
+    }
+
+    return retval;
+}
+
+
+/*
+ * discovery_cache::load
+ */
+discovery_cache discovery_cache::load(_In_ const std::wstring& path) noexcept {
+#if defined(_WIN32)
+    std::ifstream f(path);
+#else /* defined(_WIN32) */
+    std::ifstream f;
+    try {
+        f.open(::to_utf8(path));
+    } catch (...) {
+        return discovery_cache();
+    }
+#endif /* defined(_WIN32) */
+    if (!f) {
+        return discovery_cache();
+    }
+
+    return load(f);
+}
+
+
+/*
+ * discovery_cache::merge
+ */
+void discovery_cache::merge(_Inout_ discovery_cache&& other) {
+    this->_stamps.insert(this->_stamps.end(),
+        std::make_move_iterator(other._stamps.begin()),
+        std::make_move_iterator(other._stamps.end()));
+    other._stamps.clear();
+}
+
+
+/*
+ * discovery_cache::save
+ */
+void discovery_cache::save(_In_ std::ostream& stream) const {
+    auto segments = nlohmann::json::array();
+    for (auto& s : this->_segments) {
+        segments.push_back({
+            { "complete", s.complete },
+            { "folder", ::to_utf8(s.folder) },
+            { "mask", s.mask },
+            { "runtimes", save_runtimes(s.runtimes) },
+            { "stamps", save_stamps(s.stamps) },
+            { "type", static_cast<int>(s.type) }
+        });
+    }
+
+    nlohmann::json json;
+    json["version"] = version;
+    json["runtimes"] = save_runtimes(this->_runtimes);
+    json["segments"] = std::move(segments);
+    json["stamps"] = save_stamps(this->_stamps);
+
+    stream << json;
+}
+
+
+/*
+ * discovery_cache::save
+ */
+void discovery_cache::save(_In_ const std::wstring& path) const {
+    // Make sure that the directory exists. On Windows, only the last level
+    // can be missing, because the parent is the local application data
+    // folder.
+    const auto sep = std::find_if(path.rbegin(), path.rend(),
+        [](const wchar_t c) { return ::is_directory_separator(c); });
+    if (sep != path.rend()) {
+        const std::wstring dir(path.begin(), sep.base() - 1);
+#if defined(_WIN32)
+        if (!::CreateDirectoryW(dir.c_str(), nullptr)) {
+            THROW_LAST_ERROR_IF(::GetLastError() != ERROR_ALREADY_EXISTS);
+        }
+#else /* defined(_WIN32) */
+        // The cache directory of the user does not necessarily exist.
+        const auto d = ::to_utf8(dir) + "/";
+        for (auto i = d.find('/', 1); i != std::string::npos;
+                i = d.find('/', i + 1)) {
+            if (::mkdir(d.substr(0, i).c_str(), 0755) != 0) {
+                THROW_WIN32_IF(errno, errno != EEXIST);
+            }
+        }
+#endif /* defined(_WIN32) */
+    }
+
+    // Write to a temporary file first such that concurrent instances never see
+    // a partially written cache. Every save uses a file of its own, because
+    // the monitor, the console and the GUI might save at the same time and
+    // would otherwise overwrite each other's file before it is renamed.
+    static std::atomic<unsigned int> counter(0);
+#if defined(_WIN32)
+    const auto pid = ::GetCurrentProcessId();
+#else /* defined(_WIN32) */
+    const auto pid = ::getpid();
+#endif /* defined(_WIN32) */
+    const auto tmp = path + L"." + std::to_wstring(pid) + L"."
+        + std::to_wstring(counter.fetch_add(1, std::memory_order_relaxed))
+        + L".tmp";
+
+    try {
+        {
+#if defined(_WIN32)
+            std::ofstream f(tmp, std::ios::trunc);
+#else /* defined(_WIN32) */
+            std::ofstream f(::to_utf8(tmp), std::ios::trunc);
+#endif /* defined(_WIN32) */
+            THROW_WIN32_IF(ERROR_WRITE_FAULT, !f);
+            this->save(f);
+            THROW_WIN32_IF(ERROR_WRITE_FAULT, !f);
+        }
+
+#if defined(_WIN32)
+        THROW_LAST_ERROR_IF(!::MoveFileExW(tmp.c_str(), path.c_str(),
+            MOVEFILE_REPLACE_EXISTING));
+#else /* defined(_WIN32) */
+        THROW_WIN32_IF(errno, ::rename(::to_utf8(tmp).c_str(),
+            ::to_utf8(path).c_str()) != 0);
+#endif /* defined(_WIN32) */
+    } catch (...) {
+        // Do not leave the partial result of the failed save behind.
+#if defined(_WIN32)
+        ::DeleteFileW(tmp.c_str());
+#else /* defined(_WIN32) */
+        ::unlink(::to_utf8(tmp).c_str());
+#endif /* defined(_WIN32) */
+        throw;
+    }
+}
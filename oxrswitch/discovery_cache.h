@@ -0,0 +1,289 @@
+﻿// <copyright file="discovery_cache.h" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#if !defined(_OXRSWITCH_DISCOVERY_CACHE_H)
+#define _OXRSWITCH_DISCOVERY_CACHE_H
+#pragma once
+
+#include "runtime.h"
+
+
+/// <summary>
+/// Persists the result of a runtime discovery along with the time stamps of
+/// all registry keys and directories the result depends on.
+/// </summary>
+/// <remarks>
+/// A warm start only needs to compare the recorded time stamps against the
+/// current ones instead of walking the whole registry and all installation
+/// folders again.
+/// </remarks>
+class discovery_cache final {
+
+public:
+
+    /// <summary>
+    /// Identifies the part of the discovery a <see cref="segment" /> holds.
+    /// </summary>
+    enum class segment_type {
+        /// <summary>
+        /// The runtimes registered with OpenXR.
+        /// </summary>
+        registered,
+
+        /// <summary>
+        /// The installation folders of known runtimes.
+        /// </summary>
+        installations,
+
+        /// <summary>
+        /// The runtimes in a single installation folder.
+        /// </summary>
+        installed
+    };
+
+    /// <summary>
+    /// Identifies the kind of source a <see cref="stamp" /> was obtained from.
+    /// </summary>
+    enum class source_type {
+        /// <summary>
+        /// The path designates a key below <c>HKEY_LOCAL_MACHINE</c>.
+        /// </summary>
+        registry,
+
+        /// <summary>
+        /// The path designates a file or directory in the file system.
+        /// </summary>
+        file_system
+    };
+
+    /// <summary>
+    /// A single dependency of the discovery result.
+    /// </summary>
+    struct stamp final {
+        /// <summary>
+        /// The kind of source.
+        /// </summary>
+        source_type type;
+
+        /// <summary>
+        /// The path to the registry key or the file system entry.
+        /// </summary>
+        std::wstring path;
+
+        /// <summary>
+        /// The last write time of the source as <c>FILETIME</c> on Windows
+        /// or in nanoseconds since the epoch anywhere else, or zero if the
+        /// source did not exist.
+        /// </summary>
+        std::uint64_t time;
+    };
+
+    /// <summary>
+    /// A part of the discovery result that is searched as a whole along with
+    /// the sources it depends on.
+    /// </summary>
+    /// <remarks>
+    /// Persisting the segments allows a warm start to search only the
+    /// segments whose sources have changed rather than the whole system.
+    /// </remarks>
+    struct segment final {
+        /// <summary>
+        /// Indicates whether the segment has been searched completely.
+        /// </summary>
+        bool complete;
+
+        /// <summary>
+        /// The installation folder in case of
+        /// <see cref="segment_type::installed" />, or empty.
+        /// </summary>
+        std::wstring folder;
+
+        /// <summary>
+        /// The mask of the known runtimes the <see cref="folder" /> has been
+        /// attributed to.
+        /// </summary>
+        std::uint64_t mask;
+
+        /// <summary>
+        /// The runtimes found in the segment.
+        /// </summary>
+        std::vector<runtime> runtimes;
+
+        /// <summary>
+        /// The sources the segment depends on.
+        /// </summary>
+        std::vector<stamp> stamps;
+
+        /// <summary>
+        /// The part of the discovery the segment holds.
+        /// </summary>
+        segment_type type;
+    };
+
+    /// <summary>
+    /// Answer the location of the cache file of the calling user.
+    /// </summary>
+    /// <returns>The path to the cache file.</returns>
+    static std::wstring default_path(void);
+
+    /// <summary>
+    /// Retrieves the last write time of the given registry key or file system
+    /// entry.
+    /// </summary>
+    /// <param name="type">The kind of source to check.</param>
+    /// <param name="path">The path to the registry key below
+    /// <c>HKEY_LOCAL_MACHINE</c> or the path to the file or directory.</param>
+    /// <returns>The last write time, or zero if the source does not exist.
+    /// </returns>
+    static std::uint64_t get_stamp(_In_ const source_type type,
+        _In_ const std::wstring& path) noexcept;
+
+    /// <summary>
+    /// Reads a cache from the given stream.
+    /// </summary>
+    /// <param name="stream">The stream to read the cache from.</param>
+    /// <returns>The cache, which is empty if the stream did not contain a
+    /// valid cache.</returns>
+    static discovery_cache load(_In_ std::istream& stream) noexcept;
+
+    /// <summary>
+    /// Reads a cache from the given file.
+    /// </summary>
+    /// <param name="path">The path to the cache file.</param>
+    /// <returns>The cache, which is empty if the file does not exist or did
+    /// not contain a valid cache.</returns>
+    static discovery_cache load(_In_ const std::wstring& path) noexcept;
+
+    /// <summary>
+    /// Initialises a new, empty instance.
+    /// </summary>
+    discovery_cache(void) = default;
+
+    /// <summary>
+    /// Records a dependency of the discovery result.
+    /// </summary>
+    /// <param name="type">The kind of source.</param>
+    /// <param name="path">The path to the source.</param>
+    /// <param name="time">The last write time of the source.</param>
+    inline void add(_In_ const source_type type,
+            _In_ const std::wstring& path,
+            _In_ const std::uint64_t time) {
+        this->_stamps.push_back({ type, path, time });
+    }
+
+    /// <summary>
+    /// Records a dependency of the discovery result and retrieves its current
+    /// last write time using <see cref="get_stamp" />.
+    /// </summary>
+    /// <param name="type">The kind of source.</param>
+    /// <param name="path">The path to the source.</param>
+    inline void add(_In_ const source_type type,
+            _In_ const std::wstring& path) {
+        this->add(type, path, get_stamp(type, path));
+    }
+
+    /// <summary>
+    /// Answer whether the cache holds any result.
+    /// </summary>
+    /// <returns></returns>
+    inline bool empty(void) const noexcept {
+        return this->_stamps.empty();
+    }
+
+    /// <summary>
+    /// Answer whether all recorded dependencies are unchanged.
+    /// </summary>
+    /// <typeparam name="TStamper">A functor that accepts a
+    /// <see cref="source_type" /> and a path and returns the current last write
+    /// time of the source like <see cref="get_stamp" />.</typeparam>
+    /// <param name="stamper">The functor used to retrieve the current time
+    /// stamps, which allows for validating against an in-memory stand-in for
+    /// the registry and the file system.</param>
+    /// <returns><see langword="true" /> if the cache is not empty and none of
+    /// its dependencies has changed, <see langword="false" /> otherwise.
+    /// </returns>
+    template<class TStamper>
+    bool is_valid(_In_ TStamper&& stamper) const;
+
+    /// <summary>
+    /// Moves the dependencies recorded in <paramref name="other" /> into this
+    /// cache.
+    /// </summary>
+    /// <remarks>
+    /// Recording dependencies is not thread-safe, so parallel searches record
+    /// into a cache of their own, which is merged once they have completed.
+    /// </remarks>
+    /// <param name="other"></param>
+    void merge(_Inout_ discovery_cache&& other);
+
+    /// <summary>
+    /// Gets the cached runtimes.
+    /// </summary>
+    /// <returns></returns>
+    inline const std::vector<runtime>& runtimes(void) const noexcept {
+        return this->_runtimes;
+    }
+
+    /// <summary>
+    /// Gets the cached runtimes.
+    /// </summary>
+    /// <returns></returns>
+    inline std::vector<runtime>& runtimes(void) noexcept {
+        return this->_runtimes;
+    }
+
+    /// <summary>
+    /// Gets the segments the result has been assembled from.
+    /// </summary>
+    /// <returns></returns>
+    inline const std::vector<segment>& segments(void) const noexcept {
+        return this->_segments;
+    }
+
+    /// <summary>
+    /// Gets the segments the result has been assembled from.
+    /// </summary>
+    /// <returns></returns>
+    inline std::vector<segment>& segments(void) noexcept {
+        return this->_segments;
+    }
+
+    /// <summary>
+    /// Writes the cache to the given stream.
+    /// </summary>
+    /// <param name="stream"></param>
+    void save(_In_ std::ostream& stream) const;
+
+    /// <summary>
+    /// Writes the cache to the given file, replacing any previous one.
+    /// </summary>
+    /// <param name="path"></param>
+    void save(_In_ const std::wstring& path) const;
+
+    /// <summary>
+    /// Gets the recorded dependencies.
+    /// </summary>
+    /// <returns></returns>
+    inline const std::vector<stamp>& stamps(void) const noexcept {
+        return this->_stamps;
+    }
+
+private:
+
+    /// <summary>
+    /// The version of the file format, which must be changed whenever the
+    /// content of the cache or the way of discovery changes.
+    /// </summary>
+    static constexpr unsigned int version = 3;
+
+    std::vector<runtime> _runtimes;
+    std::vector<segment> _segments;
+    std::vector<stamp> _stamps;
+};
+
+#include "discovery_cache.inl"
+
+#endif /* !defined(_OXRSWITCH_DISCOVERY_CACHE_H) */
@@ -0,0 +1,22 @@
+﻿// <copyright file="discovery_cache.inl" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+
+/*
+ * discovery_cache::is_valid
+ */
+template<class TStamper>
+bool discovery_cache::is_valid(_In_ TStamper&& stamper) const {
+    if (this->_stamps.empty()) {
+        return false;
+    }
+
+    return std::all_of(this->_stamps.begin(),
+        this->_stamps.end(),
+        [&stamper](const stamp& s) {
+            return (stamper(s.type, s.path) == s.time);
+        });
+}
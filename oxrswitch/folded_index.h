@@ -0,0 +1,104 @@
+﻿// <copyright file="folded_index.h" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#if !defined(_OXRSWITCH_FOLDED_INDEX_H)
+#define _OXRSWITCH_FOLDED_INDEX_H
+#pragma once
+
+#include "util.h"
+
+
+/// <summary>
+/// Indexes a range by a case-insensitive key derived from its elements, which
+/// allows for finding the elements with a specific key in constant time
+/// instead of comparing against every element.
+/// </summary>
+/// <remarks>
+/// The index only holds iterators into the range, which must therefore
+/// outlive the index and must not be modified while the index is in use.
+/// </remarks>
+/// <typeparam name="TIterator">A forward iterator over the indexed range.
+/// </typeparam>
+/// <typeparam name="TKey">A functor deriving the key from an element of the
+/// range as <c>std::wstring_view</c>, which must remain valid as long as the
+/// element is valid.</typeparam>
+template<class TIterator, class TKey>
+class folded_index final {
+
+public:
+
+    /// <summary>
+    /// Computes the hash of <paramref name="key" /> after folding its case.
+    /// </summary>
+    /// <param name="key"></param>
+    /// <returns></returns>
+    static std::size_t hash(_In_ const std::wstring_view key) noexcept;
+
+    /// <summary>
+    /// Answer whether <paramref name="lhs" /> and <paramref name="rhs" />
+    /// are equal if their case is ignored.
+    /// </summary>
+    /// <param name="lhs"></param>
+    /// <param name="rhs"></param>
+    /// <returns></returns>
+    static bool equals(_In_ const std::wstring_view lhs,
+        _In_ const std::wstring_view rhs) noexcept;
+
+    /// <summary>
+    /// Indexes the range [<paramref name="begin" />,
+    /// <paramref name="end" />[.
+    /// </summary>
+    /// <param name="begin"></param>
+    /// <param name="end"></param>
+    /// <param name="key">The functor deriving the key of an element.
+    /// </param>
+    folded_index(_In_ const TIterator begin,
+        _In_ const TIterator end,
+        _In_ TKey key = TKey());
+
+    /// <summary>
+    /// Finds the first element of the range whose key is
+    /// <paramref name="key" />.
+    /// </summary>
+    /// <param name="key"></param>
+    /// <returns>The iterator of the element or the end of the range if no
+    /// such element exists.</returns>
+    TIterator find(_In_ const std::wstring_view key) const;
+
+    /// <summary>
+    /// Invokes <paramref name="callback" /> for the iterators of all elements
+    /// whose key is <paramref name="key" /> in the order of the range.
+    /// </summary>
+    /// <typeparam name="TCallback">A functor accepting a
+    /// <typeparamref name="TIterator" />.</typeparam>
+    /// <param name="key"></param>
+    /// <param name="callback"></param>
+    template<class TCallback>
+    void for_each(_In_ const std::wstring_view key,
+        _In_ TCallback&& callback) const;
+
+private:
+
+    std::unordered_map<std::size_t, std::vector<TIterator>> _buckets;
+    TIterator _end;
+    TKey _key;
+};
+
+
+/// <summary>
+/// Derives the directory of a path, including the trailing separator, as
+/// key of a <see cref="folded_index" />.
+/// </summary>
+struct directory_key final {
+    inline std::wstring_view operator ()(
+            _In_ const std::wstring& path) const noexcept {
+        return ::get_directory(path);
+    }
+};
+
+#include "folded_index.inl"
+
+#endif /* !defined(_OXRSWITCH_FOLDED_INDEX_H) */
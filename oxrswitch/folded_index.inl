@@ -0,0 +1,79 @@
+﻿// <copyright file="folded_index.inl" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+
+/*
+ * folded_index<TIterator, TKey>::hash
+ */
+template<class TIterator, class TKey>
+std::size_t folded_index<TIterator, TKey>::hash(
+        _In_ const std::wstring_view key) noexcept {
+    return ::fold_hash(key);
+}
+
+
+/*
+ * folded_index<TIterator, TKey>::equals
+ */
+template<class TIterator, class TKey>
+bool folded_index<TIterator, TKey>::equals(_In_ const std::wstring_view lhs,
+        _In_ const std::wstring_view rhs) noexcept {
+    return (lhs.size() == rhs.size())
+        && ::equals_n(lhs.data(), rhs.data(), lhs.size(), false);
+}
+
+
+/*
+ * folded_index<TIterator, TKey>::folded_index
+ */
+template<class TIterator, class TKey>
+folded_index<TIterator, TKey>::folded_index(_In_ const TIterator begin,
+        _In_ const TIterator end,
+        _In_ TKey key)
+        : _end(end), _key(std::move(key)) {
+    for (auto it = begin; it != end; ++it) {
+        this->_buckets[hash(this->_key(*it))].push_back(it);
+    }
+}
+
+
+/*
+ * folded_index<TIterator, TKey>::find
+ */
+template<class TIterator, class TKey>
+TIterator folded_index<TIterator, TKey>::find(
+        _In_ const std::wstring_view key) const {
+    auto bucket = this->_buckets.find(hash(key));
+    if (bucket != this->_buckets.end()) {
+        // Different keys may have the same hash, so we need to check the
+        // candidates, which are usually only one.
+        for (auto& it : bucket->second) {
+            if (equals(this->_key(*it), key)) {
+                return it;
+            }
+        }
+    }
+
+    return this->_end;
+}
+
+
+/*
+ * folded_index<TIterator, TKey>::for_each
+ */
+template<class TIterator, class TKey>
+template<class TCallback>
+void folded_index<TIterator, TKey>::for_each(_In_ const std::wstring_view key,
+        _In_ TCallback&& callback) const {
+    auto bucket = this->_buckets.find(hash(key));
+    if (bucket != this->_buckets.end()) {
+        for (auto& it : bucket->second) {
+            if (equals(this->_key(*it), key)) {
+                callback(it);
+            }
+        }
+    }
+}
@@ -0,0 +1,295 @@
+﻿// <copyright file="machine_type.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+#include "machine_type.h"
+
+#include "util.h"
+
+
+#if !defined(_WIN32)
+// The machine types of PE images from winnt.h.
+#define IMAGE_FILE_MACHINE_I386 (0x014C)
+#define IMAGE_FILE_MACHINE_ARM (0x01C0)
+#define IMAGE_FILE_MACHINE_ARMNT (0x01C4)
+#define IMAGE_FILE_MACHINE_AMD64 (0x8664)
+#define IMAGE_FILE_MACHINE_ARM64 (0xAA64)
+#endif /* !defined(_WIN32) */
+
+/// <summary>
+/// Reads an unsigned integer of type <typeparamref name="TValue" /> at
+/// <paramref name="offset" /> if it is within the image.
+/// </summary>
+template<class TValue>
+static inline bool read_value(_In_reads_bytes_(size) const std::uint8_t *data,
+        _In_ const std::size_t size,
+        _In_ const std::size_t offset,
+        _In_ const bool big_endian,
+        _Out_ TValue& value) noexcept {
+    if ((offset > size) || (size - offset < sizeof(TValue))) {
+        return false;
+    }
+
+    value = 0;
+    for (std::size_t i = 0; i < sizeof(TValue); ++i) {
+        const auto b = data[offset + (big_endian ? i : sizeof(TValue) - i - 1)];
+        value = static_cast<TValue>((value << 8) | b);
+    }
+
+    return true;
+}
+
+
+/*
+ * ::get_machine_type
+ */
+machine_type get_machine_type(_In_reads_bytes_(size) const void *data,
+        _In_ const std::size_t size) noexcept {
+    auto d = static_cast<const std::uint8_t *>(data);
+    if ((d == nullptr) || (size < 4)) {
+        return machine_type::unknown;
+    }
+
+    if ((d[0] == 'M') && (d[1] == 'Z')) {
+        // The DOS header points to the "PE\0\0" signature, which is followed
+        // by the machine type of the COFF file header.
+        std::uint32_t pe = 0;
+        std::uint32_t signature = 0;
+        std::uint16_t machine = 0;
+        if (!read_value(d, size, 0x3C, false, pe)
+                || !read_value(d, size, pe, false, signature)
+                || (signature != 0x00004550)
+                || !read_value(d, size, std::size_t(pe) + 4, false, machine)) {
+            return machine_type::unknown;
+        }
+
+        switch (machine) {
+            case IMAGE_FILE_MACHINE_I386: return machine_type::x86;
+            case IMAGE_FILE_MACHINE_AMD64: return machine_type::x64;
+            case IMAGE_FILE_MACHINE_ARM:
+            case IMAGE_FILE_MACHINE_ARMNT: return machine_type::arm;
+            case IMAGE_FILE_MACHINE_ARM64: return machine_type::arm64;
+            default: return machine_type::unknown;
+        }
+    }
+
+    if ((d[0] == 0x7F) && (d[1] == 'E') && (d[2] == 'L') && (d[3] == 'F')) {
+        // The ELF identification tells the byte order of the machine type.
+        constexpr std::size_t ei_data = 5;
+        constexpr std::size_t e_machine = 18;
+        if (size <= ei_data) {
+            return machine_type::unknown;
+        }
+
+        std::uint16_t machine = 0;
+        if (!read_value(d, size, e_machine, (d[ei_data] == 2), machine)) {
+            return machine_type::unknown;
+        }
+
+        switch (machine) {
+            case 3: return machine_type::x86;       // EM_386
+            case 40: return machine_type::arm;      // EM_ARM
+            case 62: return machine_type::x64;      // EM_X86_64
+            case 183: return machine_type::arm64;   // EM_AARCH64
+            default: return machine_type::unknown;
+        }
+    }
+
+    return machine_type::unknown;
+}
+
+
+/*
+ * machine_cache::instance
+ */
+machine_cache& machine_cache::instance(void) {
+    static machine_cache retval;
+    return retval;
+}
+
+
+/*
+ * machine_cache::get
+ */
+machine_type machine_cache::get(_In_ const std::wstring& path) {
+#if defined(_WIN32)
+    wil::unique_hfile file(::CreateFileW(path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL));
+    if (!file) {
+        return machine_type::unknown;
+    }
+
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!::GetFileInformationByHandle(file.get(), &info)) {
+        return machine_type::unknown;
+    }
+
+    const key_type key(info.dwVolumeSerialNumber,
+        (static_cast<std::uint64_t>(info.nFileIndexHigh) << 32)
+        | info.nFileIndexLow);
+    const auto size = (static_cast<std::uint64_t>(info.nFileSizeHigh) << 32)
+        | info.nFileSizeLow;
+    const auto write_time = (static_cast<std::uint64_t>(
+        info.ftLastWriteTime.dwHighDateTime) << 32)
+        | info.ftLastWriteTime.dwLowDateTime;
+
+    machine_type retval;
+    if (!this->find(key, size, write_time, retval)) {
+        // Read the file without holding the lock. If another thread does the
+        // same, both will get the same result, so it does not matter who
+        // wins.
+        retval = read(file.get(), size);
+        this->remember(key, { retval, size, write_time });
+    }
+
+    return retval;
+
+#else /* defined(_WIN32) */
+    const auto file = ::open(::to_utf8(path).c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0) {
+        return machine_type::unknown;
+    }
+
+    auto retval = machine_type::unknown;
+    struct stat info;
+    if (::fstat(file, &info) == 0) {
+        const key_type key(static_cast<std::uint64_t>(info.st_dev),
+            static_cast<std::uint64_t>(info.st_ino));
+        const auto size = static_cast<std::uint64_t>(info.st_size);
+        const auto write_time = static_cast<std::uint64_t>(
+            info.st_mtim.tv_sec) * 1000000000
+            + static_cast<std::uint64_t>(info.st_mtim.tv_nsec);
+
+        if (!this->find(key, size, write_time, retval)) {
+            retval = read(file, size);
+            this->remember(key, { retval, size, write_time });
+        }
+    }
+
+    ::close(file);
+    return retval;
+#endif /* defined(_WIN32) */
+}
+
+
+/*
+ * machine_cache::size
+ */
+std::size_t machine_cache::size(void) const {
+    std::lock_guard<std::mutex> l(this->_lock);
+    return this->_entries.size();
+}
+
+
+#if defined(_WIN32)
+/*
+ * machine_cache::read
+ */
+machine_type machine_cache::read(_In_ const HANDLE file,
+        _In_ const std::uint64_t size) noexcept {
+    // The headers we are interested in are at the very begin of the file,
+    // so there is no need to map more than the first few pages.
+    constexpr std::uint64_t max_view = 64 * 1024;
+
+    if (size == 0) {
+        // Empty files cannot be mapped.
+        return machine_type::unknown;
+    }
+
+    wil::unique_handle mapping(::CreateFileMappingW(file,
+        nullptr,
+        PAGE_READONLY,
+        0,
+        0,
+        nullptr));
+    if (!mapping) {
+        return machine_type::unknown;
+    }
+
+    const auto view_size = static_cast<std::size_t>((std::min)(size,
+        max_view));
+    wil::unique_mapview_ptr<void> view(::MapViewOfFile(mapping.get(),
+        FILE_MAP_READ,
+        0,
+        0,
+        view_size));
+    if (!view) {
+        return machine_type::unknown;
+    }
+
+    return get_machine_type(view.get(), view_size);
+}
+
+#else /* defined(_WIN32) */
+/*
+ * machine_cache::read
+ */
+machine_type machine_cache::read(_In_ const int file,
+        _In_ const std::uint64_t size) noexcept {
+    // The headers we are interested in are at the very begin of the file,
+    // so there is no need to read more than the first few pages.
+    constexpr std::uint64_t max_view = 64 * 1024;
+
+    std::vector<std::uint8_t> view;
+    try {
+        view.resize(static_cast<std::size_t>((std::min)(size, max_view)));
+    } catch (...) {
+        return machine_type::unknown;
+    }
+
+    std::size_t cnt = 0;
+    while (cnt < view.size()) {
+        const auto r = ::pread(file, view.data() + cnt, view.size() - cnt,
+            static_cast<off_t>(cnt));
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return machine_type::unknown;
+        } else if (r == 0) {
+            break;
+        }
+        cnt += static_cast<std::size_t>(r);
+    }
+
+    return get_machine_type(view.data(), cnt);
+}
+#endif /* defined(_WIN32) */
+
+
+/*
+ * machine_cache::find
+ */
+_Success_(return) bool machine_cache::find(_In_ const key_type& key,
+        _In_ const std::uint64_t size,
+        _In_ const std::uint64_t write_time,
+        _Out_ machine_type& machine) const {
+    std::lock_guard<std::mutex> l(this->_lock);
+    auto it = this->_entries.find(key);
+    if ((it == this->_entries.end())
+            || (it->second.size != size)
+            || (it->second.write_time != write_time)) {
+        return false;
+    }
+
+    machine = it->second.machine;
+    return true;
+}
+
+
+/*
+ * machine_cache::remember
+ */
+void machine_cache::remember(_In_ const key_type& key,
+        _In_ const entry& entry) {
+    std::lock_guard<std::mutex> l(this->_lock);
+    this->_entries[key] = entry;
+}
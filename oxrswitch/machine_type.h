@@ -0,0 +1,147 @@
+﻿// <copyright file="machine_type.h" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#if !defined(_OXRSWITCH_MACHINE_TYPE_H)
+#define _OXRSWITCH_MACHINE_TYPE_H
+#pragma once
+
+
+/// <summary>
+/// The processor architecture a runtime library has been built for.
+/// </summary>
+enum class machine_type {
+    unknown,
+    arm,
+    arm64,
+    x64,
+    x86
+};
+
+
+/// <summary>
+/// Determines the architecture from the header of a PE or ELF image.
+/// </summary>
+/// <param name="data">The begin of the image.</param>
+/// <param name="size">The number of bytes available at
+/// <paramref name="data" />.</param>
+/// <returns>The architecture or <see cref="machine_type::unknown" /> if the
+/// data are no valid image or the architecture is not supported.</returns>
+machine_type get_machine_type(_In_reads_bytes_(size) const void *data,
+    _In_ const std::size_t size) noexcept;
+
+/// <summary>
+/// Answer whether <paramref name="machine" /> is a 64-bit architecture.
+/// </summary>
+/// <param name="machine"></param>
+/// <returns></returns>
+inline bool is_64bit(_In_ const machine_type machine) noexcept {
+    return (machine == machine_type::arm64) || (machine == machine_type::x64);
+}
+
+/// <summary>
+/// Answer whether <paramref name="machine" /> is a 32-bit architecture.
+/// </summary>
+/// <param name="machine"></param>
+/// <returns></returns>
+inline bool is_32bit(_In_ const machine_type machine) noexcept {
+    return (machine == machine_type::arm) || (machine == machine_type::x86);
+}
+
+
+/// <summary>
+/// Determines the architecture of libraries by reading their headers and
+/// remembers the result for as long as the file remains unchanged.
+/// </summary>
+/// <remarks>
+/// Files are identified by their volume and file index, or their device and
+/// inode on Linux, rather than their path, such that the same library reached
+/// via different paths is only read once. An entry is discarded if the size
+/// or the time of the last write of the file has changed. The cache is
+/// thread-safe.
+/// </remarks>
+class machine_cache final {
+
+public:
+
+    /// <summary>
+    /// Answer the cache shared by the whole process.
+    /// </summary>
+    /// <returns></returns>
+    static machine_cache& instance(void);
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    machine_cache(void) = default;
+
+    machine_cache(const machine_cache&) = delete;
+
+    /// <summary>
+    /// Determines the architecture of the library at
+    /// <paramref name="path" />.
+    /// </summary>
+    /// <param name="path"></param>
+    /// <returns>The architecture or <see cref="machine_type::unknown" /> if
+    /// the file does not exist or is not a supported image.</returns>
+    machine_type get(_In_ const std::wstring& path);
+
+    /// <summary>
+    /// Answer the number of files in the cache.
+    /// </summary>
+    /// <returns></returns>
+    std::size_t size(void) const;
+
+    machine_cache& operator =(const machine_cache&) = delete;
+
+private:
+
+    /// <summary>
+    /// Identifies a file by its volume and its index on the volume.
+    /// </summary>
+    typedef std::pair<std::uint64_t, std::uint64_t> key_type;
+
+    /// <summary>
+    /// The cached result for a single file.
+    /// </summary>
+    struct entry final {
+        machine_type machine;
+        std::uint64_t size;
+        std::uint64_t write_time;
+    };
+
+#if defined(_WIN32)
+    /// <summary>
+    /// Maps the file <paramref name="file" /> and reads its header.
+    /// </summary>
+    static machine_type read(_In_ const HANDLE file,
+        _In_ const std::uint64_t size) noexcept;
+#else /* defined(_WIN32) */
+    /// <summary>
+    /// Reads the header of the open file <paramref name="file" />.
+    /// </summary>
+    static machine_type read(_In_ const int file,
+        _In_ const std::uint64_t size) noexcept;
+#endif /* defined(_WIN32) */
+
+    /// <summary>
+    /// Looks up the result for <paramref name="key" /> if the file has not
+    /// changed since it has been cached.
+    /// </summary>
+    _Success_(return) bool find(_In_ const key_type& key,
+        _In_ const std::uint64_t size,
+        _In_ const std::uint64_t write_time,
+        _Out_ machine_type& machine) const;
+
+    /// <summary>
+    /// Caches the result for <paramref name="key" />.
+    /// </summary>
+    void remember(_In_ const key_type& key, _In_ const entry& entry);
+
+    std::map<key_type, entry> _entries;
+    mutable std::mutex _lock;
+};
+
+#endif /* !defined(_OXRSWITCH_MACHINE_TYPE_H) */
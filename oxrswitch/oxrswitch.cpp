@@ -7,6 +7,7 @@
 #include "pch.h"
 
 #include "application.h"
+#include "console.h"
 #include "resource.h"
 
 
@@ -33,6 +34,13 @@ int APIENTRY wWinMain(_In_ const HINSTANCE instance,
             return application::unfix_acls();
 
         } else {
+            // Scripts must be able to switch runtimes without us creating any
+            // window, which would also steal the focus.
+            console cli;
+            if (cli.headless()) {
+                return cli.run();
+            }
+
             application app(instance);
             return app.run(show_command);
         }
@@ -10,36 +10,112 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <cwchar>
+#include <cwctype>
+#include <deque>
+#include <exception>
 #include <fstream>
 #include <functional>
+#include <future>
+#include <initializer_list>
+#include <iostream>
 #include <iterator>
+#include <limits>
+#include <map>
 #include <memory>
-#include <regex>
+#include <mutex>
+#include <numeric>
+#include <optional>
 #include <set>
 #include <stack>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#if defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>
+#endif /* defined(_M_IX86) || defined(_M_X64) */
+
+#if defined(_WIN32)
 #include "targetver.h"
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 
 #include <aclapi.h>
 #include <commctrl.h>
+#include <ktmw32.h>
 #include <sal.h>
 #include <shellapi.h>
 #include <tchar.h>
 
-#include <nlohmann/json.hpp>
-
 #include <wil/filesystem.h>
 #include <wil/registry.h>
 #include <wil/resource.h>
 #include <wil/result.h>
 
+#else /* defined(_WIN32) */
+// Only the discovery and switching of runtimes is available on other
+// platforms, where the OpenXR loader follows the XDG base directory
+// specification instead of reading the registry.
+#include <cerrno>
+#include <system_error>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <spawn.h>
+#include <strings.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// The SAL annotations are only available with the Windows SDK.
+#define _In_
+#define _In_opt_
+#define _In_opt_z_
+#define _In_reads_(s)
+#define _In_reads_bytes_(s)
+#define _In_z_
+#define _Inout_
+#define _Out_
+#define _Out_opt_
+#define _Out_writes_(s)
+#define _Out_writes_bytes_(s)
+#define _Success_(c)
+
+// The status codes of the portable code are Win32 error codes on Windows
+// and their errno counterparts anywhere else.
+typedef std::uint32_t DWORD;
+#define ERROR_SUCCESS (0)
+#define ERROR_INVALID_DATA (EBADMSG)
+#define ERROR_INVALID_PARAMETER (EINVAL)
+#define ERROR_NO_UNICODE_TRANSLATION (EILSEQ)
+#define ERROR_NOT_FOUND (ENOENT)
+#define ERROR_OPEN_FAILED (EIO)
+#define ERROR_OUTOFMEMORY (ENOMEM)
+#define ERROR_WRITE_FAULT (EIO)
+
+// Errors are reported as std::system_error instead of wil::ResultException.
+#define THROW_WIN32(e) throw std::system_error(static_cast<int>(e), \
+    std::generic_category())
+#define THROW_WIN32_IF(e, c) do { if (c) { THROW_WIN32(e); } } while (false)
+#define THROW_IF_WIN32_ERROR(e) do { const auto _e = (e); \
+    if (_e != ERROR_SUCCESS) { THROW_WIN32(_e); } } while (false)
+#endif /* defined(_WIN32) */
+
+#include <nlohmann/json.hpp>
+
 #endif /* !defined(_OXRSWITCH_PCH_H) */
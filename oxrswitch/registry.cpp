@@ -0,0 +1,218 @@
+﻿// <copyright file="registry.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+#include "registry.h"
+
+#include "util.h"
+
+
+#if defined(_WIN32)
+/*
+ * win32_registry::last_write_time
+ */
+std::uint64_t win32_registry::last_write_time(_In_ const handle_type parent,
+        _In_z_ const wchar_t *path) const noexcept {
+    assert(path != nullptr);
+    wil::unique_hkey key;
+    if (::RegOpenKeyExW(parent, path, 0, KEY_QUERY_VALUE, key.put())
+            != ERROR_SUCCESS) {
+        return 0;
+    }
+
+    FILETIME time { 0, 0 };
+    if (::RegQueryInfoKeyW(key.get(), nullptr, nullptr, nullptr, nullptr,
+            nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &time)
+            != ERROR_SUCCESS) {
+        return 0;
+    }
+
+    return (static_cast<std::uint64_t>(time.dwHighDateTime) << 32)
+        | time.dwLowDateTime;
+}
+
+
+/*
+ * win32_registry::try_open
+ */
+_Success_(return) bool win32_registry::try_open(_In_ const handle_type parent,
+        _In_z_ const wchar_t *path,
+        _Out_ key_type& key) const noexcept {
+    assert(path != nullptr);
+    return (::RegOpenKeyExW(parent, path, 0, KEY_READ, key.put())
+        == ERROR_SUCCESS);
+}
+
+
+/*
+ * win32_registry::try_get_string
+ */
+_Success_(return) bool win32_registry::try_get_string(
+        _In_ const handle_type key,
+        _In_opt_z_ const wchar_t *name,
+        _Out_ std::wstring& value) const {
+    constexpr auto flags = RRF_RT_REG_SZ | RRF_RT_REG_EXPAND_SZ;
+
+    // The value might change between querying its size and reading it, in
+    // which case we just try again.
+    while (true) {
+        DWORD size = 0;
+        auto status = ::RegGetValueW(key, nullptr, name, flags, nullptr,
+            nullptr, &size);
+        if (status != ERROR_SUCCESS) {
+            return false;
+        }
+
+        value.resize(size / sizeof(wchar_t));
+        status = ::RegGetValueW(key, nullptr, name, flags, nullptr,
+            value.data(), &size);
+        if (status == ERROR_MORE_DATA) {
+            continue;
+        } else if (status != ERROR_SUCCESS) {
+            return false;
+        }
+
+        // The size includes the terminating zero.
+        value.resize((size / sizeof(wchar_t)) - ((size > 0) ? 1 : 0));
+        return true;
+    }
+}
+#endif /* defined(_WIN32) */
+
+
+/*
+ * memory_registry::load
+ */
+memory_registry memory_registry::load(_In_ const std::wstring& path) {
+#if defined(_WIN32)
+    std::ifstream stream(path);
+#else /* defined(_WIN32) */
+    std::ifstream stream(::to_utf8(path));
+#endif /* defined(_WIN32) */
+    if (!stream) {
+        throw std::invalid_argument("The registry fixture could not be "
+            "opened.");
+    }
+
+    return memory_registry(nlohmann::json::parse(stream));
+}
+
+
+/*
+ * memory_registry::memory_registry
+ */
+memory_registry::memory_registry(_In_ const nlohmann::json& hive)
+        : _root(new node()) {
+    parse(*this->_root, hive);
+}
+
+
+/*
+ * memory_registry::last_write_time
+ */
+std::uint64_t memory_registry::last_write_time(_In_ const handle_type parent,
+        _In_z_ const wchar_t *path) const noexcept {
+    key_type key = nullptr;
+    return this->try_open(parent, path, key) ? key->time : 0;
+}
+
+
+/*
+ * memory_registry::try_open
+ */
+_Success_(return) bool memory_registry::try_open(_In_ const handle_type parent,
+        _In_z_ const wchar_t *path,
+        _Out_ key_type& key) const noexcept {
+    assert(parent != nullptr);
+    assert(path != nullptr);
+    key = parent;
+
+    try {
+        const std::wstring p(path);
+        std::size_t begin = 0;
+
+        while (begin < p.size()) {
+            auto end = p.find(L'\\', begin);
+            if (end == std::wstring::npos) {
+                end = p.size();
+            }
+
+            if (end > begin) {
+                auto it = key->keys.find(p.substr(begin, end - begin));
+                if (it == key->keys.end()) {
+                    return false;
+                }
+
+                key = it->second.get();
+            }
+
+            begin = end + 1;
+        }
+
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+
+/*
+ * memory_registry::try_get_string
+ */
+_Success_(return) bool memory_registry::try_get_string(
+        _In_ const handle_type key,
+        _In_opt_z_ const wchar_t *name,
+        _Out_ std::wstring& value) const {
+    assert(key != nullptr);
+    auto it = key->values.find((name != nullptr) ? name : L"");
+    if ((it == key->values.end()) || !it->second) {
+        return false;
+    }
+
+    // Environment variables are not expanded, because this would make the
+    // result depend on the machine running the fixture.
+    value = *it->second;
+    return true;
+}
+
+
+/*
+ * memory_registry::parse
+ */
+void memory_registry::parse(_Out_ node& node, _In_ const nlohmann::json& json) {
+    if (!json.is_object()) {
+        throw std::invalid_argument("A registry key must be described by a "
+            "JSON object.");
+    }
+
+    // The members of the JSON object are sorted by their names, so the time
+    // stamp does not depend on the order in the fixture.
+    std::uint64_t time = 0;
+    auto stamp = [&time](const std::size_t hash) {
+        time ^= hash + 0x9e3779b97f4a7c15ull + (time << 6) + (time >> 2);
+    };
+
+    for (auto& m : json.items()) {
+        auto name = ::from_utf8(m.key());
+        stamp(::fold_hash(name));
+
+        if (m.value().is_object()) {
+            auto& child = node.keys[name];
+            child.reset(new memory_registry::node());
+            parse(*child, m.value());
+
+        } else if (m.value().is_string()) {
+            auto& value = node.values[name];
+            value = ::from_utf8(m.value().get<std::string>());
+            stamp(std::hash<std::wstring>()(*value));
+
+        } else {
+            node.values[name] = std::nullopt;
+        }
+    }
+
+    node.time = (time != 0) ? time : 1;
+}
@@ -0,0 +1,288 @@
+﻿// <copyright file="registry.h" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#if !defined(_OXRSWITCH_REGISTRY_H)
+#define _OXRSWITCH_REGISTRY_H
+#pragma once
+
+#include "util.h"
+
+
+#if defined(_WIN32)
+/// <summary>
+/// Provides read access to the Win32 registry for the discovery of runtimes.
+/// </summary>
+/// <remarks>
+/// <para>Any other type providing the same members can be used to run the
+/// discovery against a stand-in for the registry, like the
+/// <see cref="memory_registry" />. A registry provides two types:
+/// <c>handle_type</c> refers to an open key without owning it, and
+/// <c>key_type</c> owns an open key and can be converted into a handle using
+/// <see cref="get" />.</para>
+/// <para>All methods must be safe to be called concurrently, because the
+/// discovery searches the registry in parallel.</para>
+/// </remarks>
+class win32_registry final {
+
+public:
+
+    /// <summary>
+    /// A non-owning reference to an open key.
+    /// </summary>
+    typedef HKEY handle_type;
+
+    /// <summary>
+    /// An open key which is closed when it goes out of scope.
+    /// </summary>
+    typedef wil::unique_hkey key_type;
+
+    /// <summary>
+    /// Gets the handle of <paramref name="key" />.
+    /// </summary>
+    /// <param name="key"></param>
+    /// <returns></returns>
+    static inline handle_type get(_In_ const key_type& key) noexcept {
+        return key.get();
+    }
+
+    /// <summary>
+    /// Invokes <paramref name="callback" /> with the name of each direct
+    /// subkey of <paramref name="key" />.
+    /// </summary>
+    /// <typeparam name="TCallback">A functor accepting the name of the
+    /// subkey as <c>const std::wstring&amp;</c>.</typeparam>
+    /// <param name="key"></param>
+    /// <param name="callback"></param>
+    template<class TCallback>
+    void enumerate_keys(_In_ const handle_type key,
+        _In_ TCallback&& callback) const;
+
+    /// <summary>
+    /// Invokes <paramref name="callback" /> with the name of each value of
+    /// <paramref name="key" />.
+    /// </summary>
+    /// <typeparam name="TCallback">A functor accepting the name of the
+    /// value as <c>const std::wstring&amp;</c>.</typeparam>
+    /// <param name="key"></param>
+    /// <param name="callback"></param>
+    template<class TCallback>
+    void enumerate_values(_In_ const handle_type key,
+        _In_ TCallback&& callback) const;
+
+    /// <summary>
+    /// Answer the last write time of the subkey <paramref name="path" /> of
+    /// <paramref name="parent" />.
+    /// </summary>
+    /// <param name="parent"></param>
+    /// <param name="path">The path of the subkey, which may comprise
+    /// multiple levels separated by backslashes.</param>
+    /// <returns>The last write time as <c>FILETIME</c>, or zero if the key
+    /// does not exist or is not accessible.</returns>
+    std::uint64_t last_write_time(_In_ const handle_type parent,
+        _In_z_ const wchar_t *path) const noexcept;
+
+    /// <summary>
+    /// Answer the handle of <c>HKEY_LOCAL_MACHINE</c>.
+    /// </summary>
+    /// <returns></returns>
+    inline handle_type root(void) const noexcept {
+        return HKEY_LOCAL_MACHINE;
+    }
+
+    /// <summary>
+    /// Opens the subkey <paramref name="path" /> of <paramref name="parent" />
+    /// for reading.
+    /// </summary>
+    /// <param name="parent"></param>
+    /// <param name="path">The path of the subkey, which may comprise
+    /// multiple levels separated by backslashes.</param>
+    /// <param name="key">Receives the key in case of success.</param>
+    /// <returns><see langword="true" /> if the key has been opened,
+    /// <see langword="false" /> if it does not exist or is not accessible.
+    /// </returns>
+    _Success_(return) bool try_open(_In_ const handle_type parent,
+        _In_z_ const wchar_t *path,
+        _Out_ key_type& key) const noexcept;
+
+    /// <summary>
+    /// Reads the string value <paramref name="name" /> of
+    /// <paramref name="key" />, expanding any environment variables.
+    /// </summary>
+    /// <param name="key"></param>
+    /// <param name="name">The name of the value or <see langword="nullptr" />
+    /// for the default value.</param>
+    /// <param name="value">Receives the value in case of success.</param>
+    /// <returns><see langword="true" /> if the value has been read,
+    /// <see langword="false" /> if it does not exist or is not a string.
+    /// </returns>
+    _Success_(return) bool try_get_string(_In_ const handle_type key,
+        _In_opt_z_ const wchar_t *name,
+        _Out_ std::wstring& value) const;
+};
+#endif /* defined(_WIN32) */
+
+
+/// <summary>
+/// An in-memory stand-in for the registry, which allows for running and
+/// measuring the discovery against a reproducible fixture.
+/// </summary>
+/// <remarks>
+/// <para>The hive is described by a JSON object, whose members with object
+/// values are subkeys and whose members with string values are string
+/// values. Members of any other type become values that are not strings,
+/// which is sufficient for lists like &quot;AvailableRuntimes&quot; where
+/// only the names matter. Names are compared case-insensitively like in the
+/// registry.</para>
+/// <para>The hive cannot be modified once it has been created, which makes
+/// it safe to be searched concurrently.</para>
+/// <para>The last write time of a key is derived from its values and the
+/// names of its subkeys. It therefore changes whenever the registry would
+/// update the time stamp, such that two hives can stand in for the registry
+/// before and after a modification.</para>
+/// </remarks>
+class memory_registry final {
+
+public:
+
+    /// <summary>
+    /// Compares the names of keys and values case-insensitively like the
+    /// registry does.
+    /// </summary>
+    struct name_equal final {
+        inline bool operator ()(_In_ const std::wstring& lhs,
+                _In_ const std::wstring& rhs) const noexcept {
+            return ::equals(lhs, rhs, false);
+        }
+    };
+
+    /// <summary>
+    /// Hashes the names of keys and values consistently with
+    /// <see cref="name_equal" />.
+    /// </summary>
+    struct name_hash final {
+        inline std::size_t operator ()(
+                _In_ const std::wstring& name) const noexcept {
+            return ::fold_hash(name);
+        }
+    };
+
+    /// <summary>
+    /// A key in the hive.
+    /// </summary>
+    struct node final {
+        /// <summary>
+        /// The subkeys by their names.
+        /// </summary>
+        std::unordered_map<std::wstring, std::unique_ptr<node>, name_hash,
+            name_equal> keys;
+
+        /// <summary>
+        /// The values by their names, which are empty if the value is not a
+        /// string.
+        /// </summary>
+        std::unordered_map<std::wstring, std::optional<std::wstring>,
+            name_hash, name_equal> values;
+
+        /// <summary>
+        /// The last write time, which is never zero.
+        /// </summary>
+        std::uint64_t time;
+    };
+
+    /// <summary>
+    /// A reference to a key, which is owned by the hive.
+    /// </summary>
+    typedef const node *handle_type;
+
+    /// <summary>
+    /// A key, which is owned by the hive.
+    /// </summary>
+    typedef const node *key_type;
+
+    /// <summary>
+    /// Gets the handle of <paramref name="key" />.
+    /// </summary>
+    /// <param name="key"></param>
+    /// <returns></returns>
+    static inline handle_type get(_In_ const key_type key) noexcept {
+        return key;
+    }
+
+    /// <summary>
+    /// Loads the hive from the JSON file at <paramref name="path" />.
+    /// </summary>
+    /// <param name="path"></param>
+    /// <returns></returns>
+    static memory_registry load(_In_ const std::wstring& path);
+
+    /// <summary>
+    /// Initialises a new instance from the given JSON object.
+    /// </summary>
+    /// <param name="hive">The description of
+    /// <c>HKEY_LOCAL_MACHINE</c>.</param>
+    explicit memory_registry(_In_ const nlohmann::json& hive);
+
+    /// <summary>
+    /// Invokes <paramref name="callback" /> with the name of each direct
+    /// subkey of <paramref name="key" />.
+    /// </summary>
+    template<class TCallback>
+    void enumerate_keys(_In_ const handle_type key,
+        _In_ TCallback&& callback) const;
+
+    /// <summary>
+    /// Invokes <paramref name="callback" /> with the name of each value of
+    /// <paramref name="key" />.
+    /// </summary>
+    template<class TCallback>
+    void enumerate_values(_In_ const handle_type key,
+        _In_ TCallback&& callback) const;
+
+    /// <summary>
+    /// Answer the last write time of the subkey <paramref name="path" /> of
+    /// <paramref name="parent" />, or zero if it does not exist.
+    /// </summary>
+    std::uint64_t last_write_time(_In_ const handle_type parent,
+        _In_z_ const wchar_t *path) const noexcept;
+
+    /// <summary>
+    /// Answer the root of the hive, which represents
+    /// <c>HKEY_LOCAL_MACHINE</c>.
+    /// </summary>
+    /// <returns></returns>
+    inline handle_type root(void) const noexcept {
+        return this->_root.get();
+    }
+
+    /// <summary>
+    /// Opens the subkey <paramref name="path" /> of
+    /// <paramref name="parent" />.
+    /// </summary>
+    _Success_(return) bool try_open(_In_ const handle_type parent,
+        _In_z_ const wchar_t *path,
+        _Out_ key_type& key) const noexcept;
+
+    /// <summary>
+    /// Reads the string value <paramref name="name" /> of
+    /// <paramref name="key" />.
+    /// </summary>
+    _Success_(return) bool try_get_string(_In_ const handle_type key,
+        _In_opt_z_ const wchar_t *name,
+        _Out_ std::wstring& value) const;
+
+private:
+
+    /// <summary>
+    /// Fills <paramref name="node" /> from <paramref name="json" />.
+    /// </summary>
+    static void parse(_Out_ node& node, _In_ const nlohmann::json& json);
+
+    std::unique_ptr<node> _root;
+};
+
+#include "registry.inl"
+
+#endif /* !defined(_OXRSWITCH_REGISTRY_H) */
@@ -0,0 +1,59 @@
+﻿// <copyright file="registry.inl" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+
+#if defined(_WIN32)
+/*
+ * win32_registry::enumerate_keys
+ */
+template<class TCallback>
+void win32_registry::enumerate_keys(_In_ const handle_type key,
+        _In_ TCallback&& callback) const {
+    for (auto it = wil::reg::key_iterator(key), end = wil::reg::key_iterator();
+            it != end; ++it) {
+        callback(it->name);
+    }
+}
+
+
+/*
+ * win32_registry::enumerate_values
+ */
+template<class TCallback>
+void win32_registry::enumerate_values(_In_ const handle_type key,
+        _In_ TCallback&& callback) const {
+    for (auto it = wil::reg::value_iterator(key),
+            end = wil::reg::value_iterator(); it != end; ++it) {
+        callback(it->name);
+    }
+}
+#endif /* defined(_WIN32) */
+
+
+/*
+ * memory_registry::enumerate_keys
+ */
+template<class TCallback>
+void memory_registry::enumerate_keys(_In_ const handle_type key,
+        _In_ TCallback&& callback) const {
+    assert(key != nullptr);
+    for (auto& k : key->keys) {
+        callback(k.first);
+    }
+}
+
+
+/*
+ * memory_registry::enumerate_values
+ */
+template<class TCallback>
+void memory_registry::enumerate_values(_In_ const handle_type key,
+        _In_ TCallback&& callback) const {
+    assert(key != nullptr);
+    for (auto& v : key->values) {
+        callback(v.first);
+    }
+}
@@ -0,0 +1,131 @@
+﻿// <copyright file="registry_transaction.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+#include "registry_transaction.h"
+
+#if defined(_WIN32)
+
+
+/*
+ * registry_transaction::get_value
+ */
+std::wstring registry_transaction::get_value(_In_opt_ const HKEY key,
+        _In_z_ const wchar_t *name) {
+    // The loader expands REG_EXPAND_SZ itself, so we compare what is
+    // actually stored rather than its expansion.
+    constexpr auto flags = RRF_RT_REG_SZ | RRF_RT_REG_EXPAND_SZ
+        | RRF_NOEXPAND;
+    std::wstring retval;
+
+    if (key == NULL) {
+        return retval;
+    }
+
+    // The value might change between querying its size and reading it, in
+    // which case we just try again.
+    while (true) {
+        DWORD size = 0;
+        auto status = ::RegGetValueW(key, nullptr, name, flags, nullptr,
+            nullptr, &size);
+        if ((status == ERROR_FILE_NOT_FOUND)
+                || (status == ERROR_UNSUPPORTED_TYPE)) {
+            return std::wstring();
+        }
+        THROW_IF_WIN32_ERROR(status);
+
+        retval.resize(size / sizeof(wchar_t));
+        status = ::RegGetValueW(key, nullptr, name, flags, nullptr,
+            retval.data(), &size);
+        if (status == ERROR_MORE_DATA) {
+            continue;
+        } else if ((status == ERROR_FILE_NOT_FOUND)
+                || (status == ERROR_UNSUPPORTED_TYPE)) {
+            return std::wstring();
+        }
+        THROW_IF_WIN32_ERROR(status);
+
+        // The size includes the terminating zero.
+        retval.resize((size / sizeof(wchar_t)) - ((size > 0) ? 1 : 0));
+        return retval;
+    }
+}
+
+
+/*
+ * registry_transaction::update_value
+ */
+bool registry_transaction::update_value(_In_opt_ const HKEY key,
+        _In_z_ const wchar_t *name,
+        _In_ const std::wstring& value) {
+    if ((key == NULL) || (get_value(key, name) == value)) {
+        return false;
+    }
+
+    if (value.empty()) {
+        THROW_IF_WIN32_ERROR(::RegDeleteValueW(key, name));
+    } else {
+        wil::reg::set_value(key, name, value.c_str());
+    }
+
+    return true;
+}
+
+
+/*
+ * registry_transaction::registry_transaction
+ */
+registry_transaction::registry_transaction(void)
+    : _committed(false),
+        _handle(::CreateTransaction(nullptr,
+            nullptr,
+            0,
+            0,
+            0,
+            0,
+            nullptr)) {
+    THROW_LAST_ERROR_IF(!this->_handle);
+}
+
+
+/*
+ * registry_transaction::~registry_transaction
+ */
+registry_transaction::~registry_transaction(void) noexcept {
+    if (!this->_committed) {
+        ::RollbackTransaction(this->_handle.get());
+    }
+}
+
+
+/*
+ * registry_transaction::commit
+ */
+void registry_transaction::commit(void) {
+    THROW_LAST_ERROR_IF(!::CommitTransaction(this->_handle.get()));
+    this->_committed = true;
+}
+
+
+/*
+ * registry_transaction::open
+ */
+wil::unique_hkey registry_transaction::open(_In_opt_ const HKEY key) {
+    wil::unique_hkey retval;
+
+    if (key != NULL) {
+        THROW_IF_WIN32_ERROR(::RegOpenKeyTransactedW(key,
+            nullptr,
+            0,
+            KEY_QUERY_VALUE | KEY_SET_VALUE,
+            retval.put(),
+            this->_handle.get(),
+            nullptr));
+    }
+
+    return retval;
+}
+#endif /* defined(_WIN32) */
@@ -0,0 +1,99 @@
+﻿// <copyright file="registry_transaction.h" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#if !defined(_OXRSWITCH_REGISTRY_TRANSACTION_H)
+#define _OXRSWITCH_REGISTRY_TRANSACTION_H
+#pragma once
+
+#if defined(_WIN32)
+
+
+/// <summary>
+/// Groups changes of multiple registry keys such that other programs either
+/// see all of them or none.
+/// </summary>
+/// <remarks>
+/// <para>The transaction is rolled back unless it has been committed when the
+/// instance is destroyed.</para>
+/// <para>The switcher and the service both change the native and the WOW64
+/// runtime through this class, such that a 32-bit application never sees
+/// the new native runtime along with the old WOW64 one.</para>
+/// </remarks>
+class registry_transaction final {
+
+public:
+
+    /// <summary>
+    /// Gets the string value <paramref name="name" /> of the given registry
+    /// key without expanding any environment variables.
+    /// </summary>
+    /// <param name="key">The key, which may be <see langword="NULL" />.
+    /// </param>
+    /// <param name="name">The name of the value.</param>
+    /// <returns>The value or an empty string if the key is
+    /// <see langword="NULL" /> or does not have a value of type
+    /// <c>REG_SZ</c> or <c>REG_EXPAND_SZ</c>.</returns>
+    static std::wstring get_value(_In_opt_ const HKEY key,
+        _In_z_ const wchar_t *name);
+
+    /// <summary>
+    /// Sets the string value <paramref name="name" /> of the given registry
+    /// key unless it already has the requested content.
+    /// </summary>
+    /// <remarks>
+    /// Every write to the registry wakes any program watching the key, so
+    /// writes that would not change anything are skipped.
+    /// </remarks>
+    /// <param name="key">The key, which should have been opened using
+    /// <see cref="open" /> and may be <see langword="NULL" />.</param>
+    /// <param name="name">The name of the value.</param>
+    /// <param name="value">The new content of the value. If empty, the value
+    /// is deleted.</param>
+    /// <returns><see langword="true" /> if the registry has been changed,
+    /// <see langword="false" /> if the value was already up to date or the
+    /// key is <see langword="NULL" />.</returns>
+    static bool update_value(_In_opt_ const HKEY key,
+        _In_z_ const wchar_t *name,
+        _In_ const std::wstring& value);
+
+    /// <summary>
+    /// Starts a new transaction.
+    /// </summary>
+    registry_transaction(void);
+
+    registry_transaction(const registry_transaction&) = delete;
+
+    /// <summary>
+    /// Finalises the instance.
+    /// </summary>
+    ~registry_transaction(void) noexcept;
+
+    /// <summary>
+    /// Makes all changes visible to other programs.
+    /// </summary>
+    void commit(void);
+
+    /// <summary>
+    /// Opens <paramref name="key" /> such that all changes made through the
+    /// returned handle are part of the transaction.
+    /// </summary>
+    /// <param name="key">The key to be opened, which may be
+    /// <see langword="NULL" />.</param>
+    /// <returns>The transacted handle, which is invalid if
+    /// <paramref name="key" /> is <see langword="NULL" />.</returns>
+    wil::unique_hkey open(_In_opt_ const HKEY key);
+
+    registry_transaction& operator =(const registry_transaction&) = delete;
+
+private:
+
+    bool _committed;
+    wil::unique_hfile _handle;
+};
+
+#endif /* defined(_WIN32) */
+
+#endif /* !defined(_OXRSWITCH_REGISTRY_TRANSACTION_H) */
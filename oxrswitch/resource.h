@@ -11,6 +11,7 @@
 #define IDS_ERROR_UNEXPECTED            111
 #define IDS_ERROR_NOTADMIN              112
 #define IDS_WMR                         113
+#define IDS_ERROR_WATCH                 114
 #define IDR_MAINFRAME                   128
 #define IDD_SELECTDIALOG                129
 #define IDC_LABEL_ACTIVE_RUNTIME        1000
@@ -27,6 +28,6 @@
 #define _APS_NEXT_RESOURCE_VALUE        130
 #define _APS_NEXT_COMMAND_VALUE         32771
 #define _APS_NEXT_CONTROL_VALUE         1003
-#define _APS_NEXT_SYMED_VALUE           113
+#define _APS_NEXT_SYMED_VALUE           115
 #endif
 #endif
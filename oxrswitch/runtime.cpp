@@ -7,6 +7,218 @@
 #include "pch.h"
 #include "runtime.h"
 
+#include "util.h"
+
+
+/// <summary>
+/// A SAX handler that checks whether a JSON document is an OpenXR runtime
+/// description and stops the parser as soon as this is decided.
+/// </summary>
+/// <remarks>
+/// Installation folders contain lots of JSON files that are no runtime
+/// descriptions, which we want to reject without parsing them completely.
+/// </remarks>
+class manifest_reader final
+        : public nlohmann::json_sax<nlohmann::json> {
+
+public:
+
+    inline manifest_reader(void)
+        : _depth(0),
+        _has_library(false),
+        _has_name(false),
+        _in_runtime(false),
+        _status(ERROR_INVALID_DATA) { }
+
+    /// <summary>
+    /// Answer the library path of the runtime, which is only valid if
+    /// <see cref="status" /> is <c>ERROR_SUCCESS</c> and empty if the path
+    /// is not a string.
+    /// </summary>
+    inline const std::string& library(void) const noexcept {
+        return this->_library;
+    }
+
+    /// <summary>
+    /// Answer the name of the runtime, which is only valid if
+    /// <see cref="status" /> is <c>ERROR_SUCCESS</c>.
+    /// </summary>
+    inline const std::string& name(void) const noexcept {
+        return this->_name;
+    }
+
+    /// <summary>
+    /// Answer whether the document was a valid runtime description.
+    /// </summary>
+    inline DWORD status(void) const noexcept {
+        return this->_status;
+    }
+
+    bool null(void) override {
+        return this->value();
+    }
+
+    bool boolean(bool) override {
+        return this->value();
+    }
+
+    bool number_integer(number_integer_t) override {
+        return this->value();
+    }
+
+    bool number_unsigned(number_unsigned_t) override {
+        return this->value();
+    }
+
+    bool number_float(number_float_t, const string_t&) override {
+        return this->value();
+    }
+
+    bool string(string_t& value) override {
+        if (this->is_runtime_member() && (this->_key == "name")) {
+            this->_name = std::move(value);
+            this->_has_name = true;
+            return this->check_complete();
+        }
+
+        if (this->is_runtime_member() && (this->_key == "library_path")) {
+            this->_library = std::move(value);
+        }
+
+        return this->value();
+    }
+
+    bool binary(binary_t&) override {
+        return this->value();
+    }
+
+    bool start_object(std::size_t) override {
+        if (this->_depth == 0) {
+            // The root must be an object, which is the only valid option.
+            ++this->_depth;
+            return true;
+        }
+
+        if (this->is_runtime_member() && (this->_key == "name")) {
+            // The name must be a string.
+            return this->fail();
+        }
+
+        if ((this->_depth == 1) && (this->_key == "runtime")) {
+            this->_in_runtime = true;
+        }
+
+        this->_has_library |= (this->is_runtime_member()
+            && (this->_key == "library_path"));
+        ++this->_depth;
+        return true;
+    }
+
+    bool key(string_t& value) override {
+        if ((this->_depth == 1) || this->is_runtime_member()) {
+            this->_key = std::move(value);
+        }
+        return true;
+    }
+
+    bool end_object(void) override {
+        --this->_depth;
+
+        if (this->_in_runtime && (this->_depth == 1)) {
+            // We have seen the whole runtime object, so the decision is final
+            // and we can skip the rest of the file.
+            if (this->_has_library) {
+                this->_status = ERROR_SUCCESS;
+            }
+            return false;
+        }
+
+        if (this->_depth == 0) {
+            // End of document without a "runtime" section.
+            return this->fail();
+        }
+
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        if (this->_depth == 0) {
+            // The root must be an object.
+            return this->fail();
+        }
+
+        if (this->is_runtime_member() && (this->_key == "name")) {
+            // The name must be a string.
+            return this->fail();
+        }
+
+        this->_has_library |= (this->is_runtime_member()
+            && (this->_key == "library_path"));
+        ++this->_depth;
+        return true;
+    }
+
+    bool end_array(void) override {
+        --this->_depth;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&,
+            const nlohmann::detail::exception&) override {
+        return this->fail();
+    }
+
+private:
+
+    inline bool check_complete(void) noexcept {
+        if (this->_has_library && this->_has_name) {
+            this->_status = ERROR_SUCCESS;
+            return false;
+        } else {
+            return true;
+        }
+    }
+
+    inline bool fail(void) noexcept {
+        this->_status = ERROR_INVALID_DATA;
+        return false;
+    }
+
+    inline bool is_runtime_member(void) const noexcept {
+        return (this->_in_runtime && (this->_depth == 2));
+    }
+
+    inline bool value(void) {
+        if (this->_depth == 0) {
+            // The root must be an object.
+            return this->fail();
+        }
+
+        if (this->is_runtime_member()) {
+            if (this->_key == "name") {
+                // The name must be a string.
+                return this->fail();
+            }
+
+            if (this->_key == "library_path") {
+                this->_has_library = true;
+                return this->check_complete();
+            }
+        }
+
+        return true;
+    }
+
+    std::size_t _depth;
+    bool _has_library;
+    bool _has_name;
+    bool _in_runtime;
+    std::string _key;
+    std::string _library;
+    std::string _name;
+    DWORD _status;
+};
+
 
 /*
  * runtime::from_file
@@ -16,24 +228,73 @@ runtime runtime::from_file(_In_ const std::wstring& path,
         _In_opt_z_ const wchar_t *name) {
     runtime retval;
 
-    std::ifstream f(path);
-    retval._name = check_runtime(nlohmann::json::parse(f));
-    // 'path' is valid runtime at this point.
-
-    if (wow_path != nullptr) {
-        std::ifstream f(wow_path);
-        check_runtime(nlohmann::json::parse(f));
-        // 'wow_path' is valid runtime at this point.
-        retval._wow_path = wow_path;
+    const auto error = try_from_file(path, wow_path, name, retval);
+    if (error == ERROR_INVALID_DATA) {
+        throw std::invalid_argument("The specified file does not contain a "
+            "valid OpenXR runtime description.");
     }
+    THROW_IF_WIN32_ERROR(error);
+
+    return retval;
+}
 
-    retval._path = path;
 
-    if (name != nullptr) {
-        retval._name = name;
+/*
+ * runtime::get_library_path
+ */
+std::wstring runtime::get_library_path(_In_ const std::wstring& path) {
+    std::wstring retval;
+    if ((check_file(path.c_str(), nullptr, &retval) != ERROR_SUCCESS)
+            || retval.empty()) {
+        return std::wstring();
     }
 
-    return retval;
+    const auto is_absolute = ::is_directory_separator(retval.front())
+        || ((retval.size() > 1) && (retval[1] == L':'));
+    if (!is_absolute) {
+        // The loader would search bare file names in the library search
+        // path, but the library is most likely next to the manifest anyway.
+        retval = std::wstring(::get_directory(full_path(path))) + retval;
+    }
+
+    return full_path(retval);
+}
+
+
+/*
+ * runtime::try_from_file
+ */
+DWORD runtime::try_from_file(_In_ const std::wstring& path,
+        _In_opt_z_ const wchar_t *wow_path,
+        _In_opt_z_ const wchar_t *name,
+        _Out_ runtime& retval) noexcept {
+    try {
+        auto error = check_file(path.c_str(),
+            (name == nullptr) ? &retval._name : nullptr);
+        if (error != ERROR_SUCCESS) {
+            return error;
+        }
+        // 'path' is valid runtime at this point.
+
+        if (wow_path != nullptr) {
+            error = check_file(wow_path, nullptr);
+            if (error != ERROR_SUCCESS) {
+                return error;
+            }
+            // 'wow_path' is valid runtime at this point.
+            retval._wow_path = wow_path;
+        }
+
+        retval._path = path;
+
+        if (name != nullptr) {
+            retval._name = name;
+        }
+
+        return ERROR_SUCCESS;
+    } catch (...) {
+        return ERROR_OUTOFMEMORY;
+    }
 }
 
 
@@ -52,37 +313,50 @@ runtime& runtime::operator =(_Inout_ runtime&& rhs) noexcept {
 
 
 /*
- * runtime::check_runtime
+ * runtime::check_file
  */
-std::wstring runtime::check_runtime(_In_ const nlohmann::json& json) {
-    constexpr const char *const error_message = "The specified file does not "
-        "contain a valid OpenXR runtime description.";
-
-    const auto rt = json.find("runtime");
-    if (rt == json.end()) {
-        throw std::invalid_argument(error_message);
+DWORD runtime::check_file(_In_z_ const wchar_t *path,
+        _Out_opt_ std::wstring *name,
+        _Out_opt_ std::wstring *library) noexcept {
+    assert(path != nullptr);
+#if defined(_WIN32)
+    wil::unique_file file;
+    if (::_wfopen_s(file.put(), path, L"rb") != 0) {
+        return ERROR_OPEN_FAILED;
     }
-
-    const auto path = rt->find("library_path");
-    if (path == rt->end()) {
-        throw std::invalid_argument(error_message);
+#else /* defined(_WIN32) */
+    std::unique_ptr<std::FILE, decltype(&std::fclose)> file(nullptr,
+        &std::fclose);
+    try {
+        file.reset(std::fopen(::to_utf8(path).c_str(), "rb"));
+    } catch (...) {
+        return ERROR_OPEN_FAILED;
     }
+    if (!file) {
+        return ERROR_OPEN_FAILED;
+    }
+#endif /* defined(_WIN32) */
 
-    const auto name = rt->find("name");
-    if (name != rt->end()) {
-        auto n = name->template get<std::string>();
+    try {
+        manifest_reader reader;
+        nlohmann::json::sax_parse(file.get(), &reader);
 
-        std::size_t cnt = 0;
-        ::mbstowcs_s(&cnt, nullptr, 0, n.c_str(), n.size());
-        std::wstring retval(cnt, L'\0');
+        if (reader.status() != ERROR_SUCCESS) {
+            return reader.status();
+        }
 
-        ::mbstowcs_s(&cnt, retval.data(), retval.size(), n.c_str(), _TRUNCATE);
-        retval.resize(cnt);
+        if (name != nullptr) {
+            // JSON is UTF-8 regardless of the locale we are running in.
+            *name = ::from_utf8(reader.name());
+        }
 
-        return retval;
+        if (library != nullptr) {
+            *library = ::from_utf8(reader.library());
+        }
 
-    } else {
-        return L"";
+        return ERROR_SUCCESS;
+    } catch (...) {
+        return ERROR_INVALID_DATA;
     }
 }
 
@@ -91,6 +365,7 @@ std::wstring runtime::check_runtime(_In_ const nlohmann::json& json) {
  * runtime::full_path
  */
 std::wstring runtime::full_path(_In_ const std::wstring& path) {
+#if defined(_WIN32)
     auto expected = ::GetFullPathNameW(path.c_str(), 0, nullptr, nullptr);
     THROW_LAST_ERROR_IF(expected == 0);
 
@@ -103,4 +378,49 @@ std::wstring runtime::full_path(_In_ const std::wstring& path) {
     retval.resize(actual);
 
     return retval;
+
+#else /* defined(_WIN32) */
+    // Like GetFullPathNameW, resolve relative paths against the working
+    // directory and remove "." and ".." without accessing the file.
+    std::wstring input;
+    if (path.empty() || !::is_directory_separator(path.front())) {
+        char cwd[PATH_MAX];
+        THROW_WIN32_IF(errno, ::getcwd(cwd, sizeof(cwd)) == nullptr);
+        input = ::combine_path(::from_utf8(cwd), path.c_str());
+    } else {
+        input = path;
+    }
+
+    std::vector<std::wstring> components;
+    std::size_t begin = 0;
+    while (begin <= input.size()) {
+        auto end = input.find(L'/', begin);
+        if (end == std::wstring::npos) {
+            end = input.size();
+        }
+
+        const auto component = input.substr(begin, end - begin);
+        if (component == L"..") {
+            if (!components.empty()) {
+                components.pop_back();
+            }
+        } else if (!component.empty() && (component != L".")) {
+            components.push_back(component);
+        }
+
+        begin = end + 1;
+    }
+
+    std::wstring retval;
+    for (auto& c : components) {
+        retval += L'/';
+        retval += c;
+    }
+
+    if (retval.empty() || ::is_directory_separator(input.back())) {
+        retval += L'/';
+    }
+
+    return retval;
+#endif /* defined(_WIN32) */
 }
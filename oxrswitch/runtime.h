@@ -8,6 +8,9 @@
 #define _OXRSWITCH_RUNTIME_H
 #pragma once
 
+#include "path_compare.h"
+#include "util.h"
+
 
 /// <summary>
 /// Represents an OpenXR runtime.
@@ -60,11 +63,60 @@ public:
             name.empty() ? nullptr : name.c_str());
     }
 
+    /// <summary>
+    /// Determines the path of the library of the runtime described by the
+    /// JSON file at <paramref name="path" />.
+    /// </summary>
+    /// <remarks>
+    /// Relative library paths and bare file names are resolved relative to
+    /// the directory of the JSON file. The result is empty if the file is no
+    /// valid runtime description or if the library path is not a string.
+    /// </remarks>
+    /// <param name="path">The path to the JSON file holding the meta data of
+    /// the runtime.</param>
+    /// <returns>The full path of the library.</returns>
+    static std::wstring get_library_path(_In_ const std::wstring& path);
+
+    /// <summary>
+    /// Creates a new instance from a JSON file without throwing if the file is
+    /// not a valid runtime description.
+    /// </summary>
+    /// <param name="path">The path to the JSON file holding the meta data of
+    /// the runtime.</param>
+    /// <param name="wow_path">An optional path to the WOW64 version of the JSON
+    /// file.</param>
+    /// <param name="name">If not <see langword="nullptr" />, overrides the name
+    /// of the runtime.</param>
+    /// <param name="retval">Receives the runtime in case of success.</param>
+    /// <returns><c>ERROR_SUCCESS</c> in case of success,
+    /// <c>ERROR_INVALID_DATA</c> if any of the files is not a valid runtime
+    /// description, or any other Win32 error code if a file could not be read.
+    /// </returns>
+    static DWORD try_from_file(_In_ const std::wstring& path,
+        _In_opt_z_ const wchar_t *wow_path,
+        _In_opt_z_ const wchar_t *name,
+        _Out_ runtime& retval) noexcept;
+
     /// <summary>
     /// Initialises a new instance.
     /// </summary>
     runtime(void) = default;
 
+    /// <summary>
+    /// Initialises a new instance from data that have been validated before,
+    /// for instance when restoring a <see cref="discovery_cache" />.
+    /// </summary>
+    /// <param name="name">The display name of the runtime.</param>
+    /// <param name="path">The path to the JSON file of the runtime.</param>
+    /// <param name="wow_path">The path to the JSON file of the WOW64 version,
+    /// which may be empty.</param>
+    inline runtime(_In_ std::wstring name,
+            _In_ std::wstring path,
+            _In_ std::wstring wow_path) noexcept
+        : _name(std::move(name)),
+        _path(std::move(path)),
+        _wow_path(std::move(wow_path)) { }
+
     /// <summary>
     /// Initialises a clone of <paramref name="other" />.
     /// </summary>
@@ -123,19 +175,33 @@ public:
     /// <returns><see langword="true" /> if the runtime is valid,
     /// <see langword="false" /> otherwise.</returns>
     inline operator bool(void) const noexcept {
+#if defined(_WIN32)
         auto f = wil::try_open_file(this->_path.c_str());
         return (!this->_name.empty() && f.file);
+#else /* defined(_WIN32) */
+        return (!this->_name.empty() && ::file_exists(this->_path));
+#endif /* defined(_WIN32) */
     }
 
 private:
 
     /// <summary>
-    /// Checks whether <paramref name="json" /> contains the required data and
-    /// returns the name of the runtime according to the given file content.
+    /// Streams the JSON file at <paramref name="path" /> and checks whether it
+    /// contains the required data, stopping as soon as this is decided.
     /// </summary>
-    /// <param name="json"></param>
-    /// <returns></returns>
-    static std::wstring check_runtime(_In_ const nlohmann::json& json);
+    /// <param name="path">The path to the JSON file.</param>
+    /// <param name="name">If not <see langword="nullptr" />, receives the name
+    /// of the runtime, which is empty if the file does not specify a name.
+    /// </param>
+    /// <param name="library">If not <see langword="nullptr" />, receives the
+    /// library path as specified in the file, which is empty if it is not a
+    /// string.</param>
+    /// <returns><c>ERROR_SUCCESS</c> if the file is a valid runtime
+    /// description, <c>ERROR_INVALID_DATA</c> if not, or any other Win32 error
+    /// code if the file could not be read.</returns>
+    static DWORD check_file(_In_z_ const wchar_t *path,
+        _Out_opt_ std::wstring *name,
+        _Out_opt_ std::wstring *library = nullptr) noexcept;
 
     /// <summary>
     /// Resolves the full path of <paramref name="path" />.
@@ -152,13 +218,13 @@ private:
 
 /// <summary>
 /// Provides a ordering for runtimes based on the path of the runtime file and
-/// nothing else.
+/// nothing else, which is compared like any other path.
 /// </summary>
 template<> struct std::less<runtime> {
 
     inline bool operator()(_In_ const runtime& lhs,
             _In_ const runtime& rhs) const noexcept {
-        return (lhs.path() < rhs.path());
+        return path_compare()(lhs.path(), rhs.path());
     }
 };
 
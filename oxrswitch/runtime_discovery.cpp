@@ -0,0 +1,109 @@
+﻿// <copyright file="runtime_discovery.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+#include "runtime_discovery.h"
+
+
+/*
+ * runtime_discovery::runtime_discovery
+ */
+runtime_discovery::runtime_discovery(_In_ found_callback on_found,
+        _In_ completed_callback on_completed,
+        _In_ changed_callback on_changed,
+        _In_ failed_callback on_failed)
+    : _cancelled(false),
+        _on_changed(std::move(on_changed)),
+        _on_completed(std::move(on_completed)),
+        _on_failed(std::move(on_failed)),
+        _on_found(std::move(on_found)),
+        _start(clock_type::now()),
+        _time_to_complete(not_yet),
+        _time_to_first(not_yet) {
+    // Note: the thread must be started last, because it uses all the other
+    // members.
+    this->_thread = std::thread([this](void) {
+        std::exception_ptr error;
+
+        try {
+            this->_manager.reset(new runtime_manager(
+                    [this](const runtime& r) {
+                if (this->cancelled()) {
+                    return;
+                }
+
+                auto expected = not_yet;
+                this->_time_to_first.compare_exchange_strong(expected,
+                    (clock_type::now() - this->_start).count(),
+                    std::memory_order_acq_rel);
+
+                if (this->_on_found) {
+                    this->_on_found(r);
+                }
+            }, &this->_cancelled));
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        // A cancelled discovery is incomplete and nobody is interested in it
+        // anymore.
+        if (this->cancelled()) {
+            return;
+        }
+
+        this->_time_to_complete.store(
+            (clock_type::now() - this->_start).count(),
+            std::memory_order_release);
+
+        if (this->_on_completed) {
+            try {
+                this->_on_completed(error);
+            } catch (...) { /* Nothing we could do about this. */ }
+        }
+
+        // Start watching only after the completion has been reported, such
+        // that any change is reported after the initial result.
+        if (!error && this->_on_changed && !this->cancelled()) {
+            try {
+                this->_manager->watch(this->_on_changed, this->_on_failed);
+            } catch (...) {
+                // The initial result remains valid, but it is not updated.
+                if (this->_on_failed) {
+                    try {
+                        this->_on_failed(std::current_exception());
+                    } catch (...) { /* Nothing we could do about this. */ }
+                }
+            }
+        }
+    });
+}
+
+
+/*
+ * runtime_discovery::~runtime_discovery
+ */
+runtime_discovery::~runtime_discovery(void) {
+    this->cancel();
+    this->wait();
+}
+
+
+/*
+ * runtime_discovery::cancel
+ */
+void runtime_discovery::cancel(void) noexcept {
+    this->_cancelled.store(true, std::memory_order_release);
+}
+
+
+/*
+ * runtime_discovery::wait
+ */
+void runtime_discovery::wait(void) {
+    if (this->_thread.joinable()) {
+        this->_thread.join();
+    }
+}
@@ -0,0 +1,158 @@
+﻿// <copyright file="runtime_discovery.h" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#if !defined(_OXRSWITCH_RUNTIME_DISCOVERY_H)
+#define _OXRSWITCH_RUNTIME_DISCOVERY_H
+#pragma once
+
+#include "runtime_manager.h"
+
+
+/// <summary>
+/// Searches for runtimes on a background thread and reports each runtime as
+/// soon as it has been found. Afterwards, the system can be watched for
+/// runtimes being installed or removed.
+/// </summary>
+/// <remarks>
+/// The class does not depend on any UI. All callbacks are invoked on
+/// background threads, so a UI must marshal them to its own thread, for
+/// instance by posting a window message.
+/// </remarks>
+class runtime_discovery final {
+
+public:
+
+    /// <summary>
+    /// A callback that is invoked whenever the runtimes have changed after the
+    /// discovery has completed.
+    /// </summary>
+    typedef runtime_manager::changed_callback changed_callback;
+
+    /// <summary>
+    /// The clock used to measure the progress of the discovery.
+    /// </summary>
+    typedef std::chrono::steady_clock clock_type;
+
+    /// <summary>
+    /// A callback that is invoked once the discovery has completed. If the
+    /// discovery failed, the parameter holds the exception.
+    /// </summary>
+    typedef std::function<void(std::exception_ptr)> completed_callback;
+
+    /// <summary>
+    /// A callback that is invoked if watching the system failed, after which
+    /// no further changes are reported.
+    /// </summary>
+    typedef runtime_manager::failed_callback failed_callback;
+
+    /// <summary>
+    /// A callback that is invoked for each runtime found.
+    /// </summary>
+    typedef runtime_manager::found_callback found_callback;
+
+    /// <summary>
+    /// Starts the discovery.
+    /// </summary>
+    /// <param name="on_found">The callback to be invoked for each runtime
+    /// found.</param>
+    /// <param name="on_completed">The callback to be invoked once the
+    /// discovery completed, which may be empty.</param>
+    /// <param name="on_changed">If not empty, the system is watched after
+    /// the discovery completed successfully and the callback is invoked with
+    /// all runtimes whenever they have changed.</param>
+    /// <param name="on_failed">The callback to be invoked if watching the
+    /// system failed, which may be empty.</param>
+    runtime_discovery(_In_ found_callback on_found,
+        _In_ completed_callback on_completed,
+        _In_ changed_callback on_changed = changed_callback(),
+        _In_ failed_callback on_failed = failed_callback());
+
+    runtime_discovery(const runtime_discovery&) = delete;
+
+    /// <summary>
+    /// Finalises the instance.
+    /// </summary>
+    /// <remarks>
+    /// The destructor cancels the discovery, waits for the background thread
+    /// to exit and stops watching the system.
+    /// </remarks>
+    ~runtime_discovery(void);
+
+    /// <summary>
+    /// Stops the discovery before the next installation folder is searched.
+    /// </summary>
+    /// <remarks>
+    /// Once cancelled, no callback is invoked anymore, except for the ones
+    /// that are already running. In particular, the completion is not
+    /// reported and the system is not watched.
+    /// </remarks>
+    void cancel(void) noexcept;
+
+    /// <summary>
+    /// Answer whether the discovery has been cancelled.
+    /// </summary>
+    /// <returns></returns>
+    inline bool cancelled(void) const noexcept {
+        return this->_cancelled.load(std::memory_order_acquire);
+    }
+
+    /// <summary>
+    /// Answer whether the discovery has completed.
+    /// </summary>
+    /// <returns></returns>
+    inline bool completed(void) const noexcept {
+        return (this->_time_to_complete.load(std::memory_order_acquire)
+            != not_yet);
+    }
+
+    /// <summary>
+    /// Answer the time from the start of the discovery until the first
+    /// runtime was found.
+    /// </summary>
+    /// <returns>The elapsed time or a negative value if no runtime has been
+    /// found yet.</returns>
+    inline clock_type::duration time_to_first(void) const noexcept {
+        return clock_type::duration(this->_time_to_first.load(
+            std::memory_order_acquire));
+    }
+
+    /// <summary>
+    /// Answer the time from the start of the discovery until it completed.
+    /// </summary>
+    /// <returns>The elapsed time or a negative value if the discovery has not
+    /// yet completed.</returns>
+    inline clock_type::duration time_to_complete(void) const noexcept {
+        return clock_type::duration(this->_time_to_complete.load(
+            std::memory_order_acquire));
+    }
+
+    /// <summary>
+    /// Waits for the discovery to complete or to be cancelled.
+    /// </summary>
+    void wait(void);
+
+    runtime_discovery& operator =(const runtime_discovery&) = delete;
+
+private:
+
+    /// <summary>
+    /// The value of the elapsed times before the respective event.
+    /// </summary>
+    static constexpr clock_type::rep not_yet = -1;
+
+    std::atomic<bool> _cancelled;
+    std::unique_ptr<runtime_manager> _manager;
+    changed_callback _on_changed;
+    completed_callback _on_completed;
+    failed_callback _on_failed;
+    found_callback _on_found;
+    clock_type::time_point _start;
+    std::thread _thread;
+    std::atomic<clock_type::rep> _time_to_complete;
+    std::atomic<clock_type::rep> _time_to_first;
+};
+
+#endif /* !defined(_OXRSWITCH_RUNTIME_DISCOVERY_H) */
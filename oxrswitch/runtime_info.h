@@ -8,6 +8,8 @@
 #define _OXRSWITCH_RUNTIME_INFO_H
 #pragma once
 
+#include "directory_walker.h"
+#include "registry.h"
 
 /// <summary>
 /// The runtime information that describes the properties of a known OpenXR
@@ -25,62 +27,88 @@ public:
     /// <summary>
     /// Initialises a new instance.
     /// </summary>
-    /// <param name="vendor">A regular expression the software vendor in the
-    /// registry must match.</param>
-    /// <param name="software">A regular expression the display name of the
-    /// software in the registry must match.</param>
+    /// <param name="vendor">A pattern the software vendor in the registry must
+    /// match. The pattern is matched case-insensitively and may start with
+    /// &quot;^&quot; to require a match at the begin of the vendor.</param>
+    /// <param name="software">A pattern the display name of the software in
+    /// the registry must match. The pattern is matched case-insensitively and
+    /// may start with &quot;^&quot; to require a match at the begin of the
+    /// display name.</param>
+    /// <param name="subkey">An optional subkey of the software key holding
+    /// the installation path.</param>
+    /// <param name="value">An optional name of the value holding the
+    /// installation path.</param>
+    /// <param name="walk">Restricts the search for runtime files in the
+    /// installation folder.</param>
     runtime_info(_In_z_ const wchar_t *vendor,
         _In_z_ const wchar_t *software,
         _In_opt_z_ const wchar_t *subkey = nullptr,
-        _In_opt_z_ const wchar_t *value = nullptr);
+        _In_opt_z_ const wchar_t *value = nullptr,
+        _In_ const walk_options& walk = walk_options());
 
     /// <summary>
-    /// Answer whether the given <paramref name="vendor" /> and
-    /// <paramref name="software" /> match the description of the runtime.
+    /// Gets the pattern that matches the display name of the software in the
+    /// uninstall database.
     /// </summary>
-    /// <param name="vendor"></param>
-    /// <param name="software"></param>
     /// <returns></returns>
-    bool is_match(_In_ const std::wstring& vendor,
-        _In_ const std::wstring& software) const noexcept;
+    inline const std::wstring& software(void) const noexcept {
+        return this->_software;
+    }
 
     /// <summary>
-    /// Gets a regular expression that matches the display name of the software
-    /// in the uninstall database.
+    /// Gets the subkey of the software key that holds the installation path,
+    /// which is empty if the path is stored in the software key itself.
     /// </summary>
     /// <returns></returns>
-    inline const std::wregex& software(void) const noexcept {
-        return this->_software;
+    inline const std::wstring& subkey(void) const noexcept {
+        return this->_subkey;
     }
 
     /// <summary>
     /// Tries to derive the installation path from the custom software key of
     /// the registry.
     /// </summary>
+    /// <typeparam name="TRegistry">The type providing access to the registry,
+    /// which must be compatible with <see cref="win32_registry" />.
+    /// </typeparam>
+    /// <param name="registry">The registry to be searched.</param>
     /// <param name="key">The vendor-specific software key in the
     /// &quot;Software&quot; or &quot;WOW6432Node&quot; location of the
     /// registry.</param>
     /// <param name="path">Receives the installation path in case of success.
     /// </param>
     /// <returns></returns>
+    template<class TRegistry>
     _Success_(return) bool try_get_installation_path(
-        _In_ const wil::unique_hkey& key,
+        _In_ const TRegistry& registry,
+        _In_ const typename TRegistry::handle_type key,
         _Out_ std::wstring& path) const;
 
     /// <summary>
-    /// Gets a regular expression that matches the vendor name of the runtime.
+    /// Gets the options for searching the installation folder of the runtime.
     /// </summary>
     /// <returns></returns>
-    inline const std::wregex& vendor(void) const noexcept {
+    inline const walk_options& walk(void) const noexcept {
+        return this->_walk;
+    }
+
+    /// <summary>
+    /// Gets the pattern that matches the vendor name of the runtime.
+    /// </summary>
+    /// <returns></returns>
+    inline const std::wstring& vendor(void) const noexcept {
         return this->_vendor;
     }
 
 private:
 
-    std::wregex _software;
+    std::wstring _software;
     std::wstring _subkey;
     std::wstring _value;
-    std::wregex _vendor;
+    std::wstring _vendor;
+    walk_options _walk;
 };
 
+#include "runtime_info.inl"
+
 #endif /* defined(_OXRSWITCH_RUNTIME_INFO_H) */
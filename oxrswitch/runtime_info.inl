@@ -0,0 +1,26 @@
+﻿// <copyright file="runtime_info.inl" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+
+/*
+ * runtime_info::try_get_installation_path
+ */
+template<class TRegistry>
+_Success_(return) bool runtime_info::try_get_installation_path(
+        _In_ const TRegistry& registry,
+        _In_ const typename TRegistry::handle_type key,
+        _Out_ std::wstring& path) const {
+    auto value = this->_value.empty() ? nullptr : this->_value.c_str();
+
+    if (!this->_subkey.empty()) {
+        typename TRegistry::key_type k;
+        return registry.try_open(key, this->_subkey.c_str(), k)
+            && registry.try_get_string(TRegistry::get(k), value, path);
+
+    } else {
+        return registry.try_get_string(key, value, path);
+    }
+}
@@ -7,8 +7,149 @@
 #include "pch.h"
 #include "runtime_manager.h"
 
+#include "machine_type.h"
+#include "registry_transaction.h"
 #include "resource.h"
 
+#include "../oxrsvc/protocol.h"
+
+
+#if !defined(_WIN32)
+/// <summary>
+/// Appends the OpenXR subdirectory of each directory in the colon-separated
+/// list <paramref name="list" /> to <paramref name="dst" />.
+/// </summary>
+static void append_xdg_directories(_Inout_ std::vector<std::wstring>& dst,
+        _In_ const std::wstring& list) {
+    std::size_t begin = 0;
+
+    while (begin <= list.size()) {
+        auto end = list.find(L':', begin);
+        if (end == std::wstring::npos) {
+            end = list.size();
+        }
+
+        // The specification requires relative paths to be ignored.
+        if ((end > begin) && (list[begin] == L'/')) {
+            dst.push_back(list.substr(begin, end - begin) + L"/openxr/1");
+        }
+
+        begin = end + 1;
+    }
+}
+
+
+/// <summary>
+/// Gets the base directory for configuration files of the calling user.
+/// </summary>
+static std::wstring get_config_home(void) {
+    return ::get_environment_variable("XDG_CONFIG_HOME",
+        ::get_environment_variable("HOME") + L"/.config");
+}
+
+
+/// <summary>
+/// Gets the base directory for data files of the calling user.
+/// </summary>
+static std::wstring get_data_home(void) {
+    return ::get_environment_variable("XDG_DATA_HOME",
+        ::get_environment_variable("HOME") + L"/.local/share");
+}
+
+
+/// <summary>
+/// Resolves all links in <paramref name="path" />, which yields an empty
+/// string if <paramref name="path" /> does not designate an existing file.
+/// </summary>
+static std::wstring resolve_path(_In_ const std::wstring& path) {
+    std::unique_ptr<char, void (*)(char *)> retval(
+        ::realpath(::to_utf8(path).c_str(), nullptr),
+        [](char *p) { ::free(p); });
+    return retval ? ::from_utf8(retval.get()) : std::wstring();
+}
+#endif /* !defined(_WIN32) */
+
+
+#if defined(_WIN32)
+/*
+ * runtime_manager::activate_in_service
+ */
+bool runtime_manager::activate_in_service(_In_ const std::uint32_t id) {
+    std::vector<std::uint8_t> response;
+    if (!call_service(static_cast<std::uint16_t>(message_type::activate_id),
+            &id,
+            sizeof(id),
+            static_cast<std::uint16_t>(message_type::result),
+            response)) {
+        return false;
+    }
+
+    std::int32_t status;
+    THROW_WIN32_IF(ERROR_INVALID_DATA, response.size() != sizeof(status));
+    std::memcpy(&status, response.data(), sizeof(status));
+
+    // The service might defer the write, which is a success, too.
+    THROW_IF_FAILED(status);
+    return true;
+}
+
+
+/*
+ * runtime_manager::get_service_runtimes
+ */
+_Success_(return) bool runtime_manager::get_service_runtimes(
+        _Out_ std::vector<service_runtime>& runtimes) {
+    static_assert(sizeof(wchar_t) == sizeof(char16_t), "The paths in the "
+        "catalogue must be copied as they are.");
+    runtimes.clear();
+
+    std::vector<std::uint8_t> response;
+    if (!call_service(static_cast<std::uint16_t>(message_type::list),
+            nullptr,
+            0,
+            static_cast<std::uint16_t>(message_type::catalogue),
+            response)) {
+        return false;
+    }
+
+    std::size_t offset = 0;
+    const auto read_number = [&response, &offset](void) {
+        std::uint32_t retval;
+        THROW_WIN32_IF(ERROR_INVALID_DATA,
+            response.size() - offset < sizeof(retval));
+        std::memcpy(&retval, response.data() + offset, sizeof(retval));
+        offset += sizeof(retval);
+        return retval;
+    };
+    const auto read_string = [&response, &offset](const std::uint32_t cnt) {
+        const auto size = static_cast<std::size_t>(cnt) * sizeof(wchar_t);
+        THROW_WIN32_IF(ERROR_INVALID_DATA, response.size() - offset < size);
+        std::wstring retval(cnt, L'\0');
+        std::memcpy(retval.data(), response.data() + offset, size);
+        offset += size;
+        return retval;
+    };
+
+    const auto cnt = read_number();
+    for (std::uint32_t i = 0; i < cnt; ++i) {
+        const auto id = read_number();
+        const auto cnt_path = read_number();
+        const auto cnt_wow = read_number();
+        const auto path = read_string(cnt_path);
+        const auto wow_path = read_string(cnt_wow);
+
+        runtime r;
+        if (runtime::try_from_file(path,
+                wow_path.empty() ? nullptr : wow_path.c_str(),
+                nullptr,
+                r) == ERROR_SUCCESS) {
+            runtimes.emplace_back(id, std::move(r));
+        }
+    }
+
+    return true;
+}
+
 
 /*
  * runtime_manager::open_keys
@@ -34,51 +175,103 @@ std::pair<wil::unique_hkey, wil::unique_hkey> runtime_manager::open_keys(void) {
 
     return retval;
 }
+#endif /* defined(_WIN32) */
 
 
 /*
  * runtime_manager::active_runtime
  */
-const runtime& runtime_manager::active_runtime(_Out_opt_ int *index) const {
-    auto rt = wil::reg::get_value_expanded_string(this->_key.get(),
-        active_runtime_value);
+runtime runtime_manager::active_runtime(_Out_opt_ int *index) const {
+    auto rt = this->active_path();
+    const auto runtimes = this->snapshot();
 
-    auto it = std::find_if(this->_runtimes.begin(),
-        this->_runtimes.end(),
+    auto it = std::find_if(runtimes->begin(),
+        runtimes->end(),
         [&rt](const runtime& r) { return equals(r.path(), rt, false); });
 
-    if (it == this->_runtimes.end()) {
+    if (it == runtimes->end()) {
+#if defined(_WIN32)
         throw std::runtime_error(::load_string(NULL, 0));
+#else /* defined(_WIN32) */
+        THROW_WIN32(ERROR_NOT_FOUND);
+#endif /* defined(_WIN32) */
     }
 
     if (index != nullptr) {
-        *index = static_cast<int>(std::distance(this->_runtimes.begin(), it));
+        *index = static_cast<int>(std::distance(runtimes->begin(), it));
     }
 
     return *it;
 }
 
 
+/*
+ * runtime_manager::active_path
+ */
+std::wstring runtime_manager::active_path(void) const {
+#if defined(_WIN32)
+    return wil::reg::get_value_expanded_string(this->_key.get(),
+        active_runtime_value);
+#else /* defined(_WIN32) */
+    return resolve_path(this->_link);
+#endif /* defined(_WIN32) */
+}
+
+
 /*
  * runtime_manager::active_runtime
  */
 void runtime_manager::active_runtime(_In_ const runtime& runtime) {
-    wil::reg::set_value(this->_key.get(),
+#if defined(_WIN32)
+    // Stage both values in a transaction such that a 32-bit application
+    // starting in between cannot see the new native runtime along with the
+    // old WOW64 one. If we fail half-way, the transaction is rolled back.
+    registry_transaction transaction;
+    auto changed = registry_transaction::update_value(
+        transaction.open(this->_key.get()).get(),
         active_runtime_value,
-        runtime.path().c_str());
+        runtime.path());
+    changed = registry_transaction::update_value(
+        transaction.open(this->_wow_key.get()).get(),
+        active_runtime_value,
+        runtime.wow_path()) || changed;
 
-    if (this->_wow_key) {
-        if (runtime.wow_path().empty()) {
-            ::RegDeleteValueW(this->_wow_key.get(), active_runtime_value);
-            // This may fail if no 32-bit runtime was installed in the first
-            // place, which is fine. We therefore do not check this error.
+    // Committing an empty transaction would be harmless, but there is no
+    // point in it.
+    if (changed) {
+        transaction.commit();
+    }
 
-        } else {
-            wil::reg::set_value(this->_wow_key.get(),
-                active_runtime_value,
-                runtime.wow_path().c_str());
+#else /* defined(_WIN32) */
+    const auto target = ::to_utf8(resolve_path(runtime.path()));
+    THROW_WIN32_IF(ERROR_NOT_FOUND, target.empty());
+
+    // Replacing the link wakes everyone watching the directory, so we do not
+    // do this if nothing would change.
+    if (target == ::to_utf8(this->active_path())) {
+        return;
+    }
+
+    // The configuration directory of the user might not exist yet.
+    const auto link = ::to_utf8(this->_link);
+    for (auto sep = link.find('/', 1); sep != std::string::npos;
+            sep = link.find('/', sep + 1)) {
+        const auto dir = link.substr(0, sep);
+        if (::mkdir(dir.c_str(), 0755) != 0) {
+            THROW_WIN32_IF(errno, errno != EEXIST);
         }
     }
+
+    const auto tmp = link + ".tmp" + std::to_string(::getpid());
+    ::unlink(tmp.c_str());
+    THROW_WIN32_IF(errno, ::symlink(target.c_str(), tmp.c_str()) != 0);
+
+    if (::rename(tmp.c_str(), link.c_str()) != 0) {
+        const auto error = errno;
+        ::unlink(tmp.c_str());
+        THROW_WIN32(error);
+    }
+#endif /* defined(_WIN32) */
 }
 
 
@@ -86,8 +279,269 @@ void runtime_manager::active_runtime(_In_ const runtime& runtime) {
  * runtime_manager::active_runtime
  */
 void runtime_manager::active_runtime(_In_ const std::size_t index) {
-    THROW_WIN32_IF(ERROR_INVALID_PARAMETER, index >= this->_runtimes.size());
-    this->active_runtime(this->_runtimes[index]);
+    const auto runtimes = this->snapshot();
+    THROW_WIN32_IF(ERROR_INVALID_PARAMETER, index >= runtimes->size());
+    this->active_runtime((*runtimes)[index]);
+}
+
+
+/*
+ * runtime_manager::snapshot
+ */
+runtime_manager::snapshot_type runtime_manager::snapshot(void) const noexcept {
+    return this->_monitor->snapshot();
+}
+
+
+/*
+ * runtime_manager::watch
+ */
+void runtime_manager::watch(_In_ const changed_callback& on_changed,
+        _In_ const failed_callback& on_failed) {
+    // Without discovery, the monitor would need to search the whole system,
+    // most of which the segments of the previous search spare us.
+    if (!this->_monitor->scanned()) {
+        this->_monitor->restore(discovery_cache::load(
+            discovery_cache::default_path()));
+    }
+
+    // The callback runs on the thread of the monitor, which is stopped before
+    // the monitor is destroyed. The manager, however, might have been moved
+    // by then, so the callback must only refer to the monitor.
+    auto monitor = this->_monitor.get();
+    this->_monitor->start([monitor, on_changed](const snapshot_type& s) {
+        discovery_cache cache;
+        if (monitor->cache(cache)) {
+            try {
+                cache.save(discovery_cache::default_path());
+            } catch (...) { /* The cache is only an optimisation. */ }
+        }
+
+        if (on_changed) {
+            on_changed(s);
+        }
+    }, on_failed);
+}
+
+
+#if defined(_WIN32)
+/*
+ * runtime_manager::call_service
+ */
+_Success_(return) bool runtime_manager::call_service(
+        _In_ const std::uint16_t type,
+        _In_reads_bytes_(cnt) const void *payload,
+        _In_ const std::size_t cnt,
+        _In_ const std::uint16_t expected,
+        _Out_ std::vector<std::uint8_t>& response) {
+    THROW_WIN32_IF(ERROR_INVALID_PARAMETER,
+        cnt > max_frame_size - sizeof(frame_header));
+    response.clear();
+
+    wil::unique_hfile pipe(::CreateFileW(pipe_name,
+        GENERIC_READ | GENERIC_WRITE,
+        0,
+        nullptr,
+        OPEN_EXISTING,
+        0,
+        NULL));
+
+    // All instances might be serving other clients, in which case we wait
+    // for the next one to become available.
+    if (!pipe && (::GetLastError() == ERROR_PIPE_BUSY)
+            && ::WaitNamedPipeW(pipe_name, service_timeout)) {
+        pipe.reset(::CreateFileW(pipe_name,
+            GENERIC_READ | GENERIC_WRITE,
+            0,
+            nullptr,
+            OPEN_EXISTING,
+            0,
+            NULL));
+    }
+
+    if (!pipe) {
+        const auto error = ::GetLastError();
+        if ((error == ERROR_FILE_NOT_FOUND) || (error == ERROR_SEM_TIMEOUT)) {
+            return false;
+        }
+        THROW_WIN32(error);
+    }
+
+    {
+        frame_header header { frame_magic,
+            frame_version,
+            static_cast<message_type>(type),
+            static_cast<std::uint32_t>(cnt) };
+        std::vector<std::uint8_t> request(sizeof(header) + cnt);
+        std::memcpy(request.data(), &header, sizeof(header));
+        if (cnt > 0) {
+            std::memcpy(request.data() + sizeof(header), payload, cnt);
+        }
+        write(pipe, request.data(), request.size());
+    }
+
+    frame_header header;
+    read(pipe, &header, sizeof(header));
+    THROW_WIN32_IF(ERROR_INVALID_DATA, (header.magic != frame_magic)
+        || (header.length > max_frame_size - sizeof(header)));
+    response.resize(header.length);
+    read(pipe, response.data(), response.size());
+
+    // If the service could not process the request, it reports the error in
+    // a result rather than the expected response.
+    if (static_cast<std::uint16_t>(header.type) != expected) {
+        std::int32_t status = E_UNEXPECTED;
+        if ((header.type == message_type::result)
+                && (response.size() == sizeof(status))) {
+            std::memcpy(&status, response.data(), sizeof(status));
+        }
+        THROW_HR(FAILED(status) ? status : E_UNEXPECTED);
+    }
+
+    return true;
+}
+#endif /* defined(_WIN32) */
+
+
+#if !defined(_WIN32)
+/*
+ * runtime_manager::get_active_link
+ */
+std::wstring runtime_manager::get_active_link(void) {
+    return get_config_home() + L"/openxr/1/active_runtime.json";
+}
+#endif /* !defined(_WIN32) */
+
+
+#if defined(_WIN32)
+/*
+ * runtime_manager::get_installed_runtimes
+ */
+bool runtime_manager::get_installed_runtimes(_In_ const std::wstring& folder,
+        _In_ const runtime_matcher::mask_type runtimes,
+        _Inout_ std::vector<runtime>& retval,
+        _Inout_ discovery_cache& cache) {
+    // The architecture is determined from the header of the library of
+    // the runtime. Only if the library cannot be read, we guess it from
+    // the path of the manifest.
+    const auto get_machine = [](const runtime& r) {
+        const auto library = runtime::get_library_path(r.path());
+        return library.empty()
+            ? machine_type::unknown
+            : machine_cache::instance().get(library);
+    };
+
+    const auto is_32bit = [](const runtime& r, const machine_type m) {
+        if (m != machine_type::unknown) {
+            return ::is_32bit(m);
+        }
+
+        return ::contains(r.path(), L"32", false)
+            || ::contains(r.path(), L"x86", false)
+            || ::contains(r.path(), L"i386", false);
+    };
+
+    const auto is_64bit = [](const runtime& r, const machine_type m) {
+        if (m != machine_type::unknown) {
+            return ::is_64bit(m);
+        }
+
+        return ::contains(r.path(), L"64", false)
+            || ::contains(r.path(), L"x64", false)
+            || ::contains(r.path(), L"amd64", false);
+    };
+
+    std::set<runtime> candidates;
+    std::vector<std::wstring> files;
+    const auto complete = get_json_files(folder, get_walk_options(runtimes),
+        std::back_inserter(files), cache);
+
+    for (auto& c : files) {
+        runtime r;
+        if (runtime::try_from_file(c, nullptr, nullptr, r)
+                == ERROR_SUCCESS) {
+            candidates.insert(std::move(r));
+        }
+    }
+
+    auto oit = std::back_inserter(retval);
+    if (candidates.size() > 1) {
+        // If there is more than one candidate for an installation, we
+        // assume that one of them is the standard runtime and the other
+        // the WOW64 variant. Candidates with the same runtime name
+        // belong together as a native 64 bit and WOW64 pair, which we
+        // look up in an index of the names rather than partitioning
+        // the candidates again for every name.
+        const std::vector<runtime> rem_candidates(candidates.begin(),
+            candidates.end());
+        const folded_index names(rem_candidates.begin(),
+            rem_candidates.end(),
+            [](const runtime& r) {
+                return std::wstring_view(r.name());
+            });
+        std::vector<bool> done(rem_candidates.size(), false);
+
+        for (std::size_t i = 0; i < rem_candidates.size(); ++i) {
+            if (done[i]) {
+                continue;
+            }
+
+            // Collect all candidates with the same name as 'i', which
+            // includes 'i' itself.
+            std::vector<std::vector<runtime>::const_iterator> group;
+            names.for_each(rem_candidates[i].name(),
+                    [&](const std::vector<runtime>::const_iterator it) {
+                done[it - rem_candidates.begin()] = true;
+                group.push_back(it);
+            });
+
+            if (group.size() > 1) {
+                // Found a pair with matching names.
+                const auto& it = *group[0];
+                const auto& jt = *group[1];
+                const auto im = get_machine(it);
+                const auto jm = get_machine(jt);
+                const auto it32 = is_32bit(it, im);
+                const auto it64 = is_64bit(it, im);
+                const auto jt32 = is_32bit(jt, jm);
+                const auto jt64 = is_64bit(jt, jm);
+
+                if (it64 && jt32) {
+                    // 'it' is native 64 bit, 'jt' is 32 bit.
+                    *oit++ = runtime::from_file(it.path(), jt.path(),
+                        it.name());
+
+                } else if (jt64 && it32) {
+                    // 'jt' is native 64 bit, 'it' is 32 bit.
+                    *oit++ = runtime::from_file(jt.path(), it.path(),
+                        jt.name());
+
+                } else if (it64) {
+                    // Have only 64 bit and no matching 32 bit.
+                    *oit++ = it;
+
+                } else if (jt64) {
+                    // Have only 64 bit and no matching 32 bit.
+                    *oit++ = jt;
+
+                } else {
+                    // Just copy everyhing.
+                    for (auto& g : group) {
+                        *oit++ = *g;
+                    }
+                }
+
+            } else {
+                // No match found, just copy the candidate.
+                *oit++ = rem_candidates[i];
+            }
+        }
+    } else {
+        // There was only one candidate in the folder, which we add.
+        oit = std::copy(candidates.begin(), candidates.end(), oit);
+    }
+
+    return complete;
 }
 
 
@@ -99,21 +553,10 @@ wil::unique_hkey runtime_manager::get_openxr_key(
         _In_ const bool lenient) {
     assert(path != nullptr);
     try {
-        auto key = wil::reg::open_unique_key(HKEY_LOCAL_MACHINE, path);
-
-        // If we the base key, get the subkey for the latest version.
-        std::vector<std::wstring> versions;
-        std::transform(wil::reg::key_iterator(key.get()),
-            wil::reg::key_iterator(),
-            std::back_inserter(versions),
-            [](const wil::reg::key_iterator::value_type& v) { return v.name; });
-
-        // Sort such that the latest version is at the end. TODO: will break
-        // at 10, I guess ...
-        std::sort(versions.begin(), versions.end());
+        const auto version = get_openxr_path(path);
         wil::unique_hkey retval;
-        THROW_IF_WIN32_ERROR(::RegOpenKeyExW(key.get(),
-            versions.back().c_str(), 0,
+        THROW_IF_WIN32_ERROR(::RegOpenKeyExW(HKEY_LOCAL_MACHINE,
+            version.c_str(), 0,
             KEY_READ | KEY_QUERY_VALUE | KEY_SET_VALUE,
             retval.put()));
         return retval;
@@ -128,26 +571,201 @@ wil::unique_hkey runtime_manager::get_openxr_key(
 
 
 /*
- * runtime_manager::is_match
+ * runtime_manager::get_openxr_path
  */
-_Success_(return) bool runtime_manager::is_match(
-        _In_ const wil::unique_hkey& key,
-        _In_ const runtime_info& info,
-        _Out_ std::wstring& path) {
-    assert(key);
+std::wstring runtime_manager::get_openxr_path(_In_z_ const wchar_t *path) {
+    assert(path != nullptr);
+    auto key = wil::reg::open_unique_key(HKEY_LOCAL_MACHINE, path);
+
+    // If we the base key, get the subkey for the latest version.
+    std::vector<std::wstring> versions;
+    std::transform(wil::reg::key_iterator(key.get()),
+        wil::reg::key_iterator(),
+        std::back_inserter(versions),
+        [](const wil::reg::key_iterator::value_type& v) { return v.name; });
+    THROW_WIN32_IF(ERROR_NOT_FOUND, versions.empty());
+
+    // Sort such that the latest version is at the end. TODO: will break
+    // at 10, I guess ...
+    std::sort(versions.begin(), versions.end());
+    return ::combine_path(path, versions.back().c_str());
+}
+#endif /* defined(_WIN32) */
 
-    try {
-        auto name = wil::reg::get_value_string(key.get(), L"DisplayName");
-        auto publisher = wil::reg::get_value_string(key.get(), L"Publisher");
 
-        path = wil::reg::get_value_string(key.get(), L"InstallLocation");
-        return info.is_match(publisher, name);
-    } catch (...) {
-        return false;
+/*
+ * runtime_manager::get_registered_runtimes
+ */
+void runtime_manager::get_registered_runtimes(
+        _Inout_ std::vector<runtime>& retval,
+        _Inout_ discovery_cache& cache) {
+    auto oit = std::back_inserter(retval);
+
+#if defined(_WIN32)
+    // First, get all known runtimes from the registry.
+    {
+        // Track the base keys, which change if a new version of OpenXR is
+        // installed, and the lists of available runtimes. Note that we cannot
+        // track the versioned key itself, because it changes whenever the
+        // active runtime is changed.
+        for (auto k : { openxr_key, wow_key }) {
+            cache.add(discovery_cache::source_type::registry, k);
+            try {
+                cache.add(discovery_cache::source_type::registry,
+                    ::combine_path(get_openxr_path(k), L"AvailableRuntimes"));
+            } catch (...) { /* OpenXR might not be installed. */ }
+        }
+
+        // Reading the lists does not require the access rights the manager
+        // needs for changing the active runtime.
+        auto open = [](const wchar_t *path) {
+            wil::unique_hkey key;
+            try {
+                ::RegOpenKeyExW(HKEY_LOCAL_MACHINE,
+                    get_openxr_path(path).c_str(),
+                    0,
+                    KEY_READ,
+                    key.put());
+            } catch (...) { /* OpenXR might not be installed. */ }
+            return key;
+        };
+
+        std::set<std::wstring, path_compare> paths;
+        std::set<std::wstring, path_compare> wow_paths;
+        get_available_runtimes(open(openxr_key),
+            std::inserter(paths, paths.begin()));
+        get_available_runtimes(open(wow_key),
+            std::inserter(wow_paths, wow_paths.begin()));
+        make_runtimes(paths.begin(), paths.end(),
+            wow_paths.begin(), wow_paths.end(),
+            oit);
+    }
+
+    // Second, add Windows Mixed Reality, which is not listed anywhere ...
+    {
+        auto p = ::expand_environment_variables(L"%SYSTEMROOT%\\System32\\"
+            L"MixedRealityRuntime.json");
+        auto w = ::expand_environment_variables(L"%SYSTEMROOT%\\SysWOW64\\"
+            L"MixedRealityRuntime.json");
+        cache.add(discovery_cache::source_type::file_system, p);
+        cache.add(discovery_cache::source_type::file_system, w);
+
+        if (::file_exists(p)) {
+            auto n = ::load_wstring(NULL, IDS_WMR);
+
+            if (::file_exists(w)) {
+                *oit++ = runtime::from_file(p, w, n);
+            } else {
+                *oit++ = runtime::from_file(p, nullptr, n.c_str());
+            }
+        }
     }
+
+#else /* defined(_WIN32) */
+    // SteamVR only registers itself when it is started, so we check its
+    // native, legacy and Flatpak locations ourselves.
+    const auto home = ::get_environment_variable("HOME");
+    const auto steamvr = L"/steamapps/common/SteamVR/steamxr_linux64.json";
+    for (auto& p : { get_data_home() + L"/Steam" + steamvr,
+            home + L"/.steam/steam" + steamvr,
+            home + L"/.var/app/com.valvesoftware.Steam/.local/share/Steam"
+                + steamvr }) {
+        cache.add(discovery_cache::source_type::file_system, p);
+
+        runtime r;
+        const auto path = resolve_path(p);
+        if (!path.empty() && (runtime::try_from_file(path, nullptr, nullptr,
+                r) == ERROR_SUCCESS)) {
+            *oit++ = std::move(r);
+        }
+    }
+#endif /* defined(_WIN32) */
+}
+
+
+/*
+ * runtime_manager::get_walk_options
+ */
+walk_options runtime_manager::get_walk_options(
+        _In_ const runtime_matcher::mask_type runtimes) {
+    walk_options retval;
+    auto first = true;
+
+    for (std::size_t i = 0; i < runtime_info::runtimes.size(); ++i) {
+        if ((runtimes & runtime_matcher::bit(i)) != 0) {
+            auto& w = runtime_info::runtimes[i].walk();
+            if (first) {
+                retval = w;
+                first = false;
+            } else {
+                retval.merge(w);
+            }
+        }
+    }
+
+    return retval;
 }
 
 
+#if !defined(_WIN32)
+/*
+ * runtime_manager::get_xdg_directories
+ */
+runtime_manager::installation_map runtime_manager::get_xdg_directories(
+        _Inout_ discovery_cache& cache) {
+    std::vector<std::wstring> directories;
+    directories.push_back(get_config_home() + L"/openxr/1");
+    append_xdg_directories(directories,
+        ::get_environment_variable("XDG_CONFIG_DIRS", L"/etc/xdg"));
+    directories.push_back(L"/etc/openxr/1");
+    directories.push_back(get_data_home() + L"/openxr/1");
+    append_xdg_directories(directories,
+        ::get_environment_variable("XDG_DATA_DIRS",
+            L"/usr/local/share:/usr/share"));
+
+    // The list only changes with the environment, but a directory that has
+    // been created since the last search must be watched from now on.
+    installation_map retval;
+    for (auto& d : directories) {
+        cache.add(discovery_cache::source_type::file_system, d);
+        retval.emplace(std::move(d), 0);
+    }
+
+    return retval;
+}
+
+
+/*
+ * runtime_manager::get_xdg_runtimes
+ */
+void runtime_manager::get_xdg_runtimes(_In_ const std::wstring& folder,
+        _Inout_ std::vector<runtime>& retval,
+        _Inout_ discovery_cache& cache) {
+    cache.add(discovery_cache::source_type::file_system, folder);
+
+    posix_file_system().enumerate(folder, [&](const wchar_t *name,
+            const bool is_directory) {
+        // The active runtime and its architecture-specific variants are not
+        // runtimes of their own.
+        const std::wstring file(name);
+        if (is_directory
+                || !::ends_with(file, L".json")
+                || (file.compare(0, 14, L"active_runtime") == 0)) {
+            return;
+        }
+
+        runtime r;
+        const auto path = resolve_path(folder + L"/" + file);
+        if (!path.empty() && (runtime::try_from_file(path, nullptr, nullptr,
+                r) == ERROR_SUCCESS)) {
+            retval.push_back(std::move(r));
+        }
+    });
+}
+#endif /* !defined(_WIN32) */
+
+
+#if defined(_WIN32)
 /*
  * runtime_manager::read
  */
@@ -186,148 +804,51 @@ void runtime_manager::write(_In_ wil::unique_hfile &handle,
 }
 
 
+#endif /* defined(_WIN32) */
+
 
 /*
  * runtime_manager::load_runtimes
  */
-void runtime_manager::load_runtimes(void) {
-    // As we expect that some runtimes will be discovered via multiple paths, we
-    // collect anything in a set to avoid duplicates.
-    std::set<runtime> runtimes;
-    auto oit = std::inserter(runtimes, runtimes.begin());
-
-    // First, get all known runtimes from the registry.
+void runtime_manager::load_runtimes(_In_ const found_callback& on_found,
+        _In_opt_ const std::atomic<bool> *cancelled) {
+    const auto path = discovery_cache::default_path();
+
+    // If nothing the previous result depends on has changed, we can skip the
+    // expensive search of the registry and the file system. Otherwise, the
+    // segments of the previous result tell us which parts of the system must
+    // be searched again.
+    discovery_cache cache;
     {
-        std::set<std::wstring, path_compare> paths;
-        std::set<std::wstring, path_compare> wow_paths;
-        get_available_runtimes(this->_key,
-            std::inserter(paths, paths.begin()));
-        get_available_runtimes(this->_wow_key,
-            std::inserter(wow_paths, wow_paths.begin()));
-        make_runtimes(paths.begin(), paths.end(),
-            wow_paths.begin(), wow_paths.end(),
-            oit);
-    }
+        auto previous = discovery_cache::load(path);
+        const auto valid = previous.is_valid(discovery_cache::get_stamp);
+        const auto restored = this->_monitor->restore(std::move(previous));
 
-    // Second, add Windows Mixed Reality, which is not listed anywhere ...
-    {
-        auto p = ::expand_environment_variables(L"%SYSTEMROOT%\\System32\\"
-            L"MixedRealityRuntime.json");
-        auto w = ::expand_environment_variables(L"%SYSTEMROOT%\\SysWOW64\\"
-            L"MixedRealityRuntime.json");
-        if (::file_exists(p)) {
-            auto n = ::load_wstring(NULL, IDS_WMR);
+        if (valid || restored) {
+            const auto complete = valid || this->_monitor->update(cache);
 
-            if (::file_exists(w)) {
-                *oit++ = runtime::from_file(p, w, n);
-            } else {
-                *oit++ = runtime::from_file(p, nullptr, n.c_str());
+            if (on_found) {
+                const auto runtimes = this->_monitor->snapshot();
+                std::for_each(runtimes->begin(), runtimes->end(), on_found);
             }
-        }
-    }
-
-    // Third, look for runtimes in known installation paths.
-    {
-        const auto is_32bit = [](const runtime& r) {
-            return ::contains(r.path(), L"32", false)
-                || ::contains(r.path(), L"x86", false)
-                || ::contains(r.path(), L"i386", false);
-        };
-
-        const auto is_64bit = [](const runtime& r) {
-            return ::contains(r.path(), L"64", false)
-                || ::contains(r.path(), L"x64", false)
-                || ::contains(r.path(), L"amd64", false);
-        };
-
-        std::set<std::wstring, path_compare> installs;
-        get_uninstall_paths(std::inserter(installs, installs.begin()));
-        get_software_paths(std::inserter(installs, installs.begin()));
 
-        //installs.insert(std::wstring(L"\\\\villanella\\c$\\Program Files\\Oculus"));
-
-        for (auto& p : installs) {
-            std::set<runtime> candidates;
-            std::vector<std::wstring> files;
-            get_json_files(p, std::back_inserter(files));
-
-            for (auto& c : files) {
+            if (!valid && complete) {
                 try {
-                    candidates.insert(runtime::from_file(c));
-                } catch (...) { /* Candidate invalid. */ }
-            }
-
-            if (candidates.size() > 1) {
-                // If there is more than one candidate for an installation, we
-                // assume that one of them is the standard runtime and the other
-                // the WOW64 variant. In a first step, we copy the candidates to
-                // a vector such that we can partition them according to their
-                // runtime names. This way, we can find the files that belong
-                // together as a native 64 bit and WOW64 pair.
-                std::vector<runtime> rem_candidates;
-                rem_candidates.reserve(candidates.size());
-                std::copy(candidates.begin(),
-                    candidates.end(),
-                    std::back_inserter(rem_candidates));
-
-                // Check the candidates for 32/64 pairs.
-                for (auto it = rem_candidates.begin();
-                        it != rem_candidates.end();) {
-                    // 'split' is the first runtime in 'rem_candidates' that has
-                    // a different name than 'it'.
-                    const auto split = std::partition(it, rem_candidates.end(),
-                        [&it](const runtime& r) {
-                            return (it->name() == r.name());
-                        });
-
-                    if (it != split) {
-                        // Found a pair with matching names.
-                        const auto jt = it + 1;
-                        const auto it32 = is_32bit(*it);
-                        const auto it64 = is_64bit(*it);
-                        const auto jt32 = is_32bit(*jt);
-                        const auto jt64 = is_64bit(*jt);
-
-                        if (it64 && jt32) {
-                            // 'it' is native 64 bit, 'jt' is 32 bit.
-                            *oit++ = runtime::from_file(it->path(), jt->path(),
-                                it->name());
-
-                        } else if (jt64 && it32) {
-                            // 'it' is native 64 bit, 'jt' is 32 bit.
-                            *oit++ = runtime::from_file(jt->path(), it->path(),
-                                jt->name());
-
-                        } else if (it64) {
-                            // Have only 64 bit and no matching 32 bit.
-                            *oit++ = *it;
-
-                        } else if (jt64) {
-                            // Have only 64 bit and no matching 32 bit.
-                            *oit++ = *jt;
-
-                        } else {
-                            // Just copy everyhing.
-                            oit = std::copy(it, split, *oit);
-                        }
-
-                        it = rem_candidates.erase(it, split);
-
-                    } else {
-                        // No match found, just copy everything.
-                        oit = std::copy(it, split, oit);
-                    }
-                }
-            } else {
-                // There was only one candidate in the folder, which we add.
-                oit = std::copy(candidates.begin(), candidates.end(), oit);
+                    cache.save(path);
+                } catch (...) { /* The cache is only an optimisation. */ }
             }
+            return;
         }
     }
 
-    // Finally, transfer the runtimes to our internal vector.
-    this->_runtimes.reserve(runtimes.size());
-    std::copy(runtimes.begin(),
-        runtimes.end(),
-        std::back_inserter(this->_runtimes));
+    if (!this->_monitor->scan(cache, on_found, cancelled)) {
+        // If any folder could not be searched in time or the search has been
+        // cancelled, the result is incomplete and must not prevent a full
+        // search on the next start.
+        return;
+    }
+
+    try {
+        cache.save(path);
+    } catch (...) { /* The cache is only an optimisation. */ }
 }
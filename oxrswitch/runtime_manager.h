@@ -8,9 +8,13 @@
 #define _OXRSWITCH_RUNTIME_MANAGER_H
 #pragma once
 
+#include "discovery_cache.h"
+#include "folded_index.h"
 #include "path_compare.h"
 #include "runtime.h"
 #include "runtime_info.h"
+#include "runtime_matcher.h"
+#include "runtime_monitor.h"
 #include "util.h"
 
 
@@ -18,10 +22,111 @@
 /// The runtime manager class detects known OpenXR runtimes on the system and
 /// changes the active runtime.
 /// </summary>
+/// <remarks>
+/// On Linux, the OpenXR loader follows the XDG base directory specification
+/// instead of reading the registry. The manager searches the manifests in the
+/// &quot;openxr/1&quot; subdirectories of the XDG configuration and data
+/// directories and at the well-known locations of SteamVR, and the active
+/// runtime is the target of the link &quot;active_runtime.json&quot; in the
+/// configuration directory of the user.
+/// </remarks>
 class runtime_manager {
 
 public:
 
+    /// <summary>
+    /// A callback that is invoked on a background thread whenever the
+    /// runtimes have changed.
+    /// </summary>
+    typedef std::function<void(const std::shared_ptr<
+        const std::vector<runtime>>&)> changed_callback;
+
+    /// <summary>
+    /// A callback that is invoked if watching the system failed.
+    /// </summary>
+    typedef std::function<void(std::exception_ptr)> failed_callback;
+
+    /// <summary>
+    /// A callback that is invoked for each runtime as soon as it has been
+    /// found.
+    /// </summary>
+    typedef std::function<void(const runtime&)> found_callback;
+
+    /// <summary>
+    /// Maps installation folders to the known runtimes they have been
+    /// attributed to.
+    /// </summary>
+    typedef std::map<std::wstring, runtime_matcher::mask_type, path_compare>
+        installation_map;
+
+    /// <summary>
+    /// An immutable list of runtimes ordered by their paths.
+    /// </summary>
+    typedef std::shared_ptr<const std::vector<runtime>> snapshot_type;
+
+    /// <summary>
+    /// Selects the constructor that does not search for runtimes.
+    /// </summary>
+    struct no_discovery_t final { };
+
+    /// <summary>
+    /// The tag for the constructor that does not search for runtimes.
+    /// </summary>
+    static constexpr no_discovery_t no_discovery { };
+
+#if defined(_WIN32)
+    /// <summary>
+    /// A runtime in the catalogue of the service along with the identifier
+    /// the service has assigned to it.
+    /// </summary>
+    typedef std::pair<std::uint32_t, runtime> service_runtime;
+
+    /// <summary>
+    /// Asks the service to activate the runtime with the given identifier
+    /// from its catalogue.
+    /// </summary>
+    /// <param name="id">The identifier the service has reported in
+    /// <see cref="get_service_runtimes" />.</param>
+    /// <returns><see langword="true" /> if the service has accepted the
+    /// request, <see langword="false" /> if the service is not running.
+    /// </returns>
+    /// <exception cref="wil::ResultException">If the service has rejected
+    /// the request.</exception>
+    static bool activate_in_service(_In_ const std::uint32_t id);
+#endif /* defined(_WIN32) */
+
+    /// <summary>
+    /// Searches the uninstall database and the vendor-specific software keys
+    /// in the registry for the installation folders of known runtimes.
+    /// </summary>
+    /// <typeparam name="TRegistry">The type providing access to the registry,
+    /// which must be compatible with <see cref="win32_registry" />.
+    /// </typeparam>
+    /// <param name="registry">The registry to be searched.</param>
+    /// <param name="cache">Receives the time stamps of the keys the result
+    /// depends on.</param>
+    /// <returns>The installation folders found.</returns>
+    template<class TRegistry>
+    static installation_map get_installations(_In_ const TRegistry& registry,
+        _Inout_ discovery_cache& cache);
+
+#if defined(_WIN32)
+    /// <summary>
+    /// Gets the runtimes in the catalogue of the service.
+    /// </summary>
+    /// <remarks>
+    /// The service has validated the runtimes and searched the installation
+    /// folders with its own privileges, so the catalogue may comprise
+    /// runtimes the calling user cannot find. Runtimes whose manifests cannot
+    /// be read are skipped.
+    /// </remarks>
+    /// <param name="runtimes">Receives the runtimes in the order of their
+    /// identifiers.</param>
+    /// <returns><see langword="true" /> if the catalogue has been retrieved,
+    /// <see langword="false" /> if the service is not running.</returns>
+    _Success_(return) static bool get_service_runtimes(
+        _Out_ std::vector<service_runtime>& runtimes);
+
     /// <summary>
     /// Opens the OpenXR keys for the native and possibly the WOW64 system.
     /// </summary>
@@ -29,28 +134,81 @@ public:
     /// keys could be invalid if they do not exist as the method will not throw.
     /// </returns>
     static std::pair<wil::unique_hkey, wil::unique_hkey> open_keys(void);
+#endif /* defined(_WIN32) */
 
     /// <summary>
     /// Initialises a new instance.
     /// </summary>
-    inline runtime_manager(void)
+    inline runtime_manager(void) : runtime_manager(found_callback()) { }
+
+    /// <summary>
+    /// Initialises a new instance reporting each runtime as soon as it has
+    /// been found.
+    /// </summary>
+    /// <param name="on_found">The callback to be invoked for each runtime,
+    /// which is called on the thread constructing the manager. The callback
+    /// may be empty.</param>
+    /// <param name="cancelled">If not <see langword="nullptr" />, the search
+    /// stops early once the flag has been set, in which case the manager
+    /// only knows the runtimes found so far. This parameter defaults to
+    /// <see langword="nullptr" />.</param>
+    explicit inline runtime_manager(_In_ const found_callback& on_found,
+            _In_opt_ const std::atomic<bool> *cancelled = nullptr)
+#if defined(_WIN32)
             : _key(get_openxr_key(openxr_key, true)),
+            _monitor(new runtime_monitor<scanner>()),
             _wow_key(get_openxr_key(wow_key, true)) {
-        this->load_runtimes();
+#else /* defined(_WIN32) */
+            : _link(get_active_link()),
+            _monitor(new runtime_monitor<scanner>()) {
+#endif /* defined(_WIN32) */
+        this->load_runtimes(on_found, cancelled);
     }
 
     /// <summary>
-    /// Answer the currently active runtime according to the registry.
+    /// Initialises a new instance without searching for runtimes, which can
+    /// only be used to change the active runtime unless it is told to
+    /// <see cref="watch" /> the system.
+    /// </summary>
+    explicit inline runtime_manager(_In_ const no_discovery_t)
+#if defined(_WIN32)
+        : _key(get_openxr_key(openxr_key, true)),
+        _monitor(new runtime_monitor<scanner>()),
+        _wow_key(get_openxr_key(wow_key, true)) { }
+#else /* defined(_WIN32) */
+        : _link(get_active_link()),
+        _monitor(new runtime_monitor<scanner>()) { }
+#endif /* defined(_WIN32) */
+
+    /// <summary>
+    /// Answer the currently active runtime according to the registry or the
+    /// link in the XDG configuration directory.
     /// </summary>
     /// <param name="index">If non <see langword="nullptr" />, receives the
     /// zero-based index of the selected runtime among the ones known to the
     /// manager. This parameter defaults to <see langword="nullptr" />.</param>
     /// <returns>The active runtime.</returns>
-    const runtime& active_runtime(_Out_opt_ int *index = nullptr) const;
+    runtime active_runtime(_Out_opt_ int *index = nullptr) const;
+
+    /// <summary>
+    /// Answer the path of the currently active runtime according to the
+    /// registry, regardless of whether the manager knows this runtime.
+    /// </summary>
+    /// <remarks>
+    /// On Linux, this is the resolved target of the link, which is empty if
+    /// no runtime is active.
+    /// </remarks>
+    /// <returns>The path to the JSON file of the active runtime.</returns>
+    std::wstring active_path(void) const;
 
     /// <summary>
     /// Sets a new active runtime.
     /// </summary>
+    /// <remarks>
+    /// On Linux, the new link is created next to the old one and renamed over
+    /// it, so the loader either sees the old or the new runtime, but never a
+    /// missing one.
+    /// </remarks>
     /// <param name="runtime">The runtime to activate.</param>
     void active_runtime(_In_ const runtime& runtime);
 
@@ -61,8 +219,176 @@ public:
     /// activated.</param>
     void active_runtime(_In_ const std::size_t index);
 
+    /// <summary>
+    /// Answer the runtimes known to the manager.
+    /// </summary>
+    /// <remarks>
+    /// The snapshot never changes. If the manager is watching the system, a
+    /// new snapshot is published for every change, so callers should keep the
+    /// snapshot they are working on rather than asking for it repeatedly.
+    /// </remarks>
+    /// <returns>The runtimes ordered by their paths.</returns>
+    snapshot_type snapshot(void) const noexcept;
+
+    /// <summary>
+    /// Starts watching the OpenXR keys, the uninstall database and the
+    /// installation folders in the background and updates the runtimes
+    /// whenever any of them changes.
+    /// </summary>
+    /// <remarks>
+    /// Only the part of the system that has changed is searched again. If the
+    /// manager has been created without discovery, the segments of the
+    /// previous search are restored from the discovery cache first. Only if
+    /// there are none, the whole system is searched once in the background.
+    /// </remarks>
+    /// <param name="on_changed">The callback to be invoked for each new
+    /// snapshot, which may be empty.</param>
+    /// <param name="on_failed">The callback to be invoked if watching the
+    /// system failed, in which case the last snapshot remains valid, but is
+    /// not updated anymore. The callback may be empty.</param>
+    void watch(_In_ const changed_callback& on_changed,
+        _In_ const failed_callback& on_failed = failed_callback());
+
 private:
 
+    /// <summary>
+    /// Searches the Win32 registry and file system on behalf of the
+    /// <see cref="runtime_monitor" />.
+    /// </summary>
+    /// <remarks>
+    /// On Linux, the XDG directories take the role of the installation
+    /// folders, which makes the monitor watch each of them separately.
+    /// </remarks>
+    class scanner final {
+
+    public:
+
+        typedef runtime_manager::installation_map installation_map;
+
+        inline bool find_installed(_In_ const std::wstring& folder,
+                [[maybe_unused]] _In_ const runtime_matcher::mask_type runtimes,
+                _Inout_ std::vector<runtime>& retval,
+                _Inout_ discovery_cache& cache) const {
+#if defined(_WIN32)
+            return get_installed_runtimes(folder, runtimes, retval, cache);
+#else /* defined(_WIN32) */
+            get_xdg_runtimes(folder, retval, cache);
+            return true;
+#endif /* defined(_WIN32) */
+        }
+
+        inline installation_map find_installations(
+                _Inout_ discovery_cache& cache) const {
+#if defined(_WIN32)
+            return get_installations(win32_registry(), cache);
+#else /* defined(_WIN32) */
+            return get_xdg_directories(cache);
+#endif /* defined(_WIN32) */
+        }
+
+        inline void find_registered(_Inout_ std::vector<runtime>& retval,
+                _Inout_ discovery_cache& cache) const {
+            get_registered_runtimes(retval, cache);
+        }
+
+        inline walk_options get_walk_options(
+                _In_ const runtime_matcher::mask_type runtimes) const {
+            return runtime_manager::get_walk_options(runtimes);
+        }
+
+        inline std::uint64_t stamp(_In_ const discovery_cache::source_type type,
+                _In_ const std::wstring& path) const noexcept {
+            return discovery_cache::get_stamp(type, path);
+        }
+    };
+
+    /// <summary>
+    /// Identifies a subkey by its parent key and its name.
+    /// </summary>
+    template<class TRegistry> struct subkey final {
+        /// <summary>
+        /// The open parent key.
+        /// </summary>
+        typename TRegistry::handle_type parent;
+
+        /// <summary>
+        /// The name of the subkey.
+        /// </summary>
+        std::wstring name;
+
+        /// <summary>
+        /// The path of the parent key relative to <c>HKEY_LOCAL_MACHINE</c>,
+        /// which must be a string literal.
+        /// </summary>
+        /// <remarks>
+        /// The path of the subkey is only needed for the discovery cache if
+        /// it matches any known runtime, so it is not stored for each of the
+        /// thousands of entries of the uninstall database.
+        /// </remarks>
+        const wchar_t *parent_path;
+
+        /// <summary>
+        /// Answer the path of the subkey relative to
+        /// <c>HKEY_LOCAL_MACHINE</c>.
+        /// </summary>
+        /// <returns></returns>
+        inline std::wstring path(void) const {
+            return std::wstring(this->parent_path) + L'\\' + this->name;
+        }
+    };
+
+    /// <summary>
+    /// Identifies an installation folder and the known runtimes it has been
+    /// attributed to.
+    /// </summary>
+    typedef std::pair<std::wstring, runtime_matcher::mask_type> installation;
+
+    /// <summary>
+    /// Records the last write time of the registry key at
+    /// <paramref name="path" /> in <paramref name="cache" />.
+    /// </summary>
+    /// <typeparam name="TRegistry"></typeparam>
+    /// <param name="registry"></param>
+    /// <param name="path">The path of the key relative to
+    /// <c>HKEY_LOCAL_MACHINE</c>.</param>
+    /// <param name="cache"></param>
+    template<class TRegistry>
+    static void add_stamp(_In_ const TRegistry& registry,
+        _In_ const std::wstring& path,
+        _Inout_ discovery_cache& cache);
+
+#if defined(_WIN32)
+    /// <summary>
+    /// Sends a request to the service and receives its response.
+    /// </summary>
+    /// <param name="type">The type of the request.</param>
+    /// <param name="payload">The payload of the request.</param>
+    /// <param name="cnt">The size of the payload in bytes.</param>
+    /// <param name="expected">The type of the response expected for the
+    /// request.</param>
+    /// <param name="response">Receives the payload of the response.</param>
+    /// <returns><see langword="true" /> if the response has been received,
+    /// <see langword="false" /> if the service is not running.</returns>
+    /// <exception cref="wil::ResultException">If the communication with the
+    /// service failed, if the service has reported an error instead of the
+    /// expected response or if the response is malformed.</exception>
+    _Success_(return) static bool call_service(_In_ const std::uint16_t type,
+        _In_reads_bytes_(cnt) const void *payload,
+        _In_ const std::size_t cnt,
+        _In_ const std::uint16_t expected,
+        _Out_ std::vector<std::uint8_t>& response);
+#endif /* defined(_WIN32) */
+
+#if !defined(_WIN32)
+    /// <summary>
+    /// Gets the path of the link designating the active runtime of the
+    /// calling user.
+    /// </summary>
+    /// <returns></returns>
+    static std::wstring get_active_link(void);
+#endif /* !defined(_WIN32) */
+
+#if defined(_WIN32)
     /// <summary>
     /// Gets the available OpenXR runtimes registered in the registry.
     /// </summary>
@@ -73,17 +399,67 @@ private:
     static void get_available_runtimes(_In_ const wil::unique_hkey& key,
         _In_ TIterator oit);
 
+    /// <summary>
+    /// Searches the installation <paramref name="folder" /> for runtimes and
+    /// pairs native runtimes with their WOW64 counterparts.
+    /// </summary>
+    /// <param name="folder"></param>
+    /// <param name="runtimes">The mask of the known runtimes the folder has
+    /// been attributed to.</param>
+    /// <param name="retval">Receives the runtimes found.</param>
+    /// <param name="cache">Receives the time stamps of all directories that
+    /// have been searched.</param>
+    /// <returns><see langword="true" /> if the folder has been searched
+    /// completely, <see langword="false" /> if the search was cut short.
+    /// </returns>
+    static bool get_installed_runtimes(_In_ const std::wstring& folder,
+        _In_ const runtime_matcher::mask_type runtimes,
+        _Inout_ std::vector<runtime>& retval,
+        _Inout_ discovery_cache& cache);
+#endif /* defined(_WIN32) */
+
     /// <summary>
     /// Gets the paths to all JSON files in <paramref name="folder" /> and
     /// writes them to <paramref name="oit" />.
     /// </summary>
     /// <typeparam name="TIterator"></typeparam>
     /// <param name="folder"></param>
+    /// <param name="options">Restricts the search of the folder.</param>
     /// <param name="oit"></param>
+    /// <param name="cache">Receives the time stamps of all directories that
+    /// have been searched.</param>
+    /// <returns><see langword="true" /> if the folder has been searched
+    /// completely, <see langword="false" /> if the time budget of
+    /// <paramref name="options" /> was exceeded.</returns>
     template<class TIterator>
-    static void get_json_files(_In_ const std::wstring& folder,
-        _In_ TIterator oit);
+    static bool get_json_files(_In_ const std::wstring& folder,
+        _In_ const walk_options& options,
+        _In_ TIterator oit,
+        _Inout_ discovery_cache& cache);
 
+    /// <summary>
+    /// Enumerates all vendor keys in <paramref name="key" /> that match any of
+    /// the known OpenXR runtimes.
+    /// </summary>
+    /// <typeparam name="TRegistry"></typeparam>
+    /// <typeparam name="TIterator">An output iterator for
+    /// <see cref="subkey" />s.</typeparam>
+    /// <param name="registry"></param>
+    /// <param name="key">Either the software key or the &quot;WOW6432Node&quot;
+    /// in the software key.</param>
+    /// <param name="path">The path of <paramref name="key" /> relative to
+    /// <c>HKEY_LOCAL_MACHINE</c>, which must be a string literal.</param>
+    /// <param name="oit"></param>
+    /// <param name="cache">Receives the time stamps of the vendor keys.
+    /// </param>
+    template<class TRegistry, class TIterator>
+    static void get_known_vendors(_In_ const TRegistry& registry,
+        _In_ const typename TRegistry::handle_type key,
+        _In_z_ const wchar_t *path,
+        _In_ TIterator oit,
+        _Inout_ discovery_cache& cache);
+
+#if defined(_WIN32)
     /// <summary>
     /// Gets the registry key of the latest OpenXR installation.
     /// </summary>
@@ -96,27 +472,95 @@ private:
     static wil::unique_hkey get_openxr_key(_In_z_ const wchar_t *path,
         _In_ const bool lenient);
 
+    /// <summary>
+    /// Gets the path of the registry key of the latest OpenXR installation
+    /// relative to <c>HKEY_LOCAL_MACHINE</c>.
+    /// </summary>
+    /// <param name="path">The path to the OpenXR key, which must be one of
+    /// <see cref="openxr_key" /> or <paramref name="wow_key" /></param>
+    /// <returns>The path to the key of the latest version.</returns>
+    static std::wstring get_openxr_path(_In_z_ const wchar_t *path);
+#endif /* defined(_WIN32) */
+
+    /// <summary>
+    /// Gets the runtimes registered with OpenXR, both the native and the
+    /// WOW64 ones, and Windows Mixed Reality, which is not registered
+    /// anywhere.
+    /// </summary>
+    /// <remarks>
+    /// On Linux, these are the manifests of SteamVR, which does not install
+    /// into any of the XDG directories.
+    /// </remarks>
+    /// <param name="retval">Receives the runtimes found.</param>
+    /// <param name="cache">Receives the time stamps of the keys and files the
+    /// result depends on.</param>
+    static void get_registered_runtimes(_Inout_ std::vector<runtime>& retval,
+        _Inout_ discovery_cache& cache);
+
+    /// <summary>
+    /// Gets the options for searching a folder that has been attributed to
+    /// the given <paramref name="runtimes" />.
+    /// </summary>
+    /// <remarks>
+    /// If the folder could belong to multiple runtimes, the options are merged
+    /// such that everything is searched that would be searched for any of
+    /// them.
+    /// </remarks>
+    /// <param name="runtimes"></param>
+    /// <returns></returns>
+    static walk_options get_walk_options(
+        _In_ const runtime_matcher::mask_type runtimes);
+
     /// <summary>
     /// Enumerates all vendor-specific software keys in the registry, both the
     /// standard ones as well as Wow64, and returns the installation paths
     /// derived from the ones matching known OpenXR runtimes.
     /// </summary>
+    /// <typeparam name="TRegistry"></typeparam>
     /// <typeparam name="TIterator"></typeparam>
+    /// <param name="registry"></param>
     /// <param name="oit"></param>
-    template<class TIterator>
-    static void get_software_paths(_In_ TIterator oit);
+    /// <param name="cache">Receives the time stamps of the keys the result
+    /// depends on.</param>
+    template<class TRegistry, class TIterator>
+    static void get_software_paths(_In_ const TRegistry& registry,
+        _In_ TIterator oit,
+        _Inout_ discovery_cache& cache);
 
     /// <summary>
-    /// Enumerates all vendor/software paths in <paramref name="key" /> and
-    /// returns the installation paths derived from the ones matching known
+    /// Enumerates all software keys of the given <paramref name="vendor" />
+    /// and returns the installation paths derived from the ones matching known
     /// OpenXR runtimes.
     /// </summary>
+    /// <typeparam name="TRegistry"></typeparam>
     /// <typeparam name="TIterator"></typeparam>
-    /// <param name="key">Either the software key or the &quot;WOW6432Node&quot;
-    /// in the software key.</param>
+    /// <param name="registry"></param>
+    /// <param name="vendor">The vendor key below the software key or the
+    /// &quot;WOW6432Node&quot; in the software key.</param>
     /// <param name="oit"></param>
-    template<class TIterator>
-    static void get_software_paths(_In_ const wil::unique_hkey& key,
+    /// <param name="cache">Receives the time stamps of the matching software
+    /// keys.</param>
+    template<class TRegistry, class TIterator>
+    static void get_software_paths(_In_ const TRegistry& registry,
+        _In_ const subkey<TRegistry>& vendor,
+        _In_ TIterator oit,
+        _Inout_ discovery_cache& cache);
+
+    /// <summary>
+    /// Gets all direct subkeys of <paramref name="key" />.
+    /// </summary>
+    /// <typeparam name="TRegistry"></typeparam>
+    /// <typeparam name="TIterator">An output iterator for
+    /// <see cref="subkey" />s.</typeparam>
+    /// <param name="registry"></param>
+    /// <param name="key"></param>
+    /// <param name="path">The path of <paramref name="key" /> relative to
+    /// <c>HKEY_LOCAL_MACHINE</c>, which must be a string literal.</param>
+    /// <param name="oit"></param>
+    template<class TRegistry, class TIterator>
+    static void get_subkeys(_In_ const TRegistry& registry,
+        _In_ const typename TRegistry::handle_type key,
+        _In_z_ const wchar_t *path,
         _In_ TIterator oit);
 
     /// <summary>
@@ -124,34 +568,76 @@ private:
     /// registry and returns the installation patsh from derived from the ones
     /// matching known OpenXR runtimes.
     /// </summary>
+    /// <typeparam name="TRegistry"></typeparam>
     /// <typeparam name="TIterator"></typeparam>
+    /// <param name="registry"></param>
     /// <param name="oit"></param>
-    template<class TIterator>
-    static void get_uninstall_paths(_In_ TIterator oit);
+    /// <param name="cache">Receives the time stamps of the matching entries.
+    /// </param>
+    template<class TRegistry, class TIterator>
+    static void get_uninstall_paths(_In_ const TRegistry& registry,
+        _In_ TIterator oit,
+        _Inout_ discovery_cache& cache);
 
     /// <summary>
-    /// Enumerates the uninstall database identified by <paramref name="key" />
-    /// and returns the installation patsh from derived from the ones matching
-    /// known OpenXR runtimes.
+    /// Checks the given <paramref name="entry" /> of the uninstall database
+    /// and returns the installation path if it matches any of the known OpenXR
+    /// runtimes.
     /// </summary>
+    /// <typeparam name="TRegistry"></typeparam>
     /// <typeparam name="TIterator"></typeparam>
-    /// <param name="key"></param>
+    /// <param name="registry"></param>
+    /// <param name="entry"></param>
     /// <param name="oit"></param>
-    template<class TIterator>
-    static void get_uninstall_paths(_In_ const wil::unique_hkey& key,
-        _In_ TIterator oit);
+    /// <param name="cache">Receives the time stamp of the entry if it
+    /// matches.</param>
+    template<class TRegistry, class TIterator>
+    static void get_uninstall_paths(_In_ const TRegistry& registry,
+        _In_ const subkey<TRegistry>& entry,
+        _In_ TIterator oit,
+        _Inout_ discovery_cache& cache);
+
+#if !defined(_WIN32)
+    /// <summary>
+    /// Gets the &quot;openxr/1&quot; subdirectories of the XDG configuration
+    /// and data directories, which the loader searches for manifests.
+    /// </summary>
+    /// <param name="cache">Receives the time stamps of the directories.
+    /// </param>
+    /// <returns>The directories, which are not attributed to any known
+    /// runtime.</returns>
+    static installation_map get_xdg_directories(
+        _Inout_ discovery_cache& cache);
+
+    /// <summary>
+    /// Gets the runtimes whose manifests are directly in the XDG directory
+    /// <paramref name="folder" />.
+    /// </summary>
+    /// <param name="folder"></param>
+    /// <param name="retval">Receives the runtimes found, whose paths are the
+    /// resolved targets of any links.</param>
+    /// <param name="cache">Receives the time stamp of the directory.</param>
+    static void get_xdg_runtimes(_In_ const std::wstring& folder,
+        _Inout_ std::vector<runtime>& retval,
+        _Inout_ discovery_cache& cache);
+#endif /* !defined(_WIN32) */
 
     /// <summary>
-    /// Answer whether the given software key is the given OpenXR runtime, and
-    /// if so, return the installation path.
+    /// Answer whether the given uninstall key is any of the known OpenXR
+    /// runtimes, and if so, return the installation path.
     /// </summary>
+    /// <typeparam name="TRegistry"></typeparam>
+    /// <param name="registry"></param>
     /// <param name="key"></param>
-    /// <param name="info"></param>
     /// <param name="path"></param>
+    /// <param name="runtimes">Receives the mask of the matching runtimes.
+    /// </param>
     /// <returns></returns>
-    _Success_(return) static bool is_match(_In_ const wil::unique_hkey& key,
-        _In_ const runtime_info& info,
-        _Out_ std::wstring& path);
+    template<class TRegistry>
+    _Success_(return) static bool is_match(_In_ const TRegistry& registry,
+        _In_ const typename TRegistry::handle_type key,
+        _Out_ std::wstring& path,
+        _Out_ runtime_matcher::mask_type& runtimes);
 
     /// <summary>
     /// Merges the runtimes and their potential WOW64 counterparts into a
@@ -172,6 +658,31 @@ private:
         _In_ const TIterator wow_begin, _In_ const TIterator wow_end,
         _In_ TOutIterator oit);
 
+    /// <summary>
+    /// Distributes <paramref name="keys" /> in chunks over a small number of
+    /// worker threads, which invoke <paramref name="worker" /> for each of
+    /// them, and merges the installations found into <paramref name="oit" />
+    /// and the time stamps recorded into <paramref name="cache" />.
+    /// </summary>
+    /// <typeparam name="TKey">The type of the <see cref="subkey" />s.
+    /// </typeparam>
+    /// <typeparam name="TIterator">An output iterator for
+    /// <see cref="installation" />s.</typeparam>
+    /// <typeparam name="TWorker">A functor accepting a <see cref="subkey" />,
+    /// an output iterator for <see cref="installation" />s and a
+    /// <see cref="discovery_cache" />, which is not shared with any other
+    /// thread.</typeparam>
+    /// <param name="keys"></param>
+    /// <param name="oit"></param>
+    /// <param name="cache"></param>
+    /// <param name="worker"></param>
+    template<class TKey, class TIterator, class TWorker>
+    static void parallel_enumerate(_In_ const std::vector<TKey>& keys,
+        _In_ TIterator oit,
+        _Inout_ discovery_cache& cache,
+        _In_ TWorker worker);
+
+#if defined(_WIN32)
     /// <summary>
     /// Read at exactly <paramref name="cnt" /> bytes from
     /// <paramref name="handle" />.
@@ -192,6 +703,7 @@ private:
     static void write(_In_ wil::unique_hfile& handle,
         _In_reads_bytes_(cnt) const void *data,
         _In_ const std::size_t cnt);
+#endif /* defined(_WIN32) */
 
     /// <summary>
     /// The name of the registry value that stores the active runtime.
@@ -199,6 +711,11 @@ private:
     static constexpr const wchar_t *const active_runtime_value
         = L"ActiveRuntime";
 
+    /// <summary>
+    /// The maximum number of threads used to enumerate the registry.
+    /// </summary>
+    static constexpr unsigned int max_workers = 4;
+
     /// <summary>
     /// The path in the registry where the OpenXR stuff is stored.
     /// </summary>
@@ -210,6 +727,14 @@ private:
     /// </summary>
     static constexpr const wchar_t *const pipe_name = L"\\\\.\\pipe\\oxrswitch";
 
+#if defined(_WIN32)
+    /// <summary>
+    /// The time in milliseconds we wait for an instance of the pipe to become
+    /// available if all of them are busy.
+    /// </summary>
+    static constexpr DWORD service_timeout = 1000;
+#endif /* defined(_WIN32) */
+
     /// <summary>
     /// The path in the registry to the 32-bit stuff of OpenXR.
     /// </summary>
@@ -217,31 +742,26 @@ private:
         "Khronos\\OpenXR";
 
     /// <summary>
-    /// Loads all OpenXR runtimes we can find.
+    /// Loads all OpenXR runtimes we can find, either from the discovery cache
+    /// if it is still up to date, by searching only the parts of the system
+    /// that have changed since the cache has been written, or by searching
+    /// the whole system.
     /// </summary>
-    void load_runtimes(void);
-
+    /// <param name="on_found">The callback to be invoked for each runtime
+    /// found, which may be empty.</param>
+    /// <param name="cancelled">The flag cancelling the search, which may be
+    /// <see langword="nullptr" />.</param>
+    void load_runtimes(_In_ const found_callback& on_found,
+        _In_opt_ const std::atomic<bool> *cancelled);
+
+#if defined(_WIN32)
     wil::unique_hkey _key;
-    std::vector<runtime> _runtimes;
+    std::unique_ptr<runtime_monitor<scanner>> _monitor;
     wil::unique_hkey _wow_key;
-
-public:
-
-    /// <summary>
-    /// Gets an iterator for the begin of the range of available runtimes.
-    /// </summary>
-    /// <returns></returns>
-    inline auto begin(void) const -> decltype(this->_runtimes.begin()) {
-        return this->_runtimes.begin();
-    }
-
-    /// <summary>
-    /// Gets an iterator for the end of the range of available runtimes.
-    /// </summary>
-    /// <returns></returns>
-    inline auto end(void) const -> decltype(this->_runtimes.end()) {
-        return this->_runtimes.end();
-    }
+#else /* defined(_WIN32) */
+    std::wstring _link;
+    std::unique_ptr<runtime_monitor<scanner>> _monitor;
+#endif /* defined(_WIN32) */
 };
 
 #include "runtime_manager.inl"
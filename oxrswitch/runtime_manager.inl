@@ -5,6 +5,19 @@
 // <author>Christoph Müller</author>
 
 
+/*
+ * runtime_manager::add_stamp
+ */
+template<class TRegistry>
+void runtime_manager::add_stamp(_In_ const TRegistry& registry,
+        _In_ const std::wstring& path,
+        _Inout_ discovery_cache& cache) {
+    cache.add(discovery_cache::source_type::registry, path,
+        registry.last_write_time(registry.root(), path.c_str()));
+}
+
+
+#if defined(_WIN32)
 /*
  * runtime_manager::get_available_runtimes
  */
@@ -21,144 +34,278 @@ void runtime_manager::get_available_runtimes(_In_ const wil::unique_hkey& key,
             });
     } catch (...) { /* The "AvailableRuntimes" subkey might be inexistent. */ }
 }
+#endif /* defined(_WIN32) */
 
 
 /*
  * runtime_manager::get_json_files
  */
 template<class TIterator>
-void runtime_manager::get_json_files(_In_ const std::wstring& folder,
-        _In_ TIterator oit) {
-    std::stack<std::wstring> stack;
-    stack.push(folder);
-
-    while (!stack.empty()) {
-        const auto cur = std::move(stack.top());
-        stack.pop();
-
-        WIN32_FIND_DATAW fd;
-        const auto query = cur + L"\\*";
-        wil::unique_hfind find(::FindFirstFileW(query.c_str(), &fd));
-        if (!find) {
-            continue;
-        }
+bool runtime_manager::get_json_files(_In_ const std::wstring& folder,
+        _In_ const walk_options& options,
+        _In_ TIterator oit,
+        _Inout_ discovery_cache& cache) {
+    std::vector<std::wstring> directories;
+    directory_walker<> walker(options);
 
-        do {
-            if (::equals(fd.cFileName, L".") || ::equals(fd.cFileName, L"..")) {
-                continue;
-            }
+    const auto retval = walker(folder, oit, std::back_inserter(directories));
 
-            const auto path = combine_path(cur, fd.cFileName);
+    // Adding or removing any file in a directory changes its time stamp, so we
+    // can detect new or deleted runtime files on warm starts. Directories
+    // that have been pruned are not tracked, because their content does not
+    // matter for the result.
+    for (auto& d : directories) {
+        cache.add(discovery_cache::source_type::file_system, d);
+    }
 
-            if ((fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
-                stack.push(path);
+    return retval;
+}
 
-            } else if (::ends_with(path, L".json", false)) {
-                *oit++ = std::move(path);
-            }
-        } while (::FindNextFile(find.get(), &fd) != 0);
+
+/*
+ * runtime_manager::get_installations
+ */
+template<class TRegistry>
+runtime_manager::installation_map runtime_manager::get_installations(
+        _In_ const TRegistry& registry,
+        _Inout_ discovery_cache& cache) {
+    // The same folder might be found via the registry and the uninstall
+    // database, in which case we search it only once for all runtimes it
+    // has been attributed to.
+    std::vector<installation> found;
+    get_uninstall_paths(registry, std::back_inserter(found), cache);
+    get_software_paths(registry, std::back_inserter(found), cache);
+
+    installation_map retval;
+    for (auto& f : found) {
+        retval[f.first] |= f.second;
     }
+
+    return retval;
+}
+
+
+/*
+ * runtime_manager::get_known_vendors
+ */
+template<class TRegistry, class TIterator>
+void runtime_manager::get_known_vendors(_In_ const TRegistry& registry,
+        _In_ const typename TRegistry::handle_type key,
+        _In_z_ const wchar_t *path,
+        _In_ TIterator oit,
+        _Inout_ discovery_cache& cache) {
+    assert(key);
+    assert(path != nullptr);
+
+    registry.enumerate_keys(key, [&](const std::wstring& name) {
+        // Only vendors matching any of the known runtimes can ever yield an
+        // installation path, so there is no need to open any other key.
+        if (runtime_matcher::known().match_vendor(name) != 0) {
+            // A new software key below a vendor we know could be a new
+            // runtime, so we need to track it for the discovery cache.
+            subkey<TRegistry> vendor { key, name, path };
+            add_stamp(registry, vendor.path(), cache);
+            *oit++ = std::move(vendor);
+        }
+    });
 }
 
 
 /*
  * runtime_manager::get_software_paths
  */
-template<class TIterator>
-void runtime_manager::get_software_paths(_In_ TIterator oit) {
+template<class TRegistry, class TIterator>
+void runtime_manager::get_software_paths(_In_ const TRegistry& registry,
+        _In_ TIterator oit,
+        _Inout_ discovery_cache& cache) {
+    constexpr auto native_path = L"SOFTWARE";
+    constexpr auto wow_path = L"SOFTWARE\\WOW6432Node";
+    std::vector<subkey<TRegistry>> vendors;
 
     // Native software.
-    {
-        auto key = wil::reg::open_unique_key(HKEY_LOCAL_MACHINE, L"SOFTWARE");
-        get_software_paths(key, oit);
+    add_stamp(registry, native_path, cache);
+    typename TRegistry::key_type key;
+    if (registry.try_open(registry.root(), native_path, key)) {
+        get_known_vendors(registry, TRegistry::get(key), native_path,
+            std::back_inserter(vendors), cache);
     }
 
     // 32-bit software on 64-bit systems.
-    try {
-        auto key = wil::reg::open_unique_key(HKEY_LOCAL_MACHINE, L"SOFTWARE\\"
-            L"WOW6432Node");
-        get_software_paths(key, oit);
-    } catch (...) { /* This is not fatal. */ }
+    add_stamp(registry, wow_path, cache);
+    typename TRegistry::key_type wow;
+    if (registry.try_open(registry.root(), wow_path, wow)) {
+        get_known_vendors(registry, TRegistry::get(wow), wow_path,
+            std::back_inserter(vendors), cache);
+    }
+
+    // Search the vendors of both views in parallel.
+    parallel_enumerate(vendors, oit, cache,
+            [&registry](const subkey<TRegistry>& v, auto oit,
+                discovery_cache& cache) {
+        get_software_paths(registry, v, oit, cache);
+    });
 }
 
 
 /*
  * runtime_manager::get_software_paths
  */
-template<class TIterator>
-void runtime_manager::get_software_paths(_In_ const wil::unique_hkey& key,
-        _In_ TIterator oit) {
-    assert(key);
+template<class TRegistry, class TIterator>
+void runtime_manager::get_software_paths(_In_ const TRegistry& registry,
+        _In_ const subkey<TRegistry>& vendor,
+        _In_ TIterator oit,
+        _Inout_ discovery_cache& cache) {
+    // Get the "vendor" key below SOFTWARE/WOW6432Node.
+    typename TRegistry::key_type v;
+    if (!registry.try_open(vendor.parent, vendor.name.c_str(), v)) {
+        return;
+    }
 
-    for (auto it = wil::reg::key_iterator(key.get()),
-            end = wil::reg::key_iterator(); it != end; ++it) {
-        // Get the "vendor" key below SOFTWARE/WOW6432Node.
-        auto v = wil::reg::open_unique_key(key.get(), it->name.c_str());
-
-        for (auto jt = wil::reg::key_iterator(v.get()); jt != end; ++jt) {
-            // 'jt' goes over the per-vendor software entries in the vendor key.
-            // If the name of this key in combination with the vendor name in
-            // 'it' match any of the known runtimes, try to derive the
-            // installation location from it.
-
-            for (auto& r : runtime_info::runtimes) {
-                if (r.is_match(it->name, jt->name)) {
-                    std::wstring path;
-                    auto s = wil::reg::open_unique_key(v.get(),
-                        jt->name.c_str());
-                    if (r.try_get_installation_path(s, path)) {
-                        *oit++ = std::move(path);
-                    }
+    registry.enumerate_keys(TRegistry::get(v), [&](const std::wstring& name) {
+        // 'name' goes over the per-vendor software entries in the vendor key.
+        // If the name of this key in combination with the vendor name match
+        // any of the known runtimes, try to derive the installation location
+        // from it.
+        const auto matches = runtime_matcher::known().match(vendor.name,
+            name);
+        if (matches == 0) {
+            return;
+        }
+
+        typename TRegistry::key_type s;
+        if (!registry.try_open(TRegistry::get(v), name.c_str(), s)) {
+            return;
+        }
+
+        // The installation path is a value of the matching key or one of its
+        // subkeys, which changes the time stamp of the key holding it.
+        const auto path = vendor.path() + L'\\' + name;
+        add_stamp(registry, path, cache);
+
+        for (std::size_t i = 0; i < runtime_info::runtimes.size(); ++i) {
+            if ((matches & runtime_matcher::bit(i)) != 0) {
+                auto& r = runtime_info::runtimes[i];
+                if (!r.subkey().empty()) {
+                    add_stamp(registry, path + L'\\' + r.subkey(), cache);
+                }
+
+                std::wstring path;
+                if (r.try_get_installation_path(registry, TRegistry::get(s),
+                        path)) {
+                    *oit++ = std::make_pair(std::move(path),
+                        runtime_matcher::bit(i));
                 }
             }
         }
-    }
+    });
+}
+
+
+/*
+ * runtime_manager::get_subkeys
+ */
+template<class TRegistry, class TIterator>
+void runtime_manager::get_subkeys(_In_ const TRegistry& registry,
+        _In_ const typename TRegistry::handle_type key,
+        _In_z_ const wchar_t *path,
+        _In_ TIterator oit) {
+    assert(key);
+    assert(path != nullptr);
+    registry.enumerate_keys(key, [key, path, &oit](const std::wstring& name) {
+        *oit++ = subkey<TRegistry> { key, name, path };
+    });
 }
 
 
 /*
  * runtime_manager::get_uninstall_paths
  */
-template<class TIterator>
-void runtime_manager::get_uninstall_paths(_In_ TIterator oit) {
+template<class TRegistry, class TIterator>
+void runtime_manager::get_uninstall_paths(_In_ const TRegistry& registry,
+        _In_ TIterator oit,
+        _Inout_ discovery_cache& cache) {
+    constexpr auto native_path
+        = L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall";
+    constexpr auto wow_path = L"SOFTWARE\\WOW6432Node\\"
+        L"Microsoft\\Windows\\CurrentVersion\\Uninstall";
+    std::vector<subkey<TRegistry>> entries;
 
-    // Native software.
+    // Installing or removing any software adds or removes an entry, which
+    // changes the time stamp of the uninstall key itself.
+    add_stamp(registry, native_path, cache);
+    add_stamp(registry, wow_path, cache);
 
-    {
-        auto key = wil::reg::open_unique_key(HKEY_LOCAL_MACHINE,
-            L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall");
-        get_uninstall_paths(key, oit);
+    // Native software.
+    typename TRegistry::key_type key;
+    if (registry.try_open(registry.root(), native_path, key)) {
+        get_subkeys(registry, TRegistry::get(key), native_path,
+            std::back_inserter(entries));
     }
 
     // 32-bit software on 64-bit systems.
-    try {
-        auto key = wil::reg::open_unique_key(HKEY_LOCAL_MACHINE, L"SOFTWARE\\"
-            L"WOW6432Node\\Microsoft\\Windows\\CurrentVersion\\Uninstall");
-        get_uninstall_paths(key, oit);
-    } catch(...) { /* This is not fatal. */ }
+    typename TRegistry::key_type wow;
+    if (registry.try_open(registry.root(), wow_path, wow)) {
+        get_subkeys(registry, TRegistry::get(wow), wow_path,
+            std::back_inserter(entries));
+    }
+
+    // Search the entries of both views in parallel.
+    parallel_enumerate(entries, oit, cache,
+            [&registry](const subkey<TRegistry>& e, auto oit,
+                discovery_cache& cache) {
+        get_uninstall_paths(registry, e, oit, cache);
+    });
 }
 
 
 /*
  * runtime_manager::get_uninstall_paths
  */
-template<class TIterator>
-void runtime_manager::get_uninstall_paths(_In_ const wil::unique_hkey& key,
-        _In_ TIterator oit) {
+template<class TRegistry, class TIterator>
+void runtime_manager::get_uninstall_paths(_In_ const TRegistry& registry,
+        _In_ const subkey<TRegistry>& entry,
+        _In_ TIterator oit,
+        _Inout_ discovery_cache& cache) {
+    typename TRegistry::key_type k;
+    if (!registry.try_open(entry.parent, entry.name.c_str(), k)) {
+        return;
+    }
+
+    // An update of a matching runtime might move its installation location,
+    // which only changes the time stamp of its entry. Entries that do not
+    // match are not tracked, because there are thousands of them.
+    runtime_matcher::mask_type runtimes;
+    std::wstring path;
+    if (is_match(registry, TRegistry::get(k), path, runtimes)) {
+        add_stamp(registry, entry.path(), cache);
+        *oit++ = std::make_pair(std::move(path), runtimes);
+    }
+}
+
+
+/*
+ * runtime_manager::is_match
+ */
+template<class TRegistry>
+_Success_(return) bool runtime_manager::is_match(
+        _In_ const TRegistry& registry,
+        _In_ const typename TRegistry::handle_type key,
+        _Out_ std::wstring& path,
+        _Out_ runtime_matcher::mask_type& runtimes) {
     assert(key);
-    auto cnt = wil::reg::get_child_key_count(key.get());
+    std::wstring name, publisher;
 
-    for (auto it = wil::reg::key_iterator(key.get()),
-            end = wil::reg::key_iterator(); it != end; ++it) {
-        auto k = wil::reg::open_unique_key(key.get(), it->name.c_str());
+    if (!registry.try_get_string(key, L"DisplayName", name)
+            || !registry.try_get_string(key, L"Publisher", publisher)) {
+        return false;
+    }
 
-        for (auto& r : runtime_info::runtimes) {
-            std::wstring path;
-            if (is_match(k, r, path)) {
-                *oit++ = std::move(path);
-            }
-        }
+    runtimes = runtime_matcher::known().match(publisher, name);
+    if (runtimes == 0) {
+        return false;
     }
+
+    return registry.try_get_string(key, L"InstallLocation", path);
 }
 
 
@@ -171,18 +318,72 @@ void runtime_manager::make_runtimes(_In_ const TIterator path_begin,
         _In_ const TIterator wow_begin,
         _In_ const TIterator wow_end,
         _In_ TOutIterator oit) {
+    // Index the WOW64 files by their directory once instead of comparing
+    // every native file against all of them.
+    const folded_index<TIterator, directory_key> wow(wow_begin, wow_end);
+
     for (auto p = path_begin; p != path_end; ++p) {
-        auto w = std::find_if(wow_begin,
-            wow_end,
-            [p](const std::wstring& w) { return ::is_same_directory(*p, w); });
+        auto w = wow.find(::get_directory(*p));
 
-        try {
-            if (w == wow_end) {
-                *oit++ = runtime::from_file(*p);
-            }
-            else {
-                *oit++ = runtime::from_file(*p, *w);
-            }
-        } catch (...) { /* Ignore all invalid runtime files. */ }
+        // Ignore all invalid runtime files.
+        runtime r;
+        if (runtime::try_from_file(*p,
+                (w == wow_end) ? nullptr : w->c_str(),
+                nullptr,
+                r) == ERROR_SUCCESS) {
+            *oit++ = std::move(r);
+        }
+    }
+}
+
+
+/*
+ * runtime_manager::parallel_enumerate
+ */
+template<class TKey, class TIterator, class TWorker>
+void runtime_manager::parallel_enumerate(_In_ const std::vector<TKey>& keys,
+        _In_ TIterator oit,
+        _Inout_ discovery_cache& cache,
+        _In_ TWorker worker) {
+    const auto cnt_workers = (std::min)(keys.size(), static_cast<std::size_t>(
+        (std::max)(1u, (std::min)(max_workers,
+            std::thread::hardware_concurrency()))));
+
+    if (cnt_workers < 2) {
+        // Not worth spinning up any thread.
+        for (auto& k : keys) {
+            worker(k, oit, cache);
+        }
+        return;
+    }
+
+    // Each worker processes a contiguous chunk of the keys and collects its
+    // results in its own vector and cache, so there is no need for any
+    // synchronisation until the results are merged below.
+    typedef std::pair<std::vector<installation>, discovery_cache> result_type;
+    const auto chunk = (keys.size() + cnt_workers - 1) / cnt_workers;
+    std::vector<std::future<result_type>> results;
+    results.reserve(cnt_workers);
+
+    for (std::size_t i = 0; i < keys.size(); i += chunk) {
+        const auto begin = keys.begin() + i;
+        const auto end = keys.begin() + (std::min)(i + chunk, keys.size());
+        results.push_back(std::async(std::launch::async,
+            [begin, end, &worker](void) {
+                result_type retval;
+                for (auto it = begin; it != end; ++it) {
+                    worker(*it, std::back_inserter(retval.first),
+                        retval.second);
+                }
+                return retval;
+            }));
+    }
+
+    // Merge the results in the order of the keys, which rethrows any
+    // exception from the workers.
+    for (auto& r : results) {
+        auto result = r.get();
+        oit = std::move(result.first.begin(), result.first.end(), oit);
+        cache.merge(std::move(result.second));
     }
 }
@@ -0,0 +1,216 @@
+﻿// <copyright file="runtime_matcher.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+#include "runtime_matcher.h"
+
+
+/*
+ * runtime_matcher::known
+ */
+const runtime_matcher& runtime_matcher::known(void) {
+    // Note: initialisation of the local static is thread-safe, which is
+    // important as the registry is searched in parallel.
+    static const runtime_matcher retval(runtime_info::runtimes);
+    return retval;
+}
+
+
+/*
+ * runtime_matcher::runtime_matcher
+ */
+runtime_matcher::runtime_matcher(
+        _In_ const std::vector<runtime_info>& runtimes)
+    : _software([&runtimes](void) {
+            std::vector<std::wstring> retval;
+            retval.reserve(runtimes.size());
+            for (auto& r : runtimes) {
+                retval.push_back(r.software());
+            }
+            return retval;
+        }()),
+        _vendor([&runtimes](void) {
+            std::vector<std::wstring> retval;
+            retval.reserve(runtimes.size());
+            for (auto& r : runtimes) {
+                retval.push_back(r.vendor());
+            }
+            return retval;
+        }()) { }
+
+
+/*
+ * runtime_matcher::match
+ */
+runtime_matcher::mask_type runtime_matcher::match(
+        _In_ const std::wstring& vendor,
+        _In_ const std::wstring& software) const noexcept {
+    auto retval = this->_vendor.match(vendor);
+
+    // Only scan the software if there is a chance of a match.
+    if (retval != 0) {
+        retval &= this->_software.match(software);
+    }
+
+    return retval;
+}
+
+
+/*
+ * runtime_matcher::automaton::automaton
+ */
+runtime_matcher::automaton::automaton(
+        _In_ const std::vector<std::wstring>& patterns)
+        : _cnt_classes(1) {
+    constexpr auto none = (std::numeric_limits<std::uint32_t>::max)();
+
+    if (patterns.size() > 8 * sizeof(mask_type)) {
+        throw std::invalid_argument("Too many patterns for a single runtime "
+            "matcher.");
+    }
+
+    // Assign a character class to each character occurring in any of the
+    // patterns. Class 0 is reserved for all characters not in any pattern.
+    this->_ascii.fill(0);
+    for (auto& p : patterns) {
+        const auto anchored = (!p.empty() && (p.front() == L'^'));
+        for (auto it = p.begin() + (anchored ? 1 : 0); it != p.end(); ++it) {
+            const auto c = ::fold_case(*it);
+
+            if (static_cast<std::size_t>(c) < this->_ascii.size()) {
+                if (this->_ascii[c] == 0) {
+                    this->_ascii[c] = static_cast<std::uint16_t>(
+                        this->_cnt_classes++);
+                }
+
+            } else {
+                auto o = std::lower_bound(this->_other.begin(),
+                    this->_other.end(),
+                    c,
+                    [](const std::pair<wchar_t, std::uint16_t>& l,
+                            const wchar_t r) {
+                        return (l.first < r);
+                    });
+                if ((o == this->_other.end()) || (o->first != c)) {
+                    this->_other.emplace(o, c, static_cast<std::uint16_t>(
+                        this->_cnt_classes++));
+                }
+            }
+        }
+    }
+
+    // Build the trie of all patterns.
+    const auto cnt = this->_cnt_classes;
+    this->_states.push_back({ 0, 0, 0 });
+    this->_transitions.assign(cnt, none);
+
+    for (std::size_t i = 0; i < patterns.size(); ++i) {
+        auto& p = patterns[i];
+        const auto anchored = (!p.empty() && (p.front() == L'^'));
+        std::uint32_t s = 0;
+
+        for (auto it = p.begin() + (anchored ? 1 : 0); it != p.end(); ++it) {
+            const auto t = s * cnt + this->char_class(::fold_case(*it));
+
+            if (this->_transitions[t] == none) {
+                const auto depth = this->_states[s].depth + 1;
+                this->_transitions[t] = static_cast<std::uint32_t>(
+                    this->_states.size());
+                this->_states.push_back({ 0, depth, 0 });
+                this->_transitions.resize(this->_transitions.size() + cnt,
+                    none);
+            }
+
+            s = this->_transitions[t];
+        }
+
+        if (anchored) {
+            this->_states[s].anchored |= bit(i);
+        } else {
+            this->_states[s].found |= bit(i);
+        }
+    }
+
+    // Compute the failure links in breadth-first order, which guarantees that
+    // the target of the failure link is complete when it is used. We fill the
+    // missing transitions with the ones of the failure state, which makes the
+    // automaton deterministic.
+    std::vector<std::uint32_t> fail(this->_states.size(), 0);
+    std::vector<std::uint32_t> queue;
+    queue.reserve(this->_states.size());
+
+    for (std::size_t c = 0; c < cnt; ++c) {
+        auto& t = this->_transitions[c];
+        if (t == none) {
+            t = 0;
+        } else {
+            queue.push_back(t);
+        }
+    }
+
+    for (std::size_t q = 0; q < queue.size(); ++q) {
+        const auto s = queue[q];
+        this->_states[s].found |= this->_states[fail[s]].found;
+
+        for (std::size_t c = 0; c < cnt; ++c) {
+            const auto f = this->_transitions[fail[s] * cnt + c];
+            auto& t = this->_transitions[s * cnt + c];
+
+            if (t == none) {
+                t = f;
+            } else {
+                fail[t] = f;
+                queue.push_back(t);
+            }
+        }
+    }
+}
+
+
+/*
+ * runtime_matcher::automaton::match
+ */
+runtime_matcher::mask_type runtime_matcher::automaton::match(
+        _In_ const std::wstring& str) const noexcept {
+    auto retval = this->_states.front().anchored
+        | this->_states.front().found;
+    std::uint32_t s = 0;
+    std::size_t i = 0;
+
+    for (auto c : str) {
+        s = this->_transitions[s * this->_cnt_classes
+            + this->char_class(::fold_case(c))];
+        auto& state = this->_states[s];
+        retval |= state.found;
+
+        // If the depth of the state is the number of characters consumed,
+        // we never followed a failure link and anchored patterns match.
+        if (state.depth == ++i) {
+            retval |= state.anchored;
+        }
+    }
+
+    return retval;
+}
+
+
+/*
+ * runtime_matcher::automaton::char_class
+ */
+std::size_t runtime_matcher::automaton::char_class(
+        _In_ const wchar_t c) const noexcept {
+    if (static_cast<std::size_t>(c) < this->_ascii.size()) {
+        return this->_ascii[c];
+    }
+
+    auto o = std::lower_bound(this->_other.begin(),
+        this->_other.end(),
+        c,
+        [](const std::pair<wchar_t, std::uint16_t>& l, const wchar_t r) {
+            return (l.first < r);
+        });
+    return ((o != this->_other.end()) && (o->first == c)) ? o->second : 0;
+}
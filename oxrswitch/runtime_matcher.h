@@ -0,0 +1,160 @@
+﻿// <copyright file="runtime_matcher.h" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#if !defined(_OXRSWITCH_RUNTIME_MATCHER_H)
+#define _OXRSWITCH_RUNTIME_MATCHER_H
+#pragma once
+
+#include "runtime_info.h"
+
+
+/// <summary>
+/// Classifies vendor/software pairs against all known runtimes at once.
+/// </summary>
+/// <remarks>
+/// <para>The vendor and software patterns of all
+/// <see cref="runtime_info" />s are compiled into two case-insensitive
+/// Aho-Corasick automata, such that each string needs to be scanned only once
+/// regardless of the number of known runtimes.</para>
+/// <para>A pattern starting with &quot;^&quot; must match at the begin of the
+/// input, all other patterns can match anywhere in the input.</para>
+/// </remarks>
+class runtime_matcher final {
+
+public:
+
+    /// <summary>
+    /// A bit mask of runtimes, where bit <c>i</c> designates the runtime at
+    /// index <c>i</c>.
+    /// </summary>
+    typedef std::uint64_t mask_type;
+
+    /// <summary>
+    /// Answer the bit for the runtime at <paramref name="index" />.
+    /// </summary>
+    /// <param name="index"></param>
+    /// <returns></returns>
+    static constexpr mask_type bit(_In_ const std::size_t index) noexcept {
+        return static_cast<mask_type>(1) << index;
+    }
+
+    /// <summary>
+    /// Answer the matcher for <see cref="runtime_info::runtimes" />.
+    /// </summary>
+    /// <returns></returns>
+    static const runtime_matcher& known(void);
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="runtimes">The runtimes to match, which must not be more
+    /// than the number of bits in <see cref="mask_type" />.</param>
+    explicit runtime_matcher(_In_ const std::vector<runtime_info>& runtimes);
+
+    /// <summary>
+    /// Determines the runtimes matching the given vendor and software.
+    /// </summary>
+    /// <param name="vendor"></param>
+    /// <param name="software"></param>
+    /// <returns>The mask of all runtimes whose vendor and software patterns
+    /// both match.</returns>
+    mask_type match(_In_ const std::wstring& vendor,
+        _In_ const std::wstring& software) const noexcept;
+
+    /// <summary>
+    /// Determines the runtimes whose vendor pattern matches
+    /// <paramref name="vendor" />.
+    /// </summary>
+    /// <param name="vendor"></param>
+    /// <returns></returns>
+    inline mask_type match_vendor(
+            _In_ const std::wstring& vendor) const noexcept {
+        return this->_vendor.match(vendor);
+    }
+
+private:
+
+    /// <summary>
+    /// A deterministic, case-insensitive Aho-Corasick automaton.
+    /// </summary>
+    class automaton final {
+
+    public:
+
+        /// <summary>
+        /// Builds the automaton for the given patterns, where the pattern at
+        /// index <c>i</c> reports bit <c>i</c>.
+        /// </summary>
+        /// <param name="patterns"></param>
+        explicit automaton(_In_ const std::vector<std::wstring>& patterns);
+
+        /// <summary>
+        /// Scans <paramref name="str" /> and returns the mask of all patterns
+        /// found.
+        /// </summary>
+        /// <param name="str"></param>
+        /// <returns></returns>
+        mask_type match(_In_ const std::wstring& str) const noexcept;
+
+    private:
+
+        /// <summary>
+        /// The state of the automaton.
+        /// </summary>
+        struct state final {
+            /// <summary>
+            /// The patterns that are found if the state is reached from the
+            /// root without following any failure link.
+            /// </summary>
+            mask_type anchored;
+
+            /// <summary>
+            /// The distance of the state from the root.
+            /// </summary>
+            std::size_t depth;
+
+            /// <summary>
+            /// The unanchored patterns that are found whenever the state is
+            /// reached, including the ones of the failure chain.
+            /// </summary>
+            mask_type found;
+        };
+
+        /// <summary>
+        /// Answer the character class of <paramref name="c" />.
+        /// </summary>
+        std::size_t char_class(_In_ const wchar_t c) const noexcept;
+
+        /// <summary>
+        /// Maps ASCII characters to their character classes.
+        /// </summary>
+        std::array<std::uint16_t, 128> _ascii;
+
+        /// <summary>
+        /// The number of character classes including the class for all
+        /// characters not occurring in any pattern.
+        /// </summary>
+        std::size_t _cnt_classes;
+
+        /// <summary>
+        /// The sorted non-ASCII characters and their character classes.
+        /// </summary>
+        std::vector<std::pair<wchar_t, std::uint16_t>> _other;
+
+        std::vector<state> _states;
+
+        /// <summary>
+        /// The transition table with <see cref="_cnt_classes" /> entries per
+        /// state.
+        /// </summary>
+        std::vector<std::uint32_t> _transitions;
+    };
+
+    automaton _software;
+    automaton _vendor;
+};
+
+#endif /* !defined(_OXRSWITCH_RUNTIME_MATCHER_H) */
@@ -0,0 +1,472 @@
+﻿// <copyright file="runtime_monitor.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+#include "runtime_monitor.h"
+
+
+#if defined(_WIN32)
+/*
+ * win32_notification_source::win32_notification_source
+ */
+win32_notification_source::win32_notification_source(
+        _In_ const std::vector<notification_target>& targets) {
+    this->_ready.create(wil::EventOptions::None);
+    this->_stop.create(wil::EventOptions::ManualReset);
+    this->_watches.reserve(targets.size());
+
+    for (std::size_t i = 0; i < targets.size(); ++i) {
+        auto& t = targets[i];
+        watch w;
+        w.pending = false;
+        w.target = i;
+
+        switch (t.type) {
+            case discovery_cache::source_type::registry:
+                if (::RegOpenKeyExW(HKEY_LOCAL_MACHINE,
+                        t.path.c_str(),
+                        0,
+                        KEY_NOTIFY,
+                        w.key.put()) != ERROR_SUCCESS) {
+                    continue;
+                }
+                break;
+
+            case discovery_cache::source_type::file_system:
+                // Adding, removing or rewriting a manifest anywhere in the
+                // installation folder could change the result, so we need to
+                // read the changes in order to ignore the ones the search
+                // would not see anyway.
+                w.directory.reset(::CreateFileW(t.path.c_str(),
+                    FILE_LIST_DIRECTORY,
+                    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                    nullptr,
+                    OPEN_EXISTING,
+                    FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+                    NULL));
+                if (!w.directory) {
+                    continue;
+                }
+                w.buffer.resize(16 * 1024 / sizeof(DWORD));
+                w.options = t.options;
+                break;
+        }
+
+        w.event.create(wil::EventOptions::None);
+        this->_watches.push_back(std::move(w));
+    }
+
+    // Each shard also waits for the stop event, so the last handle of each
+    // shard is the stop event. The first shard is waited for by 'wait',
+    // which also needs to learn about the watches the other shards queued.
+    this->_shards.resize((std::max)(static_cast<std::size_t>(1),
+        (this->_watches.size() + shard_size - 1) / shard_size));
+    for (std::size_t i = 0; i < this->_watches.size(); ++i) {
+        this->_shards[i / shard_size].push_back(
+            this->_watches[i].event.get());
+    }
+    for (auto& s : this->_shards) {
+        s.push_back(this->_stop.get());
+    }
+    this->_shards.front().push_back(this->_ready.get());
+
+    // The watches must not move once they have been armed, because the
+    // pending reads refer to them.
+    try {
+        for (std::size_t i = 0; i < this->_watches.size(); ++i) {
+            this->arm(i);
+        }
+
+        this->_threads.reserve(this->_shards.size() - 1);
+        for (std::size_t s = 1; s < this->_shards.size(); ++s) {
+            this->_threads.emplace_back(&win32_notification_source::run,
+                this, s);
+        }
+    } catch (...) {
+        this->cancel();
+        throw;
+    }
+}
+
+
+/*
+ * win32_notification_source::~win32_notification_source
+ */
+win32_notification_source::~win32_notification_source(void) {
+    this->cancel();
+}
+
+
+/*
+ * win32_notification_source::stop
+ */
+void win32_notification_source::stop(void) noexcept {
+    this->_stop.SetEvent();
+}
+
+
+/*
+ * win32_notification_source::wait
+ */
+bool win32_notification_source::wait(_Out_ std::size_t& target) {
+    using namespace std::chrono;
+    auto& handles = this->_shards.front();
+
+    while (true) {
+        // Report the first change that has settled or that has been held back
+        // for too long. Otherwise, wait until the next one is due.
+        const auto now = clock_type::now();
+        DWORD timeout = INFINITE;
+
+        for (auto& w : this->_watches) {
+            if (w.pending) {
+                const auto due = (std::min)(w.last_changed + settle_time,
+                    w.changed + max_delay);
+                if (due <= now) {
+                    w.pending = false;
+                    target = w.target;
+                    return true;
+                }
+
+                const auto remaining = duration_cast<milliseconds>(
+                    due - now).count() + 1;
+                timeout = (std::min)(timeout, static_cast<DWORD>(remaining));
+            }
+        }
+
+        const auto status = ::WaitForMultipleObjects(
+            static_cast<DWORD>(handles.size()),
+            handles.data(),
+            FALSE,
+            timeout);
+        THROW_LAST_ERROR_IF(status == WAIT_FAILED);
+        if (status == WAIT_TIMEOUT) {
+            continue;
+        }
+
+        const auto index = static_cast<std::size_t>(status - WAIT_OBJECT_0);
+        if (handles[index] == this->_stop.get()) {
+            return false;
+
+        } else if (handles[index] == this->_ready.get()) {
+            // The threads of the other shards only queue what they have seen,
+            // so the watches are only ever changed on this thread.
+            std::vector<std::size_t> signalled;
+            {
+                std::lock_guard<std::mutex> l(this->_lock);
+                if (this->_error) {
+                    std::rethrow_exception(this->_error);
+                }
+                signalled.swap(this->_signalled);
+            }
+
+            for (auto i : signalled) {
+                this->collect(i);
+            }
+
+        } else {
+            this->collect(index);
+        }
+    }
+}
+
+
+/*
+ * win32_notification_source::arm
+ */
+void win32_notification_source::arm(_In_ const std::size_t index) {
+    auto& w = this->_watches[index];
+
+    if (w.directory) {
+        ::ZeroMemory(&w.overlapped, sizeof(w.overlapped));
+        w.overlapped.hEvent = w.event.get();
+        THROW_LAST_ERROR_IF(!::ReadDirectoryChangesW(w.directory.get(),
+            w.buffer.data(),
+            static_cast<DWORD>(w.buffer.size() * sizeof(DWORD)),
+            TRUE,
+            FILE_NOTIFY_CHANGE_FILE_NAME
+            | FILE_NOTIFY_CHANGE_DIR_NAME
+            | FILE_NOTIFY_CHANGE_LAST_WRITE,
+            nullptr,
+            &w.overlapped,
+            nullptr));
+
+    } else {
+        // The notification must not be bound to the calling thread, because
+        // it would otherwise be signalled as soon as that thread exits. Only
+        // the key itself is watched, because its time stamp changes if any
+        // of its subkeys is added or removed, which is what the discovery
+        // depends on.
+        THROW_IF_WIN32_ERROR(::RegNotifyChangeKeyValue(w.key.get(),
+            FALSE,
+            REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET
+            | REG_NOTIFY_THREAD_AGNOSTIC,
+            w.event.get(),
+            TRUE));
+    }
+}
+
+
+/*
+ * win32_notification_source::cancel
+ */
+void win32_notification_source::cancel(void) noexcept {
+    this->_stop.SetEvent();
+    for (auto& t : this->_threads) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+
+    for (auto& w : this->_watches) {
+        if (w.directory && ::CancelIoEx(w.directory.get(), &w.overlapped)) {
+            DWORD cnt = 0;
+            ::GetOverlappedResult(w.directory.get(), &w.overlapped, &cnt,
+                TRUE);
+        }
+    }
+}
+
+
+/*
+ * win32_notification_source::collect
+ */
+void win32_notification_source::collect(_In_ const std::size_t index) {
+    auto& w = this->_watches[index];
+    auto relevant = true;
+
+    if (w.directory) {
+        DWORD cnt = 0;
+        if (!::GetOverlappedResult(w.directory.get(), &w.overlapped, &cnt,
+                FALSE)) {
+            // If the buffer overflowed, we do not know what has changed.
+            THROW_LAST_ERROR_IF(::GetLastError() != ERROR_NOTIFY_ENUM_DIR);
+            cnt = 0;
+        }
+
+        // The buffer is reused by the next read, so we must inspect it
+        // before re-arming the watch. An empty buffer also indicates that
+        // the changes did not fit into it.
+        auto data = reinterpret_cast<const std::uint8_t *>(w.buffer.data());
+        for (DWORD o = 0; o < cnt;) {
+            auto info = reinterpret_cast<const FILE_NOTIFY_INFORMATION *>(
+                data + o);
+            const std::wstring path(info->FileName,
+                info->FileNameLength / sizeof(wchar_t));
+            relevant = w.options.is_relevant(path,
+                info->Action == FILE_ACTION_MODIFIED);
+
+            if (relevant || (info->NextEntryOffset == 0)) {
+                break;
+            }
+
+            o += info->NextEntryOffset;
+        }
+    }
+
+    this->arm(index);
+
+    if (relevant) {
+        const auto now = clock_type::now();
+        if (!w.pending) {
+            w.changed = now;
+            w.pending = true;
+        }
+        w.last_changed = now;
+    }
+}
+
+
+/*
+ * win32_notification_source::run
+ */
+void win32_notification_source::run(_In_ const std::size_t shard) noexcept {
+    auto& handles = this->_shards[shard];
+
+    while (true) {
+        const auto status = ::WaitForMultipleObjects(
+            static_cast<DWORD>(handles.size()),
+            handles.data(),
+            FALSE,
+            INFINITE);
+        if (status == WAIT_FAILED) {
+            // Let 'wait' report the error, because there is no one else who
+            // could handle it.
+            try {
+                THROW_LAST_ERROR();
+            } catch (...) {
+                std::lock_guard<std::mutex> l(this->_lock);
+                this->_error = std::current_exception();
+            }
+            this->_ready.SetEvent();
+            return;
+        }
+
+        const auto index = static_cast<std::size_t>(status - WAIT_OBJECT_0);
+        if (index + 1 >= handles.size()) {
+            // This is the stop event.
+            return;
+        }
+
+        // The events of the watches reset automatically and are only
+        // signalled again once 'collect' has re-armed the watch, so we can
+        // keep waiting for the whole shard right away.
+        {
+            std::lock_guard<std::mutex> l(this->_lock);
+            this->_signalled.push_back(shard * shard_size + index);
+        }
+        this->_ready.SetEvent();
+    }
+}
+
+#else /* defined(_WIN32) */
+/*
+ * inotify_notification_source::inotify_notification_source
+ */
+inotify_notification_source::inotify_notification_source(
+        _In_ const std::vector<notification_target>& targets)
+        : _inotify(-1) {
+    constexpr auto events = IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE
+        | IN_DELETE | IN_DELETE_SELF | IN_MOVED_FROM | IN_MOVED_TO
+        | IN_MOVE_SELF | IN_ONLYDIR;
+    this->_wake[0] = this->_wake[1] = -1;
+
+    try {
+        if (::pipe2(this->_wake, O_CLOEXEC | O_NONBLOCK) != 0) {
+            THROW_WIN32(errno);
+        }
+
+        this->_inotify = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if (this->_inotify < 0) {
+            THROW_WIN32(errno);
+        }
+
+        this->_watches.reserve(targets.size());
+        for (auto& t : targets) {
+            auto watch = -1;
+
+            if (t.type == discovery_cache::source_type::file_system) {
+                watch = ::inotify_add_watch(this->_inotify,
+                    ::to_utf8(t.path).c_str(),
+                    events);
+            }
+
+            this->_watches.push_back(watch);
+        }
+    } catch (...) {
+        this->release();
+        throw;
+    }
+}
+
+
+/*
+ * inotify_notification_source::~inotify_notification_source
+ */
+inotify_notification_source::~inotify_notification_source(void) {
+    this->release();
+}
+
+
+/*
+ * inotify_notification_source::stop
+ */
+void inotify_notification_source::stop(void) noexcept {
+    const char wake = 1;
+    // If the pipe is full, the source is already about to stop.
+    (void) ::write(this->_wake[1], &wake, sizeof(wake));
+}
+
+
+/*
+ * inotify_notification_source::wait
+ */
+bool inotify_notification_source::wait(_Out_ std::size_t& target) {
+    while (this->_changed.empty()) {
+        pollfd fds[2];
+        fds[0].fd = this->_inotify;
+        fds[0].events = POLLIN;
+        fds[1].fd = this->_wake[0];
+        fds[1].events = POLLIN;
+
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            THROW_WIN32(errno);
+        }
+
+        if ((fds[1].revents & POLLIN) != 0) {
+            return false;
+        }
+
+        if ((fds[0].revents & POLLIN) != 0) {
+            this->read();
+        }
+    }
+
+    target = this->_changed.front();
+    this->_changed.pop_front();
+    return true;
+}
+
+
+/*
+ * inotify_notification_source::read
+ */
+void inotify_notification_source::read(void) {
+    alignas(inotify_event) char buffer[4096];
+
+    while (true) {
+        const auto cnt = ::read(this->_inotify, buffer, sizeof(buffer));
+        if (cnt < 0) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                return;
+            } else if (errno == EINTR) {
+                continue;
+            }
+            THROW_WIN32(errno);
+        }
+
+        for (ssize_t o = 0; o < cnt;) {
+            auto e = reinterpret_cast<const inotify_event *>(buffer + o);
+            o += sizeof(inotify_event) + e->len;
+
+            auto it = std::find(this->_watches.begin(), this->_watches.end(),
+                e->wd);
+            if (it == this->_watches.end()) {
+                continue;
+            }
+
+            // Report a burst of events for the same target only once.
+            const auto target = static_cast<std::size_t>(
+                std::distance(this->_watches.begin(), it));
+            if (std::find(this->_changed.begin(), this->_changed.end(),
+                    target) == this->_changed.end()) {
+                this->_changed.push_back(target);
+            }
+        }
+    }
+}
+
+
+/*
+ * inotify_notification_source::release
+ */
+void inotify_notification_source::release(void) noexcept {
+    if (this->_inotify >= 0) {
+        ::close(this->_inotify);
+        this->_inotify = -1;
+    }
+
+    for (auto& w : this->_wake) {
+        if (w >= 0) {
+            ::close(w);
+            w = -1;
+        }
+    }
+}
+#endif /* defined(_WIN32) */
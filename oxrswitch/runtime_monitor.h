@@ -0,0 +1,646 @@
+﻿// <copyright file="runtime_monitor.h" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#if !defined(_OXRSWITCH_RUNTIME_MONITOR_H)
+#define _OXRSWITCH_RUNTIME_MONITOR_H
+#pragma once
+
+#include "directory_walker.h"
+#include "discovery_cache.h"
+#include "path_compare.h"
+#include "runtime.h"
+#include "runtime_table.h"
+
+
+/// <summary>
+/// A registry key or a directory tree that the discovery depends on.
+/// </summary>
+struct notification_target final {
+    /// <summary>
+    /// The kind of the target.
+    /// </summary>
+    discovery_cache::source_type type;
+
+    /// <summary>
+    /// The path of a key below <c>HKEY_LOCAL_MACHINE</c> or the path of a
+    /// directory, in which case the whole tree below it is watched.
+    /// </summary>
+    std::wstring path;
+
+    /// <summary>
+    /// The options the directory is searched with, which allow a source to
+    /// ignore changes that cannot affect the result, like downloads into an
+    /// excluded directory.
+    /// </summary>
+    walk_options options;
+};
+
+
+#if defined(_WIN32)
+/// <summary>
+/// Waits for registry keys or directory trees to be changed using the Win32
+/// change notifications.
+/// </summary>
+/// <remarks>
+/// <para>A notification source observes a fixed list of
+/// <see cref="notification_target" />s, which is passed to its constructor,
+/// and must provide the following methods:</para>
+/// <list type="bullet">
+/// <item><c>bool wait(std::size_t&amp; target)</c> blocks until any of the
+/// targets changed and returns its zero-based index, or returns
+/// <see langword="false" /> if the source has been stopped.</item>
+/// <item><c>void stop(void)</c> makes <c>wait</c> return
+/// <see langword="false" />, which may be called from any thread.</item>
+/// </list>
+/// <para>This is the same interface as the one of the watchers of the
+/// service, so a source for tests on Linux can be built on inotify.</para>
+/// <para>As <c>WaitForMultipleObjects</c> is limited to
+/// <c>MAXIMUM_WAIT_OBJECTS</c> handles, the handles are split into shards.
+/// The thread calling <c>wait</c> waits for the first shard itself, and every
+/// other shard has a thread of its own, which queues the watches that have
+/// been signalled for <c>wait</c>. The source is therefore idle as long as
+/// nothing changes, no matter how many targets there are. Changes of a
+/// directory tree are filtered against the
+/// <see cref="notification_target::options" /> and only reported once the
+/// tree has settled, such that an installer writing thousands of files does
+/// not make the monitor search the folder for each of them.</para>
+/// </remarks>
+class win32_notification_source final {
+
+public:
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="targets">The targets to be watched. Targets that do not
+    /// exist are ignored.</param>
+    explicit win32_notification_source(
+        _In_ const std::vector<notification_target>& targets);
+
+    win32_notification_source(const win32_notification_source&) = delete;
+
+    /// <summary>
+    /// Finalises the instance.
+    /// </summary>
+    /// <remarks>
+    /// The destructor cancels all pending reads of directory changes and
+    /// waits for them to complete, because they write into the buffers of
+    /// the watches.
+    /// </remarks>
+    ~win32_notification_source(void);
+
+    /// <summary>
+    /// Makes <see cref="wait" /> return <see langword="false" />.
+    /// </summary>
+    void stop(void) noexcept;
+
+    /// <summary>
+    /// Blocks until any of the targets changed.
+    /// </summary>
+    /// <param name="target">Receives the index of the target that changed.
+    /// </param>
+    /// <returns><see langword="true" /> if a target changed,
+    /// <see langword="false" /> if the source has been stopped.</returns>
+    bool wait(_Out_ std::size_t& target);
+
+    win32_notification_source& operator =(
+        const win32_notification_source&) = delete;
+
+private:
+
+    /// <summary>
+    /// The clock measuring how long a target has been quiet.
+    /// </summary>
+    typedef std::chrono::steady_clock clock_type;
+
+    /// <summary>
+    /// A target that exists and is being watched.
+    /// </summary>
+    struct watch final {
+        /// <summary>
+        /// Receives the changes of a directory, which must be aligned to a
+        /// <c>DWORD</c> boundary.
+        /// </summary>
+        std::vector<DWORD> buffer;
+
+        /// <summary>
+        /// The time the first change has been pending since, which is only
+        /// valid if <see cref="pending" /> is set.
+        /// </summary>
+        clock_type::time_point changed;
+
+        wil::unique_hfile directory;
+        wil::unique_event event;
+        wil::unique_hkey key;
+
+        /// <summary>
+        /// The time of the most recent change that has not been reported yet.
+        /// </summary>
+        clock_type::time_point last_changed;
+
+        walk_options options;
+        OVERLAPPED overlapped;
+
+        /// <summary>
+        /// Indicates whether the target has changed, but the change has not
+        /// been reported yet.
+        /// </summary>
+        bool pending;
+
+        std::size_t target;
+    };
+
+    /// <summary>
+    /// The maximum time a change is held back while the target keeps
+    /// changing.
+    /// </summary>
+    static constexpr clock_type::duration max_delay
+        = std::chrono::seconds(5);
+
+    /// <summary>
+    /// The time a target must not have changed before its change is
+    /// reported.
+    /// </summary>
+    static constexpr clock_type::duration settle_time
+        = std::chrono::milliseconds(500);
+
+    /// <summary>
+    /// The number of watches per shard, which leaves room for the stop
+    /// event and the event signalling queued watches.
+    /// </summary>
+    static constexpr std::size_t shard_size = MAXIMUM_WAIT_OBJECTS - 2;
+
+    /// <summary>
+    /// Requests a notification for the next change of a watch.
+    /// </summary>
+    /// <param name="index">The index of the watch.</param>
+    void arm(_In_ const std::size_t index);
+
+    /// <summary>
+    /// Stops the threads waiting for the shards, cancels all pending reads
+    /// of directory changes and waits for them to complete.
+    /// </summary>
+    void cancel(void) noexcept;
+
+    /// <summary>
+    /// Collects the changes of a watch that has been signalled and re-arms
+    /// it.
+    /// </summary>
+    /// <param name="index">The index of the watch.</param>
+    void collect(_In_ const std::size_t index);
+
+    /// <summary>
+    /// Waits for the given shard on a thread of its own and queues the
+    /// watches that have been signalled until the source is stopped.
+    /// </summary>
+    /// <param name="shard">The index of the shard, which must not be the
+    /// first one.</param>
+    void run(_In_ const std::size_t shard) noexcept;
+
+    /// <summary>
+    /// The error that ended the wait for a shard on its own thread.
+    /// </summary>
+    std::exception_ptr _error;
+
+    /// <summary>
+    /// Protects <see cref="_error" /> and <see cref="_signalled" />.
+    /// </summary>
+    std::mutex _lock;
+
+    /// <summary>
+    /// Signals that watches have been queued in <see cref="_signalled" />.
+    /// </summary>
+    wil::unique_event _ready;
+
+    /// <summary>
+    /// The handles of the watches in shards of at most
+    /// <see cref="shard_size" />, each followed by the event signalling a
+    /// stop request. The first shard is also followed by
+    /// <see cref="_ready" />.
+    /// </summary>
+    std::vector<std::vector<HANDLE>> _shards;
+
+    /// <summary>
+    /// The indices of the watches that the threads of the shards have seen
+    /// signalled, but which have not been collected yet.
+    /// </summary>
+    std::vector<std::size_t> _signalled;
+    wil::unique_event _stop;
+    std::vector<std::thread> _threads;
+    std::vector<watch> _watches;
+};
+
+/// <summary>
+/// The notification source used by default on the current platform.
+/// </summary>
+typedef win32_notification_source native_notification_source;
+
+#else /* defined(_WIN32) */
+/// <summary>
+/// Waits for directories to be changed using inotify.
+/// </summary>
+/// <remarks>
+/// <para>This is the Linux counterpart of
+/// <see cref="win32_notification_source" />. Registry targets are ignored,
+/// and only the entries directly in a directory are watched, which is what
+/// the OpenXR loader searches in the XDG directories.</para>
+/// </remarks>
+class inotify_notification_source final {
+
+public:
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="targets">The targets to be watched. Targets that do not
+    /// exist are ignored.</param>
+    explicit inotify_notification_source(
+        _In_ const std::vector<notification_target>& targets);
+
+    inotify_notification_source(const inotify_notification_source&) = delete;
+
+    /// <summary>
+    /// Finalises the instance.
+    /// </summary>
+    ~inotify_notification_source(void);
+
+    /// <summary>
+    /// Makes <see cref="wait" /> return <see langword="false" />.
+    /// </summary>
+    void stop(void) noexcept;
+
+    /// <summary>
+    /// Blocks until any of the targets changed.
+    /// </summary>
+    /// <param name="target">Receives the index of the target that changed.
+    /// </param>
+    /// <returns><see langword="true" /> if a target changed,
+    /// <see langword="false" /> if the source has been stopped.</returns>
+    bool wait(_Out_ std::size_t& target);
+
+    inotify_notification_source& operator =(
+        const inotify_notification_source&) = delete;
+
+private:
+
+    /// <summary>
+    /// Reads all pending events and queues the targets they refer to.
+    /// </summary>
+    void read(void);
+
+    /// <summary>
+    /// Closes all descriptors.
+    /// </summary>
+    void release(void) noexcept;
+
+    /// <summary>
+    /// The targets that changed, but have not been reported yet.
+    /// </summary>
+    std::deque<std::size_t> _changed;
+    int _inotify;
+
+    /// <summary>
+    /// The watch descriptor of each target, which is negative if the target
+    /// is not watched.
+    /// </summary>
+    std::vector<int> _watches;
+
+    /// <summary>
+    /// A pipe that wakes <see cref="wait" /> when the source is stopped.
+    /// </summary>
+    int _wake[2];
+};
+
+/// <summary>
+/// The notification source used by default on the current platform.
+/// </summary>
+typedef inotify_notification_source native_notification_source;
+#endif /* defined(_WIN32) */
+
+
+/// <summary>
+/// Keeps the result of the discovery up to date by re-scanning only the part
+/// of the system that has changed.
+/// </summary>
+/// <remarks>
+/// <para>The result is split into segments: the runtimes registered with
+/// OpenXR, the installation folders of known runtimes and the runtimes in
+/// each of these folders. Every segment records the sources it depends on in
+/// its own <see cref="discovery_cache" />. The monitor watches the registry
+/// keys of all segments and each installation folder as a whole. If any of
+/// them changes, only the segment it belongs to is scanned again. If the
+/// installation folders change, only folders that have been added or
+/// attributed to other runtimes are searched.</para>
+/// <para>After each update, the monitor publishes a new, immutable snapshot
+/// of all runtimes, which readers obtain using <see cref="snapshot" /> on
+/// any thread without locking.</para>
+/// <para>The scanner must provide the type <c>installation_map</c>, which
+/// maps folders to a mask of runtimes, and the following methods, all of
+/// which record the sources they depend on in a
+/// <see cref="discovery_cache" />:</para>
+/// <list type="bullet">
+/// <item><c>void find_registered(std::vector&lt;runtime&gt;&amp; runtimes,
+/// discovery_cache&amp; cache)</c> appends the runtimes registered with
+/// OpenXR.</item>
+/// <item><c>installation_map find_installations(discovery_cache&amp; cache)
+/// </c> answers the installation folders of known runtimes.</item>
+/// <item><c>bool find_installed(const std::wstring&amp; folder, mask,
+/// std::vector&lt;runtime&gt;&amp; runtimes, discovery_cache&amp; cache)</c>
+/// appends the runtimes in an installation folder and answers whether the
+/// folder has been searched completely.</item>
+/// <item><c>walk_options get_walk_options(mask)</c> answers the options an
+/// installation folder attributed to the given runtimes is searched with.
+/// </item>
+/// <item><c>std::uint64_t stamp(source_type type, const std::wstring&amp;
+/// path)</c> answers the current time stamp of a source like
+/// <see cref="discovery_cache::get_stamp" />.</item>
+/// </list>
+/// </remarks>
+/// <typeparam name="TScanner">The type searching the system for runtimes.
+/// </typeparam>
+/// <typeparam name="TSource">The type providing change notifications, which
+/// must be compatible with <see cref="win32_notification_source" />.
+/// </typeparam>
+template<class TScanner, class TSource = native_notification_source>
+class runtime_monitor final {
+
+public:
+
+    /// <summary>
+    /// A callback that is invoked on the thread of the monitor whenever a new
+    /// snapshot has been published.
+    /// </summary>
+    typedef std::function<void(const std::shared_ptr<
+        const std::vector<runtime>>&)> changed_callback;
+
+    /// <summary>
+    /// A callback that is invoked on the thread of the monitor if it failed
+    /// and stopped watching the system.
+    /// </summary>
+    typedef std::function<void(std::exception_ptr)> failed_callback;
+
+    /// <summary>
+    /// A callback that is invoked for each runtime as soon as it has been
+    /// found.
+    /// </summary>
+    typedef std::function<void(const runtime&)> found_callback;
+
+    /// <summary>
+    /// An immutable list of runtimes ordered by their paths.
+    /// </summary>
+    typedef std::shared_ptr<const std::vector<runtime>> snapshot_type;
+
+    /// <summary>
+    /// Initialises a new instance, which has not found any runtime yet.
+    /// </summary>
+    /// <param name="scanner">The scanner searching the system.</param>
+    explicit runtime_monitor(_In_ TScanner scanner = TScanner());
+
+    runtime_monitor(const runtime_monitor&) = delete;
+
+    /// <summary>
+    /// Finalises the instance.
+    /// </summary>
+    /// <remarks>
+    /// The destructor stops watching and waits for the thread of the monitor
+    /// to exit.
+    /// </remarks>
+    ~runtime_monitor(void);
+
+    /// <summary>
+    /// Combines the sources of all segments and the current snapshot into a
+    /// cache that can be persisted for the next start.
+    /// </summary>
+    /// <remarks>
+    /// This method must only be called before the monitor is started or from
+    /// the callback passed to <see cref="start" />, because the segments are
+    /// owned by the thread of the monitor.
+    /// </remarks>
+    /// <param name="retval">Receives the cache.</param>
+    /// <returns><see langword="true" /> if all installation folders have been
+    /// searched completely, <see langword="false" /> if the result is
+    /// incomplete and should not be persisted.</returns>
+    bool cache(_Out_ discovery_cache& retval) const;
+
+    /// <summary>
+    /// Publishes the runtimes from a <see cref="discovery_cache" /> and
+    /// restores the segments they have been assembled from without searching
+    /// the system.
+    /// </summary>
+    /// <remarks>
+    /// <para>Segments depending on a runtime file that has changed since the
+    /// cache has been written are marked as outdated. All outdated segments
+    /// are searched by <see cref="update" /> or as soon as the monitor has
+    /// been started.</para>
+    /// <para>If the cache does not hold any segment, the monitor will search
+    /// the whole system once when it is started.</para>
+    /// <para>This method must only be called before the monitor is started.
+    /// </para>
+    /// </remarks>
+    /// <param name="cache">The cache, which must hold the runtimes ordered by
+    /// their paths.</param>
+    /// <returns><see langword="true" /> if the segments have been restored,
+    /// <see langword="false" /> if only the runtimes have been published.
+    /// </returns>
+    bool restore(_Inout_ discovery_cache&& cache);
+
+    /// <summary>
+    /// Answer whether the segments are known, either because the system has
+    /// been searched or because they have been restored from a cache.
+    /// </summary>
+    /// <remarks>
+    /// This method must only be called before the monitor is started.
+    /// </remarks>
+    /// <returns></returns>
+    inline bool scanned(void) const noexcept {
+        return this->_scanned;
+    }
+
+    /// <summary>
+    /// Searches the whole system and publishes the result.
+    /// </summary>
+    /// <param name="cache">Receives the result and all sources it depends on
+    /// like from <see cref="cache" />.</param>
+    /// <param name="on_found">The callback to be invoked for each runtime
+    /// found, which may be empty.</param>
+    /// <param name="cancelled">If not <see langword="nullptr" />, the search
+    /// stops before the next installation folder once the flag has been
+    /// set, in which case no further runtime is reported and the monitor
+    /// searches the whole system again when it is started.</param>
+    /// <returns><see langword="true" /> if all installation folders have been
+    /// searched completely, <see langword="false" /> if the search of any of
+    /// them was cut short or the search has been cancelled.</returns>
+    bool scan(_Out_ discovery_cache& cache,
+        _In_ const found_callback& on_found,
+        _In_opt_ const std::atomic<bool> *cancelled = nullptr);
+
+    /// <summary>
+    /// Answer the runtimes found most recently.
+    /// </summary>
+    /// <returns>The current snapshot, which is never
+    /// <see langword="nullptr" />.</returns>
+    inline snapshot_type snapshot(void) const noexcept {
+        return std::atomic_load(&this->_snapshot);
+    }
+
+    /// <summary>
+    /// Starts watching the system on a background thread.
+    /// </summary>
+    /// <remarks>
+    /// Anything that changed since the last scan is picked up as soon as the
+    /// monitor has started. If the monitor fails, for instance because the
+    /// system does not allow for watching all sources, it stops and reports
+    /// the error to <paramref name="on_failed" />. The last snapshot remains
+    /// valid in this case.
+    /// </remarks>
+    /// <param name="on_changed">The callback to be invoked for each new
+    /// snapshot, which may be empty.</param>
+    /// <param name="on_failed">The callback to be invoked if the monitor
+    /// failed, which may be empty.</param>
+    void start(_In_ changed_callback on_changed,
+        _In_ failed_callback on_failed = failed_callback());
+
+    /// <summary>
+    /// Stops watching the system and waits for the background thread to
+    /// exit.
+    /// </summary>
+    void stop(void) noexcept;
+
+    /// <summary>
+    /// Searches all segments whose sources have changed since they have been
+    /// searched and publishes the result.
+    /// </summary>
+    /// <remarks>
+    /// This method must only be called before the monitor is started.
+    /// </remarks>
+    /// <param name="cache">Receives the result and all sources it depends on
+    /// like from <see cref="cache" />.</param>
+    /// <returns><see langword="true" /> if all installation folders have been
+    /// searched completely, <see langword="false" /> if the search of any of
+    /// them was cut short.</returns>
+    bool update(_Out_ discovery_cache& cache);
+
+    runtime_monitor& operator =(const runtime_monitor&) = delete;
+
+private:
+
+    /// <summary>
+    /// Identifies the kind of segment a <see cref="notification_target" />
+    /// belongs to.
+    /// </summary>
+    typedef discovery_cache::segment_type segment_type;
+
+    /// <summary>
+    /// A part of the result that is searched as a whole.
+    /// </summary>
+    struct segment final {
+        /// <summary>
+        /// The sources the segment depends on.
+        /// </summary>
+        discovery_cache cache;
+
+        /// <summary>
+        /// Indicates whether the segment has been searched completely.
+        /// </summary>
+        bool complete = true;
+
+        /// <summary>
+        /// The runtimes found in the segment.
+        /// </summary>
+        std::vector<runtime> runtimes;
+    };
+
+    /// <summary>
+    /// Identifies the segment a <see cref="notification_target" /> belongs
+    /// to, which is the installation folder in case of
+    /// <see cref="segment_type::installed" />.
+    /// </summary>
+    typedef std::pair<segment_type, std::wstring> owner;
+
+    /// <summary>
+    /// Answer whether <paramref name="lhs" /> and <paramref name="rhs" />
+    /// hold the same runtimes in the same order.
+    /// </summary>
+    static bool equals(_In_ const std::vector<runtime>& lhs,
+        _In_ const std::vector<runtime>& rhs) noexcept;
+
+    /// <summary>
+    /// Merges all segments into a new snapshot and publishes it unless it is
+    /// equal to the current one.
+    /// </summary>
+    /// <returns><see langword="true" /> if a new snapshot has been
+    /// published.</returns>
+    bool publish(void);
+
+    /// <summary>
+    /// Searches the installation folders and all folders that are new or
+    /// attributed to other runtimes than before.
+    /// </summary>
+    /// <typeparam name="TCallback">A functor accepting the
+    /// <see cref="segment" /> of each folder that has been searched.
+    /// </typeparam>
+    /// <param name="on_scanned"></param>
+    /// <param name="cancelled">If not <see langword="nullptr" />, no further
+    /// folder is searched once the flag has been set.</param>
+    template<class TCallback>
+    void rescan_installations(_In_ TCallback&& on_scanned,
+        _In_opt_ const std::atomic<bool> *cancelled = nullptr);
+
+    /// <summary>
+    /// Searches the given installation folder.
+    /// </summary>
+    /// <param name="folder"></param>
+    /// <param name="runtimes">The mask of the runtimes the folder has been
+    /// attributed to.</param>
+    /// <returns>The segment of the folder.</returns>
+    segment rescan_installed(_In_ const std::wstring& folder,
+        _In_ const typename TScanner::installation_map::mapped_type runtimes);
+
+    /// <summary>
+    /// Searches the runtimes registered with OpenXR.
+    /// </summary>
+    void rescan_registered(void);
+
+    /// <summary>
+    /// The body of the background thread.
+    /// </summary>
+    void run(void) noexcept;
+
+    /// <summary>
+    /// Determines the sources to be watched from the segments.
+    /// </summary>
+    /// <param name="targets">Receives the targets to be passed to the
+    /// notification source.</param>
+    /// <param name="owners">Receives the segment of each target.</param>
+    void targets(_Out_ std::vector<notification_target>& targets,
+        _Out_ std::vector<owner>& owners) const;
+
+    /// <summary>
+    /// Searches all segments that depend on a source whose time stamp has
+    /// changed since the segment has been searched.
+    /// </summary>
+    /// <returns><see langword="true" /> if the installation folders have
+    /// changed, which requires new targets to be watched.</returns>
+    bool validate(void);
+
+    typename TScanner::installation_map _installations;
+    segment _installations_segment;
+    std::map<std::wstring, segment, path_compare> _installed;
+    std::mutex _lock;
+    changed_callback _on_changed;
+    failed_callback _on_failed;
+    segment _registered;
+    bool _scanned;
+    TScanner _scanner;
+    snapshot_type _snapshot;
+    TSource *_source;
+    bool _stopping;
+    std::thread _thread;
+};
+
+#include "runtime_monitor.inl"
+
+#endif /* !defined(_OXRSWITCH_RUNTIME_MONITOR_H) */
@@ -0,0 +1,537 @@
+﻿// <copyright file="runtime_monitor.inl" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+
+/*
+ * runtime_monitor<TScanner, TSource>::runtime_monitor
+ */
+template<class TScanner, class TSource>
+runtime_monitor<TScanner, TSource>::runtime_monitor(_In_ TScanner scanner)
+    : _scanned(false),
+        _scanner(std::move(scanner)),
+        _snapshot(std::make_shared<const std::vector<runtime>>()),
+        _source(nullptr),
+        _stopping(false) { }
+
+
+/*
+ * runtime_monitor<TScanner, TSource>::~runtime_monitor
+ */
+template<class TScanner, class TSource>
+runtime_monitor<TScanner, TSource>::~runtime_monitor(void) {
+    this->stop();
+}
+
+
+/*
+ * runtime_monitor<TScanner, TSource>::cache
+ */
+template<class TScanner, class TSource>
+bool runtime_monitor<TScanner, TSource>::cache(
+        _Out_ discovery_cache& retval) const {
+    auto complete = this->_scanned;
+    retval = discovery_cache();
+
+    // Besides the combined sources, the segments themselves are persisted,
+    // which allows the next start to search only the outdated ones.
+    auto add = [&retval](const segment& s, const segment_type type,
+            const std::wstring& folder, const std::uint64_t mask) {
+        for (auto& t : s.cache.stamps()) {
+            retval.add(t.type, t.path, t.time);
+        }
+
+        retval.segments().push_back({ s.complete,
+            folder,
+            mask,
+            s.runtimes,
+            s.cache.stamps(),
+            type });
+    };
+
+    if (this->_scanned) {
+        add(this->_registered, segment_type::registered, L"", 0);
+        add(this->_installations_segment, segment_type::installations, L"",
+            0);
+        for (auto& i : this->_installed) {
+            add(i.second, segment_type::installed, i.first,
+                this->_installations.at(i.first));
+            complete = complete && i.second.complete;
+        }
+    }
+
+    // Track the runtime files themselves, because their content might change
+    // without the directory being changed.
+    const auto runtimes = this->snapshot();
+    const auto type = discovery_cache::source_type::file_system;
+    for (auto& r : *runtimes) {
+        retval.add(type, r.path(), this->_scanner.stamp(type, r.path()));
+        if (!r.wow_path().empty()) {
+            retval.add(type, r.wow_path(),
+                this->_scanner.stamp(type, r.wow_path()));
+        }
+    }
+
+    retval.runtimes() = *runtimes;
+    return complete;
+}
+
+
+/*
+ * runtime_monitor<TScanner, TSource>::restore
+ */
+template<class TScanner, class TSource>
+bool runtime_monitor<TScanner, TSource>::restore(
+        _Inout_ discovery_cache&& cache) {
+    const auto retval = !cache.segments().empty();
+
+    if (retval) {
+        // The runtime files are only recorded in the combined sources, so we
+        // check them here and make the segments holding a changed file look
+        // outdated by dropping their sources.
+        std::map<std::wstring, std::uint64_t, path_compare> files;
+        for (auto& s : cache.stamps()) {
+            if (s.type == discovery_cache::source_type::file_system) {
+                files[s.path] = s.time;
+            }
+        }
+
+        auto is_current = [this, &files](const std::wstring& path) {
+            if (path.empty()) {
+                return true;
+            }
+
+            auto it = files.find(path);
+            return (it != files.end()) && (it->second == this->_scanner.stamp(
+                discovery_cache::source_type::file_system, path));
+        };
+
+        this->_installations.clear();
+        this->_installed.clear();
+
+        for (auto& s : cache.segments()) {
+            segment dst;
+            dst.complete = s.complete;
+            dst.runtimes = std::move(s.runtimes);
+
+            const auto current = std::all_of(dst.runtimes.begin(),
+                dst.runtimes.end(),
+                [&is_current](const runtime& r) {
+                    return is_current(r.path()) && is_current(r.wow_path());
+                });
+            if (current) {
+                for (auto& t : s.stamps) {
+                    dst.cache.add(t.type, t.path, t.time);
+                }
+            }
+
+            switch (s.type) {
+                case segment_type::registered:
+                    this->_registered = std::move(dst);
+                    break;
+
+                case segment_type::installations:
+                    this->_installations_segment = std::move(dst);
+                    break;
+
+                case segment_type::installed:
+                    this->_installations[s.folder] = static_cast<
+                        typename TScanner::installation_map::mapped_type>(
+                        s.mask);
+                    this->_installed[s.folder] = std::move(dst);
+                    break;
+            }
+        }
+
+        this->_scanned = true;
+    }
+
+    std::atomic_store(&this->_snapshot,
+        std::make_shared<const std::vector<runtime>>(
+            std::move(cache.runtimes())));
+    return retval;
+}
+
+
+/*
+ * runtime_monitor<TScanner, TSource>::scan
+ */
+template<class TScanner, class TSource>
+bool runtime_monitor<TScanner, TSource>::scan(_Out_ discovery_cache& cache,
+        _In_ const found_callback& on_found,
+        _In_opt_ const std::atomic<bool> *cancelled) {
+    auto is_cancelled = [cancelled](void) {
+        return (cancelled != nullptr)
+            && cancelled->load(std::memory_order_acquire);
+    };
+
+    // The same runtime might be found in multiple segments, but we report
+    // each of them only once.
+    runtime_table reported;
+    auto report = [&on_found, &reported, &is_cancelled](const segment& s) {
+        if (on_found) {
+            for (auto& r : s.runtimes) {
+                if (is_cancelled()) {
+                    return;
+                }
+                if (reported.insert(r).second) {
+                    on_found(r);
+                }
+            }
+        }
+    };
+
+    this->rescan_registered();
+    report(this->_registered);
+
+    // Forget all folders, which makes all of them be searched again.
+    this->_installations.clear();
+    this->_installed.clear();
+    this->rescan_installations(report, cancelled);
+
+    if (is_cancelled()) {
+        // Some folders have not been searched, so the segments must be
+        // established again if the monitor is started.
+        this->_scanned = false;
+        cache = discovery_cache();
+        return false;
+    }
+
+    this->_scanned = true;
+    this->publish();
+    return this->cache(cache);
+}
+
+
+/*
+ * runtime_monitor<TScanner, TSource>::start
+ */
+template<class TScanner, class TSource>
+void runtime_monitor<TScanner, TSource>::start(
+        _In_ changed_callback on_changed,
+        _In_ failed_callback on_failed) {
+    if (this->_thread.joinable()) {
+        throw std::logic_error("The runtime monitor is already running.");
+    }
+
+    this->_on_changed = std::move(on_changed);
+    this->_on_failed = std::move(on_failed);
+    this->_stopping = false;
+    this->_thread = std::thread(&runtime_monitor::run, this);
+}
+
+
+/*
+ * runtime_monitor<TScanner, TSource>::stop
+ */
+template<class TScanner, class TSource>
+void runtime_monitor<TScanner, TSource>::stop(void) noexcept {
+    {
+        std::lock_guard<std::mutex> l(this->_lock);
+        this->_stopping = true;
+        if (this->_source != nullptr) {
+            this->_source->stop();
+        }
+    }
+
+    if (this->_thread.joinable()) {
+        this->_thread.join();
+    }
+}
+
+
+/*
+ * runtime_monitor<TScanner, TSource>::update
+ */
+template<class TScanner, class TSource>
+bool runtime_monitor<TScanner, TSource>::update(_Out_ discovery_cache& cache) {
+    this->validate();
+    this->publish();
+    return this->cache(cache);
+}
+
+
+/*
+ * runtime_monitor<TScanner, TSource>::equals
+ */
+template<class TScanner, class TSource>
+bool runtime_monitor<TScanner, TSource>::equals(
+        _In_ const std::vector<runtime>& lhs,
+        _In_ const std::vector<runtime>& rhs) noexcept {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+        [](const runtime& l, const runtime& r) {
+            return (l.path() == r.path())
+                && (l.wow_path() == r.wow_path())
+                && (l.name() == r.name());
+        });
+}
+
+
+/*
+ * runtime_monitor<TScanner, TSource>::publish
+ */
+template<class TScanner, class TSource>
+bool runtime_monitor<TScanner, TSource>::publish(void) {
+    runtime_table table;
+    for (auto& r : this->_registered.runtimes) {
+        table.insert(r);
+    }
+    for (auto& i : this->_installed) {
+        for (auto& r : i.second.runtimes) {
+            table.insert(r);
+        }
+    }
+
+    std::vector<runtime> runtimes;
+    runtimes.reserve(table.size());
+    table.copy(std::back_inserter(runtimes));
+
+    // Most notifications do not affect any runtime, for instance if an
+    // unrelated program is installed, which we do not want to bother the
+    // readers with.
+    if (equals(*this->snapshot(), runtimes)) {
+        return false;
+    }
+
+    const snapshot_type snapshot = std::make_shared<const std::vector<runtime>>(
+        std::move(runtimes));
+    std::atomic_store(&this->_snapshot, snapshot);
+
+    if (this->_on_changed) {
+        try {
+            this->_on_changed(snapshot);
+        } catch (...) { /* The snapshot has been published anyway. */ }
+    }
+
+    return true;
+}
+
+
+/*
+ * runtime_monitor<TScanner, TSource>::rescan_installations
+ */
+template<class TScanner, class TSource>
+template<class TCallback>
+void runtime_monitor<TScanner, TSource>::rescan_installations(
+        _In_ TCallback&& on_scanned,
+        _In_opt_ const std::atomic<bool> *cancelled) {
+    segment installations;
+    auto found = this->_scanner.find_installations(installations.cache);
+
+    // Drop the folders that are gone or that have been attributed to other
+    // runtimes, which might require them to be searched differently.
+    for (auto it = this->_installed.begin(); it != this->_installed.end();) {
+        auto f = found.find(it->first);
+        if ((f == found.end())
+                || (f->second != this->_installations.at(it->first))) {
+            it = this->_installed.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (auto& f : found) {
+        if ((cancelled != nullptr)
+                && cancelled->load(std::memory_order_acquire)) {
+            break;
+        }
+
+        if (this->_installed.find(f.first) == this->_installed.end()) {
+            auto it = this->_installed.emplace(f.first,
+                this->rescan_installed(f.first, f.second)).first;
+            on_scanned(it->second);
+        }
+    }
+
+    this->_installations = std::move(found);
+    this->_installations_segment = std::move(installations);
+}
+
+
+/*
+ * runtime_monitor<TScanner, TSource>::rescan_installed
+ */
+template<class TScanner, class TSource>
+typename runtime_monitor<TScanner, TSource>::segment
+runtime_monitor<TScanner, TSource>::rescan_installed(
+        _In_ const std::wstring& folder,
+        _In_ const typename TScanner::installation_map::mapped_type runtimes) {
+    segment retval;
+    retval.complete = this->_scanner.find_installed(folder,
+        runtimes,
+        retval.runtimes,
+        retval.cache);
+    return retval;
+}
+
+
+/*
+ * runtime_monitor<TScanner, TSource>::rescan_registered
+ */
+template<class TScanner, class TSource>
+void runtime_monitor<TScanner, TSource>::rescan_registered(void) {
+    segment registered;
+    this->_scanner.find_registered(registered.runtimes, registered.cache);
+    this->_registered = std::move(registered);
+}
+
+
+/*
+ * runtime_monitor<TScanner, TSource>::run
+ */
+template<class TScanner, class TSource>
+void runtime_monitor<TScanner, TSource>::run(void) noexcept {
+    try {
+        // If the runtimes have been restored from a cache without segments,
+        // we need to establish them once. Otherwise, only the outdated
+        // segments are searched by the validation below.
+        if (!this->_scanned) {
+            discovery_cache cache;
+            this->scan(cache, found_callback());
+        }
+
+        auto stopped = false;
+        while (!stopped) {
+            std::vector<owner> owners;
+            std::vector<notification_target> targets;
+            this->targets(targets, owners);
+
+            TSource source(targets);
+            {
+                std::lock_guard<std::mutex> l(this->_lock);
+                if (this->_stopping) {
+                    return;
+                }
+                this->_source = std::addressof(source);
+            }
+
+            try {
+                // Anything might have changed while no source was armed, so
+                // we check the time stamps of all segments before waiting.
+                auto retarget = this->validate();
+                this->publish();
+
+                while (!retarget) {
+                    std::size_t target;
+                    if (!source.wait(target)) {
+                        stopped = true;
+                        break;
+                    }
+
+                    auto& o = owners[target];
+                    switch (o.first) {
+                        case segment_type::registered:
+                            this->rescan_registered();
+                            break;
+
+                        case segment_type::installations:
+                            // The folders to be watched might change, so we
+                            // need a new source afterwards.
+                            this->rescan_installations([](const segment&) { });
+                            retarget = true;
+                            break;
+
+                        case segment_type::installed: {
+                            auto it = this->_installations.find(o.second);
+                            if (it != this->_installations.end()) {
+                                this->_installed[it->first]
+                                    = this->rescan_installed(it->first,
+                                        it->second);
+                            }
+                            } break;
+                    }
+
+                    this->publish();
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> l(this->_lock);
+                this->_source = nullptr;
+                throw;
+            }
+
+            std::lock_guard<std::mutex> l(this->_lock);
+            this->_source = nullptr;
+        }
+    } catch (...) {
+        // The last snapshot remains valid, but it will not be updated anymore,
+        // which the owner must know about.
+        if (this->_on_failed) {
+            try {
+                this->_on_failed(std::current_exception());
+            } catch (...) { /* Nothing we could do about this. */ }
+        }
+    }
+}
+
+
+/*
+ * runtime_monitor<TScanner, TSource>::targets
+ */
+template<class TScanner, class TSource>
+void runtime_monitor<TScanner, TSource>::targets(
+        _Out_ std::vector<notification_target>& targets,
+        _Out_ std::vector<owner>& owners) const {
+    targets.clear();
+    owners.clear();
+
+    // Only the registry keys of the segments are watched. File system sources
+    // of these segments, like the manifests of Windows Mixed Reality in the
+    // system directory, only change when Windows is updated.
+    auto add = [&targets, &owners](const segment& s, const segment_type t) {
+        for (auto& c : s.cache.stamps()) {
+            if (c.type == discovery_cache::source_type::registry) {
+                targets.push_back({ c.type, c.path, walk_options() });
+                owners.emplace_back(t, std::wstring());
+            }
+        }
+    };
+
+    add(this->_registered, segment_type::registered);
+    add(this->_installations_segment, segment_type::installations);
+
+    // The installation folders are watched as a whole rather than each
+    // directory that has been searched, which is what the time stamps in the
+    // segments refer to.
+    for (auto& i : this->_installed) {
+        targets.push_back({ discovery_cache::source_type::file_system,
+            i.first,
+            this->_scanner.get_walk_options(this->_installations.at(i.first))
+        });
+        owners.emplace_back(segment_type::installed, i.first);
+    }
+}
+
+
+/*
+ * runtime_monitor<TScanner, TSource>::validate
+ */
+template<class TScanner, class TSource>
+bool runtime_monitor<TScanner, TSource>::validate(void) {
+    auto retval = false;
+    auto stamper = [this](const discovery_cache::source_type type,
+            const std::wstring& path) {
+        return this->_scanner.stamp(type, path);
+    };
+
+    // Check the installation folders first, which avoids searching folders
+    // that are gone anyway.
+    if (!this->_installations_segment.cache.is_valid(stamper)) {
+        this->rescan_installations([](const segment&) { });
+        retval = true;
+    }
+
+    if (!this->_registered.cache.is_valid(stamper)) {
+        this->rescan_registered();
+    }
+
+    for (auto& i : this->_installed) {
+        if (!i.second.cache.is_valid(stamper)) {
+            i.second = this->rescan_installed(i.first,
+                this->_installations.at(i.first));
+        }
+    }
+
+    return retval;
+}
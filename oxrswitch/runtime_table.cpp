@@ -0,0 +1,180 @@
+﻿// <copyright file="runtime_table.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+#include "runtime_table.h"
+
+#include "util.h"
+
+
+/*
+ * runtime_table::at
+ */
+runtime runtime_table::at(_In_ const size_type index) const {
+    const auto& e = this->_entries.at(index);
+    return runtime(std::wstring(this->view(e.name)),
+        std::wstring(this->view(e.path)),
+        std::wstring(this->view(e.wow_path)));
+}
+
+
+/*
+ * runtime_table::insert
+ */
+std::pair<runtime_table::size_type, bool> runtime_table::insert(
+        _In_ const runtime& runtime) {
+    const std::wstring_view name(runtime.name());
+    const std::wstring_view path(runtime.path());
+
+    // Keep the load factor of the indices below one half, which keeps the
+    // probe sequences short.
+    if (2 * (this->_entries.size() + 1) > this->_paths.size()) {
+        if (this->_entries.size() >= empty_slot / 4) {
+            throw std::length_error("Too many runtimes for a runtime table.");
+        }
+
+        this->grow();
+    }
+
+    auto& p = probe(this->_paths, ::fold_hash(path),
+        [this, path](const size_type i) {
+            const auto other = this->path(i);
+            return (other.size() == path.size())
+                && ::equals_n(other.data(), path.data(), path.size(), false);
+        });
+    if (p != empty_slot) {
+        return std::make_pair(p, false);
+    }
+
+    auto& n = probe(this->_names, std::hash<std::wstring_view>()(name),
+        [this, name](const size_type i) { return (this->name(i) == name); });
+
+    entry e;
+    e.name = (n != empty_slot) ? this->_entries[n].name : this->append(name);
+    e.path = this->append(path);
+    e.wow_path = this->append(runtime.wow_path());
+
+    const auto retval = static_cast<size_type>(this->_entries.size());
+    this->_entries.push_back(e);
+    p = retval;
+    if (n == empty_slot) {
+        n = retval;
+    }
+
+    return std::make_pair(retval, true);
+}
+
+
+/*
+ * runtime_table::memory
+ */
+std::size_t runtime_table::memory(void) const noexcept {
+    return this->_arena.capacity() * sizeof(wchar_t)
+        + this->_entries.capacity() * sizeof(entry)
+        + this->_names.capacity() * sizeof(size_type)
+        + this->_paths.capacity() * sizeof(size_type);
+}
+
+
+/*
+ * runtime_table::less
+ */
+bool runtime_table::less(_In_ const std::wstring_view lhs,
+        _In_ const std::wstring_view rhs) noexcept {
+    const auto cnt = (std::min)(lhs.size(), rhs.size());
+
+    for (std::size_t i = 0; i < cnt; ++i) {
+        const auto l = ::fold_case(lhs[i]);
+        const auto r = ::fold_case(rhs[i]);
+        if (l != r) {
+            return (l < r);
+        }
+    }
+
+    return (lhs.size() < rhs.size());
+}
+
+
+/*
+ * runtime_table::probe
+ */
+template<class TEqual>
+runtime_table::size_type& runtime_table::probe(
+        _In_ std::vector<size_type>& slots,
+        _In_ const std::size_t hash,
+        _In_ TEqual&& equal) noexcept {
+    assert(!slots.empty());
+    const auto mask = slots.size() - 1;
+    assert((slots.size() & mask) == 0);
+
+    for (auto i = hash & mask; ; i = (i + 1) & mask) {
+        auto& retval = slots[i];
+        if ((retval == empty_slot) || equal(retval)) {
+            return retval;
+        }
+    }
+}
+
+
+/*
+ * runtime_table::append
+ */
+runtime_table::string_ref runtime_table::append(
+        _In_ const std::wstring_view str) {
+    if (this->_arena.size() + str.size()
+            > (std::numeric_limits<std::uint32_t>::max)()) {
+        throw std::length_error("The string arena of the runtime table is "
+            "exhausted.");
+    }
+
+    string_ref retval;
+    retval.offset = static_cast<std::uint32_t>(this->_arena.size());
+    retval.length = static_cast<std::uint32_t>(str.size());
+    this->_arena.append(str);
+
+    return retval;
+}
+
+
+/*
+ * runtime_table::grow
+ */
+void runtime_table::grow(void) {
+    const auto cnt = (std::max)(static_cast<std::size_t>(16),
+        2 * this->_paths.size());
+    this->_names.assign(cnt, empty_slot);
+    this->_paths.assign(cnt, empty_slot);
+
+    // All entries are unique by path, and the first entry of each name owns
+    // the name, so we only need to find empty slots.
+    for (size_type i = 0; i < this->size(); ++i) {
+        probe(this->_paths, ::fold_hash(this->path(i)),
+            [](const size_type) { return false; }) = i;
+
+        auto& n = probe(this->_names,
+            std::hash<std::wstring_view>()(this->name(i)),
+            [this, i](const size_type j) {
+                return (this->name(j) == this->name(i));
+            });
+        if (n == empty_slot) {
+            n = i;
+        }
+    }
+}
+
+
+/*
+ * runtime_table::sorted
+ */
+std::vector<runtime_table::size_type> runtime_table::sorted(void) const {
+    std::vector<size_type> retval(this->_entries.size());
+    std::iota(retval.begin(), retval.end(), 0);
+    std::sort(retval.begin(), retval.end(),
+        [this](const size_type l, const size_type r) {
+            return less(this->path(l), this->path(r));
+        });
+    return retval;
+}
@@ -0,0 +1,186 @@
+﻿// <copyright file="runtime_table.h" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#if !defined(_OXRSWITCH_RUNTIME_TABLE_H)
+#define _OXRSWITCH_RUNTIME_TABLE_H
+#pragma once
+
+#include "runtime.h"
+
+
+/// <summary>
+/// A compact collection of unique runtimes, which is used to gather the
+/// results of the discovery.
+/// </summary>
+/// <remarks>
+/// <para>All strings are stored in a single arena and the entries only
+/// reference them by offset and length. The names of runtimes, of which
+/// there are only a few distinct ones, are interned and stored only once.
+/// </para>
+/// <para>Runtimes are identified by the case-folded path of their manifest,
+/// which is consistent with how paths are compared everywhere else.
+/// Duplicates are detected using a flat, open-addressed hash index of the
+/// entries, and the entries are sorted by their paths only once when they
+/// are enumerated.</para>
+/// </remarks>
+class runtime_table final {
+
+public:
+
+    /// <summary>
+    /// The type of indices of the runtimes in the table.
+    /// </summary>
+    typedef std::uint32_t size_type;
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    runtime_table(void) = default;
+
+    /// <summary>
+    /// Materialises the runtime at <paramref name="index" />.
+    /// </summary>
+    /// <param name="index">The index returned by <see cref="insert" />.
+    /// </param>
+    /// <returns></returns>
+    runtime at(_In_ const size_type index) const;
+
+    /// <summary>
+    /// Materialises all runtimes ordered by their paths.
+    /// </summary>
+    /// <typeparam name="TIterator">An output iterator for
+    /// <see cref="runtime" />s.</typeparam>
+    /// <param name="oit"></param>
+    /// <returns><paramref name="oit" /> after the last runtime.</returns>
+    template<class TIterator> TIterator copy(_In_ TIterator oit) const {
+        for (auto i : this->sorted()) {
+            *oit++ = this->at(i);
+        }
+        return oit;
+    }
+
+    /// <summary>
+    /// Adds <paramref name="runtime" /> unless a runtime with the same path
+    /// is already in the table.
+    /// </summary>
+    /// <param name="runtime"></param>
+    /// <returns>The index of the runtime with the path of
+    /// <paramref name="runtime" /> and whether it has been added.</returns>
+    std::pair<size_type, bool> insert(_In_ const runtime& runtime);
+
+    /// <summary>
+    /// Answer the number of bytes allocated by the table.
+    /// </summary>
+    /// <returns></returns>
+    std::size_t memory(void) const noexcept;
+
+    /// <summary>
+    /// Answer the display name of the runtime at <paramref name="index" />.
+    /// </summary>
+    /// <param name="index"></param>
+    /// <returns></returns>
+    inline std::wstring_view name(_In_ const size_type index) const noexcept {
+        return this->view(this->_entries[index].name);
+    }
+
+    /// <summary>
+    /// Answer the path of the runtime at <paramref name="index" />.
+    /// </summary>
+    /// <param name="index"></param>
+    /// <returns></returns>
+    inline std::wstring_view path(_In_ const size_type index) const noexcept {
+        return this->view(this->_entries[index].path);
+    }
+
+    /// <summary>
+    /// Answer the number of runtimes in the table.
+    /// </summary>
+    /// <returns></returns>
+    inline size_type size(void) const noexcept {
+        return static_cast<size_type>(this->_entries.size());
+    }
+
+    /// <summary>
+    /// Answer the WOW64 path of the runtime at <paramref name="index" />,
+    /// which is empty if there is none.
+    /// </summary>
+    /// <param name="index"></param>
+    /// <returns></returns>
+    inline std::wstring_view wow_path(
+            _In_ const size_type index) const noexcept {
+        return this->view(this->_entries[index].wow_path);
+    }
+
+private:
+
+    /// <summary>
+    /// References a string in the arena.
+    /// </summary>
+    struct string_ref final {
+        std::uint32_t offset;
+        std::uint32_t length;
+    };
+
+    /// <summary>
+    /// A runtime in the table.
+    /// </summary>
+    struct entry final {
+        string_ref name;
+        string_ref path;
+        string_ref wow_path;
+    };
+
+    /// <summary>
+    /// Marks an unused slot of a hash index.
+    /// </summary>
+    static constexpr size_type empty_slot
+        = (std::numeric_limits<size_type>::max)();
+
+    /// <summary>
+    /// Compares the case-folded strings <paramref name="lhs" /> and
+    /// <paramref name="rhs" /> lexicographically.
+    /// </summary>
+    static bool less(_In_ const std::wstring_view lhs,
+        _In_ const std::wstring_view rhs) noexcept;
+
+    /// <summary>
+    /// Finds the slot of the entry for which <paramref name="equal" /> holds
+    /// or the empty slot where it should be inserted using linear probing.
+    /// </summary>
+    template<class TEqual>
+    static size_type& probe(_In_ std::vector<size_type>& slots,
+        _In_ const std::size_t hash,
+        _In_ TEqual&& equal) noexcept;
+
+    /// <summary>
+    /// Appends <paramref name="str" /> to the arena.
+    /// </summary>
+    string_ref append(_In_ const std::wstring_view str);
+
+    /// <summary>
+    /// Doubles the size of the hash indices and reinserts all entries.
+    /// </summary>
+    void grow(void);
+
+    /// <summary>
+    /// Gets the indices of all entries ordered by their paths.
+    /// </summary>
+    std::vector<size_type> sorted(void) const;
+
+    /// <summary>
+    /// Gets a view of the string <paramref name="ref" /> in the arena.
+    /// </summary>
+    inline std::wstring_view view(_In_ const string_ref ref) const noexcept {
+        return std::wstring_view(this->_arena.data() + ref.offset, ref.length);
+    }
+
+    std::wstring _arena;
+    std::vector<entry> _entries;
+    std::vector<size_type> _names;
+    std::vector<size_type> _paths;
+};
+
+#endif /* !defined(_OXRSWITCH_RUNTIME_TABLE_H) */
@@ -8,6 +8,141 @@
 #include "util.h"
 
 
+#if defined(_M_IX86) || defined(_M_X64)
+/// <summary>
+/// Folds the case of the ASCII letters in <paramref name="v" />, which holds
+/// eight UTF-16 code units.
+/// </summary>
+static inline __m128i fold_ascii(_In_ const __m128i v) noexcept {
+    const auto upper = _mm_and_si128(
+        _mm_cmpgt_epi16(v, _mm_set1_epi16(L'A' - 1)),
+        _mm_cmplt_epi16(v, _mm_set1_epi16(L'Z' + 1)));
+    return _mm_add_epi16(v, _mm_and_si128(upper, _mm_set1_epi16(0x20)));
+}
+
+
+/// <summary>
+/// Computes a mask of the code units in <paramref name="v" /> that are not
+/// ASCII, which have two bits set in the result of
+/// <c>_mm_movemask_epi8</c>.
+/// </summary>
+static inline __m128i non_ascii(_In_ const __m128i v) noexcept {
+    const auto high = _mm_and_si128(v, _mm_set1_epi16(
+        static_cast<short>(0xFF80)));
+    return _mm_xor_si128(_mm_cmpeq_epi16(high, _mm_setzero_si128()),
+        _mm_set1_epi16(-1));
+}
+#endif /* defined(_M_IX86) || defined(_M_X64) */
+
+
+/// <summary>
+/// A run of characters whose lowercase counterparts are at the same
+/// distance. Runs with a stride of two hold alternating uppercase and
+/// lowercase letters, of which only the uppercase ones are in the run.
+/// </summary>
+struct fold_range {
+    std::uint16_t first;
+    std::uint16_t last;
+    std::uint16_t stride;
+    std::int32_t delta;
+};
+
+
+/// <summary>
+/// The simple lowercase mappings of the Unicode character database (version
+/// 14.0) for the basic multilingual plane beyond ASCII, sorted by the first
+/// character of the run.
+/// </summary>
+static constexpr fold_range fold_ranges[] = {
+    { 0x00C0, 0x00D6, 1, 32 }, { 0x00D8, 0x00DE, 1, 32 },
+    { 0x0100, 0x012E, 2, 1 }, { 0x0130, 0x0130, 1, -199 },
+    { 0x0132, 0x0136, 2, 1 }, { 0x0139, 0x0147, 2, 1 },
+    { 0x014A, 0x0176, 2, 1 }, { 0x0178, 0x0178, 1, -121 },
+    { 0x0179, 0x017D, 2, 1 }, { 0x0181, 0x0181, 1, 210 },
+    { 0x0182, 0x0184, 2, 1 }, { 0x0186, 0x0186, 1, 206 },
+    { 0x0187, 0x0187, 1, 1 }, { 0x0189, 0x018A, 1, 205 },
+    { 0x018B, 0x018B, 1, 1 }, { 0x018E, 0x018E, 1, 79 },
+    { 0x018F, 0x018F, 1, 202 }, { 0x0190, 0x0190, 1, 203 },
+    { 0x0191, 0x0191, 1, 1 }, { 0x0193, 0x0193, 1, 205 },
+    { 0x0194, 0x0194, 1, 207 }, { 0x0196, 0x0196, 1, 211 },
+    { 0x0197, 0x0197, 1, 209 }, { 0x0198, 0x0198, 1, 1 },
+    { 0x019C, 0x019C, 1, 211 }, { 0x019D, 0x019D, 1, 213 },
+    { 0x019F, 0x019F, 1, 214 }, { 0x01A0, 0x01A4, 2, 1 },
+    { 0x01A6, 0x01A6, 1, 218 }, { 0x01A7, 0x01A7, 1, 1 },
+    { 0x01A9, 0x01A9, 1, 218 }, { 0x01AC, 0x01AC, 1, 1 },
+    { 0x01AE, 0x01AE, 1, 218 }, { 0x01AF, 0x01AF, 1, 1 },
+    { 0x01B1, 0x01B2, 1, 217 }, { 0x01B3, 0x01B5, 2, 1 },
+    { 0x01B7, 0x01B7, 1, 219 }, { 0x01B8, 0x01B8, 1, 1 },
+    { 0x01BC, 0x01BC, 1, 1 }, { 0x01C4, 0x01C4, 1, 2 },
+    { 0x01C5, 0x01C5, 1, 1 }, { 0x01C7, 0x01C7, 1, 2 },
+    { 0x01C8, 0x01C8, 1, 1 }, { 0x01CA, 0x01CA, 1, 2 },
+    { 0x01CB, 0x01DB, 2, 1 }, { 0x01DE, 0x01EE, 2, 1 },
+    { 0x01F1, 0x01F1, 1, 2 }, { 0x01F2, 0x01F4, 2, 1 },
+    { 0x01F6, 0x01F6, 1, -97 }, { 0x01F7, 0x01F7, 1, -56 },
+    { 0x01F8, 0x021E, 2, 1 }, { 0x0220, 0x0220, 1, -130 },
+    { 0x0222, 0x0232, 2, 1 }, { 0x023A, 0x023A, 1, 10795 },
+    { 0x023B, 0x023B, 1, 1 }, { 0x023D, 0x023D, 1, -163 },
+    { 0x023E, 0x023E, 1, 10792 }, { 0x0241, 0x0241, 1, 1 },
+    { 0x0243, 0x0243, 1, -195 }, { 0x0244, 0x0244, 1, 69 },
+    { 0x0245, 0x0245, 1, 71 }, { 0x0246, 0x024E, 2, 1 },
+    { 0x0370, 0x0372, 2, 1 }, { 0x0376, 0x0376, 1, 1 },
+    { 0x037F, 0x037F, 1, 116 }, { 0x0386, 0x0386, 1, 38 },
+    { 0x0388, 0x038A, 1, 37 }, { 0x038C, 0x038C, 1, 64 },
+    { 0x038E, 0x038F, 1, 63 }, { 0x0391, 0x03A1, 1, 32 },
+    { 0x03A3, 0x03AB, 1, 32 }, { 0x03CF, 0x03CF, 1, 8 },
+    { 0x03D8, 0x03EE, 2, 1 }, { 0x03F4, 0x03F4, 1, -60 },
+    { 0x03F7, 0x03F7, 1, 1 }, { 0x03F9, 0x03F9, 1, -7 },
+    { 0x03FA, 0x03FA, 1, 1 }, { 0x03FD, 0x03FF, 1, -130 },
+    { 0x0400, 0x040F, 1, 80 }, { 0x0410, 0x042F, 1, 32 },
+    { 0x0460, 0x0480, 2, 1 }, { 0x048A, 0x04BE, 2, 1 },
+    { 0x04C0, 0x04C0, 1, 15 }, { 0x04C1, 0x04CD, 2, 1 },
+    { 0x04D0, 0x052E, 2, 1 }, { 0x0531, 0x0556, 1, 48 },
+    { 0x10A0, 0x10C5, 1, 7264 }, { 0x10C7, 0x10C7, 1, 7264 },
+    { 0x10CD, 0x10CD, 1, 7264 }, { 0x13A0, 0x13EF, 1, 38864 },
+    { 0x13F0, 0x13F5, 1, 8 }, { 0x1C90, 0x1CBA, 1, -3008 },
+    { 0x1CBD, 0x1CBF, 1, -3008 }, { 0x1E00, 0x1E94, 2, 1 },
+    { 0x1E9E, 0x1E9E, 1, -7615 }, { 0x1EA0, 0x1EFE, 2, 1 },
+    { 0x1F08, 0x1F0F, 1, -8 }, { 0x1F18, 0x1F1D, 1, -8 },
+    { 0x1F28, 0x1F2F, 1, -8 }, { 0x1F38, 0x1F3F, 1, -8 },
+    { 0x1F48, 0x1F4D, 1, -8 }, { 0x1F59, 0x1F5F, 2, -8 },
+    { 0x1F68, 0x1F6F, 1, -8 }, { 0x1F88, 0x1F8F, 1, -8 },
+    { 0x1F98, 0x1F9F, 1, -8 }, { 0x1FA8, 0x1FAF, 1, -8 },
+    { 0x1FB8, 0x1FB9, 1, -8 }, { 0x1FBA, 0x1FBB, 1, -74 },
+    { 0x1FBC, 0x1FBC, 1, -9 }, { 0x1FC8, 0x1FCB, 1, -86 },
+    { 0x1FCC, 0x1FCC, 1, -9 }, { 0x1FD8, 0x1FD9, 1, -8 },
+    { 0x1FDA, 0x1FDB, 1, -100 }, { 0x1FE8, 0x1FE9, 1, -8 },
+    { 0x1FEA, 0x1FEB, 1, -112 }, { 0x1FEC, 0x1FEC, 1, -7 },
+    { 0x1FF8, 0x1FF9, 1, -128 }, { 0x1FFA, 0x1FFB, 1, -126 },
+    { 0x1FFC, 0x1FFC, 1, -9 }, { 0x2126, 0x2126, 1, -7517 },
+    { 0x212A, 0x212A, 1, -8383 }, { 0x212B, 0x212B, 1, -8262 },
+    { 0x2132, 0x2132, 1, 28 }, { 0x2160, 0x216F, 1, 16 },
+    { 0x2183, 0x2183, 1, 1 }, { 0x24B6, 0x24CF, 1, 26 },
+    { 0x2C00, 0x2C2F, 1, 48 }, { 0x2C60, 0x2C60, 1, 1 },
+    { 0x2C62, 0x2C62, 1, -10743 }, { 0x2C63, 0x2C63, 1, -3814 },
+    { 0x2C64, 0x2C64, 1, -10727 }, { 0x2C67, 0x2C6B, 2, 1 },
+    { 0x2C6D, 0x2C6D, 1, -10780 }, { 0x2C6E, 0x2C6E, 1, -10749 },
+    { 0x2C6F, 0x2C6F, 1, -10783 }, { 0x2C70, 0x2C70, 1, -10782 },
+    { 0x2C72, 0x2C72, 1, 1 }, { 0x2C75, 0x2C75, 1, 1 },
+    { 0x2C7E, 0x2C7F, 1, -10815 }, { 0x2C80, 0x2CE2, 2, 1 },
+    { 0x2CEB, 0x2CED, 2, 1 }, { 0x2CF2, 0x2CF2, 1, 1 },
+    { 0xA640, 0xA66C, 2, 1 }, { 0xA680, 0xA69A, 2, 1 },
+    { 0xA722, 0xA72E, 2, 1 }, { 0xA732, 0xA76E, 2, 1 },
+    { 0xA779, 0xA77B, 2, 1 }, { 0xA77D, 0xA77D, 1, -35332 },
+    { 0xA77E, 0xA786, 2, 1 }, { 0xA78B, 0xA78B, 1, 1 },
+    { 0xA78D, 0xA78D, 1, -42280 }, { 0xA790, 0xA792, 2, 1 },
+    { 0xA796, 0xA7A8, 2, 1 }, { 0xA7AA, 0xA7AA, 1, -42308 },
+    { 0xA7AB, 0xA7AB, 1, -42319 }, { 0xA7AC, 0xA7AC, 1, -42315 },
+    { 0xA7AD, 0xA7AD, 1, -42305 }, { 0xA7AE, 0xA7AE, 1, -42308 },
+    { 0xA7B0, 0xA7B0, 1, -42258 }, { 0xA7B1, 0xA7B1, 1, -42282 },
+    { 0xA7B2, 0xA7B2, 1, -42261 }, { 0xA7B3, 0xA7B3, 1, 928 },
+    { 0xA7B4, 0xA7C2, 2, 1 }, { 0xA7C4, 0xA7C4, 1, -48 },
+    { 0xA7C5, 0xA7C5, 1, -42307 }, { 0xA7C6, 0xA7C6, 1, -35384 },
+    { 0xA7C7, 0xA7C9, 2, 1 }, { 0xA7D0, 0xA7D0, 1, 1 },
+    { 0xA7D6, 0xA7D8, 2, 1 }, { 0xA7F5, 0xA7F5, 1, 1 },
+    { 0xFF21, 0xFF3A, 1, 32 }
+};
+
+
 /*
  * ::combine_path
  */
@@ -19,10 +154,16 @@ std::wstring combine_path(_In_ const std::wstring& left,
         return right;
     }
 
-    if ((left.back() == L'\\') || (left.back() == L'/')) {
+#if defined(_WIN32)
+    constexpr auto separator = L'\\';
+#else /* defined(_WIN32) */
+    constexpr auto separator = L'/';
+#endif /* defined(_WIN32) */
+
+    if (::is_directory_separator(left.back())) {
         return std::wstring(left) + right;
     } else {
-        return (left + L'\\') + right;
+        return (left + separator) + right;
     }
 }
 
@@ -52,17 +193,43 @@ bool contains(_In_opt_z_ const wchar_t *haystack,
     }
 
     // Search on our own.
+    const auto haystack_len = ::wcslen(haystack);
     const auto needle_len = ::wcslen(needle);
-    for (auto h = haystack; *h; ++h) {
-        std::size_t i = 0;
-        for (; i < needle_len; ++i) {
-            if (std::tolower(h[i]) != std::tolower(needle[i])) {
-                break;
-            }
-            if (i + 1 == needle_len) {
-                return true;
+    if (needle_len > haystack_len) {
+        return false;
+    }
+
+    const auto first = ::fold_case(*needle);
+    const auto last = haystack + (haystack_len - needle_len);
+    for (auto h = haystack; h <= last; ++h) {
+#if defined(_M_IX86) || defined(_M_X64)
+        // Skip blocks that cannot contain the start of the needle. Characters
+        // other than ASCII might fold to the first character, so we need to
+        // check them one by one.
+        if (first < 128) {
+            const auto f = _mm_set1_epi16(static_cast<short>(first));
+            while (last - h >= 8) {
+                const auto v = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i *>(h));
+                const auto m = _mm_movemask_epi8(_mm_or_si128(
+                    _mm_cmpeq_epi16(fold_ascii(v), f),
+                    non_ascii(v)));
+                if (m != 0) {
+                    unsigned long i;
+                    _BitScanForward(&i, static_cast<unsigned long>(m));
+                    h += i / 2;
+                    break;
+                }
+
+                h += 8;
             }
         }
+#endif /* defined(_M_IX86) || defined(_M_X64) */
+
+        if ((::fold_case(*h) == first)
+                && ::equals_n(h, needle, needle_len, false)) {
+            return true;
+        }
     }
 
     return false;
@@ -75,11 +242,19 @@ bool contains(_In_opt_z_ const wchar_t *haystack,
 bool directory_exists(_In_opt_z_ const wchar_t *path) noexcept {
     if (path == nullptr) {
         return false;
-    } else {
-        const auto attr = ::GetFileAttributesW(path);
-        return ((attr != INVALID_FILE_ATTRIBUTES) 
-            && ((attr & FILE_ATTRIBUTE_DIRECTORY) != 0));
     }
+
+#if defined(_WIN32)
+    const auto attr = ::GetFileAttributesW(path);
+    return ((attr != INVALID_FILE_ATTRIBUTES) 
+        && ((attr & FILE_ATTRIBUTE_DIRECTORY) != 0));
+#else /* defined(_WIN32) */
+    try {
+        return ::directory_exists(::to_utf8(path).c_str());
+    } catch (...) {
+        return false;
+    }
+#endif /* defined(_WIN32) */
 }
 
 /*
@@ -88,11 +263,16 @@ bool directory_exists(_In_opt_z_ const wchar_t *path) noexcept {
 bool directory_exists(_In_opt_z_ const char *path) noexcept {
     if (path == nullptr) {
         return false;
-    } else {
-        const auto attr = ::GetFileAttributesA(path);
-        return ((attr != INVALID_FILE_ATTRIBUTES) 
-            && ((attr & FILE_ATTRIBUTE_DIRECTORY) != 0));
     }
+
+#if defined(_WIN32)
+    const auto attr = ::GetFileAttributesA(path);
+    return ((attr != INVALID_FILE_ATTRIBUTES) 
+        && ((attr & FILE_ATTRIBUTE_DIRECTORY) != 0));
+#else /* defined(_WIN32) */
+    struct stat s;
+    return ((::stat(path, &s) == 0) && S_ISDIR(s.st_mode));
+#endif /* defined(_WIN32) */
 }
 
 
@@ -111,9 +291,12 @@ bool equals(_In_opt_z_ const wchar_t *lhs,
         return false;
     }
 
-    return case_sensitive
-        ? (::wcscmp(lhs, rhs) == 0)
-        : (::_wcsicmp(lhs, rhs) == 0);
+    if (case_sensitive) {
+        return (::wcscmp(lhs, rhs) == 0);
+    }
+
+    const auto len = ::wcslen(lhs);
+    return (len == ::wcslen(rhs)) && ::equals_n(lhs, rhs, len, false);
 }
 
 
@@ -132,12 +315,94 @@ bool equals(_In_opt_z_ const char *lhs,
         return false;
     }
 
+#if defined(_WIN32)
     return case_sensitive
         ? (::strcmp(lhs, rhs) == 0)
         : (::_stricmp(lhs, rhs) == 0);
+#else /* defined(_WIN32) */
+    return case_sensitive
+        ? (::strcmp(lhs, rhs) == 0)
+        : (::strcasecmp(lhs, rhs) == 0);
+#endif /* defined(_WIN32) */
 }
 
 
+/*
+ * ::equals_n
+ */
+bool equals_n(_In_reads_(cnt) const wchar_t *lhs,
+        _In_reads_(cnt) const wchar_t *rhs,
+        _In_ const std::size_t cnt,
+        _In_ const bool case_sensitive) noexcept {
+    if (case_sensitive) {
+        return (std::wmemcmp(lhs, rhs, cnt) == 0);
+    }
+
+    std::size_t i = 0;
+
+#if defined(_M_IX86) || defined(_M_X64)
+    for (; cnt - i >= 8; i += 8) {
+        const auto l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(
+            lhs + i));
+        const auto r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(
+            rhs + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(l, r)) == 0xFFFF) {
+            // Identical blocks are equal regardless of their case.
+            continue;
+        }
+
+        if (_mm_movemask_epi8(_mm_or_si128(non_ascii(l), non_ascii(r))) != 0) {
+            // The block contains characters we cannot fold in the register.
+            for (std::size_t j = i; j < i + 8; ++j) {
+                if (::fold_case(lhs[j]) != ::fold_case(rhs[j])) {
+                    return false;
+                }
+            }
+            continue;
+        }
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(fold_ascii(l), fold_ascii(r)))
+                != 0xFFFF) {
+            return false;
+        }
+    }
+#endif /* defined(_M_IX86) || defined(_M_X64) */
+
+    for (; i < cnt; ++i) {
+        if ((lhs[i] != rhs[i])
+                && (::fold_case(lhs[i]) != ::fold_case(rhs[i]))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/*
+ * ::equals_n
+ */
+bool equals_n(_In_reads_(cnt) const char *lhs,
+        _In_reads_(cnt) const char *rhs,
+        _In_ const std::size_t cnt,
+        _In_ const bool case_sensitive) noexcept {
+    if (case_sensitive) {
+        return (std::memcmp(lhs, rhs, cnt) == 0);
+    }
+
+    for (std::size_t i = 0; i < cnt; ++i) {
+        const auto l = static_cast<unsigned char>(lhs[i]);
+        const auto r = static_cast<unsigned char>(rhs[i]);
+        if ((l != r) && (std::tolower(l) != std::tolower(r))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+#if defined(_WIN32)
 /*
  * ::expand_environment_variables
  */
@@ -161,6 +426,7 @@ std::wstring expand_environment_variables(_In_z_ const wchar_t *str) {
         retval.resize(cnt);
     }
 }
+#endif /* defined(_WIN32) */
 
 
 /*
@@ -169,11 +435,19 @@ std::wstring expand_environment_variables(_In_z_ const wchar_t *str) {
 bool file_exists(_In_opt_z_ const wchar_t *path) noexcept {
     if (path == nullptr) {
         return false;
-    } else {
-        const auto attr = ::GetFileAttributesW(path);
-        return ((attr != INVALID_FILE_ATTRIBUTES)
-            && ((attr & FILE_ATTRIBUTE_DIRECTORY) == 0));
     }
+
+#if defined(_WIN32)
+    const auto attr = ::GetFileAttributesW(path);
+    return ((attr != INVALID_FILE_ATTRIBUTES)
+        && ((attr & FILE_ATTRIBUTE_DIRECTORY) == 0));
+#else /* defined(_WIN32) */
+    try {
+        return ::file_exists(::to_utf8(path).c_str());
+    } catch (...) {
+        return false;
+    }
+#endif /* defined(_WIN32) */
 }
 
 
@@ -183,14 +457,178 @@ bool file_exists(_In_opt_z_ const wchar_t *path) noexcept {
 bool file_exists(_In_opt_z_ const char *path) noexcept {
     if (path == nullptr) {
         return false;
-    } else {
-        const auto attr = ::GetFileAttributesA(path);
-        return ((attr != INVALID_FILE_ATTRIBUTES)
-            && ((attr & FILE_ATTRIBUTE_DIRECTORY) == 0));
     }
+
+#if defined(_WIN32)
+    const auto attr = ::GetFileAttributesA(path);
+    return ((attr != INVALID_FILE_ATTRIBUTES)
+        && ((attr & FILE_ATTRIBUTE_DIRECTORY) == 0));
+#else /* defined(_WIN32) */
+    struct stat s;
+    return ((::stat(path, &s) == 0) && !S_ISDIR(s.st_mode));
+#endif /* defined(_WIN32) */
+}
+
+
+/*
+ * ::fold_case_unicode
+ */
+wchar_t fold_case_unicode(_In_ const wchar_t c) noexcept {
+    const auto cp = static_cast<std::uint32_t>(c);
+    const auto end = std::end(fold_ranges);
+    auto it = std::upper_bound(std::begin(fold_ranges), end, cp,
+        [](const std::uint32_t c, const fold_range& r) {
+            return (c < r.first);
+        });
+    if (it == std::begin(fold_ranges)) {
+        return c;
+    }
+
+    --it;
+    if ((cp > it->last) || (((cp - it->first) % it->stride) != 0)) {
+        return c;
+    }
+
+    return static_cast<wchar_t>(static_cast<std::int32_t>(cp) + it->delta);
+}
+
+
+/*
+ * ::fold_hash
+ */
+std::size_t fold_hash(_In_ const std::wstring_view str) noexcept {
+    // FNV-1a over the folded characters, which is cheap enough to be computed
+    // for every path and does not require a folded copy of the string.
+    auto retval = static_cast<std::size_t>(14695981039346656037ull);
+    for (auto c : str) {
+        retval ^= static_cast<std::size_t>(::fold_case(c));
+        retval *= static_cast<std::size_t>(1099511628211ull);
+    }
+    return retval;
+}
+
+
+/*
+ * ::from_utf8
+ */
+std::wstring from_utf8(_In_ const std::string& str) {
+    // Each byte of the input yields at most one code unit of the output,
+    // so we can allocate the output once and shrink it at the end.
+    std::wstring retval(str.size(), L'\0');
+    auto src = reinterpret_cast<const std::uint8_t *>(str.data());
+    const auto end = src + str.size();
+    auto dst = retval.data();
+
+    while (src < end) {
+#if defined(_M_IX86) || defined(_M_X64)
+        // Widen blocks of ASCII characters by interleaving them with zeros.
+        while (end - src >= 16) {
+            const auto v = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(src));
+            if (_mm_movemask_epi8(v) != 0) {
+                break;
+            }
+
+            const auto zero = _mm_setzero_si128();
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst),
+                _mm_unpacklo_epi8(v, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 8),
+                _mm_unpackhi_epi8(v, zero));
+            src += 16;
+            dst += 16;
+        }
+#endif /* defined(_M_IX86) || defined(_M_X64) */
+
+        if (src == end) {
+            break;
+        }
+
+        const auto lead = *src++;
+        if (lead < 0x80) {
+            *dst++ = static_cast<wchar_t>(lead);
+            continue;
+        }
+
+        // Determine the length of the sequence and the range of the second
+        // byte, which rejects overlong encodings, surrogates and code points
+        // beyond U+10FFFF in one go.
+        std::size_t cnt = 0;
+        std::uint32_t cp = 0;
+        std::uint8_t lo = 0x80, hi = 0xBF;
+        if ((lead >= 0xC2) && (lead <= 0xDF)) {
+            cnt = 1;
+            cp = lead & 0x1F;
+        } else if ((lead >= 0xE0) && (lead <= 0xEF)) {
+            cnt = 2;
+            cp = lead & 0x0F;
+            if (lead == 0xE0) {
+                lo = 0xA0;
+            } else if (lead == 0xED) {
+                hi = 0x9F;
+            }
+        } else if ((lead >= 0xF0) && (lead <= 0xF4)) {
+            cnt = 3;
+            cp = lead & 0x07;
+            if (lead == 0xF0) {
+                lo = 0x90;
+            } else if (lead == 0xF4) {
+                hi = 0x8F;
+            }
+        } else {
+            THROW_WIN32(ERROR_NO_UNICODE_TRANSLATION);
+        }
+
+        if (static_cast<std::size_t>(end - src) < cnt) {
+            THROW_WIN32(ERROR_NO_UNICODE_TRANSLATION);
+        }
+
+        for (std::size_t i = 0; i < cnt; ++i) {
+            const auto c = *src++;
+            if ((i == 0) ? ((c < lo) || (c > hi)) : ((c & 0xC0) != 0x80)) {
+                THROW_WIN32(ERROR_NO_UNICODE_TRANSLATION);
+            }
+            cp = (cp << 6) | (c & 0x3F);
+        }
+
+        if ((sizeof(wchar_t) == 2) && (cp >= 0x10000)) {
+            cp -= 0x10000;
+            *dst++ = static_cast<wchar_t>(0xD800 + (cp >> 10));
+            *dst++ = static_cast<wchar_t>(0xDC00 + (cp & 0x3FF));
+        } else {
+            *dst++ = static_cast<wchar_t>(cp);
+        }
+    }
+
+    retval.resize(dst - retval.data());
+    return retval;
 }
 
 
+/*
+ * ::get_directory
+ */
+std::wstring_view get_directory(_In_ const std::wstring& path) noexcept {
+    const auto it = std::find_if(path.rbegin(), path.rend(),
+        [](const wchar_t c) { return ::is_directory_separator(c); });
+    return std::wstring_view(path.data(), std::distance(it, path.rend()));
+}
+
+
+#if !defined(_WIN32)
+/*
+ * ::get_environment_variable
+ */
+std::wstring get_environment_variable(_In_z_ const char *name,
+        _In_ const std::wstring& fallback) {
+    auto retval = ::getenv(name);
+    return ((retval != nullptr) && (*retval != 0))
+        ? ::from_utf8(retval)
+        : fallback;
+}
+#endif /* !defined(_WIN32) */
+
+
+#if defined(_WIN32)
 /*
  * ::get_module_path
  */
@@ -228,6 +666,7 @@ bool is_elevated(void) {
 
     return (info.TokenIsElevated != FALSE);
 }
+#endif /* defined(_WIN32) */
 
 
 /*
@@ -235,22 +674,19 @@ bool is_elevated(void) {
  */
 bool is_same_directory(_In_ const std::wstring& lhs,
         _In_ const std::wstring& rhs) noexcept {
-    const auto l = std::find_if(lhs.rbegin(), lhs.rend(),
-        [](const wchar_t c) { return ::is_directory_separator(c); });
-    const auto r = std::find_if(rhs.rbegin(), rhs.rend(),
-        [](const wchar_t c) { return ::is_directory_separator(c); });
-    return std::equal(lhs.begin(), l.base(),
-        rhs.begin(), r.base(),
-        [](const wchar_t l, const wchar_t r) {
+    const auto l = ::get_directory(lhs);
+    const auto r = ::get_directory(rhs);
 #if defined(_WIN32)
-            return (std::tolower(l) == std::tolower(r));
+    constexpr auto case_sensitive = false;
 #else /* defined(_WIN32) */
-            return (l == r);
+    constexpr auto case_sensitive = true;
 #endif /* defined(_WIN32) */
-        });
+    return (l.size() == r.size())
+        && ::equals_n(l.data(), r.data(), l.size(), case_sensitive);
 }
 
 
+#if defined(_WIN32)
 /*
  * ::load_string
  */
@@ -258,20 +694,7 @@ std::string load_string(_In_opt_ const HINSTANCE instance, _In_ const UINT id) {
     // Note: As we are building with UNICODE, we cannot obtain the read-only
     // pointer to the actual resource here, but we must retrieve it and convert
     // the result.
-    auto resource = ::load_wstring(instance, id);
-
-    std::size_t cnt = 0;
-    ::wcstombs_s(&cnt,
-        nullptr, 0,
-        resource.c_str(), resource.size() * sizeof(wchar_t));
-    std::string retval(cnt, L'\0');
-
-    ::wcstombs_s(&cnt,
-        retval.data(), retval.size(),
-        resource.c_str(), resource.size() * sizeof(wchar_t));
-    retval.resize(cnt);
-
-    return retval;
+    return ::to_utf8(::load_wstring(instance, id));
 }
 
 
@@ -286,3 +709,85 @@ std::wstring load_wstring(_In_opt_ const HINSTANCE instance,
     THROW_LAST_ERROR_IF(len == 0);
     return std::wstring(str, len);
 }
+#endif /* defined(_WIN32) */
+
+
+/*
+ * ::to_utf8
+ */
+std::string to_utf8(_In_ const std::wstring& str) {
+    // A UTF-16 code unit yields at most three bytes (surrogate pairs yield
+    // four bytes for two units) and a UTF-32 one at most four bytes, so we
+    // can allocate the output once.
+    constexpr std::size_t max_bytes = (sizeof(wchar_t) == 2) ? 3 : 4;
+    std::string retval(max_bytes * str.size(), '\0');
+    auto src = str.data();
+    const auto end = src + str.size();
+    auto dst = reinterpret_cast<std::uint8_t *>(retval.data());
+
+    while (src < end) {
+#if defined(_M_IX86) || defined(_M_X64)
+        // Narrow blocks of ASCII characters. Saturating to unsigned bytes
+        // keeps ASCII intact and maps everything else to a byte with the
+        // top bit set, which the mask detects.
+        while (end - src >= 8) {
+            const auto v = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(src));
+            const auto n = _mm_packus_epi16(v, v);
+            if (((_mm_movemask_epi8(n) & 0xFF) != 0)
+                    || (_mm_movemask_epi8(_mm_cmplt_epi16(v,
+                        _mm_setzero_si128())) != 0)) {
+                break;
+            }
+
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(dst), n);
+            src += 8;
+            dst += 8;
+        }
+#endif /* defined(_M_IX86) || defined(_M_X64) */
+
+        if (src == end) {
+            break;
+        }
+
+        auto cp = static_cast<std::uint32_t>(*src++);
+        if ((cp >= 0xD800) && (cp <= 0xDFFF)) {
+            // Only a high surrogate followed by a low one is valid, and only
+            // if the string is UTF-16.
+            const auto lo = ((sizeof(wchar_t) == 2) && (src < end))
+                ? static_cast<std::uint32_t>(*src)
+                : 0;
+            if ((cp > 0xDBFF) || (lo < 0xDC00) || (lo > 0xDFFF)) {
+                THROW_WIN32(ERROR_NO_UNICODE_TRANSLATION);
+            }
+
+            ++src;
+            cp = 0x10000 + (((cp - 0xD800) << 10) | (lo - 0xDC00));
+        }
+
+        if (cp < 0x80) {
+            *dst++ = static_cast<std::uint8_t>(cp);
+
+        } else if (cp < 0x800) {
+            *dst++ = static_cast<std::uint8_t>(0xC0 | (cp >> 6));
+            *dst++ = static_cast<std::uint8_t>(0x80 | (cp & 0x3F));
+
+        } else if (cp < 0x10000) {
+            *dst++ = static_cast<std::uint8_t>(0xE0 | (cp >> 12));
+            *dst++ = static_cast<std::uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+            *dst++ = static_cast<std::uint8_t>(0x80 | (cp & 0x3F));
+
+        } else if (cp <= 0x10FFFF) {
+            *dst++ = static_cast<std::uint8_t>(0xF0 | (cp >> 18));
+            *dst++ = static_cast<std::uint8_t>(0x80 | ((cp >> 12) & 0x3F));
+            *dst++ = static_cast<std::uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+            *dst++ = static_cast<std::uint8_t>(0x80 | (cp & 0x3F));
+
+        } else {
+            THROW_WIN32(ERROR_NO_UNICODE_TRANSLATION);
+        }
+    }
+
+    retval.resize(dst - reinterpret_cast<std::uint8_t *>(retval.data()));
+    return retval;
+}
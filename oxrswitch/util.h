@@ -82,6 +82,40 @@ bool directory_exists(
     return ::directory_exists(path.c_str());
 }
 
+/// <summary>
+/// Answer whether the first <paramref name="cnt" /> characters of
+/// <paramref name="lhs" /> and <paramref name="rhs" /> are equal.
+/// </summary>
+/// <remarks>
+/// This is the kernel of all other string comparisons. If the comparison is
+/// case-insensitive, blocks of ASCII characters are folded and compared in
+/// SIMD registers, and only blocks containing other characters are folded
+/// one by one using <see cref="fold_case" />.
+/// </remarks>
+/// <param name="lhs"></param>
+/// <param name="rhs"></param>
+/// <param name="cnt"></param>
+/// <param name="case_sensitive"></param>
+/// <returns></returns>
+bool equals_n(_In_reads_(cnt) const wchar_t *lhs,
+    _In_reads_(cnt) const wchar_t *rhs,
+    _In_ const std::size_t cnt,
+    _In_ const bool case_sensitive = true) noexcept;
+
+/// <summary>
+/// Answer whether the first <paramref name="cnt" /> characters of
+/// <paramref name="lhs" /> and <paramref name="rhs" /> are equal.
+/// </summary>
+/// <param name="lhs"></param>
+/// <param name="rhs"></param>
+/// <param name="cnt"></param>
+/// <param name="case_sensitive"></param>
+/// <returns></returns>
+bool equals_n(_In_reads_(cnt) const char *lhs,
+    _In_reads_(cnt) const char *rhs,
+    _In_ const std::size_t cnt,
+    _In_ const bool case_sensitive = true) noexcept;
+
 /// <summary>
 /// Answer whether <paramref name="lhs" /> ends with <paramref name="rhs" />.
 /// </summary>
@@ -90,6 +124,7 @@ bool directory_exists(
 /// <typeparam name="TAlloc"></typeparam>
 /// <param name="lhs"></param>
 /// <param name="rhs"></param>
+/// <param name="case_sensitive"></param>
 /// <returns></returns>
 template<class TChar, class TTraits, class TAlloc>
 inline bool ends_with(_In_ const std::basic_string<TChar, TTraits, TAlloc>& lhs,
@@ -97,7 +132,7 @@ inline bool ends_with(_In_ const std::basic_string<TChar, TTraits, TAlloc>& lhs,
         _In_ const bool case_sensitive = true) noexcept {
     const auto len = (rhs != nullptr) ? TTraits::length(rhs) : 0;
     return (lhs.size() >= len)
-        && std::equal(lhs.begin() + lhs.size() - len, lhs.end(), rhs);
+        && ::equals_n(lhs.data() + lhs.size() - len, rhs, len, case_sensitive);
 }
 
 /// <summary>
@@ -181,12 +216,14 @@ inline bool equals(_In_opt_z_ const TChar *lhs,
     return ::equals(lhs, rhs.c_str(), case_sensitive);
 }
 
+#if defined(_WIN32)
 /// <summary>
 /// Expands all environment variables in the given string.
 /// </summary>
 /// <param name="str"></param>
 /// <returns></returns>
 std::wstring expand_environment_variables(_In_z_ const wchar_t *str);
+#endif /* defined(_WIN32) */
 
 /// <summary>
 /// Answer whether the <paramref name="path" /> designates an existing
@@ -222,12 +259,85 @@ bool file_exists(
     return ::file_exists(path.c_str());
 }
 
+/// <summary>
+/// Folds the case of <paramref name="c" />, which is not ASCII, using the
+/// simple lowercase mappings of the Unicode character database.
+/// </summary>
+/// <remarks>
+/// Unlike <c>std::towlower</c>, the result does not depend on the current
+/// locale. Only characters in the basic multilingual plane are folded.
+/// </remarks>
+/// <param name="c"></param>
+/// <returns></returns>
+wchar_t fold_case_unicode(_In_ const wchar_t c) noexcept;
+
+/// <summary>
+/// Folds the case of <paramref name="c" /> for case-insensitive comparisons.
+/// </summary>
+/// <param name="c"></param>
+/// <returns></returns>
+inline wchar_t fold_case(_In_ const wchar_t c) noexcept {
+    if ((c >= L'A') && (c <= L'Z')) {
+        return c + (L'a' - L'A');
+    } else if (c < 128) {
+        return c;
+    } else {
+        return ::fold_case_unicode(c);
+    }
+}
+
+/// <summary>
+/// Computes a hash of <paramref name="str" /> that does not depend on the
+/// case of the characters.
+/// </summary>
+/// <param name="str"></param>
+/// <returns></returns>
+std::size_t fold_hash(_In_ const std::wstring_view str) noexcept;
+
+/// <summary>
+/// Converts the UTF-8 string <paramref name="str" /> to UTF-16, or to UTF-32
+/// on platforms where <c>wchar_t</c> has four bytes.
+/// </summary>
+/// <remarks>
+/// The conversion does not depend on the current locale. Runs of ASCII
+/// characters, which make up most of the names and paths in manifests, are
+/// widened in blocks of 16 bytes on x86 and x64.
+/// </remarks>
+/// <param name="str"></param>
+/// <returns></returns>
+/// <exception cref="wil::ResultException">If <paramref name="str" /> is not
+/// valid UTF-8.</exception>
+std::wstring from_utf8(_In_ const std::string& str);
+
+/// <summary>
+/// Gets the directory part of <paramref name="path" />, which includes the
+/// trailing separator and is empty if the path has no directory.
+/// </summary>
+/// <param name="path"></param>
+/// <returns>A view of <paramref name="path" />, which is only valid as long
+/// as <paramref name="path" /> is not modified.</returns>
+std::wstring_view get_directory(_In_ const std::wstring& path) noexcept;
+
+#if !defined(_WIN32)
+/// <summary>
+/// Gets the value of the environment variable <paramref name="name" />.
+/// </summary>
+/// <param name="name"></param>
+/// <param name="fallback">The value returned if the variable is not set or
+/// empty.</param>
+/// <returns></returns>
+std::wstring get_environment_variable(_In_z_ const char *name,
+    _In_ const std::wstring& fallback = std::wstring());
+#endif /* !defined(_WIN32) */
+
+#if defined(_WIN32)
 /// <summary>
 /// Gets the path to the file holding the given module.
 /// </summary>
 /// <param name="handle"></param>
 /// <returns></returns>
 std::wstring get_module_path(_In_opt_ HMODULE handle);
+#endif /* defined(_WIN32) */
 
 /// <summary>
 /// Answer whether <paramref name="c" /> is a directory separator.
@@ -255,11 +365,13 @@ inline bool is_directory_separator(_In_ const char c) noexcept {
 #endif /* defined(_WIN32) */
 }
 
+#if defined(_WIN32)
 /// <summary>
 /// Running whether the calling process is running elevated (as administrator).
 /// </summary>
 /// <returns></returns>
 bool is_elevated(void);
+#endif /* defined(_WIN32) */
 
 /// <summary>
 /// Answer whether the given two paths are the same directory.
@@ -270,6 +382,7 @@ bool is_elevated(void);
 bool is_same_directory(_In_ const std::wstring& lhs,
     _In_ const std::wstring& rhs) noexcept;
 
+#if defined(_WIN32)
 /// <summary>
 /// Loads the specified string resource.
 /// </summary>
@@ -286,5 +399,21 @@ std::string load_string(_In_opt_ const HINSTANCE instance, _In_ const UINT id);
 /// <returns></returns>
 std::wstring load_wstring(_In_opt_ const HINSTANCE instance,
     _In_ const UINT id);
+#endif /* defined(_WIN32) */
+
+/// <summary>
+/// Converts the UTF-16 string <paramref name="str" /> to UTF-8, or the UTF-32
+/// string on platforms where <c>wchar_t</c> has four bytes.
+/// </summary>
+/// <remarks>
+/// The conversion does not depend on the current locale. Runs of ASCII
+/// characters are narrowed in blocks of eight characters on x86 and x64.
+/// </remarks>
+/// <param name="str"></param>
+/// <returns></returns>
+/// <exception cref="wil::ResultException">If <paramref name="str" />
+/// contains unpaired surrogates or code points that are not valid.
+/// </exception>
+std::string to_utf8(_In_ const std::wstring& str);
 
 #endif /* !defined(_OXRSWITCH_UTIL_H) */
@@ -0,0 +1,47 @@
+﻿// <copyright file="benchmark.h" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#if !defined(_OXRTEST_BENCHMARK_H)
+#define _OXRTEST_BENCHMARK_H
+#pragma once
+
+
+/// <summary>
+/// Invokes <paramref name="callback" /> <paramref name="iterations" /> times
+/// and answers the mean time of an invocation.
+/// </summary>
+/// <remarks>
+/// The benchmarks run as part of the tests with small workloads, which
+/// makes them a smoke test of the measured code on every build. The results
+/// are printed and recorded as properties of the test, such that they can be
+/// compared between builds via <c>--gtest_output</c>.
+/// </remarks>
+/// <typeparam name="TCallback">A functor without parameters.</typeparam>
+/// <param name="name">The name under which the result is recorded.</param>
+/// <param name="iterations">The number of invocations, which must be
+/// positive.</param>
+/// <param name="callback">The code to be measured.</param>
+/// <returns>The mean time of an invocation.</returns>
+template<class TCallback>
+std::chrono::nanoseconds benchmark(_In_ const char *name,
+        _In_ const std::size_t iterations,
+        _In_ TCallback&& callback) {
+    assert(iterations > 0);
+    const auto begin = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i) {
+        callback();
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    const auto retval = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        end - begin) / iterations;
+    std::cout << "[ BENCHMARK] " << name << ": " << retval.count()
+        << " ns" << std::endl;
+    ::testing::Test::RecordProperty(name, std::to_string(retval.count()));
+    return retval;
+}
+
+#endif /* !defined(_OXRTEST_BENCHMARK_H) */
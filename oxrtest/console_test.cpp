@@ -0,0 +1,214 @@
+﻿// <copyright file="console_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+#include "pch.h"
+
+#include "../oxrswitch/console.h"
+
+#include "benchmark.h"
+#include "xdg_environment.h"
+
+
+#if !defined(_WIN32)
+namespace {
+
+    /// <summary>
+    /// Runs the command line <paramref name="args" /> and parses its output.
+    /// </summary>
+    int run(_In_ const std::vector<std::wstring>& args,
+            _Out_ nlohmann::json& output) {
+        std::stringstream stream;
+        console cli(args, &stream);
+        EXPECT_TRUE(cli.headless());
+        const auto retval = cli.run();
+        output = nlohmann::json::parse(stream.str());
+        return retval;
+    }
+
+} /* namespace */
+
+
+/*
+ * console.headless
+ */
+TEST(console, headless) {
+    EXPECT_FALSE(console({ }).headless());
+    EXPECT_FALSE(console({ L"/fixacls" }).headless());
+    EXPECT_TRUE(console({ L"/LIST" }).headless());
+    EXPECT_TRUE(console({ L"/get" }).headless());
+    EXPECT_TRUE(console({ L"/set", L"SteamVR" }).headless());
+    EXPECT_TRUE(console({ L"/launch" }).headless());
+}
+
+
+/*
+ * console.usage
+ */
+TEST(console, usage) {
+    xdg_environment env;
+    nlohmann::json output;
+
+    EXPECT_EQ(run({ L"/get", L"SteamVR" }, output), console::exit_usage);
+    EXPECT_TRUE(output.contains("error"));
+    EXPECT_EQ(run({ L"/list", L"SteamVR" }, output), console::exit_usage);
+    EXPECT_TRUE(output.contains("error"));
+    EXPECT_EQ(run({ L"/set" }, output), console::exit_usage);
+    EXPECT_TRUE(output.contains("error"));
+    EXPECT_EQ(run({ L"/launch", L"SteamVR" }, output), console::exit_usage);
+    EXPECT_TRUE(output.contains("error"));
+}
+
+
+/*
+ * console.switch
+ */
+TEST(console, switch) {
+    xdg_environment env;
+    const auto alpha = env.manifest(L"usr/share/openxr/1/alpha.json",
+        "Alpha");
+    env.manifest(L"usr/share/openxr/1/beta.json", "Beta");
+    nlohmann::json output;
+
+    EXPECT_EQ(run({ L"/get" }, output), console::exit_not_found);
+    EXPECT_TRUE(output.is_null());
+
+    EXPECT_EQ(run({ L"/set", L"beta" }, output), console::exit_success);
+    EXPECT_EQ(output["name"], "Beta");
+    EXPECT_EQ(output["active"], true);
+    EXPECT_TRUE(output["wowPath"].is_null());
+
+    EXPECT_EQ(run({ L"/get" }, output), console::exit_success);
+    EXPECT_EQ(output["name"], "Beta");
+
+    ASSERT_EQ(run({ L"/list" }, output), console::exit_success);
+    ASSERT_TRUE(output.is_array());
+    ASSERT_EQ(output.size(), 2u);
+    for (auto& r : output) {
+        EXPECT_EQ(r["active"], (r["name"] == "Beta"));
+    }
+
+    // The path takes precedence over the name.
+    EXPECT_EQ(run({ L"/set", alpha }, output), console::exit_success);
+    EXPECT_EQ(output["name"], "Alpha");
+    EXPECT_EQ(run({ L"/get" }, output), console::exit_success);
+    EXPECT_EQ(output["name"], "Alpha");
+
+    EXPECT_EQ(run({ L"/set", L"Gamma" }, output), console::exit_not_found);
+    EXPECT_TRUE(output.contains("error"));
+}
+
+
+/*
+ * console.ambiguous
+ */
+TEST(console, ambiguous) {
+    xdg_environment env;
+    const auto first = env.manifest(L"usr/share/openxr/1/first.json",
+        "Alpha");
+    env.manifest(L"usr/local/share/openxr/1/second.json", "Alpha");
+    nlohmann::json output;
+
+    EXPECT_EQ(run({ L"/set", L"Alpha" }, output), console::exit_not_found);
+    EXPECT_TRUE(output.contains("error"));
+
+    EXPECT_EQ(run({ L"/set", first }, output), console::exit_success);
+    EXPECT_EQ(output["path"], ::to_utf8(first));
+}
+
+
+/*
+ * console.launch
+ */
+TEST(console, launch) {
+    xdg_environment env;
+    const auto alpha = env.manifest(L"usr/share/openxr/1/alpha.json",
+        "Alpha");
+    const auto echo = ::to_utf8(env.path(L"echo.txt"));
+    nlohmann::json output;
+
+    // The child must see the manifest even if we have another one set.
+    ::setenv("XR_RUNTIME_JSON", "inherited.json", 1);
+
+    // The dummy child echoes the variable it got into a file.
+    ASSERT_EQ(run({ L"/launch", L"Alpha", L"sh", L"-c",
+        L"printf %s \"$XR_RUNTIME_JSON\" > \"$0\"", ::from_utf8(echo) },
+        output), console::exit_success);
+    EXPECT_EQ(output["name"], "Alpha");
+    EXPECT_EQ(output["runtimeJson"], ::to_utf8(alpha));
+
+    int status = 0;
+    ASSERT_EQ(::waitpid(output["processId"].get<pid_t>(), &status, 0),
+        output["processId"].get<pid_t>());
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+
+    std::ifstream stream(echo);
+    std::string actual((std::istreambuf_iterator<char>(stream)),
+        std::istreambuf_iterator<char>());
+    EXPECT_EQ(actual, ::to_utf8(alpha));
+
+    // Neither our environment nor the active runtime must have changed.
+    EXPECT_STREQ(::getenv("XR_RUNTIME_JSON"), "inherited.json");
+    ::unsetenv("XR_RUNTIME_JSON");
+    EXPECT_EQ(run({ L"/get" }, output), console::exit_not_found);
+
+    EXPECT_EQ(run({ L"/launch", L"Alpha", L"does-not-exist" }, output),
+        console::exit_failure);
+    EXPECT_TRUE(output.contains("error"));
+}
+
+
+/*
+ * console.launch_cached
+ */
+TEST(console, launch_cached) {
+    xdg_environment env;
+    const auto alpha = env.manifest(L"usr/share/openxr/1/alpha.json",
+        "Alpha");
+    nlohmann::json output;
+
+    // Fill the discovery cache, which the launch uses without discovery.
+    ASSERT_EQ(run({ L"/list" }, output), console::exit_success);
+
+    ASSERT_EQ(run({ L"/launch", L"Alpha", L"true" }, output),
+        console::exit_success);
+    ::waitpid(output["processId"].get<pid_t>(), nullptr, 0);
+
+    // A cached runtime whose manifest has gone must not be used.
+    std::filesystem::remove(alpha);
+    EXPECT_EQ(run({ L"/launch", L"Alpha", L"true" }, output),
+        console::exit_not_found);
+    EXPECT_TRUE(output.contains("error"));
+}
+
+
+/*
+ * benchmark.console
+ */
+TEST(benchmark, console) {
+    xdg_environment env;
+    env.manifest(L"usr/share/openxr/1/alpha.json", "Alpha");
+    env.manifest(L"usr/share/openxr/1/beta.json", "Beta");
+    nlohmann::json output;
+
+    // The first run performs a cold discovery and writes the cache, which
+    // all of the measured runs start from like a script would.
+    ASSERT_EQ(run({ L"/list" }, output), console::exit_success);
+
+    benchmark("console.list", 20, [&](void) {
+        EXPECT_EQ(run({ L"/list" }, output), console::exit_success);
+    });
+
+    std::size_t i = 0;
+    benchmark("console.set", 20, [&](void) {
+        const auto name = ((i++ % 2) == 0) ? L"Alpha" : L"Beta";
+        EXPECT_EQ(run({ L"/set", name }, output), console::exit_success);
+    });
+
+    benchmark("console.get", 20, [&](void) {
+        EXPECT_EQ(run({ L"/get" }, output), console::exit_success);
+    });
+}
+#endif /* !defined(_WIN32) */
@@ -0,0 +1,310 @@
+﻿// <copyright file="directory_walker_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrswitch/directory_walker.h"
+
+#include "benchmark.h"
+#include "temp_directory.h"
+
+
+namespace {
+
+    /// <summary>
+    /// An in-memory stand-in for the file system, which optionally
+    /// simulates the latency of enumerating a directory.
+    /// </summary>
+    class memory_file_system final {
+
+    public:
+
+        /// <summary>
+        /// Adds the file <paramref name="path" /> and all directories on the
+        /// way, which are separated by forward slashes.
+        /// </summary>
+        void add(_In_ const std::wstring& path) {
+            std::size_t begin = 0;
+            std::wstring parent;
+
+            while (true) {
+                const auto end = path.find(L'/', begin);
+                const auto name = path.substr(begin, end - begin);
+                const auto is_directory = (end != std::wstring::npos);
+                auto& entries = this->_directories[parent];
+                if (std::find(entries.begin(), entries.end(),
+                        std::make_pair(name, is_directory)) == entries.end()) {
+                    entries.emplace_back(name, is_directory);
+                }
+
+                if (!is_directory) {
+                    break;
+                }
+
+                parent = ::combine_path(parent, name.c_str());
+                begin = end + 1;
+            }
+        }
+
+        /// <summary>
+        /// Makes every enumeration take at least
+        /// <paramref name="latency" />.
+        /// </summary>
+        void latency(_In_ const std::chrono::microseconds latency) noexcept {
+            this->_latency = latency;
+        }
+
+        /// <summary>
+        /// Enumerates <paramref name="directory" /> like
+        /// <see cref="native_file_system" />.
+        /// </summary>
+        template<class TCallback>
+        void enumerate(_In_ const std::wstring& directory,
+                _In_ TCallback&& callback) const {
+            if (this->_latency.count() > 0) {
+                std::this_thread::sleep_for(this->_latency);
+            }
+
+            auto it = this->_directories.find(directory);
+            if (it != this->_directories.end()) {
+                for (auto& e : it->second) {
+                    callback(e.first.c_str(), e.second);
+                }
+            }
+        }
+
+    private:
+
+        std::map<std::wstring, std::vector<std::pair<std::wstring, bool>>>
+            _directories;
+        std::chrono::microseconds _latency = std::chrono::microseconds(0);
+    };
+
+    /// <summary>
+    /// Walks <paramref name="root" /> and answers the files and directories
+    /// found in a well-defined order.
+    /// </summary>
+    template<class TFileSystem>
+    bool walk(_In_ const TFileSystem& file_system,
+            _In_ const walk_options& options,
+            _In_ const std::wstring& root,
+            _Out_ std::set<std::wstring>& files,
+            _Out_ std::set<std::wstring>& directories) {
+        files.clear();
+        directories.clear();
+        directory_walker<TFileSystem> walker(options, file_system);
+        return walker(root, std::inserter(files, files.end()),
+            std::inserter(directories, directories.end()));
+    }
+
+    /// <summary>
+    /// Answer the number of directories in the tree of the benchmark, which
+    /// can be changed via the environment variable
+    /// <c>OXRTEST_WALKER_DIRECTORIES</c>.
+    /// </summary>
+    std::size_t benchmark_directories(void) {
+        constexpr std::size_t fallback = 100000;
+#if defined(_WIN32)
+        wchar_t value[32];
+        const auto cnt = ::GetEnvironmentVariableW(
+            L"OXRTEST_WALKER_DIRECTORIES", value, 32);
+        if ((cnt == 0) || (cnt >= 32)) {
+            return fallback;
+        }
+        const auto retval = std::wcstoull(value, nullptr, 10);
+#else /* defined(_WIN32) */
+        const auto value = ::getenv("OXRTEST_WALKER_DIRECTORIES");
+        if (value == nullptr) {
+            return fallback;
+        }
+        const auto retval = std::strtoull(value, nullptr, 10);
+#endif /* defined(_WIN32) */
+        return (retval > 0) ? static_cast<std::size_t>(retval) : fallback;
+    }
+
+    /// <summary>
+    /// Creates a file system with an installation folder that has a runtime
+    /// next to a large tree of unrelated resources.
+    /// </summary>
+    memory_file_system make_install_tree(_In_ const std::size_t width) {
+        memory_file_system retval;
+        retval.add(L"Runtime/openxr_runtime.json");
+        retval.add(L"Runtime/bin/runtime.dll");
+
+        for (std::size_t i = 0; i < width; ++i) {
+            for (std::size_t j = 0; j < width; ++j) {
+                retval.add(L"resources/" + std::to_wstring(i) + L"/"
+                    + std::to_wstring(j) + L"/material.json");
+            }
+        }
+
+        return retval;
+    }
+
+} /* namespace */
+
+
+/*
+ * directory_walker.search
+ */
+TEST(directory_walker, search) {
+    const auto fs = make_install_tree(4);
+    std::set<std::wstring> files, directories;
+
+    walk_options options;
+    options.threads = 3;
+    ASSERT_TRUE(walk(fs, options, L"", files, directories));
+    EXPECT_EQ(files.size(), 17u);
+    EXPECT_EQ(files.count(::combine_path(L"Runtime", L"openxr_runtime.json")),
+        1u);
+    EXPECT_EQ(files.count(::combine_path(L"Runtime", L"runtime.dll")), 0u);
+    EXPECT_EQ(directories.size(), 1u + 2u + 1u + 4u + 16u);
+}
+
+
+/*
+ * directory_walker.options
+ */
+TEST(directory_walker, options) {
+    const auto fs = make_install_tree(4);
+    std::set<std::wstring> files, directories;
+
+    // Excluded directories are compared case-insensitively.
+    walk_options options(walk_options::unlimited_depth, { L"RESOURCES" });
+    ASSERT_TRUE(walk(fs, options, L"", files, directories));
+    EXPECT_EQ(files, std::set<std::wstring>({
+        ::combine_path(L"Runtime", L"openxr_runtime.json") }));
+    EXPECT_EQ(directories.count(L"resources"), 0u);
+
+    // The depth is counted below the root.
+    options = walk_options(1, { });
+    ASSERT_TRUE(walk(fs, options, L"", files, directories));
+    EXPECT_EQ(files.size(), 1u);
+    EXPECT_EQ(directories.size(), 3u);
+
+    // Other extensions, which are compared case-insensitively, too.
+    options = walk_options();
+    options.extension = L".DLL";
+    ASSERT_TRUE(walk(fs, options, L"", files, directories));
+    EXPECT_EQ(files.size(), 1u);
+}
+
+
+/*
+ * directory_walker.merge
+ */
+TEST(directory_walker, merge) {
+    walk_options lhs(2, { L"Resources", L"Shaders" });
+    walk_options rhs(4, { L"shaders", L"Textures" });
+    lhs.merge(rhs);
+
+    EXPECT_EQ(lhs.max_depth, 4u);
+    EXPECT_TRUE(lhs.is_excluded(L"SHADERS"));
+    EXPECT_FALSE(lhs.is_excluded(L"Resources"));
+    EXPECT_FALSE(lhs.is_excluded(L"Textures"));
+}
+
+
+/*
+ * directory_walker.relevant
+ */
+TEST(directory_walker, relevant) {
+    const walk_options options(2, { L"Downloads" });
+    const auto path = [](const wchar_t *dir, const wchar_t *name) {
+        return ::combine_path(dir, name);
+    };
+
+    // Manifests the walker finds.
+    EXPECT_TRUE(options.is_relevant(L"runtime.json", true));
+    EXPECT_TRUE(options.is_relevant(path(L"bin", L"runtime.JSON"), true));
+    EXPECT_TRUE(options.is_relevant(path(L"bin", L"runtime.json"), false));
+
+    // Anything added or removed might be a directory with manifests.
+    EXPECT_TRUE(options.is_relevant(path(L"bin", L"win64"), false));
+    EXPECT_FALSE(options.is_relevant(path(L"bin", L"runtime.dll"), true));
+
+    // Excluded directories and their content.
+    EXPECT_FALSE(options.is_relevant(L"downloads", false));
+    EXPECT_FALSE(options.is_relevant(path(L"Downloads", L"a.json"), false));
+
+    // Directories below the maximum depth are not searched.
+    EXPECT_TRUE(options.is_relevant(path(path(L"a", L"b").c_str(),
+        L"c.json"), false));
+    EXPECT_FALSE(options.is_relevant(path(path(path(L"a", L"b").c_str(),
+        L"c").c_str(), L"d.json"), false));
+}
+
+
+/*
+ * directory_walker.budget
+ */
+TEST(directory_walker, budget) {
+    auto fs = make_install_tree(8);
+    fs.latency(std::chrono::milliseconds(2));
+    std::set<std::wstring> files, directories;
+
+    walk_options options;
+    options.budget = std::chrono::milliseconds(10);
+    options.threads = 2;
+    EXPECT_FALSE(walk(fs, options, L"", files, directories));
+    EXPECT_LT(directories.size(), 1u + 2u + 1u + 8u + 64u);
+}
+
+
+/*
+ * directory_walker.native
+ */
+TEST(directory_walker, native) {
+    temp_directory dir;
+    dir.write(L"Runtime/openxr_runtime.json", "{ }");
+    dir.write(L"Runtime/bin/runtime.dll", "");
+    dir.write(L"resources/a/b/material.JSON", "{ }");
+
+    std::set<std::wstring> files, directories;
+    ASSERT_TRUE(walk(native_file_system(), walk_options(), dir.path(), files,
+        directories));
+    EXPECT_EQ(files, std::set<std::wstring>({
+        dir.path(L"Runtime/openxr_runtime.json"),
+        dir.path(L"resources/a/b/material.JSON") }));
+    EXPECT_EQ(directories.size(), 6u);
+}
+
+
+/*
+ * benchmark.directory_walker
+ */
+TEST(benchmark, directory_walker) {
+    // The tree is a square of directories, which holds about 100,000 of them
+    // by default like a large game library. Every directory takes 50 us to
+    // enumerate, which is in the order of a directory on an SSD that is not
+    // in the cache.
+    const auto width = static_cast<std::size_t>(std::sqrt(
+        static_cast<double>(benchmark_directories())));
+    auto fs = make_install_tree(width);
+    fs.latency(std::chrono::microseconds(50));
+    std::set<std::wstring> files, directories;
+
+    // The budget would cut the search of the whole tree short.
+    walk_options options;
+    options.budget = std::chrono::hours(1);
+    options.threads = 1;
+    benchmark("directory_walker (1 thread)", 1, [&]() {
+        walk(fs, options, L"", files, directories);
+    });
+    EXPECT_EQ(files.size(), width * width + 1);
+
+    options.threads = 4;
+    benchmark("directory_walker (4 threads)", 1, [&]() {
+        walk(fs, options, L"", files, directories);
+    });
+    EXPECT_EQ(files.size(), width * width + 1);
+
+    options = walk_options(walk_options::unlimited_depth, { L"resources" });
+    benchmark("directory_walker (pruned)", 3, [&]() {
+        walk(fs, options, L"", files, directories);
+    });
+    EXPECT_EQ(files.size(), 1u);
+}
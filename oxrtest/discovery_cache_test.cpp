@@ -0,0 +1,276 @@
+﻿// <copyright file="discovery_cache_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+#include "pch.h"
+
+#include "../oxrswitch/registry.h"
+#include "../oxrswitch/runtime_manager.h"
+
+#include "benchmark.h"
+#include "temp_directory.h"
+
+
+namespace {
+
+    /// <summary>
+    /// The path of the native uninstall database.
+    /// </summary>
+    constexpr auto uninstall_path
+        = L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall";
+
+    /// <summary>
+    /// Creates a hive with SteamVR and Varjo among <paramref name="cnt" />
+    /// unrelated programs in the uninstall database.
+    /// </summary>
+    nlohmann::json make_hive(_In_ const std::size_t cnt) {
+        auto retval = nlohmann::json::parse(R"({
+            "SOFTWARE": {
+                "Microsoft": { "Windows": { "CurrentVersion": {
+                    "Uninstall": {
+                        "Steam App 250820": {
+                            "DisplayName": "SteamVR",
+                            "Publisher": "Valve Corporation",
+                            "InstallLocation": "C:\\Steam\\SteamVR"
+                        }
+                    }
+                } } },
+                "Varjo": {
+                    "Runtime": { "InstallDir": "C:\\Varjo\\Runtime" }
+                },
+                "WOW6432Node": { }
+            }
+        })");
+
+        auto& uninstall = retval["SOFTWARE"]["Microsoft"]["Windows"]
+            ["CurrentVersion"]["Uninstall"];
+        for (std::size_t i = 0; i < cnt; ++i) {
+            const auto n = std::to_string(i);
+            uninstall["{" + n + "}"] = {
+                { "DisplayName", "Program " + n },
+                { "Publisher", "Publisher " + n },
+                { "InstallLocation", "C:\\Program Files\\Program " + n }
+            };
+        }
+
+        return retval;
+    }
+
+    /// <summary>
+    /// Creates a stamper that retrieves the time stamps of registry keys
+    /// from <paramref name="registry" /> instead of the real registry.
+    /// </summary>
+    auto make_stamper(_In_ const memory_registry& registry) {
+        return [&registry](const discovery_cache::source_type type,
+                const std::wstring& path) {
+            return (type == discovery_cache::source_type::registry)
+                ? registry.last_write_time(registry.root(), path.c_str())
+                : discovery_cache::get_stamp(type, path);
+        };
+    }
+
+    /// <summary>
+    /// Answer whether <paramref name="cache" /> tracks the registry key at
+    /// <paramref name="path" />.
+    /// </summary>
+    bool is_tracked(_In_ const discovery_cache& cache,
+            _In_ const std::wstring& path) {
+        auto& stamps = cache.stamps();
+        return std::any_of(stamps.begin(), stamps.end(),
+            [&path](const discovery_cache::stamp& s) {
+                return (s.type == discovery_cache::source_type::registry)
+                    && ::equals(s.path, path, false);
+            });
+    }
+
+} /* namespace */
+
+
+/*
+ * discovery_cache.matched_keys
+ */
+TEST(discovery_cache, matched_keys) {
+    const memory_registry registry(make_hive(100));
+    discovery_cache cache;
+    const auto installations = runtime_manager::get_installations(registry,
+        cache);
+    EXPECT_EQ(installations.size(), 2u);
+
+    // The keys holding the installation locations are tracked, but none of
+    // the unrelated programs.
+    EXPECT_TRUE(is_tracked(cache, uninstall_path));
+    EXPECT_TRUE(is_tracked(cache,
+        std::wstring(uninstall_path) + L"\\Steam App 250820"));
+    EXPECT_TRUE(is_tracked(cache, L"SOFTWARE\\Varjo"));
+    EXPECT_TRUE(is_tracked(cache, L"SOFTWARE\\Varjo\\Runtime"));
+    EXPECT_FALSE(is_tracked(cache, std::wstring(uninstall_path) + L"\\{0}"));
+
+    EXPECT_TRUE(cache.is_valid(make_stamper(registry)));
+}
+
+
+/*
+ * discovery_cache.moved_installation
+ */
+TEST(discovery_cache, moved_installation) {
+    const memory_registry registry(make_hive(100));
+    discovery_cache cache;
+    runtime_manager::get_installations(registry, cache);
+
+    {
+        // An update moved SteamVR, which only changes its uninstall entry.
+        auto hive = make_hive(100);
+        hive["SOFTWARE"]["Microsoft"]["Windows"]["CurrentVersion"]
+            ["Uninstall"]["Steam App 250820"]["InstallLocation"]
+            = "D:\\SteamVR";
+        EXPECT_FALSE(cache.is_valid(make_stamper(memory_registry(hive))));
+    }
+
+    {
+        // Varjo moved its installation directory.
+        auto hive = make_hive(100);
+        hive["SOFTWARE"]["Varjo"]["Runtime"]["InstallDir"] = "D:\\Varjo";
+        EXPECT_FALSE(cache.is_valid(make_stamper(memory_registry(hive))));
+    }
+
+    {
+        // A new program was installed.
+        EXPECT_FALSE(cache.is_valid(make_stamper(
+            memory_registry(make_hive(101)))));
+    }
+
+    {
+        // An unrelated program was updated.
+        auto hive = make_hive(100);
+        hive["SOFTWARE"]["Microsoft"]["Windows"]["CurrentVersion"]
+            ["Uninstall"]["{0}"]["InstallLocation"] = "D:\\Program 0";
+        EXPECT_TRUE(cache.is_valid(make_stamper(memory_registry(hive))));
+    }
+}
+
+
+/*
+ * discovery_cache.round_trip
+ */
+TEST(discovery_cache, round_trip) {
+    const memory_registry registry(make_hive(10));
+    discovery_cache cache;
+    runtime_manager::get_installations(registry, cache);
+    cache.runtimes().emplace_back(L"SteamVR",
+        L"C:\\Steam\\SteamVR\\steamxr_win64.json",
+        L"C:\\Steam\\SteamVR\\steamxr_win32.json");
+
+    std::stringstream stream;
+    cache.save(stream);
+    const auto loaded = discovery_cache::load(stream);
+
+    ASSERT_EQ(loaded.stamps().size(), cache.stamps().size());
+    for (std::size_t i = 0; i < cache.stamps().size(); ++i) {
+        EXPECT_EQ(loaded.stamps()[i].path, cache.stamps()[i].path);
+        EXPECT_EQ(loaded.stamps()[i].time, cache.stamps()[i].time);
+    }
+
+    ASSERT_EQ(loaded.runtimes().size(), 1u);
+    EXPECT_EQ(loaded.runtimes().front().name(), L"SteamVR");
+    EXPECT_TRUE(loaded.is_valid(make_stamper(registry)));
+
+    // The segments allow for searching only what has changed.
+    cache.segments().push_back({ false,
+        L"C:\\Steam\\SteamVR",
+        0x5,
+        cache.runtimes(),
+        cache.stamps(),
+        discovery_cache::segment_type::installed });
+    stream = std::stringstream();
+    cache.save(stream);
+    const auto segmented = discovery_cache::load(stream);
+
+    ASSERT_EQ(segmented.segments().size(), 1u);
+    auto& s = segmented.segments().front();
+    EXPECT_FALSE(s.complete);
+    EXPECT_EQ(s.folder, L"C:\\Steam\\SteamVR");
+    EXPECT_EQ(s.mask, 0x5u);
+    ASSERT_EQ(s.runtimes.size(), 1u);
+    EXPECT_EQ(s.runtimes.front().wow_path(),
+        L"C:\\Steam\\SteamVR\\steamxr_win32.json");
+    EXPECT_EQ(s.stamps.size(), cache.stamps().size());
+    EXPECT_EQ(s.type, discovery_cache::segment_type::installed);
+
+    std::stringstream garbage("{ \"version\": 0 }");
+    EXPECT_TRUE(discovery_cache::load(garbage).empty());
+}
+
+
+/*
+ * discovery_cache.concurrent_save
+ */
+TEST(discovery_cache, concurrent_save) {
+    const memory_registry registry(make_hive(10));
+    const temp_directory dir;
+    const auto path = dir.path(L"cache/discovery.json");
+
+    discovery_cache cache;
+    runtime_manager::get_installations(registry, cache);
+    cache.runtimes().emplace_back(L"SteamVR",
+        L"C:\\Steam\\SteamVR\\steamxr_win64.json",
+        L"C:\\Steam\\SteamVR\\steamxr_win32.json");
+
+    // Every saver must use a temporary file of its own, or they would fail
+    // renaming a file another one has already renamed, or rename a file
+    // another one is still writing.
+    std::atomic<unsigned int> failures(0);
+    std::vector<std::thread> savers;
+    for (int i = 0; i < 8; ++i) {
+        savers.emplace_back([&](void) {
+            for (int j = 0; j < 50; ++j) {
+                try {
+                    cache.save(path);
+                } catch (...) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (auto& s : savers) {
+        s.join();
+    }
+
+    EXPECT_EQ(failures.load(), 0u);
+    EXPECT_TRUE(discovery_cache::load(path).is_valid(make_stamper(registry)));
+
+    // No temporary file is left behind.
+    const auto files = std::distance(
+        std::filesystem::directory_iterator(dir.path(L"cache")),
+        std::filesystem::directory_iterator());
+    EXPECT_EQ(files, 1);
+}
+
+
+/*
+ * benchmark.discovery_cache
+ */
+TEST(benchmark, discovery_cache) {
+    const memory_registry registry(make_hive(2000));
+    const auto stamper = make_stamper(registry);
+    std::string serialised;
+
+    // A cold start searches the whole uninstall database and writes the
+    // cache, whereas a warm start only reads the cache and compares the time
+    // stamps of the keys that have been tracked.
+    const auto cold = benchmark("discovery_cache.cold", 10, [&](void) {
+        discovery_cache cache;
+        runtime_manager::get_installations(registry, cache);
+        std::ostringstream stream;
+        cache.save(stream);
+        serialised = stream.str();
+    });
+
+    const auto warm = benchmark("discovery_cache.warm", 10, [&](void) {
+        std::istringstream stream(serialised);
+        const auto cache = discovery_cache::load(stream);
+        EXPECT_TRUE(cache.is_valid(stamper));
+    });
+
+    EXPECT_LT(warm, cold);
+}
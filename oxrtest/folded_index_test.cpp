@@ -0,0 +1,109 @@
+﻿// <copyright file="folded_index_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrswitch/folded_index.h"
+
+#include "benchmark.h"
+
+
+namespace {
+
+    /// <summary>
+    /// Creates <paramref name="cnt" /> manifests in distinct directories,
+    /// optionally in the WOW64 variant and in upper case.
+    /// </summary>
+    std::vector<std::wstring> make_manifests(_In_ const std::size_t cnt,
+            _In_ const bool wow,
+            _In_ const bool upper) {
+        std::vector<std::wstring> retval;
+        retval.reserve(cnt);
+
+        for (std::size_t i = 0; i < cnt; ++i) {
+            std::wstring path = L"C:/Program Files/Vendor"
+                + std::to_wstring(i) + L"/Runtime/";
+            if (upper) {
+                std::transform(path.begin(), path.end(), path.begin(),
+                    [](const wchar_t c) { return std::towupper(c); });
+            }
+            path += wow ? L"runtime_x86.json" : L"runtime_x64.json";
+            retval.push_back(std::move(path));
+        }
+
+        return retval;
+    }
+
+    typedef std::vector<std::wstring>::const_iterator iterator_type;
+    typedef folded_index<iterator_type, directory_key> index_type;
+
+} /* namespace */
+
+
+/*
+ * folded_index.find
+ */
+TEST(folded_index, find) {
+    // Forward slashes are directory separators on all platforms.
+    const std::vector<std::wstring> paths = {
+        L"C:/Varjo/VarjoOpenXR.json",
+        L"C:/SteamVR/steamxr_win64.json",
+        L"C:/SteamVR/steamxr_win32.json",
+    };
+    index_type index(paths.cbegin(), paths.cend());
+
+    EXPECT_EQ(index.find(L"c:/steamvr/"), paths.cbegin() + 1);
+    EXPECT_EQ(index.find(L"C:/VARJO/"), paths.cbegin());
+    EXPECT_EQ(index.find(L"C:/Varjo"), paths.cend());
+    EXPECT_EQ(index.find(L"C:/Oculus/"), paths.cend());
+
+    std::vector<iterator_type> found;
+    index.for_each(L"C:/STEAMVR/", [&found](const iterator_type it) {
+        found.push_back(it);
+    });
+    EXPECT_EQ(found, std::vector<iterator_type>({ paths.cbegin() + 1,
+        paths.cbegin() + 2 }));
+}
+
+
+/*
+ * benchmark.folded_index_pairing
+ */
+TEST(benchmark, folded_index_pairing) {
+    // This is what make_runtimes does for the AvailableRuntimes of the
+    // native and the WOW64 view, each of which has 5000 entries here.
+    const auto native = make_manifests(5000, false, false);
+    const auto wow = make_manifests(5000, true, true);
+
+    std::size_t paired = 0;
+    benchmark("folded_index pairing (5000)", 10, [&]() {
+        index_type index(wow.cbegin(), wow.cend());
+        for (auto& n : native) {
+            if (index.find(::get_directory(n)) != wow.cend()) {
+                ++paired;
+            }
+        }
+    });
+    EXPECT_EQ(paired, 10 * native.size());
+
+    // The quadratic search it replaced, which compared every native entry
+    // with all WOW64 entries.
+    paired = 0;
+    benchmark("quadratic pairing (5000)", 1, [&]() {
+        for (auto& n : native) {
+            for (auto& w : wow) {
+                const auto l = ::get_directory(n);
+                const auto r = ::get_directory(w);
+                if ((l.size() == r.size())
+                        && ::equals_n(l.data(), r.data(), l.size(), false)) {
+                    ++paired;
+                    break;
+                }
+            }
+        }
+    });
+    EXPECT_EQ(paired, native.size());
+}
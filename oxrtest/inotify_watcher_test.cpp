@@ -0,0 +1,63 @@
+﻿// <copyright file="inotify_watcher_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrsvc/inotify_watcher.h"
+
+#include "temp_directory.h"
+
+
+#if !defined(_WIN32)
+namespace {
+
+    /// <summary>
+    /// Replaces the file at <paramref name="path" /> by renaming a new file
+    /// over it, which is how most tools update their configuration.
+    /// </summary>
+    void replace(const std::string& path, const std::string& content) {
+        const auto temp = path + ".tmp";
+        {
+            std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+            stream << content;
+        }
+        std::filesystem::rename(temp, path);
+    }
+
+} /* namespace */
+
+
+/*
+ * inotify_watcher.changes
+ */
+TEST(inotify_watcher, changes) {
+    temp_directory dir;
+    const auto a = std::filesystem::path(dir.write(L"a/active_runtime.json",
+        "{}")).string();
+    const auto b = std::filesystem::path(dir.write(L"b/active_runtime.json",
+        "{}")).string();
+    dir.write(L"a/unrelated.json", "{}");
+
+    inotify_watcher watcher({ a, std::string(), b });
+    std::size_t file;
+
+    // Writing in place and replacing the file must both be reported, and
+    // other files in the same directory must be ignored.
+    dir.write(L"a/unrelated.json", "[]");
+    dir.write(L"b/active_runtime.json", "[]");
+    ASSERT_TRUE(watcher.wait(file));
+    EXPECT_EQ(file, 2);
+
+    replace(a, "[]");
+    ASSERT_TRUE(watcher.wait(file));
+    EXPECT_EQ(file, 0);
+
+    std::thread stopper([&watcher](void) { watcher.stop(); });
+    EXPECT_FALSE(watcher.wait(file));
+    stopper.join();
+}
+
+#endif /* !defined(_WIN32) */
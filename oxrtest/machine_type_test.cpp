@@ -0,0 +1,290 @@
+﻿// <copyright file="machine_type_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrswitch/machine_type.h"
+#include "../oxrswitch/util.h"
+
+#include "benchmark.h"
+#include "temp_directory.h"
+
+
+namespace {
+
+    /// <summary>
+    /// Creates the header of a PE image for the given machine.
+    /// </summary>
+    std::vector<std::uint8_t> make_pe(_In_ const std::uint16_t machine) {
+        constexpr std::size_t offset = 0x80;
+        std::vector<std::uint8_t> retval(offset + 24, 0);
+        retval[0] = 'M';
+        retval[1] = 'Z';
+        retval[0x3C] = static_cast<std::uint8_t>(offset);
+        retval[offset + 0] = 'P';
+        retval[offset + 1] = 'E';
+        retval[offset + 4] = static_cast<std::uint8_t>(machine);
+        retval[offset + 5] = static_cast<std::uint8_t>(machine >> 8);
+        return retval;
+    }
+
+    /// <summary>
+    /// Creates the header of an ELF image for the given machine.
+    /// </summary>
+    std::vector<std::uint8_t> make_elf(_In_ const std::uint16_t machine,
+            _In_ const bool big_endian) {
+        std::vector<std::uint8_t> retval(64, 0);
+        retval[0] = 0x7F;
+        retval[1] = 'E';
+        retval[2] = 'L';
+        retval[3] = 'F';
+        retval[4] = 2;
+        retval[5] = big_endian ? 2 : 1;
+        retval[big_endian ? 19 : 18] = static_cast<std::uint8_t>(machine);
+        retval[big_endian ? 18 : 19] = static_cast<std::uint8_t>(machine >> 8);
+        return retval;
+    }
+
+    /// <summary>
+    /// Creates stub images of all supported architectures in both formats.
+    /// </summary>
+    std::vector<std::vector<std::uint8_t>> make_stubs(void) {
+        std::vector<std::vector<std::uint8_t>> retval;
+        for (auto m : { 0x014C, 0x8664, 0x01C4, 0xAA64 }) {
+            retval.push_back(make_pe(static_cast<std::uint16_t>(m)));
+        }
+        for (auto m : { 3, 40, 62, 183 }) {
+            for (auto big_endian : { false, true }) {
+                retval.push_back(make_elf(static_cast<std::uint16_t>(m),
+                    big_endian));
+            }
+        }
+        return retval;
+    }
+
+    /// <summary>
+    /// Answer the type of the image the tests are running in.
+    /// </summary>
+    constexpr machine_type this_machine(void) noexcept {
+#if defined(_M_X64) || defined(__x86_64__)
+        return machine_type::x64;
+#elif defined(_M_IX86) || defined(__i386__)
+        return machine_type::x86;
+#elif defined(_M_ARM64) || defined(__aarch64__)
+        return machine_type::arm64;
+#elif defined(_M_ARM) || defined(__arm__)
+        return machine_type::arm;
+#else
+        return machine_type::unknown;
+#endif
+    }
+
+    /// <summary>
+    /// Writes <paramref name="image" /> to the file <paramref name="child" />
+    /// in <paramref name="dir" />.
+    /// </summary>
+    std::wstring write(_In_ const temp_directory& dir,
+            _In_ const std::wstring& child,
+            _In_ const std::vector<std::uint8_t>& image) {
+        return dir.write(child, std::string(image.begin(), image.end()));
+    }
+
+} /* namespace */
+
+
+/*
+ * machine_type.pe
+ */
+TEST(machine_type, pe) {
+    const std::pair<std::uint16_t, machine_type> machines[] = {
+        { 0x014C, machine_type::x86 },
+        { 0x8664, machine_type::x64 },
+        { 0x01C0, machine_type::arm },
+        { 0x01C4, machine_type::arm },
+        { 0xAA64, machine_type::arm64 },
+        { 0x0200, machine_type::unknown },
+    };
+
+    for (auto& m : machines) {
+        const auto image = make_pe(m.first);
+        EXPECT_EQ(::get_machine_type(image.data(), image.size()), m.second);
+    }
+}
+
+
+/*
+ * machine_type.elf
+ */
+TEST(machine_type, elf) {
+    const std::pair<std::uint16_t, machine_type> machines[] = {
+        { 3, machine_type::x86 },
+        { 40, machine_type::arm },
+        { 62, machine_type::x64 },
+        { 183, machine_type::arm64 },
+        { 8, machine_type::unknown },
+    };
+
+    for (auto& m : machines) {
+        for (auto big_endian : { false, true }) {
+            const auto image = make_elf(m.first, big_endian);
+            EXPECT_EQ(::get_machine_type(image.data(), image.size()),
+                m.second);
+        }
+    }
+}
+
+
+/*
+ * machine_type.invalid
+ */
+TEST(machine_type, invalid) {
+    EXPECT_EQ(::get_machine_type(nullptr, 0), machine_type::unknown);
+    EXPECT_EQ(::get_machine_type("MZ", 2), machine_type::unknown);
+    EXPECT_EQ(::get_machine_type("#!/bin/sh\n", 10), machine_type::unknown);
+
+    // The signature is beyond the data.
+    auto image = make_pe(0x8664);
+    EXPECT_EQ(::get_machine_type(image.data(), 0x80), machine_type::unknown);
+
+    // The signature is wrong.
+    image[0x81] = 'X';
+    EXPECT_EQ(::get_machine_type(image.data(), image.size()),
+        machine_type::unknown);
+
+    // The offset of the signature is bogus.
+    image = make_pe(0x8664);
+    std::fill(image.begin() + 0x3C, image.begin() + 0x40, 0xFF);
+    EXPECT_EQ(::get_machine_type(image.data(), image.size()),
+        machine_type::unknown);
+
+    // The ELF header is truncated.
+    image = make_elf(62, false);
+    EXPECT_EQ(::get_machine_type(image.data(), 19), machine_type::unknown);
+}
+
+
+/*
+ * machine_type.this_image
+ */
+TEST(machine_type, this_image) {
+#if defined(_WIN32)
+    const auto path = ::to_utf8(::get_module_path(nullptr));
+#else /* defined(_WIN32) */
+    const std::string path("/proc/self/exe");
+#endif /* defined(_WIN32) */
+
+    std::ifstream stream(path, std::ios::binary);
+    ASSERT_TRUE(stream);
+    std::vector<char> header(64 * 1024);
+    stream.read(header.data(), header.size());
+    header.resize(static_cast<std::size_t>(stream.gcount()));
+
+    EXPECT_EQ(::get_machine_type(header.data(), header.size()),
+        this_machine());
+}
+
+
+/*
+ * machine_cache.hit
+ */
+TEST(machine_cache, hit) {
+    temp_directory dir;
+    const auto path = write(dir, L"runtime.dll", make_pe(0x8664));
+
+    machine_cache cache;
+    EXPECT_EQ(cache.get(path), machine_type::x64);
+    EXPECT_EQ(cache.size(), 1);
+
+    // Change the content without changing the size or the time of the last
+    // write, which makes the file look unchanged. The cache must therefore
+    // answer what it has read before rather than reading the file again.
+    const auto time = std::filesystem::last_write_time(path);
+    write(dir, L"runtime.dll", make_pe(0xAA64));
+    std::filesystem::last_write_time(path, time);
+    EXPECT_EQ(cache.get(path), machine_type::x64);
+    EXPECT_EQ(cache.size(), 1);
+
+    // Another path to the same file hits the same entry.
+    const auto link = dir.path(L"link.dll");
+    std::filesystem::create_hard_link(path, link);
+    EXPECT_EQ(cache.get(link), machine_type::x64);
+    EXPECT_EQ(cache.size(), 1);
+}
+
+
+/*
+ * machine_cache.miss
+ */
+TEST(machine_cache, miss) {
+    temp_directory dir;
+    const auto path = write(dir, L"runtime.dll", make_pe(0x8664));
+
+    machine_cache cache;
+    EXPECT_EQ(cache.get(path), machine_type::x64);
+    const auto time = std::filesystem::last_write_time(path);
+
+    // Rewriting the file changes the time of the last write. We set it
+    // explicitly, because the resolution of the file system might be too
+    // coarse to tell the writes apart.
+    write(dir, L"runtime.dll", make_pe(0xAA64));
+    std::filesystem::last_write_time(path, time + std::chrono::seconds(2));
+    EXPECT_EQ(cache.get(path), machine_type::arm64);
+    EXPECT_EQ(cache.size(), 1);
+
+    // A change of the size is detected even if the time is the same.
+    write(dir, L"runtime.dll", make_elf(3, false));
+    std::filesystem::last_write_time(path, time + std::chrono::seconds(2));
+    EXPECT_EQ(cache.get(path), machine_type::x86);
+    EXPECT_EQ(cache.size(), 1);
+
+    // Files that do not exist are not cached.
+    EXPECT_EQ(cache.get(dir.path(L"missing.dll")), machine_type::unknown);
+    EXPECT_EQ(cache.size(), 1);
+}
+
+
+/*
+ * benchmark.machine_type
+ */
+TEST(benchmark, machine_type) {
+    const auto stubs = make_stubs();
+
+    std::size_t cnt_known = 0;
+    std::size_t i = 0;
+    benchmark("machine_type.get_machine_type", 100000, [&](void) {
+        auto& s = stubs[i++ % stubs.size()];
+        if (::get_machine_type(s.data(), s.size()) != machine_type::unknown) {
+            ++cnt_known;
+        }
+    });
+    EXPECT_EQ(cnt_known, i);
+
+    // The cache must answer from memory once it has read all files.
+    temp_directory dir;
+    std::vector<std::wstring> paths;
+    for (std::size_t s = 0; s < stubs.size(); ++s) {
+        paths.push_back(write(dir, std::to_wstring(s) + L".dll", stubs[s]));
+    }
+
+    machine_cache cache;
+    cnt_known = 0;
+    benchmark("machine_type.cache_cold", 1, [&](void) {
+        for (auto& p : paths) {
+            if (cache.get(p) != machine_type::unknown) {
+                ++cnt_known;
+            }
+        }
+    });
+    benchmark("machine_type.cache_warm", 100, [&](void) {
+        for (auto& p : paths) {
+            if (cache.get(p) != machine_type::unknown) {
+                ++cnt_known;
+            }
+        }
+    });
+    EXPECT_EQ(cnt_known, 101 * paths.size());
+    EXPECT_EQ(cache.size(), paths.size());
+}
@@ -0,0 +1,340 @@
+﻿// <copyright file="memory_transport.h" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#if !defined(_OXRTEST_MEMORY_TRANSPORT_H)
+#define _OXRTEST_MEMORY_TRANSPORT_H
+#pragma once
+
+#include "../oxrsvc/transport.h"
+
+
+/// <summary>
+/// A transport of the <see cref="server" /> that connects clients running
+/// on other threads of the same process, which allows for testing and
+/// benchmarking the server loop without pipes or sockets.
+/// </summary>
+/// <remarks>
+/// Writes of the server complete immediately, and reads complete as soon as
+/// a client has sent data, so the measurements reflect the server loop and
+/// the handler rather than the operating system. Clients give up after
+/// <see cref="timeout" />, which turns a server that is stuck into a failed
+/// test rather than a hanging one.
+/// </remarks>
+class memory_transport final {
+
+public:
+
+    /// <summary>
+    /// Identifies the connection of a client.
+    /// </summary>
+    struct client_type final {
+        std::size_t instance;
+        std::uint64_t session;
+    };
+
+    /// <summary>
+    /// The time a client waits for the server before it fails.
+    /// </summary>
+    static constexpr std::chrono::seconds timeout = std::chrono::seconds(10);
+
+    /// <summary>
+    /// Initialises a new instance.
+    /// </summary>
+    /// <param name="instances">The number of clients that can be served
+    /// concurrently.</param>
+    explicit memory_transport(_In_ const std::size_t instances)
+        : _instances(instances), _notified(false), _stopped(false) { }
+
+    memory_transport(const memory_transport&) = delete;
+
+    /// <summary>
+    /// Starts waiting for a client to connect to the given instance.
+    /// </summary>
+    void accept(_In_ const std::size_t instance) {
+        std::lock_guard<std::mutex> l(this->_lock);
+        this->_instances.at(instance).accepting = true;
+        this->_client_cv.notify_all();
+    }
+
+    /// <summary>
+    /// Cancels all pending operations on the given instance.
+    /// </summary>
+    void cancel(_In_ const std::size_t instance) {
+        std::lock_guard<std::mutex> l(this->_lock);
+        auto& i = this->_instances.at(instance);
+        if (i.accepting) {
+            i.accepting = false;
+            this->complete(instance, transport_operation::accept, 0, 1);
+        }
+        if (i.reading) {
+            i.reading = false;
+            this->complete(instance, transport_operation::read, 0, 1);
+        }
+    }
+
+    /// <summary>
+    /// Closes the connection of a client from the client side, which the
+    /// server observes as a read of zero bytes.
+    /// </summary>
+    void close(_In_ const client_type& client) {
+        std::lock_guard<std::mutex> l(this->_lock);
+        auto& i = this->_instances.at(client.instance);
+        if (i.session == client.session) {
+            i.hung_up = true;
+            if (i.reading) {
+                i.reading = false;
+                this->complete(client.instance, transport_operation::read,
+                    0, 0);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Connects a new client as soon as an instance accepts it.
+    /// </summary>
+    /// <returns>The connection of the client.</returns>
+    client_type connect(void) {
+        std::unique_lock<std::mutex> l(this->_lock);
+        std::size_t retval = 0;
+
+        const auto accepted = this->_client_cv.wait_for(l, timeout,
+                [this, &retval](void) {
+            for (retval = 0; retval < this->_instances.size(); ++retval) {
+                if (this->_instances[retval].accepting) {
+                    return true;
+                }
+            }
+            return this->_stopped;
+        });
+        if (!accepted || (retval >= this->_instances.size())) {
+            throw std::runtime_error("No instance accepted the client.");
+        }
+
+        auto& i = this->_instances[retval];
+        i.accepting = false;
+        i.hung_up = false;
+        i.inbound.clear();
+        i.outbound.clear();
+        this->complete(retval, transport_operation::accept, 0, 0);
+        return { retval, i.session };
+    }
+
+    /// <summary>
+    /// Closes the connection of the given instance.
+    /// </summary>
+    void disconnect(_In_ const std::size_t instance) {
+        std::lock_guard<std::mutex> l(this->_lock);
+        auto& i = this->_instances.at(instance);
+        ++i.session;
+        i.inbound.clear();
+        i.outbound.clear();
+        this->_client_cv.notify_all();
+    }
+
+    /// <summary>
+    /// Answer the number of instances.
+    /// </summary>
+    inline std::size_t instances(void) const noexcept {
+        return this->_instances.size();
+    }
+
+    /// <summary>
+    /// Wakes the thread waiting for completions with a notification.
+    /// </summary>
+    void notify(void) {
+        std::lock_guard<std::mutex> l(this->_lock);
+        this->_notified = true;
+        this->_server_cv.notify_all();
+    }
+
+    /// <summary>
+    /// Starts reading from the given instance.
+    /// </summary>
+    void read(_In_ const std::size_t instance,
+            _Out_writes_bytes_(cnt) void *dst,
+            _In_ const std::size_t cnt) {
+        std::lock_guard<std::mutex> l(this->_lock);
+        auto& i = this->_instances.at(instance);
+        i.cnt_read = cnt;
+        i.dst = dst;
+        i.reading = true;
+        this->deliver(instance);
+    }
+
+    /// <summary>
+    /// Receives exactly <paramref name="cnt" /> bytes as a client.
+    /// </summary>
+    /// <returns><see langword="false" /> if the server closed the
+    /// connection before all data have been received.</returns>
+    /// <exception cref="std::runtime_error">If the server did not respond
+    /// within <see cref="timeout" />.</exception>
+    bool receive(_In_ const client_type& client,
+            _Out_writes_bytes_(cnt) void *dst,
+            _In_ const std::size_t cnt) {
+        std::unique_lock<std::mutex> l(this->_lock);
+        auto& i = this->_instances.at(client.instance);
+        const auto done = this->_client_cv.wait_for(l, timeout,
+                [this, &client, &i, cnt](void) {
+            return (i.session != client.session)
+                || (i.outbound.size() >= cnt)
+                || this->_stopped;
+        });
+        if (!done) {
+            throw std::runtime_error("The server did not respond in time.");
+        }
+
+        if ((i.session != client.session) || (i.outbound.size() < cnt)) {
+            return false;
+        }
+
+        auto d = static_cast<std::uint8_t *>(dst);
+        std::copy(i.outbound.begin(), i.outbound.begin() + cnt, d);
+        i.outbound.erase(i.outbound.begin(), i.outbound.begin() + cnt);
+        return true;
+    }
+
+    /// <summary>
+    /// Sends data as a client.
+    /// </summary>
+    /// <returns><see langword="false" /> if the server closed the
+    /// connection.</returns>
+    bool send(_In_ const client_type& client,
+            _In_reads_bytes_(cnt) const void *src,
+            _In_ const std::size_t cnt) {
+        std::lock_guard<std::mutex> l(this->_lock);
+        auto& i = this->_instances.at(client.instance);
+        if (i.session != client.session) {
+            return false;
+        }
+
+        auto s = static_cast<const std::uint8_t *>(src);
+        i.inbound.insert(i.inbound.end(), s, s + cnt);
+        this->deliver(client.instance);
+        return true;
+    }
+
+    /// <summary>
+    /// Makes <see cref="wait" /> return <see langword="false" /> once all
+    /// queued completions have been reported.
+    /// </summary>
+    void stop(void) {
+        std::lock_guard<std::mutex> l(this->_lock);
+        this->_stopped = true;
+        this->_client_cv.notify_all();
+        this->_server_cv.notify_all();
+    }
+
+    /// <summary>
+    /// Waits for the next operation to complete.
+    /// </summary>
+    bool wait(_Out_ transport_completion& completion) {
+        std::unique_lock<std::mutex> l(this->_lock);
+        // The server may be idle for an arbitrary amount of time.
+        while (!this->_server_cv.wait_for(l, timeout, [this](void) {
+                return this->_stopped || this->_notified
+                    || !this->_completed.empty();
+            }));
+
+        // Completions that are already queued are reported before the stop,
+        // such that the statistics of the server include all responses the
+        // clients have received.
+        if (this->_completed.empty() && this->_stopped) {
+            return false;
+        }
+
+        if (this->_notified) {
+            this->_notified = false;
+            completion = { 0, 0, 0, transport_operation::notify };
+        } else {
+            completion = this->_completed.front();
+            this->_completed.pop_front();
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Starts writing to the given instance, which completes immediately
+    /// unless the client has closed its end.
+    /// </summary>
+    void write(_In_ const std::size_t instance,
+            _In_reads_bytes_(cnt) const void *src,
+            _In_ const std::size_t cnt) {
+        std::lock_guard<std::mutex> l(this->_lock);
+        auto& i = this->_instances.at(instance);
+        if (i.hung_up) {
+            this->complete(instance, transport_operation::write, 0, 1);
+        } else {
+            auto s = static_cast<const std::uint8_t *>(src);
+            i.outbound.insert(i.outbound.end(), s, s + cnt);
+            this->complete(instance, transport_operation::write, cnt, 0);
+            this->_client_cv.notify_all();
+        }
+    }
+
+    memory_transport& operator =(const memory_transport&) = delete;
+
+private:
+
+    /// <summary>
+    /// The state of a single connection.
+    /// </summary>
+    struct memory_instance final {
+        bool accepting = false;
+        std::size_t cnt_read = 0;
+        void *dst = nullptr;
+        bool hung_up = false;
+        std::deque<std::uint8_t> inbound;
+        std::deque<std::uint8_t> outbound;
+        bool reading = false;
+        std::uint64_t session = 0;
+    };
+
+    /// <summary>
+    /// Queues the completion of an operation. The caller must hold the lock.
+    /// </summary>
+    void complete(_In_ const std::size_t instance,
+            _In_ const transport_operation operation,
+            _In_ const std::size_t cnt,
+            _In_ const std::uint32_t error) {
+        this->_completed.push_back({ cnt, error, instance, operation });
+        this->_server_cv.notify_all();
+    }
+
+    /// <summary>
+    /// Completes a pending read of the given instance if the client has sent
+    /// data or closed its end. The caller must hold the lock.
+    /// </summary>
+    void deliver(_In_ const std::size_t instance) {
+        auto& i = this->_instances[instance];
+        if (!i.reading) {
+            return;
+        }
+
+        if (!i.inbound.empty()) {
+            const auto cnt = (std::min)(i.cnt_read, i.inbound.size());
+            std::copy(i.inbound.begin(), i.inbound.begin() + cnt,
+                static_cast<std::uint8_t *>(i.dst));
+            i.inbound.erase(i.inbound.begin(), i.inbound.begin() + cnt);
+            i.reading = false;
+            this->complete(instance, transport_operation::read, cnt, 0);
+
+        } else if (i.hung_up) {
+            i.reading = false;
+            this->complete(instance, transport_operation::read, 0, 0);
+        }
+    }
+
+    std::condition_variable _client_cv;
+    std::deque<transport_completion> _completed;
+    std::vector<memory_instance> _instances;
+    std::mutex _lock;
+    bool _notified;
+    std::condition_variable _server_cv;
+    bool _stopped;
+};
+
+#endif /* !defined(_OXRTEST_MEMORY_TRANSPORT_H) */
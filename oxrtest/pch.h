@@ -0,0 +1,30 @@
+﻿// <copyright file="pch.h" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#if !defined(_OXRTEST_PCH_H)
+#define _OXRTEST_PCH_H
+#pragma once
+
+#include <clocale>
+#include <cmath>
+#include <condition_variable>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <sstream>
+
+#include "../oxrswitch/pch.h"
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif /* !defined(_WIN32) */
+
+#include <gtest/gtest.h>
+
+#endif /* !defined(_OXRTEST_PCH_H) */
@@ -0,0 +1,400 @@
+﻿// <copyright file="protocol_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrsvc/protocol.h"
+
+#include "benchmark.h"
+
+
+namespace {
+
+    /// <summary>
+    /// A path with a character beyond the BMP, which is a surrogate pair in
+    /// UTF-16.
+    /// </summary>
+    const std::u16string emoji_path = u"C:\\VR \xD83E\xDD7D\\runtime.json";
+
+    /// <summary>
+    /// The wide string <see cref="emoji_path" /> is parsed into.
+    /// </summary>
+    const std::wstring emoji_wpath = std::wstring(L"C:\\VR ")
+        + ((sizeof(wchar_t) == 2) ? L"\xD83E\xDD7D" : L"\U0001F97D")
+        + L"\\runtime.json";
+
+    /// <summary>
+    /// Appends <paramref name="cnt" /> bytes to <paramref name="buffer" />.
+    /// </summary>
+    void append(ring_buffer& buffer, const void *src, std::size_t cnt) {
+        auto s = static_cast<const std::uint8_t *>(src);
+        while (cnt > 0) {
+            auto dst = buffer.writable();
+            ASSERT_GT(dst.second, 0);
+            const auto c = (std::min)(cnt, dst.second);
+            std::copy(s, s + c, dst.first);
+            buffer.commit(c);
+            s += c;
+            cnt -= c;
+        }
+    }
+
+    /// <summary>
+    /// Creates an activation request in the zero-terminated format of old
+    /// clients.
+    /// </summary>
+    std::vector<std::uint8_t> make_legacy(const std::u16string& runtime,
+            const std::u16string& wow_runtime) {
+        // An empty WOW64 path already forms the pair of terminators that
+        // ends the request.
+        std::u16string units = runtime;
+        units.push_back(0);
+        units += wow_runtime;
+        units.push_back(0);
+        if (!wow_runtime.empty()) {
+            units.push_back(0);
+        }
+
+        auto data = reinterpret_cast<const std::uint8_t *>(units.data());
+        return std::vector<std::uint8_t>(data,
+            data + units.size() * sizeof(char16_t));
+    }
+
+    /// <summary>
+    /// Creates a framed activation request.
+    /// </summary>
+    std::vector<std::uint8_t> make_activate(const std::u16string& runtime,
+            const std::u16string& wow_runtime) {
+        const std::uint32_t counts[] = {
+            static_cast<std::uint32_t>(runtime.size()),
+            static_cast<std::uint32_t>(wow_runtime.size())
+        };
+
+        frame_header header;
+        header.magic = frame_magic;
+        header.version = frame_version;
+        header.type = message_type::activate;
+        header.length = static_cast<std::uint32_t>(sizeof(counts)
+            + (runtime.size() + wow_runtime.size()) * sizeof(char16_t));
+
+        std::vector<std::uint8_t> retval(sizeof(header) + header.length);
+        auto dst = retval.data();
+        std::memcpy(dst, &header, sizeof(header));
+        dst += sizeof(header);
+        std::memcpy(dst, counts, sizeof(counts));
+        dst += sizeof(counts);
+        std::memcpy(dst, runtime.data(), runtime.size() * sizeof(char16_t));
+        dst += runtime.size() * sizeof(char16_t);
+        std::memcpy(dst, wow_runtime.data(),
+            wow_runtime.size() * sizeof(char16_t));
+        return retval;
+    }
+
+    /// <summary>
+    /// Parses a <see cref="message_type::catalogue" /> message like a client
+    /// does.
+    /// </summary>
+    std::vector<catalogue_entry> read_catalogue(
+            const std::vector<std::uint8_t>& message) {
+        std::vector<catalogue_entry> retval;
+        std::size_t offset = 0;
+        const auto read = [&](void *dst, const std::size_t cnt) {
+            EXPECT_LE(offset + cnt, message.size());
+            if (offset + cnt <= message.size()) {
+                std::memcpy(dst, message.data() + offset, cnt);
+            }
+            offset += cnt;
+        };
+        const auto read_string = [&](const std::uint32_t cnt) {
+            std::u16string units(cnt, u'\0');
+            read(&units[0], cnt * sizeof(char16_t));
+            return std::wstring(units.begin(), units.end());
+        };
+
+        frame_header header;
+        read(&header, sizeof(header));
+        EXPECT_EQ(header.magic, frame_magic);
+        EXPECT_EQ(header.type, message_type::catalogue);
+        EXPECT_EQ(header.length, message.size() - sizeof(header));
+
+        std::uint32_t cnt = 0;
+        read(&cnt, sizeof(cnt));
+        for (std::uint32_t i = 0; i < cnt; ++i) {
+            catalogue_entry entry;
+            std::uint32_t counts[2];
+            read(&entry.id, sizeof(entry.id));
+            read(counts, sizeof(counts));
+            entry.path = read_string(counts[0]);
+            entry.wow_path = read_string(counts[1]);
+            retval.push_back(std::move(entry));
+        }
+
+        EXPECT_EQ(offset, message.size());
+        return retval;
+    }
+
+    /// <summary>
+    /// Feeds <paramref name="data" /> to the parser in parts of
+    /// <paramref name="fragment" /> bytes and answers the number of calls
+    /// that did not yield a complete request.
+    /// </summary>
+    /// <param name="rescan">If <see langword="true" />, forget how far the
+    /// data have been scanned before every call, which is how the parser
+    /// used to work.</param>
+    std::size_t parse_fragmented(const std::vector<std::uint8_t>& data,
+            const std::size_t fragment,
+            const bool rescan,
+            request& request) {
+        ring_buffer input(max_frame_size);
+        std::size_t scanned = 0;
+        std::size_t retval = 0;
+
+        for (std::size_t i = 0; i < data.size(); i += fragment) {
+            append(input, data.data() + i, (std::min)(fragment,
+                data.size() - i));
+            if (rescan) {
+                scanned = 0;
+            }
+
+            const auto consumed = ::parse_request(input, scanned, request);
+            if (consumed == 0) {
+                ++retval;
+            } else {
+                EXPECT_EQ(consumed, data.size());
+                EXPECT_EQ(scanned, 0);
+            }
+        }
+
+        return retval;
+    }
+
+} /* namespace */
+
+
+/*
+ * protocol.activate
+ */
+TEST(protocol, activate) {
+    const auto data = make_activate(emoji_path, u"C:\\VR\\wow.json");
+    ring_buffer input(max_frame_size);
+    append(input, data.data(), data.size());
+
+    request req;
+    std::size_t scanned = 0;
+    EXPECT_EQ(::parse_request(input, scanned, req), data.size());
+    EXPECT_FALSE(req.legacy);
+    EXPECT_EQ(req.type, message_type::activate);
+    EXPECT_EQ(req.version, frame_version);
+    EXPECT_EQ(req.runtime, emoji_wpath);
+    EXPECT_EQ(req.wow_runtime, L"C:\\VR\\wow.json");
+}
+
+
+/*
+ * protocol.catalogue
+ */
+TEST(protocol, catalogue) {
+    const std::vector<catalogue_entry> entries = {
+        { 1, L"C:\\VR\\runtime.json", L"C:\\VR\\runtime32.json" },
+        { 7, L"C:\\Other\\runtime.json", L"" }
+    };
+
+    std::vector<std::uint8_t> output;
+    EXPECT_EQ(::write_catalogue(output, entries), entries.size());
+
+    const auto actual = read_catalogue(output);
+    ASSERT_EQ(actual.size(), entries.size());
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        EXPECT_EQ(actual[i].id, entries[i].id);
+        EXPECT_EQ(actual[i].path, entries[i].path);
+        EXPECT_EQ(actual[i].wow_path, entries[i].wow_path);
+    }
+
+    // An empty catalogue only comprises the number of runtimes.
+    output.clear();
+    EXPECT_EQ(::write_catalogue(output, { }), 0);
+    EXPECT_EQ(output.size(), sizeof(frame_header) + sizeof(std::uint32_t));
+    EXPECT_TRUE(read_catalogue(output).empty());
+}
+
+
+/*
+ * protocol.catalogue_capped
+ */
+TEST(protocol, catalogue_capped) {
+    // Each runtime takes more than 2 KiB, so the catalogue cannot fit into a
+    // single frame.
+    std::vector<catalogue_entry> entries;
+    for (std::uint32_t i = 1; i <= 64; ++i) {
+        entries.push_back({ i,
+            std::wstring(1000, L'a') + std::to_wstring(i),
+            std::wstring(100, L'b') });
+    }
+
+    std::vector<std::uint8_t> output;
+    const auto cnt = ::write_catalogue(output, entries);
+    EXPECT_GT(cnt, 0);
+    EXPECT_LT(cnt, entries.size());
+    EXPECT_LE(output.size(), max_frame_size);
+
+    // The runtimes with the lowest identifiers are reported completely.
+    const auto actual = read_catalogue(output);
+    ASSERT_EQ(actual.size(), cnt);
+    for (std::size_t i = 0; i < cnt; ++i) {
+        EXPECT_EQ(actual[i].id, entries[i].id);
+        EXPECT_EQ(actual[i].path, entries[i].path);
+    }
+
+    // Adding another runtime would have exceeded the limit.
+    const auto next = sizeof(std::uint32_t) * 3
+        + (entries[cnt].path.size() + entries[cnt].wow_path.size())
+        * sizeof(char16_t);
+    EXPECT_GT(output.size() + next, max_frame_size);
+}
+
+
+/*
+ * protocol.changed
+ */
+TEST(protocol, changed) {
+    std::vector<std::uint8_t> output;
+    ::write_changed(output, emoji_wpath, L"");
+
+    // The message must be the same on all platforms, which is UTF-16.
+    const auto expected_units = emoji_path.size();
+    ASSERT_EQ(output.size(), sizeof(frame_header) + 2 * sizeof(std::uint32_t)
+        + expected_units * sizeof(char16_t));
+
+    frame_header header;
+    std::memcpy(&header, output.data(), sizeof(header));
+    EXPECT_EQ(header.magic, frame_magic);
+    EXPECT_EQ(header.type, message_type::changed);
+    EXPECT_EQ(header.length, output.size() - sizeof(header));
+
+    std::uint32_t counts[2];
+    std::memcpy(counts, output.data() + sizeof(header), sizeof(counts));
+    EXPECT_EQ(counts[0], expected_units);
+    EXPECT_EQ(counts[1], 0);
+
+    std::u16string units(expected_units, u'\0');
+    std::memcpy(&units[0], output.data() + sizeof(header) + sizeof(counts),
+        units.size() * sizeof(char16_t));
+    EXPECT_EQ(units, emoji_path);
+}
+
+
+/*
+ * protocol.legacy
+ */
+TEST(protocol, legacy) {
+    // The request arrives byte by byte, and the parser must report it once
+    // it is complete, including an empty WOW64 path.
+    {
+        const auto data = make_legacy(emoji_path, u"");
+        request req;
+        EXPECT_EQ(parse_fragmented(data, 1, false, req), data.size() - 1);
+        EXPECT_TRUE(req.legacy);
+        EXPECT_EQ(req.type, message_type::activate);
+        EXPECT_EQ(req.runtime, emoji_wpath);
+        EXPECT_EQ(req.wow_runtime, L"");
+    }
+
+    {
+        const auto data = make_legacy(u"C:\\a.json", u"C:\\b.json");
+        request req;
+        EXPECT_EQ(parse_fragmented(data, 3, false, req),
+            (data.size() + 2) / 3 - 1);
+        EXPECT_EQ(req.runtime, L"C:\\a.json");
+        EXPECT_EQ(req.wow_runtime, L"C:\\b.json");
+    }
+
+    // The parser must resume at the last unit it has seen, which might be
+    // the first of the pair of terminators.
+    {
+        const auto data = make_legacy(u"C:\\a.json", u"");
+        ring_buffer input(max_frame_size);
+        std::size_t scanned = 0;
+        request req;
+
+        const auto split = data.size() - sizeof(char16_t);
+        append(input, data.data(), split);
+        EXPECT_EQ(::parse_request(input, scanned, req), 0);
+        EXPECT_EQ(scanned, split);
+
+        append(input, data.data() + split, data.size() - split);
+        EXPECT_EQ(::parse_request(input, scanned, req), data.size());
+        EXPECT_EQ(req.runtime, L"C:\\a.json");
+    }
+}
+
+
+/*
+ * protocol.oversized
+ */
+TEST(protocol, oversized) {
+    const std::u16string units(max_frame_size / sizeof(char16_t), u'a');
+    ring_buffer input(max_frame_size);
+    append(input, units.data(), units.size() * sizeof(char16_t));
+
+    request req;
+    std::size_t scanned = 0;
+    EXPECT_THROW(::parse_request(input, scanned, req), std::invalid_argument);
+}
+
+
+/*
+ * protocol.result
+ */
+TEST(protocol, result) {
+    const std::int32_t status = static_cast<std::int32_t>(0x80070490);
+    request req;
+    req.legacy = false;
+
+    std::vector<std::uint8_t> output;
+    ::write_result(output, req, status);
+    ASSERT_EQ(output.size(), sizeof(frame_header) + sizeof(status));
+
+    frame_header header;
+    std::memcpy(&header, output.data(), sizeof(header));
+    EXPECT_EQ(header.type, message_type::result);
+    EXPECT_EQ(header.length, sizeof(status));
+
+    std::int32_t actual;
+    std::memcpy(&actual, output.data() + sizeof(header), sizeof(actual));
+    EXPECT_EQ(actual, status);
+
+    // Old clients only expect the status code.
+    req.legacy = true;
+    output.clear();
+    ::write_result(output, req, status);
+    ASSERT_EQ(output.size(), sizeof(status));
+    std::memcpy(&actual, output.data(), sizeof(actual));
+    EXPECT_EQ(actual, status);
+}
+
+
+/*
+ * benchmark.parse_legacy
+ */
+TEST(benchmark, parse_legacy) {
+    // A request close to the maximum size that trickles in small parts used
+    // to be scanned from its begin whenever a part arrived.
+    const std::u16string path(16000, u'a');
+    const auto data = make_legacy(path, path);
+    request req;
+
+    const auto rescan = benchmark("parse_legacy.rescan", 3, [&](void) {
+        parse_fragmented(data, 64, true, req);
+    });
+
+    const auto incremental = benchmark("parse_legacy.incremental", 3,
+            [&](void) {
+        parse_fragmented(data, 64, false, req);
+    });
+
+    EXPECT_EQ(req.runtime.size(), path.size());
+    EXPECT_LT(incremental, rescan);
+}
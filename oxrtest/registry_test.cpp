@@ -0,0 +1,132 @@
+﻿// <copyright file="registry_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrswitch/registry.h"
+
+
+namespace {
+
+    /// <summary>
+    /// A hive with two runtimes and an unrelated key.
+    /// </summary>
+    const auto hive = nlohmann::json::parse(R"({
+        "SOFTWARE": {
+            "Khronos": {
+                "OpenXR": {
+                    "1": {
+                        "ActiveRuntime": "C:\\SteamVR\\steamxr_win64.json",
+                        "AvailableRuntimes": {
+                            "C:\\SteamVR\\steamxr_win64.json": 0,
+                            "C:\\Varjo\\VarjoOpenXR.json": 0
+                        }
+                    }
+                }
+            },
+            "Valve": { }
+        }
+    })");
+
+} /* namespace */
+
+
+/*
+ * memory_registry.try_open
+ */
+TEST(memory_registry, try_open) {
+    memory_registry registry(hive);
+    memory_registry::key_type key = nullptr;
+
+    EXPECT_TRUE(registry.try_open(registry.root(), L"SOFTWARE", key));
+    EXPECT_NE(key, nullptr);
+
+    EXPECT_TRUE(registry.try_open(registry.root(),
+        L"SOFTWARE\\Khronos\\OpenXR\\1", key));
+    EXPECT_NE(key, nullptr);
+
+    EXPECT_FALSE(registry.try_open(registry.root(),
+        L"SOFTWARE\\Khronos\\OpenXR\\2", key));
+    EXPECT_FALSE(registry.try_open(registry.root(), L"SYSTEM", key));
+}
+
+
+/*
+ * memory_registry.case_insensitive
+ */
+TEST(memory_registry, case_insensitive) {
+    memory_registry registry(hive);
+    memory_registry::key_type key = nullptr;
+
+    ASSERT_TRUE(registry.try_open(registry.root(),
+        L"software\\KHRONOS\\openxr\\1", key));
+
+    std::wstring value;
+    EXPECT_TRUE(registry.try_get_string(key, L"activeruntime", value));
+    EXPECT_EQ(value, L"C:\\SteamVR\\steamxr_win64.json");
+
+    // Names with umlauts must be folded, too.
+    memory_registry umlauts(nlohmann::json::parse(
+        R"({ "\u00C4": { "\u00D6": "\u00DC" } })"));
+    ASSERT_TRUE(umlauts.try_open(umlauts.root(), L"\u00E4", key));
+    EXPECT_TRUE(umlauts.try_get_string(key, L"\u00F6", value));
+    EXPECT_EQ(value, L"\u00DC");
+}
+
+
+/*
+ * memory_registry.try_get_string
+ */
+TEST(memory_registry, try_get_string) {
+    memory_registry registry(hive);
+    memory_registry::key_type key = nullptr;
+    std::wstring value;
+
+    ASSERT_TRUE(registry.try_open(registry.root(),
+        L"SOFTWARE\\Khronos\\OpenXR\\1\\AvailableRuntimes", key));
+
+    // Values which are not strings exist, but cannot be read as strings.
+    EXPECT_FALSE(registry.try_get_string(key,
+        L"C:\\Varjo\\VarjoOpenXR.json", value));
+    EXPECT_FALSE(registry.try_get_string(key, L"ActiveRuntime", value));
+    EXPECT_FALSE(registry.try_get_string(key, nullptr, value));
+}
+
+
+/*
+ * memory_registry.enumerate
+ */
+TEST(memory_registry, enumerate) {
+    memory_registry registry(hive);
+    memory_registry::key_type key = nullptr;
+
+    std::set<std::wstring> keys;
+    registry.enumerate_keys(registry.root(), [&keys](const std::wstring& n) {
+        keys.insert(n);
+    });
+    EXPECT_EQ(keys, std::set<std::wstring>({ L"SOFTWARE" }));
+
+    ASSERT_TRUE(registry.try_open(registry.root(),
+        L"SOFTWARE\\Khronos\\OpenXR\\1\\AvailableRuntimes", key));
+    std::set<std::wstring> values;
+    registry.enumerate_values(key, [&values](const std::wstring& n) {
+        values.insert(n);
+    });
+    EXPECT_EQ(values, std::set<std::wstring>({
+        L"C:\\SteamVR\\steamxr_win64.json",
+        L"C:\\Varjo\\VarjoOpenXR.json" }));
+}
+
+
+/*
+ * memory_registry.invalid
+ */
+TEST(memory_registry, invalid) {
+    EXPECT_THROW(memory_registry(nlohmann::json::parse("[ 1, 2 ]")),
+        std::invalid_argument);
+    EXPECT_THROW(memory_registry::load(L"does-not-exist.json"),
+        std::invalid_argument);
+}
@@ -0,0 +1,135 @@
+﻿// <copyright file="runtime_catalogue_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrsvc/runtime_catalogue.h"
+
+#include "temp_directory.h"
+
+
+namespace {
+
+    typedef std::vector<std::pair<std::wstring, std::wstring>> discovered_type;
+
+    /// <summary>
+    /// Answer the identifier of the entry for <paramref name="path" /> or
+    /// <see cref="catalogue_entry::invalid_id" /> if there is none.
+    /// </summary>
+    std::uint32_t find_id(const std::vector<catalogue_entry>& entries,
+            const std::wstring& path) {
+        auto it = std::find_if(entries.begin(), entries.end(),
+            [&path](const catalogue_entry& e) { return (e.path == path); });
+        return (it != entries.end()) ? it->id : catalogue_entry::invalid_id;
+    }
+
+} /* namespace */
+
+
+/*
+ * runtime_catalogue.rebuild
+ */
+TEST(runtime_catalogue, rebuild) {
+    temp_directory dir;
+    const auto a = dir.write(L"a/runtime.json", "{}");
+    const auto a32 = dir.write(L"a/runtime32.json", "{}");
+    const auto b = dir.write(L"b/runtime.json", "{}");
+    const auto c = dir.write(L"c/runtime.json", "{}");
+    const auto missing = dir.path(L"d/runtime.json");
+
+    std::vector<catalogue_entry> entries;
+    std::uint32_t next_id = catalogue_entry::invalid_id + 1;
+
+    // Registered runtimes are paired with the WOW64 runtime in the same
+    // directory and win over a discovered runtime with the same path.
+    // Runtimes that do not exist are not added.
+    ::rebuild_catalogue(entries, next_id, { a, b, missing }, { a32 },
+        discovered_type({ { c, L"" }, { a, L"" } }));
+    ASSERT_EQ(entries.size(), 3);
+    EXPECT_EQ(entries[0].id, 1);
+    EXPECT_EQ(entries[0].path, a);
+    EXPECT_EQ(entries[0].wow_path, a32);
+    EXPECT_EQ(entries[1].id, 2);
+    EXPECT_EQ(entries[1].path, b);
+    EXPECT_EQ(entries[1].wow_path, L"");
+    EXPECT_EQ(entries[2].id, 3);
+    EXPECT_EQ(entries[2].path, c);
+    EXPECT_EQ(next_id, 4);
+
+    // Known runtimes keep their identifiers regardless of the order, and
+    // they are not validated again.
+    std::filesystem::remove(std::filesystem::path(b));
+    ::rebuild_catalogue(entries, next_id, { b, a }, { a32 },
+        discovered_type({ { c, L"" } }));
+    ASSERT_EQ(entries.size(), 3);
+    EXPECT_EQ(find_id(entries, a), 1);
+    EXPECT_EQ(find_id(entries, b), 2);
+    EXPECT_EQ(find_id(entries, c), 3);
+    EXPECT_EQ(next_id, 4);
+
+    // Runtimes that have disappeared are removed, and their identifiers are
+    // not reused if they come back.
+    ::rebuild_catalogue(entries, next_id, { a }, { a32 }, discovered_type());
+    ASSERT_EQ(entries.size(), 1);
+    EXPECT_EQ(find_id(entries, a), 1);
+
+    ::rebuild_catalogue(entries, next_id, { a }, { a32 },
+        discovered_type({ { c, L"" } }));
+    ASSERT_EQ(entries.size(), 2);
+    EXPECT_EQ(find_id(entries, a), 1);
+    EXPECT_EQ(find_id(entries, c), 4);
+    EXPECT_EQ(next_id, 5);
+}
+
+
+/*
+ * runtime_catalogue.rebuild_wow
+ */
+TEST(runtime_catalogue, rebuild_wow) {
+    temp_directory dir;
+    const auto a = dir.write(L"a/runtime.json", "{}");
+    const auto a32 = dir.write(L"a/runtime32.json", "{}");
+    const auto b32 = dir.write(L"b/runtime32.json", "{}");
+    const auto missing32 = dir.path(L"c/runtime32.json");
+
+    std::vector<catalogue_entry> entries;
+    std::uint32_t next_id = catalogue_entry::invalid_id + 1;
+
+    ::rebuild_catalogue(entries, next_id, { }, { },
+        discovered_type({ { a, a32 } }));
+    ASSERT_EQ(entries.size(), 1);
+    EXPECT_EQ(entries[0].id, 1);
+    EXPECT_EQ(entries[0].wow_path, a32);
+
+    // An identifier must never designate another pair of runtimes, so a
+    // different WOW64 runtime makes a new entry.
+    ::rebuild_catalogue(entries, next_id, { }, { },
+        discovered_type({ { a, b32 } }));
+    ASSERT_EQ(entries.size(), 1);
+    EXPECT_EQ(entries[0].id, 2);
+    EXPECT_EQ(entries[0].wow_path, b32);
+
+    ::rebuild_catalogue(entries, next_id, { }, { },
+        discovered_type({ { a, L"" } }));
+    ASSERT_EQ(entries.size(), 1);
+    EXPECT_EQ(entries[0].id, 3);
+    EXPECT_EQ(entries[0].wow_path, L"");
+
+    // A WOW64 runtime that does not exist leaves the entry as it is until it
+    // is installed.
+    ::rebuild_catalogue(entries, next_id, { }, { },
+        discovered_type({ { a, missing32 } }));
+    ASSERT_EQ(entries.size(), 1);
+    EXPECT_EQ(entries[0].id, 3);
+    EXPECT_EQ(entries[0].wow_path, L"");
+
+    const auto installed32 = dir.write(L"c/runtime32.json", "{}");
+    ::rebuild_catalogue(entries, next_id, { }, { },
+        discovered_type({ { a, installed32 } }));
+    ASSERT_EQ(entries.size(), 1);
+    EXPECT_EQ(entries[0].id, 4);
+    EXPECT_EQ(entries[0].wow_path, installed32);
+}
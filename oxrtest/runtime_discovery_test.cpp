@@ -0,0 +1,130 @@
+﻿// <copyright file="runtime_discovery_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrswitch/runtime_discovery.h"
+
+#include "xdg_environment.h"
+
+
+#if !defined(_WIN32)
+namespace {
+
+    /// <summary>
+    /// Collects what a <see cref="runtime_discovery" /> reports.
+    /// </summary>
+    struct recorder final {
+        std::atomic<unsigned int> completed { 0 };
+        std::exception_ptr error;
+        std::mutex lock;
+        std::vector<std::wstring> names;
+
+        /// <summary>
+        /// Answer the names reported so far in alphabetical order.
+        /// </summary>
+        std::vector<std::wstring> sorted(void) {
+            std::lock_guard<std::mutex> l(this->lock);
+            auto retval = this->names;
+            std::sort(retval.begin(), retval.end());
+            return retval;
+        }
+    };
+
+} /* namespace */
+
+
+/*
+ * runtime_discovery.callbacks
+ */
+TEST(runtime_discovery, callbacks) {
+    xdg_environment env;
+    env.manifest(L"home/.config/openxr/1/alpha.json", "Alpha");
+    env.manifest(L"usr/share/openxr/1/beta.json", "Beta");
+
+    recorder r;
+    runtime_discovery discovery([&r](const runtime& rt) {
+        std::lock_guard<std::mutex> l(r.lock);
+        r.names.push_back(rt.name());
+    }, [&r](std::exception_ptr e) {
+        r.error = e;
+        ++r.completed;
+    });
+    discovery.wait();
+
+    EXPECT_TRUE(discovery.completed());
+    EXPECT_FALSE(discovery.cancelled());
+    EXPECT_EQ(r.completed.load(), 1u);
+    EXPECT_FALSE(r.error);
+    EXPECT_EQ(r.sorted(), std::vector<std::wstring>({ L"Alpha", L"Beta" }));
+
+    // The first runtime cannot be found after the discovery has completed.
+    EXPECT_GE(discovery.time_to_first().count(), 0);
+    EXPECT_LE(discovery.time_to_first(), discovery.time_to_complete());
+}
+
+
+/*
+ * runtime_discovery.empty
+ */
+TEST(runtime_discovery, empty) {
+    xdg_environment env;
+
+    std::atomic<unsigned int> completed(0);
+    runtime_discovery discovery([](const runtime&) { },
+        [&completed](std::exception_ptr) { ++completed; });
+    discovery.wait();
+
+    // Without any runtime, there is no time to the first one.
+    EXPECT_TRUE(discovery.completed());
+    EXPECT_EQ(completed.load(), 1u);
+    EXPECT_LT(discovery.time_to_first().count(), 0);
+    EXPECT_GE(discovery.time_to_complete().count(), 0);
+}
+
+
+/*
+ * runtime_discovery.cancel
+ */
+TEST(runtime_discovery, cancel) {
+    xdg_environment env;
+    env.manifest(L"etc/xdg/openxr/1/alpha.json", "Alpha");
+    env.manifest(L"home/.config/openxr/1/beta.json", "Beta");
+    env.manifest(L"usr/share/openxr/1/gamma.json", "Gamma");
+
+    // Hold the discovery in the callback of the first runtime until it has
+    // been cancelled, which makes it skip the remaining folders.
+    std::promise<void> found;
+    std::promise<void> resume;
+    auto resumed = resume.get_future().share();
+
+    recorder r;
+    runtime_discovery discovery([&](const runtime& rt) {
+        std::lock_guard<std::mutex> l(r.lock);
+        r.names.push_back(rt.name());
+        if (r.names.size() == 1) {
+            found.set_value();
+            resumed.wait_for(std::chrono::seconds(5));
+        }
+    }, [&r](std::exception_ptr) { ++r.completed; },
+        [](const runtime_manager::snapshot_type&) { });
+
+    ASSERT_EQ(found.get_future().wait_for(std::chrono::seconds(5)),
+        std::future_status::ready);
+    discovery.cancel();
+    resume.set_value();
+    discovery.wait();
+
+    EXPECT_TRUE(discovery.cancelled());
+    EXPECT_FALSE(discovery.completed());
+    EXPECT_EQ(r.completed.load(), 0u);
+    EXPECT_EQ(r.sorted().size(), 1u);
+
+    // The incomplete result must not be mistaken for a complete one on the
+    // next start.
+    EXPECT_FALSE(::file_exists(discovery_cache::default_path()));
+}
+#endif /* !defined(_WIN32) */
@@ -0,0 +1,377 @@
+﻿// <copyright file="runtime_manager_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrswitch/registry.h"
+#include "../oxrswitch/runtime_manager.h"
+
+#include "benchmark.h"
+#include "xdg_environment.h"
+
+
+namespace {
+
+    /// <summary>
+    /// The paths of the native and the WOW64 uninstall database.
+    /// </summary>
+    const wchar_t *const uninstall_paths[] = {
+        L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall",
+        L"SOFTWARE\\WOW6432Node\\Microsoft\\Windows\\CurrentVersion\\"
+            L"Uninstall"
+    };
+
+    /// <summary>
+    /// Creates a hive with <paramref name="cnt" /> entries in each of the
+    /// uninstall databases, every 500th of which is a known runtime.
+    /// </summary>
+    memory_registry make_uninstall_hive(_In_ const std::size_t cnt) {
+        const char *runtimes[][2] = {
+            { "Valve Corporation", "SteamVR" },
+            { "Oculus VR, LLC", "Oculus" },
+            { "Varjo Technologies", "Varjo OpenXR Runtime" }
+        };
+
+        auto make_entries = [&runtimes, cnt](const std::string& folder) {
+            nlohmann::json retval;
+            for (std::size_t i = 0; i < cnt; ++i) {
+                const auto n = std::to_string(i);
+                const auto r = runtimes[(i / 500) % std::size(runtimes)];
+                const auto known = ((i % 500) == 0);
+                retval["{" + n + "}"] = {
+                    { "DisplayName", known ? r[1] : "Program " + n },
+                    { "Publisher", known ? r[0] : "Publisher " + n },
+                    { "InstallLocation", folder + n }
+                };
+            }
+            return retval;
+        };
+
+        nlohmann::json hive;
+        hive["SOFTWARE"]["Microsoft"]["Windows"]["CurrentVersion"]
+            ["Uninstall"] = make_entries("C:\\Program Files\\");
+        hive["SOFTWARE"]["WOW6432Node"]["Microsoft"]["Windows"]
+            ["CurrentVersion"]["Uninstall"]
+            = make_entries("C:\\Program Files (x86)\\");
+
+        return memory_registry(hive);
+    }
+
+    /// <summary>
+    /// Searches the uninstall databases of <paramref name="registry" /> one
+    /// entry after the other, which is what the discovery did before it was
+    /// parallelised.
+    /// </summary>
+    runtime_manager::installation_map serial_installations(
+            _In_ const memory_registry& registry) {
+        runtime_manager::installation_map retval;
+
+        for (auto p : uninstall_paths) {
+            memory_registry::key_type uninstall;
+            if (!registry.try_open(registry.root(), p, uninstall)) {
+                continue;
+            }
+
+            registry.enumerate_keys(uninstall, [&](const std::wstring& n) {
+                memory_registry::key_type k;
+                std::wstring name, publisher, path;
+                if (registry.try_open(uninstall, n.c_str(), k)
+                        && registry.try_get_string(k, L"DisplayName", name)
+                        && registry.try_get_string(k, L"Publisher", publisher)) {
+                    const auto runtimes = runtime_matcher::known().match(
+                        publisher, name);
+                    if ((runtimes != 0) && registry.try_get_string(k,
+                            L"InstallLocation", path)) {
+                        retval[path] |= runtimes;
+                    }
+                }
+            });
+        }
+
+        return retval;
+    }
+
+} /* namespace */
+
+
+/*
+ * runtime_manager.get_installations
+ */
+TEST(runtime_manager, get_installations) {
+    const auto registry = make_uninstall_hive(5000);
+    discovery_cache cache;
+    const auto actual = runtime_manager::get_installations(registry, cache);
+    const auto expected = serial_installations(registry);
+
+    EXPECT_EQ(actual.size(), 20u);
+    EXPECT_EQ(actual, expected);
+}
+
+
+/*
+ * benchmark.get_installations
+ */
+TEST(benchmark, get_installations) {
+    const auto registry = make_uninstall_hive(5000);
+
+    const auto serial = benchmark("get_installations.serial", 10, [&](void) {
+        EXPECT_FALSE(serial_installations(registry).empty());
+    });
+
+    const auto parallel = benchmark("get_installations.parallel", 10,
+            [&](void) {
+        discovery_cache cache;
+        EXPECT_FALSE(runtime_manager::get_installations(registry,
+            cache).empty());
+    });
+
+    // The parallel search only pays off if there are multiple cores.
+    if (std::thread::hardware_concurrency() > 1) {
+        EXPECT_LT(parallel, serial);
+    }
+}
+
+
+#if !defined(_WIN32)
+namespace {
+
+    /// <summary>
+    /// Finds the runtime named <paramref name="name" /> in
+    /// <paramref name="snapshot" />.
+    /// </summary>
+    const runtime *find(_In_ const runtime_manager::snapshot_type& snapshot,
+            _In_ const std::wstring& name) {
+        auto it = std::find_if(snapshot->begin(), snapshot->end(),
+            [&name](const runtime& r) { return (r.name() == name); });
+        return (it != snapshot->end()) ? std::addressof(*it) : nullptr;
+    }
+
+    /// <summary>
+    /// Answer the index of the runtime named <paramref name="name" />.
+    /// </summary>
+    std::size_t index_of(_In_ const runtime_manager& manager,
+            _In_ const std::wstring& name) {
+        const auto snapshot = manager.snapshot();
+        auto r = find(snapshot, name);
+        EXPECT_NE(r, nullptr);
+        return (r != nullptr) ? (r - snapshot->data()) : snapshot->size();
+    }
+
+} /* namespace */
+
+
+/*
+ * runtime_manager.xdg_discovery
+ */
+TEST(runtime_manager, xdg_discovery) {
+    xdg_environment env;
+    const auto alpha = env.manifest(L"home/.config/openxr/1/alpha.json",
+        "Alpha");
+    env.manifest(L"usr/share/openxr/1/beta.json", "Beta");
+    env.manifest(L"etc/xdg/openxr/1/not_a_runtime.txt", "Text");
+    env.manifest(L"home/.local/share/Steam/steamapps/common/SteamVR/"
+        L"steamxr_linux64.json", "SteamVR");
+
+    // A link to a runtime found elsewhere must not make it appear twice, and
+    // the active runtime is no runtime of its own.
+    std::filesystem::create_directories(env.path(L"usr/local/share/openxr/1"));
+    std::filesystem::create_symlink(alpha,
+        env.path(L"usr/local/share/openxr/1/alpha_link.json"));
+    std::filesystem::create_symlink(alpha,
+        env.path(L"home/.config/openxr/1/active_runtime.json"));
+
+    runtime_manager manager;
+    const auto snapshot = manager.snapshot();
+    EXPECT_NE(find(snapshot, L"Alpha"), nullptr);
+    EXPECT_NE(find(snapshot, L"Beta"), nullptr);
+    EXPECT_NE(find(snapshot, L"SteamVR"), nullptr);
+    EXPECT_EQ(find(snapshot, L"Text"), nullptr);
+    EXPECT_EQ(std::count_if(snapshot->begin(), snapshot->end(),
+        [](const runtime& r) { return (r.name() == L"Alpha"); }), 1);
+
+    int index;
+    EXPECT_EQ(manager.active_runtime(&index).name(), L"Alpha");
+    EXPECT_EQ(static_cast<std::size_t>(index), index_of(manager, L"Alpha"));
+
+    // A warm start restores the same runtimes from the discovery cache.
+    EXPECT_TRUE(::file_exists(::get_environment_variable("XDG_CACHE_HOME")
+        + L"/oxrswitch/discovery.json"));
+    runtime_manager warm;
+    EXPECT_EQ(warm.snapshot()->size(), snapshot->size());
+    EXPECT_NE(find(warm.snapshot(), L"SteamVR"), nullptr);
+}
+
+
+/*
+ * runtime_manager.xdg_warm_update
+ */
+TEST(runtime_manager, xdg_warm_update) {
+    xdg_environment env;
+    const auto alpha = env.manifest(L"home/.config/openxr/1/alpha.json",
+        "Alpha");
+    const auto beta = env.manifest(L"usr/share/openxr/1/beta.json", "Beta");
+
+    {
+        runtime_manager cold;
+        ASSERT_NE(find(cold.snapshot(), L"Beta"), nullptr);
+    }
+
+    // Make sure that the changes get time stamps of their own.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::filesystem::remove(beta);
+    env.manifest(L"usr/share/openxr/1/gamma.json", "Gamma");
+
+    // Renaming Alpha without changing any time stamp proves that its
+    // directory is not searched again, but restored from the cache.
+    const auto time = std::filesystem::last_write_time(alpha);
+    env.manifest(L"home/.config/openxr/1/alpha.json", "Renamed");
+    std::filesystem::last_write_time(alpha, time);
+
+    runtime_manager warm;
+    const auto snapshot = warm.snapshot();
+    EXPECT_NE(find(snapshot, L"Alpha"), nullptr);
+    EXPECT_EQ(find(snapshot, L"Renamed"), nullptr);
+    EXPECT_EQ(find(snapshot, L"Beta"), nullptr);
+    EXPECT_NE(find(snapshot, L"Gamma"), nullptr);
+
+    // The updated result has been persisted for the next start.
+    const auto cache = discovery_cache::load(
+        discovery_cache::default_path());
+    EXPECT_TRUE(cache.is_valid(discovery_cache::get_stamp));
+    EXPECT_FALSE(cache.segments().empty());
+}
+
+
+/*
+ * runtime_manager.xdg_switch
+ */
+TEST(runtime_manager, xdg_switch) {
+    xdg_environment env;
+    env.manifest(L"usr/share/openxr/1/alpha.json", "Alpha");
+    env.manifest(L"usr/share/openxr/1/beta.json", "Beta");
+
+    runtime_manager manager;
+    EXPECT_TRUE(manager.active_path().empty());
+    EXPECT_THROW(manager.active_runtime(), std::exception);
+
+    // The configuration directory does not exist yet.
+    const auto link = env.path(L"home/.config/openxr/1/active_runtime.json");
+    manager.active_runtime(index_of(manager, L"Beta"));
+    EXPECT_TRUE(std::filesystem::is_symlink(link));
+    EXPECT_EQ(manager.active_runtime().name(), L"Beta");
+
+    manager.active_runtime(index_of(manager, L"Alpha"));
+    EXPECT_EQ(manager.active_runtime().name(), L"Alpha");
+
+    // Activating the active runtime again must not replace the link.
+    struct stat before, after;
+    ASSERT_EQ(::lstat(::to_utf8(link).c_str(), &before), 0);
+    manager.active_runtime(index_of(manager, L"Alpha"));
+    ASSERT_EQ(::lstat(::to_utf8(link).c_str(), &after), 0);
+    EXPECT_EQ(before.st_ino, after.st_ino);
+
+    // No temporary links must be left behind.
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator(
+        env.path(L"home/.config/openxr/1")),
+        std::filesystem::directory_iterator()), 1);
+
+    EXPECT_THROW(manager.active_runtime(manager.snapshot()->size()),
+        std::exception);
+    EXPECT_THROW(manager.active_runtime(runtime(L"Gone",
+        env.path(L"gone.json"), L"")), std::exception);
+}
+
+
+/*
+ * runtime_manager.xdg_switch_stress
+ */
+TEST(runtime_manager, xdg_switch_stress) {
+    xdg_environment env;
+    env.manifest(L"usr/share/openxr/1/alpha.json", "Alpha");
+    env.manifest(L"usr/share/openxr/1/beta.json", "Beta");
+
+    runtime_manager manager;
+    const auto alpha = index_of(manager, L"Alpha");
+    const auto beta = index_of(manager, L"Beta");
+    manager.active_runtime(alpha);
+
+    const auto link = ::to_utf8(
+        env.path(L"home/.config/openxr/1/active_runtime.json"));
+    const auto alpha_path = std::filesystem::canonical(
+        env.path(L"usr/share/openxr/1/alpha.json"));
+    const auto beta_path = std::filesystem::canonical(
+        env.path(L"usr/share/openxr/1/beta.json"));
+
+    // Readers must always observe either the old or the new link, but never
+    // a missing or half-written one while the switch is in progress.
+    std::atomic<bool> running(true);
+    std::atomic<std::size_t> torn(0);
+    std::atomic<std::size_t> reads(0);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 2; ++i) {
+        readers.emplace_back([&](void) {
+            while (running.load()) {
+                std::error_code error;
+                const auto target = std::filesystem::canonical(link, error);
+                if (error
+                        || ((target != alpha_path) && (target != beta_path))) {
+                    ++torn;
+                }
+                ++reads;
+            }
+        });
+    }
+
+    for (int i = 0; i < 500; ++i) {
+        manager.active_runtime(((i % 2) == 0) ? beta : alpha);
+    }
+
+    running.store(false);
+    for (auto& r : readers) {
+        r.join();
+    }
+
+    EXPECT_GT(reads.load(), 0u);
+    EXPECT_EQ(torn.load(), 0u);
+    EXPECT_EQ(manager.active_runtime().name(), L"Alpha");
+}
+
+
+/*
+ * runtime_manager.xdg_watch
+ */
+TEST(runtime_manager, xdg_watch) {
+    xdg_environment env;
+    env.manifest(L"usr/share/openxr/1/alpha.json", "Alpha");
+
+    runtime_manager manager;
+    std::condition_variable changed;
+    std::mutex lock;
+    runtime_manager::snapshot_type latest;
+
+    manager.watch([&](const runtime_manager::snapshot_type& s) {
+        std::lock_guard<std::mutex> l(lock);
+        latest = s;
+        changed.notify_all();
+    });
+
+    const auto wait_for = [&](const std::wstring& name, const bool present) {
+        std::unique_lock<std::mutex> l(lock);
+        return changed.wait_for(l, std::chrono::seconds(5), [&](void) {
+            return latest && ((find(latest, name) != nullptr) == present);
+        });
+    };
+
+    // Wait for the monitor to have established its watches, which it
+    // signals by a snapshot once it has seen the first change.
+    env.manifest(L"usr/share/openxr/1/beta.json", "Beta");
+    ASSERT_TRUE(wait_for(L"Beta", true));
+
+    std::filesystem::remove(env.path(L"usr/share/openxr/1/beta.json"));
+    EXPECT_TRUE(wait_for(L"Beta", false));
+    EXPECT_EQ(find(manager.snapshot(), L"Beta"), nullptr);
+}
+#endif /* !defined(_WIN32) */
@@ -0,0 +1,176 @@
+﻿// <copyright file="runtime_matcher_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+#include "pch.h"
+
+#include "../oxrswitch/runtime_matcher.h"
+
+#include "benchmark.h"
+
+
+namespace {
+
+    /// <summary>
+    /// The flags the original regular expressions were compiled with.
+    /// </summary>
+    constexpr auto regex_flags = std::wregex::icase
+        | std::wregex::optimize
+        | std::wregex::ECMAScript;
+
+    /// <summary>
+    /// Compiles the vendor and software patterns of all known runtimes into
+    /// regular expressions, which are the reference for the matcher.
+    /// </summary>
+    std::vector<std::pair<std::wregex, std::wregex>> make_regexes(void) {
+        std::vector<std::pair<std::wregex, std::wregex>> retval;
+        for (auto& r : runtime_info::runtimes) {
+            retval.emplace_back(std::wregex(r.vendor(), regex_flags),
+                std::wregex(r.software(), regex_flags));
+        }
+        return retval;
+    }
+
+    /// <summary>
+    /// Creates <paramref name="cnt" /> vendor/software pairs from fragments
+    /// of real uninstall entries and random noise.
+    /// </summary>
+    std::vector<std::pair<std::wstring, std::wstring>> make_entries(
+            _In_ const std::size_t cnt) {
+        const wchar_t *fragments[] = { L"Oculus", L"OCULUS", L"oculu",
+            L"Valve", L"vALVE", L"SteamVR", L"steam", L"Varjo", L"VARJO",
+            L"Runtime", L"runtim", L"HTC", L"htc", L"Updater", L"VIVE",
+            L"Microsoft", L"Corporation", L" ", L", ", L"LLC", L"Ä",
+            L"ü", L"^", L"" };
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<std::size_t> fragment(0,
+            std::size(fragments) - 1);
+        std::uniform_int_distribution<std::size_t> length(0, 4);
+
+        const auto make = [&](void) {
+            std::wstring retval;
+            for (auto i = length(rng); i > 0; --i) {
+                retval += fragments[fragment(rng)];
+            }
+            return retval;
+        };
+
+        std::vector<std::pair<std::wstring, std::wstring>> retval;
+        retval.reserve(cnt);
+        for (std::size_t i = 0; i < cnt; ++i) {
+            auto vendor = make();
+            retval.emplace_back(std::move(vendor), make());
+        }
+
+        return retval;
+    }
+
+} /* namespace */
+
+
+/*
+ * runtime_matcher.known
+ */
+TEST(runtime_matcher, known) {
+    auto& matcher = runtime_matcher::known();
+    const auto index = [](_In_z_ const wchar_t *vendor) {
+        auto& r = runtime_info::runtimes;
+        auto it = std::find_if(r.begin(), r.end(),
+            [vendor](const runtime_info& i) { return (i.vendor() == vendor); });
+        return runtime_matcher::bit(std::distance(r.begin(), it));
+    };
+
+    EXPECT_EQ(matcher.match(L"Oculus VR, LLC", L"Oculus"), index(L"^oculus"));
+    EXPECT_EQ(matcher.match(L"Valve Corporation", L"SteamVR"),
+        index(L"^valve"));
+    EXPECT_EQ(matcher.match(L"Varjo Technologies", L"Varjo Base Runtime"),
+        index(L"^varjo"));
+    EXPECT_EQ(matcher.match(L"HTC Corporation", L"VIVE Updater"),
+        index(L"^htc"));
+    EXPECT_EQ(matcher.match(L"Microsoft Corporation", L"Mixed Reality"), 0u);
+    EXPECT_EQ(matcher.match(L"The Oculus Fan Club", L"Oculus"), 0u);
+    EXPECT_EQ(matcher.match(L"Valve Corporation", L"Half-Life"), 0u);
+    EXPECT_EQ(matcher.match(L"", L""), 0u);
+}
+
+
+/*
+ * runtime_matcher.regex_search
+ */
+TEST(runtime_matcher, regex_search) {
+    // The matcher implements the subset of ECMAScript used by the patterns,
+    // ie literals optionally anchored at the begin, and must classify every
+    // entry exactly like std::regex_search.
+    const auto regexes = make_regexes();
+    auto& matcher = runtime_matcher::known();
+
+    for (auto& e : make_entries(20000)) {
+        runtime_matcher::mask_type expected = 0;
+        for (std::size_t i = 0; i < regexes.size(); ++i) {
+            if (std::regex_search(e.first, regexes[i].first)
+                    && std::regex_search(e.second, regexes[i].second)) {
+                expected |= runtime_matcher::bit(i);
+            }
+        }
+
+        EXPECT_EQ(matcher.match(e.first, e.second), expected);
+    }
+}
+
+
+/*
+ * runtime_matcher.regex_match
+ */
+TEST(runtime_matcher, regex_match) {
+    // The original code used std::regex_match, which requires the whole
+    // string to match and therefore only recognised entries like "Oculus"
+    // rather than "Oculus VR, LLC". Everything it found is still found.
+    const auto regexes = make_regexes();
+    auto& matcher = runtime_matcher::known();
+
+    for (auto& e : make_entries(20000)) {
+        for (std::size_t i = 0; i < regexes.size(); ++i) {
+            if (std::regex_match(e.first, regexes[i].first)
+                    && std::regex_match(e.second, regexes[i].second)) {
+                EXPECT_NE(matcher.match(e.first, e.second)
+                    & runtime_matcher::bit(i), 0u);
+            }
+        }
+    }
+
+    EXPECT_FALSE(std::regex_match(std::wstring(L"Oculus VR, LLC"),
+        regexes.front().first));
+}
+
+
+/*
+ * benchmark.runtime_matcher
+ */
+TEST(benchmark, runtime_matcher) {
+    const auto regexes = make_regexes();
+    const auto entries = make_entries(2000);
+    auto& matcher = runtime_matcher::known();
+    std::size_t found = 0;
+
+    benchmark("runtime_matcher/regex", 5, [&](void) {
+        for (auto& e : entries) {
+            for (auto& r : regexes) {
+                if (std::regex_search(e.first, r.first)
+                        && std::regex_search(e.second, r.second)) {
+                    ++found;
+                }
+            }
+        }
+    });
+
+    benchmark("runtime_matcher/automaton", 5, [&](void) {
+        for (auto& e : entries) {
+            if (matcher.match(e.first, e.second) != 0) {
+                ++found;
+            }
+        }
+    });
+
+    EXPECT_GT(found, 0u);
+}
@@ -0,0 +1,344 @@
+﻿// <copyright file="runtime_monitor_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrswitch/runtime_monitor.h"
+
+
+namespace {
+
+    typedef discovery_cache::source_type source_type;
+
+    /// <summary>
+    /// The sources a <see cref="stub_scanner" /> pretends to search, which
+    /// are shared with the test.
+    /// </summary>
+    struct stub_system final {
+        /// <summary>
+        /// The installation folders and the mask of runtimes they have been
+        /// attributed to.
+        /// </summary>
+        std::map<std::wstring, std::uint32_t, path_compare> installations;
+
+        /// <summary>
+        /// The runtimes in each installation folder.
+        /// </summary>
+        std::map<std::wstring, std::vector<runtime>, path_compare> installed;
+        std::mutex lock;
+
+        /// <summary>
+        /// The runtimes registered with OpenXR.
+        /// </summary>
+        std::vector<runtime> registered;
+
+        /// <summary>
+        /// The number of times each segment has been searched, which is
+        /// identified by the installation folder or by the name of the
+        /// registry source.
+        /// </summary>
+        std::map<std::wstring, std::size_t> scans;
+
+        /// <summary>
+        /// The current time stamp of each source, which is zero if the
+        /// source has never changed.
+        /// </summary>
+        std::map<std::wstring, std::uint64_t> stamps;
+
+        /// <summary>
+        /// Adds a runtime to an installation folder and changes the time
+        /// stamp of the folder like an installer would do.
+        /// </summary>
+        void install(const std::wstring& folder, const std::wstring& name) {
+            std::lock_guard<std::mutex> l(this->lock);
+            this->installed[folder].emplace_back(name,
+                folder + L"/" + name + L".json", L"");
+            ++this->stamps[folder];
+        }
+
+        /// <summary>
+        /// Answer how often the given segment has been searched.
+        /// </summary>
+        std::size_t scanned(const std::wstring& segment) {
+            std::lock_guard<std::mutex> l(this->lock);
+            auto it = this->scans.find(segment);
+            return (it != this->scans.end()) ? it->second : 0;
+        }
+
+        /// <summary>
+        /// Changes the time stamp of a source without changing the result
+        /// of the search.
+        /// </summary>
+        void touch(const std::wstring& path) {
+            std::lock_guard<std::mutex> l(this->lock);
+            ++this->stamps[path];
+        }
+    };
+
+    /// <summary>
+    /// A scanner searching a <see cref="stub_system" /> and counting the
+    /// searches of each segment.
+    /// </summary>
+    struct stub_scanner final {
+        typedef std::map<std::wstring, std::uint32_t, path_compare>
+            installation_map;
+
+        std::shared_ptr<stub_system> system;
+
+        bool find_installed(const std::wstring& folder,
+                const std::uint32_t,
+                std::vector<runtime>& runtimes,
+                discovery_cache& cache) const {
+            std::lock_guard<std::mutex> l(this->system->lock);
+            ++this->system->scans[folder];
+            cache.add(source_type::file_system, folder,
+                this->system->stamps[folder]);
+            auto& installed = this->system->installed[folder];
+            runtimes.insert(runtimes.end(), installed.begin(),
+                installed.end());
+            return true;
+        }
+
+        installation_map find_installations(discovery_cache& cache) const {
+            std::lock_guard<std::mutex> l(this->system->lock);
+            ++this->system->scans[L"installations"];
+            cache.add(source_type::registry, L"installations",
+                this->system->stamps[L"installations"]);
+            return this->system->installations;
+        }
+
+        void find_registered(std::vector<runtime>& runtimes,
+                discovery_cache& cache) const {
+            std::lock_guard<std::mutex> l(this->system->lock);
+            ++this->system->scans[L"registered"];
+            cache.add(source_type::registry, L"registered",
+                this->system->stamps[L"registered"]);
+            runtimes.insert(runtimes.end(), this->system->registered.begin(),
+                this->system->registered.end());
+        }
+
+        walk_options get_walk_options(const std::uint32_t) const {
+            return walk_options();
+        }
+
+        std::uint64_t stamp(const source_type, const std::wstring& path) const {
+            std::lock_guard<std::mutex> l(this->system->lock);
+            auto it = this->system->stamps.find(path);
+            return (it != this->system->stamps.end()) ? it->second : 0;
+        }
+    };
+
+    /// <summary>
+    /// Passes changes from the test to the <see cref="stub_source" /> the
+    /// monitor is waiting for.
+    /// </summary>
+    struct stub_channel final {
+        std::condition_variable changed;
+
+        /// <summary>
+        /// The paths of the targets that changed, but have not been
+        /// reported yet.
+        /// </summary>
+        std::deque<std::wstring> changes;
+        std::mutex lock;
+
+        /// <summary>
+        /// The number of times the monitor started waiting for a change.
+        /// </summary>
+        std::size_t waits = 0;
+
+        /// <summary>
+        /// Reports a change of the target at <paramref name="path" />.
+        /// </summary>
+        void notify(const std::wstring& path) {
+            std::lock_guard<std::mutex> l(this->lock);
+            this->changes.push_back(path);
+            this->changed.notify_all();
+        }
+
+        /// <summary>
+        /// Waits until the monitor has started waiting for a change at least
+        /// <paramref name="cnt" /> times.
+        /// </summary>
+        bool wait_for_waits(const std::size_t cnt) {
+            std::unique_lock<std::mutex> l(this->lock);
+            return this->changed.wait_for(l, std::chrono::seconds(5),
+                [this, cnt](void) { return (this->waits >= cnt); });
+        }
+    };
+
+    /// <summary>
+    /// Answer the channel shared by all <see cref="stub_source" />s.
+    /// </summary>
+    stub_channel& get_channel(void) {
+        static stub_channel retval;
+        return retval;
+    }
+
+    /// <summary>
+    /// A notification source reporting the changes passed to the
+    /// <see cref="stub_channel" />.
+    /// </summary>
+    class stub_source final {
+
+    public:
+
+        explicit stub_source(const std::vector<notification_target>& targets)
+            : _stopped(false), _targets(targets) { }
+
+        void stop(void) noexcept {
+            auto& c = get_channel();
+            std::lock_guard<std::mutex> l(c.lock);
+            this->_stopped = true;
+            c.changed.notify_all();
+        }
+
+        bool wait(std::size_t& target) {
+            auto& c = get_channel();
+            std::unique_lock<std::mutex> l(c.lock);
+            ++c.waits;
+            c.changed.notify_all();
+
+            while (!this->_stopped) {
+                while (!c.changes.empty()) {
+                    const auto path = c.changes.front();
+                    c.changes.pop_front();
+
+                    auto it = std::find_if(this->_targets.begin(),
+                        this->_targets.end(),
+                        [&path](const notification_target& t) {
+                            return (t.path == path);
+                        });
+                    if (it != this->_targets.end()) {
+                        target = std::distance(this->_targets.begin(), it);
+                        return true;
+                    }
+                }
+
+                c.changed.wait_for(l, std::chrono::milliseconds(100));
+            }
+
+            return false;
+        }
+
+    private:
+
+        bool _stopped;
+        std::vector<notification_target> _targets;
+    };
+
+    typedef runtime_monitor<stub_scanner, stub_source> stub_monitor;
+
+    /// <summary>
+    /// Creates a system with a registered runtime and two installation
+    /// folders holding a runtime each.
+    /// </summary>
+    std::shared_ptr<stub_system> make_system(void) {
+        auto retval = std::make_shared<stub_system>();
+        retval->registered.emplace_back(L"registered", L"/etc/registered.json",
+            L"");
+        retval->installations[L"/opt/a"] = 1;
+        retval->installations[L"/opt/b"] = 2;
+        retval->install(L"/opt/a", L"a");
+        retval->install(L"/opt/b", L"b");
+        get_channel().changes.clear();
+        return retval;
+    }
+
+} /* namespace */
+
+
+/*
+ * runtime_monitor.rescan_segment
+ */
+TEST(runtime_monitor, rescan_segment) {
+    auto system = make_system();
+    stub_monitor monitor(stub_scanner { system });
+
+    discovery_cache cache;
+    EXPECT_TRUE(monitor.scan(cache, stub_monitor::found_callback()));
+    EXPECT_EQ(monitor.snapshot()->size(), 3u);
+    EXPECT_EQ(system->scanned(L"registered"), 1u);
+    EXPECT_EQ(system->scanned(L"installations"), 1u);
+    EXPECT_EQ(system->scanned(L"/opt/a"), 1u);
+    EXPECT_EQ(system->scanned(L"/opt/b"), 1u);
+
+    std::condition_variable changed;
+    std::mutex lock;
+    std::size_t runtimes = 0;
+    const auto waits = get_channel().waits;
+    monitor.start([&](const stub_monitor::snapshot_type& s) {
+        std::lock_guard<std::mutex> l(lock);
+        runtimes = s->size();
+        changed.notify_all();
+    });
+
+    // Change the folder only once the monitor is waiting, because it would
+    // otherwise find the outdated segment before it starts waiting.
+    ASSERT_TRUE(get_channel().wait_for_waits(waits + 1));
+    system->install(L"/opt/b", L"c");
+    get_channel().notify(L"/opt/b");
+
+    {
+        std::unique_lock<std::mutex> l(lock);
+        EXPECT_TRUE(changed.wait_for(l, std::chrono::seconds(5),
+            [&runtimes](void) { return (runtimes == 4u); }));
+    }
+    monitor.stop();
+
+    EXPECT_EQ(system->scanned(L"registered"), 1u);
+    EXPECT_EQ(system->scanned(L"installations"), 1u);
+    EXPECT_EQ(system->scanned(L"/opt/a"), 1u);
+    EXPECT_EQ(system->scanned(L"/opt/b"), 2u);
+}
+
+
+/*
+ * runtime_monitor.restart
+ */
+TEST(runtime_monitor, restart) {
+    auto system = make_system();
+
+    discovery_cache cache;
+    {
+        stub_monitor monitor(stub_scanner { system });
+        EXPECT_TRUE(monitor.scan(cache, stub_monitor::found_callback()));
+    }
+
+    // While the monitor is not running, a runtime is added to one folder and
+    // the runtime file in the other one changes, which both outdate only the
+    // segment of their folder.
+    system->install(L"/opt/a", L"c");
+    system->touch(L"/opt/b/b.json");
+
+    stub_monitor monitor(stub_scanner { system });
+    EXPECT_TRUE(monitor.restore(std::move(cache)));
+    EXPECT_TRUE(monitor.scanned());
+    EXPECT_EQ(monitor.snapshot()->size(), 3u);
+
+    const auto waits = get_channel().waits;
+    monitor.start(stub_monitor::changed_callback());
+    ASSERT_TRUE(get_channel().wait_for_waits(waits + 1));
+    monitor.stop();
+
+    EXPECT_EQ(monitor.snapshot()->size(), 4u);
+    EXPECT_EQ(system->scanned(L"registered"), 1u);
+    EXPECT_EQ(system->scanned(L"installations"), 1u);
+    EXPECT_EQ(system->scanned(L"/opt/a"), 2u);
+    EXPECT_EQ(system->scanned(L"/opt/b"), 2u);
+
+    // The restored segments are persisted again, so the next start does not
+    // need to search anything.
+    ASSERT_TRUE(monitor.cache(cache));
+    stub_monitor restarted(stub_scanner { system });
+    EXPECT_TRUE(restarted.restore(std::move(cache)));
+    EXPECT_TRUE(restarted.update(cache));
+    EXPECT_EQ(restarted.snapshot()->size(), 4u);
+    EXPECT_EQ(system->scanned(L"registered"), 1u);
+    EXPECT_EQ(system->scanned(L"installations"), 1u);
+    EXPECT_EQ(system->scanned(L"/opt/a"), 2u);
+    EXPECT_EQ(system->scanned(L"/opt/b"), 2u);
+}
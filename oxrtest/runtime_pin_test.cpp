@@ -0,0 +1,141 @@
+﻿// <copyright file="runtime_pin_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrsvc/file_store.h"
+#include "../oxrsvc/inotify_watcher.h"
+#include "../oxrsvc/runtime_pin.h"
+
+#include "benchmark.h"
+#include "temp_directory.h"
+
+
+#if !defined(_WIN32)
+namespace {
+
+    typedef runtime_pin<inotify_watcher, file_store> file_pin;
+    typedef std::array<std::string, 2> file_pair;
+
+    /// <summary>
+    /// Replaces the file at <paramref name="path" /> by renaming a new file
+    /// over it like another tool taking over the active runtime would do.
+    /// </summary>
+    void replace(const std::string& path, const std::string& content) {
+        const auto temp = path + ".tmp";
+        {
+            std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+            stream << content;
+        }
+        std::filesystem::rename(temp, path);
+    }
+
+    /// <summary>
+    /// Records the content of the files whenever the pin reports a change.
+    /// </summary>
+    struct observer final {
+        std::condition_variable changed;
+        file_pair content;
+        file_pair keys;
+        std::mutex lock;
+
+        explicit observer(const file_pair& keys) : keys(keys) { }
+
+        /// <summary>
+        /// Runs <paramref name="action" /> while no change can be recorded
+        /// and waits until a change reported after it left the files with the
+        /// <paramref name="expected" /> content.
+        /// </summary>
+        template<class TAction>
+        bool expect(TAction&& action, const file_pair& expected) {
+            std::unique_lock<std::mutex> l(this->lock);
+            this->content = file_pair();
+            action();
+            return this->changed.wait_for(l, std::chrono::seconds(5),
+                [&](void) { return (this->content == expected); });
+        }
+
+        /// <summary>
+        /// The callback of the pin.
+        /// </summary>
+        void operator ()(const std::size_t) {
+            file_store store;
+            std::lock_guard<std::mutex> l(this->lock);
+            for (std::size_t i = 0; i < this->keys.size(); ++i) {
+                this->content[i] = store.read(this->keys[i]);
+            }
+            this->changed.notify_all();
+        }
+    };
+
+} /* namespace */
+
+
+/*
+ * runtime_pin.restore
+ */
+TEST(runtime_pin, restore) {
+    temp_directory dir;
+    const file_pair keys = {
+        std::filesystem::path(dir.write(L"openxr/1/active_runtime.json",
+            "native")).string(),
+        std::filesystem::path(dir.write(L"openxr/1/active_runtime.i686.json",
+            "wow")).string()
+    };
+
+    observer o(keys);
+    file_pin pin(keys, file_store(),
+        [&o](const std::size_t key) { o(key); });
+    EXPECT_FALSE(pin.pinned());
+
+    // Pinning restores both files immediately and removes the WOW64 one.
+    pin.pin("pinned", "");
+    EXPECT_TRUE(pin.pinned());
+    EXPECT_EQ(file_store().read(keys[0]), "pinned");
+    EXPECT_FALSE(std::filesystem::exists(keys[1]));
+
+    EXPECT_TRUE(o.expect([&](void) { replace(keys[0], "hijacked"); },
+        file_pair({ "pinned", "" })));
+    EXPECT_TRUE(o.expect([&](void) { replace(keys[1], "hijacked"); },
+        file_pair({ "pinned", "" })));
+
+    // Once unpinned, other programs are free to change the active runtime.
+    pin.unpin();
+    EXPECT_FALSE(pin.pinned());
+    EXPECT_TRUE(o.expect([&](void) { replace(keys[0], "other"); },
+        file_pair({ "other", "" })));
+}
+
+
+/*
+ * benchmark.pin_restore
+ */
+TEST(benchmark, pin_restore) {
+    // The pin restores the active runtime whenever another tool replaces the
+    // file, and we measure the time from the hijack to the pin reporting the
+    // change after the restore.
+    temp_directory dir;
+    const std::string pinned = R"({ "runtime": "pinned" })";
+    const file_pair keys = {
+        std::filesystem::path(dir.write(L"openxr/1/active_runtime.json",
+            pinned)).string(),
+        std::string()
+    };
+
+    observer o(keys);
+    file_pin pin(keys, file_store(),
+        [&o](const std::size_t key) { o(key); });
+    pin.pin(pinned, "");
+
+    benchmark("pin_restore", 20, [&](void) {
+        EXPECT_TRUE(o.expect([&](void) {
+            replace(keys[0], R"({ "runtime": "hijacked" })");
+        }, file_pair({ pinned, "" })));
+    });
+
+    EXPECT_EQ(file_store().read(keys[0]), pinned);
+}
+#endif /* !defined(_WIN32) */
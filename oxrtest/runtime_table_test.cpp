@@ -0,0 +1,145 @@
+﻿// <copyright file="runtime_table_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrswitch/runtime_table.h"
+
+#include "benchmark.h"
+
+
+namespace {
+
+    /// <summary>
+    /// Creates <paramref name="cnt" /> runtimes from a few vendors, which
+    /// is what the discovery collects.
+    /// </summary>
+    std::vector<runtime> make_runtimes(_In_ const std::size_t cnt,
+            _In_ const bool upper) {
+        const wchar_t *names[] = { L"SteamVR", L"Oculus", L"Varjo",
+            L"Windows Mixed Reality", L"VIVE" };
+        std::vector<runtime> retval;
+        retval.reserve(cnt);
+
+        for (std::size_t i = 0; i < cnt; ++i) {
+            std::wstring path = L"C:/Program Files/Vendor" + std::to_wstring(i)
+                + L"/Runtime/openxr_runtime.json";
+            std::wstring wow_path = L"C:/Program Files (x86)/Vendor"
+                + std::to_wstring(i) + L"/Runtime/openxr_runtime.json";
+            if (upper) {
+                for (auto s : { &path, &wow_path }) {
+                    std::transform(s->begin(), s->end(), s->begin(),
+                        [](const wchar_t c) { return std::towupper(c); });
+                }
+            }
+
+            retval.emplace_back(names[i % std::size(names)], std::move(path),
+                std::move(wow_path));
+        }
+
+        return retval;
+    }
+
+} /* namespace */
+
+
+/*
+ * runtime_table.insert
+ */
+TEST(runtime_table, insert) {
+    runtime_table table;
+
+    auto r = table.insert(runtime(L"SteamVR", L"C:/SteamVR/steamxr_win64.json",
+        L"C:/SteamVR/steamxr_win32.json"));
+    EXPECT_TRUE(r.second);
+    EXPECT_EQ(r.first, 0u);
+
+    r = table.insert(runtime(L"Varjo", L"C:/Varjo/VarjoOpenXR.json", L""));
+    EXPECT_TRUE(r.second);
+    EXPECT_EQ(r.first, 1u);
+
+    // The same manifest with a different spelling is a duplicate.
+    r = table.insert(runtime(L"Other", L"c:/steamvr/STEAMXR_WIN64.json", L""));
+    EXPECT_FALSE(r.second);
+    EXPECT_EQ(r.first, 0u);
+    EXPECT_EQ(table.size(), 2u);
+
+    EXPECT_EQ(table.name(0), L"SteamVR");
+    EXPECT_EQ(table.path(1), L"C:/Varjo/VarjoOpenXR.json");
+    EXPECT_EQ(table.wow_path(0), L"C:/SteamVR/steamxr_win32.json");
+    EXPECT_TRUE(table.wow_path(1).empty());
+
+    const auto steamvr = table.at(0);
+    EXPECT_EQ(steamvr.name(), L"SteamVR");
+    EXPECT_EQ(steamvr.path(), L"C:/SteamVR/steamxr_win64.json");
+    EXPECT_EQ(steamvr.wow_path(), L"C:/SteamVR/steamxr_win32.json");
+}
+
+
+/*
+ * runtime_table.copy
+ */
+TEST(runtime_table, copy) {
+    runtime_table table;
+    table.insert(runtime(L"Varjo", L"C:/Varjo/VarjoOpenXR.json", L""));
+    table.insert(runtime(L"SteamVR", L"C:/SteamVR/steamxr_win64.json", L""));
+    table.insert(runtime(L"Oculus", L"c:/oculus/oculus_openxr_64.json", L""));
+
+    std::vector<runtime> runtimes;
+    table.copy(std::back_inserter(runtimes));
+    ASSERT_EQ(runtimes.size(), 3u);
+
+    // The order is by the folded path.
+    EXPECT_EQ(runtimes[0].name(), L"Oculus");
+    EXPECT_EQ(runtimes[1].name(), L"SteamVR");
+    EXPECT_EQ(runtimes[2].name(), L"Varjo");
+}
+
+
+/*
+ * benchmark.runtime_table
+ */
+TEST(benchmark, runtime_table) {
+    // Every runtime is found twice, the second time with a different case,
+    // which the table recognises as duplicate.
+    const auto lower = make_runtimes(10000, false);
+    const auto upper = make_runtimes(10000, true);
+
+    std::size_t memory = 0;
+    std::vector<runtime> runtimes;
+    benchmark("runtime_table (10000 x 2)", 5, [&]() {
+        runtime_table table;
+        for (auto& r : lower) {
+            table.insert(r);
+        }
+        for (auto& r : upper) {
+            table.insert(r);
+        }
+
+        memory = table.memory();
+        runtimes.clear();
+        table.copy(std::back_inserter(runtimes));
+    });
+    EXPECT_EQ(runtimes.size(), lower.size());
+    std::cout << "[ BENCHMARK] runtime_table memory: " << memory
+        << " bytes" << std::endl;
+
+    // The std::set it replaced only recognises the duplicates on platforms
+    // where path_compare ignores the case.
+    std::set<runtime> set;
+    benchmark("std::set<runtime> (10000 x 2)", 5, [&]() {
+        set.clear();
+        for (auto& r : lower) {
+            set.insert(r);
+        }
+        for (auto& r : upper) {
+            set.insert(r);
+        }
+
+        runtimes.assign(set.begin(), set.end());
+    });
+    EXPECT_GE(set.size(), lower.size());
+}
@@ -0,0 +1,164 @@
+﻿// <copyright file="runtime_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrswitch/runtime.h"
+
+#include "benchmark.h"
+#include "temp_directory.h"
+
+
+namespace {
+
+    /// <summary>
+    /// A valid runtime description.
+    /// </summary>
+    const std::string valid_manifest = R"({
+        "file_format_version": "1.0.0",
+        "runtime": {
+            "name": "Universit\u00E4t",
+            "library_path": "bin/runtime.dll"
+        }
+    })";
+
+    /// <summary>
+    /// Creates a large JSON file that is no runtime description, like the
+    /// ones in game libraries and resource trees.
+    /// </summary>
+    std::string make_unrelated_json(_In_ const std::size_t cnt) {
+        std::string retval = "[";
+        for (std::size_t i = 0; i < cnt; ++i) {
+            retval += (i > 0) ? ", " : " ";
+            retval += R"({ "id": )" + std::to_string(i)
+                + R"(, "texture": "textures/tile.png", "scale": [ 1, 2, 3 ] })";
+        }
+        retval += " ]";
+        return retval;
+    }
+
+} /* namespace */
+
+
+/*
+ * runtime.try_from_file
+ */
+TEST(runtime, try_from_file) {
+    temp_directory dir;
+    const auto path = dir.write(L"valid.json", valid_manifest);
+
+    runtime r;
+    ASSERT_EQ(runtime::try_from_file(path, nullptr, nullptr, r),
+        static_cast<DWORD>(ERROR_SUCCESS));
+    EXPECT_EQ(r.name(), L"Universit\u00E4t");
+    EXPECT_EQ(r.path(), path);
+    EXPECT_TRUE(r.wow_path().empty());
+    EXPECT_TRUE(r);
+
+    ASSERT_EQ(runtime::try_from_file(path, path.c_str(), L"Override", r),
+        static_cast<DWORD>(ERROR_SUCCESS));
+    EXPECT_EQ(r.name(), L"Override");
+    EXPECT_EQ(r.wow_path(), path);
+
+    // The name is optional, but the library is not.
+    const auto unnamed = dir.write(L"unnamed.json",
+        R"({ "runtime": { "library_path": "runtime.dll" } })");
+    EXPECT_EQ(runtime::try_from_file(unnamed, nullptr, nullptr, r),
+        static_cast<DWORD>(ERROR_SUCCESS));
+    EXPECT_EQ(r.name(), unnamed);
+
+    EXPECT_EQ(runtime::try_from_file(dir.path(L"missing.json"), nullptr,
+        nullptr, r), static_cast<DWORD>(ERROR_OPEN_FAILED));
+    EXPECT_THROW(runtime::from_file(dir.path(L"missing.json")),
+        std::exception);
+}
+
+
+/*
+ * runtime.invalid
+ */
+TEST(runtime, invalid) {
+    const char *manifests[] = {
+        "",
+        "not JSON",
+        "[ 1, 2, 3 ]",
+        R"({ "file_format_version": "1.0.0" })",
+        R"({ "runtime": { "name": "No library" } })",
+        R"({ "runtime": { "name": 42, "library_path": "runtime.dll" } })",
+        R"({ "runtime": { "library_path": "runtime.dll", "name": [ ] } })",
+        R"({ "runtime": { "library_path": "runtime.dll", )",
+    };
+
+    temp_directory dir;
+    for (auto m : manifests) {
+        const auto path = dir.write(L"invalid.json", m);
+        runtime r;
+        EXPECT_EQ(runtime::try_from_file(path, nullptr, nullptr, r),
+            static_cast<DWORD>(ERROR_INVALID_DATA)) << m;
+        EXPECT_THROW(runtime::from_file(path), std::invalid_argument) << m;
+    }
+}
+
+
+/*
+ * runtime.get_library_path
+ */
+TEST(runtime, get_library_path) {
+    temp_directory dir;
+    const auto path = dir.write(L"manifests/valid.json", valid_manifest);
+
+    const auto library = runtime::get_library_path(path);
+    EXPECT_EQ(library, dir.path(L"manifests/bin/runtime.dll"));
+
+    const auto invalid = dir.write(L"invalid.json", "[ ]");
+    EXPECT_TRUE(runtime::get_library_path(invalid).empty());
+}
+
+
+/*
+ * benchmark.manifest_validation
+ */
+TEST(benchmark, manifest_validation) {
+    // An installation folder with 20 large JSON files that are no runtime
+    // descriptions and a single manifest.
+    temp_directory dir;
+    std::vector<std::wstring> paths;
+    const auto unrelated = make_unrelated_json(1000);
+    for (std::size_t i = 0; i < 20; ++i) {
+        paths.push_back(dir.write(L"resources/" + std::to_wstring(i)
+            + L".json", unrelated));
+    }
+    paths.push_back(dir.write(L"runtime.json", valid_manifest));
+
+    std::size_t valid = 0;
+    benchmark("SAX validation (21 files)", 5, [&]() {
+        for (auto& p : paths) {
+            runtime r;
+            if (runtime::try_from_file(p, nullptr, nullptr, r)
+                    == ERROR_SUCCESS) {
+                ++valid;
+            }
+        }
+    });
+    EXPECT_EQ(valid, 5u);
+
+    // What the discovery did before: parse the whole file into a DOM and
+    // throw if it is no runtime description.
+    valid = 0;
+    benchmark("DOM validation (21 files)", 5, [&]() {
+        for (auto& p : paths) {
+            try {
+                std::ifstream stream{ std::filesystem::path(p) };
+                const auto json = nlohmann::json::parse(stream);
+                const auto& runtime = json.at("runtime");
+                if (!runtime.at("library_path").is_null()) {
+                    ++valid;
+                }
+            } catch (...) { }
+        }
+    });
+    EXPECT_EQ(valid, 5u);
+}
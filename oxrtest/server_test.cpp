@@ -0,0 +1,331 @@
+﻿// <copyright file="server_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrswitch/registry.h"
+#include "../oxrsvc/protocol.h"
+#include "../oxrsvc/server.h"
+
+#include "benchmark.h"
+#include "memory_transport.h"
+
+
+namespace {
+
+    /// <summary>
+    /// The status reported for runtimes that are not registered, which is
+    /// what the service reports for <c>ERROR_NOT_FOUND</c>.
+    /// </summary>
+    constexpr auto status_not_found = static_cast<std::int32_t>(0x80070490);
+
+    /// <summary>
+    /// The status reported for requests the handler does not support, which
+    /// is what the service reports for <c>ERROR_NOT_SUPPORTED</c>.
+    /// </summary>
+    constexpr auto status_not_supported = static_cast<std::int32_t>(
+        0x80070032);
+
+    /// <summary>
+    /// The runtimes registered in <see cref="make_hive" />.
+    /// </summary>
+    const std::u16string runtimes[] = {
+        u"C:\\SteamVR\\steamxr_win64.json",
+        u"C:\\Varjo\\VarjoOpenXR.json"
+    };
+
+    /// <summary>
+    /// Creates an in-memory hive with the <see cref="runtimes" />.
+    /// </summary>
+    nlohmann::json make_hive(void) {
+        return nlohmann::json::parse(R"({
+            "SOFTWARE": {
+                "Khronos": {
+                    "OpenXR": {
+                        "1": {
+                            "AvailableRuntimes": {
+                                "C:\\SteamVR\\steamxr_win64.json": 0,
+                                "C:\\Varjo\\VarjoOpenXR.json": 0
+                            }
+                        }
+                    }
+                }
+            }
+        })");
+    }
+
+    /// <summary>
+    /// Processes requests like the switcher does, but activates runtimes
+    /// registered in an in-memory registry rather than writing to the
+    /// registry of the machine.
+    /// </summary>
+    struct registry_handler final {
+        std::wstring active;
+        std::set<std::wstring> available;
+
+        explicit registry_handler(const memory_registry& registry) {
+            memory_registry::key_type key = nullptr;
+            if (registry.try_open(registry.root(),
+                    L"SOFTWARE\\Khronos\\OpenXR\\1\\AvailableRuntimes", key)) {
+                registry.enumerate_values(key, [this](const std::wstring& n) {
+                    this->available.insert(n);
+                });
+            }
+        }
+
+        void notify(std::vector<std::uint8_t>& output) {
+            ::write_changed(output, this->active, L"");
+        }
+
+        std::size_t process(const ring_buffer& input,
+                std::size_t& scanned,
+                std::vector<std::uint8_t>& output,
+                bool& subscribe) {
+            subscribe = false;
+
+            request req;
+            const auto retval = ::parse_request(input, scanned, req);
+            if (retval == 0) {
+                return 0;
+            }
+
+            auto status = status_not_supported;
+            if (!req.legacy && (req.version != frame_version)) {
+                // Keep the default.
+            } else if (req.type == message_type::activate) {
+                if (this->available.count(req.runtime) > 0) {
+                    this->active = req.runtime;
+                    status = 0;
+                } else {
+                    status = status_not_found;
+                }
+            } else if (req.type == message_type::subscribe) {
+                subscribe = true;
+                status = 0;
+            }
+
+            ::write_result(output, req, status);
+            return retval;
+        }
+    };
+
+    /// <summary>
+    /// The server under test.
+    /// </summary>
+    typedef server<memory_transport, registry_handler> server_type;
+
+    /// <summary>
+    /// Creates a frame of the given type.
+    /// </summary>
+    std::vector<std::uint8_t> make_frame(const message_type type,
+            const std::vector<std::uint8_t>& payload = { }) {
+        frame_header header;
+        header.magic = frame_magic;
+        header.version = frame_version;
+        header.type = type;
+        header.length = static_cast<std::uint32_t>(payload.size());
+
+        std::vector<std::uint8_t> retval(sizeof(header) + payload.size());
+        std::memcpy(retval.data(), &header, sizeof(header));
+        if (!payload.empty()) {
+            std::memcpy(retval.data() + sizeof(header), payload.data(),
+                payload.size());
+        }
+        return retval;
+    }
+
+    /// <summary>
+    /// Creates a framed activation request for a native runtime.
+    /// </summary>
+    std::vector<std::uint8_t> make_activate(const std::u16string& runtime) {
+        const std::uint32_t counts[] = {
+            static_cast<std::uint32_t>(runtime.size()), 0 };
+        std::vector<std::uint8_t> payload(sizeof(counts)
+            + runtime.size() * sizeof(char16_t));
+        std::memcpy(payload.data(), counts, sizeof(counts));
+        std::memcpy(payload.data() + sizeof(counts), runtime.data(),
+            runtime.size() * sizeof(char16_t));
+        return make_frame(message_type::activate, payload);
+    }
+
+    /// <summary>
+    /// Creates a frame announcing more data than the server accepts, which
+    /// makes the server disconnect the client.
+    /// </summary>
+    std::vector<std::uint8_t> make_malformed(void) {
+        auto retval = make_frame(message_type::activate);
+        const auto length = static_cast<std::uint32_t>(max_frame_size);
+        std::memcpy(retval.data() + offsetof(frame_header, length), &length,
+            sizeof(length));
+        return retval;
+    }
+
+    /// <summary>
+    /// Sends <paramref name="frame" /> and receives the status of the
+    /// result.
+    /// </summary>
+    /// <returns><see langword="false" /> if the server closed the
+    /// connection.</returns>
+    bool round_trip(memory_transport& transport,
+            const memory_transport::client_type& client,
+            const std::vector<std::uint8_t>& frame,
+            std::int32_t& status) {
+        if (!transport.send(client, frame.data(), frame.size())) {
+            return false;
+        }
+
+        std::uint8_t response[sizeof(frame_header) + sizeof(status)];
+        if (!transport.receive(client, response, sizeof(response))) {
+            return false;
+        }
+
+        frame_header header;
+        std::memcpy(&header, response, sizeof(header));
+        EXPECT_EQ(header.magic, frame_magic);
+        EXPECT_EQ(header.type, message_type::result);
+        std::memcpy(&status, response + sizeof(header), sizeof(status));
+        return true;
+    }
+
+} /* namespace */
+
+
+/*
+ * server.requests
+ */
+TEST(server, requests) {
+    const memory_registry registry(make_hive());
+    memory_transport transport(2);
+    server_type loop(transport, registry_handler(registry), max_frame_size);
+    std::thread thread([&loop](void) { loop(); });
+
+    {
+        auto client = transport.connect();
+        std::int32_t status;
+
+        ASSERT_TRUE(round_trip(transport, client,
+            make_activate(runtimes[0]), status));
+        EXPECT_EQ(status, 0);
+
+        ASSERT_TRUE(round_trip(transport, client,
+            make_activate(u"C:\\Unknown\\runtime.json"), status));
+        EXPECT_EQ(status, status_not_found);
+
+        ASSERT_TRUE(round_trip(transport, client,
+            make_frame(message_type::list), status));
+        EXPECT_EQ(status, status_not_supported);
+
+        // The server must drop the client after an invalid request and
+        // accept a new one on the instance.
+        EXPECT_FALSE(round_trip(transport, client, make_malformed(),
+            status));
+
+        client = transport.connect();
+        ASSERT_TRUE(round_trip(transport, client,
+            make_activate(runtimes[1]), status));
+        EXPECT_EQ(status, 0);
+        transport.close(client);
+    }
+
+    transport.stop();
+    thread.join();
+
+    EXPECT_EQ(loop.statistics().requests(), 4);
+    EXPECT_EQ(loop.statistics().failures(), 1);
+}
+
+
+/*
+ * benchmark.server_load
+ */
+TEST(benchmark, server_load) {
+    // Several clients fire requests at the server concurrently, most of them
+    // valid, some for unknown runtimes or unsupported, and some malformed,
+    // which costs the client its connection.
+    constexpr std::size_t cnt_clients = 8;
+    constexpr std::size_t cnt_requests = 250;
+    const memory_registry registry(make_hive());
+    const auto valid0 = make_activate(runtimes[0]);
+    const auto valid1 = make_activate(runtimes[1]);
+    const auto unknown = make_activate(u"C:\\Unknown\\runtime.json");
+    const auto unsupported = make_frame(message_type::list);
+    const auto malformed = make_malformed();
+
+    memory_transport transport(cnt_clients);
+    server_type loop(transport, registry_handler(registry), max_frame_size);
+    std::atomic<std::size_t> errors(0);
+
+    benchmark("server_load", 1, [&](void) {
+        std::thread thread([&loop](void) { loop(); });
+
+        std::vector<std::thread> clients;
+        for (std::size_t c = 0; c < cnt_clients; ++c) {
+            clients.emplace_back([&, c](void) {
+                auto client = transport.connect();
+                for (std::size_t r = 0; r < cnt_requests; ++r) {
+                    std::int32_t status;
+                    switch ((c + r) % 10) {
+                        case 7:
+                            round_trip(transport, client, unknown, status);
+                            errors += (status != status_not_found);
+                            break;
+
+                        case 8:
+                            round_trip(transport, client, unsupported,
+                                status);
+                            errors += (status != status_not_supported);
+                            break;
+
+                        case 9:
+                            errors += round_trip(transport, client, malformed,
+                                status);
+                            client = transport.connect();
+                            break;
+
+                        default:
+                            round_trip(transport, client,
+                                ((r % 2) == 0) ? valid0 : valid1,
+                                status);
+                            errors += (status != 0);
+                            break;
+                    }
+                }
+                transport.close(client);
+            });
+        }
+
+        for (auto& c : clients) {
+            c.join();
+        }
+
+        transport.stop();
+        thread.join();
+    });
+
+    const auto& stats = loop.statistics();
+    const auto cnt_malformed = cnt_clients * cnt_requests / 10;
+    EXPECT_EQ(errors, 0);
+    EXPECT_EQ(stats.requests(), cnt_clients * cnt_requests - cnt_malformed);
+    EXPECT_EQ(stats.failures(), cnt_malformed);
+
+    std::cout << "[ BENCHMARK] server_load.throughput: "
+        << stats.throughput() << " requests/s" << std::endl;
+    ::testing::Test::RecordProperty("server_load.throughput",
+        std::to_string(stats.throughput()));
+
+    const std::pair<const char *, double> percentiles[] = {
+        { "server_load.p50", 0.5 },
+        { "server_load.p99", 0.99 },
+        { "server_load.p999", 0.999 }
+    };
+    for (auto& p : percentiles) {
+        const std::string name(p.first);
+        const auto value = stats.percentile(p.second).count();
+        std::cout << "[ BENCHMARK] " << name << ": " << value << " us"
+            << std::endl;
+        ::testing::Test::RecordProperty(name, std::to_string(value));
+    }
+}
@@ -0,0 +1,130 @@
+﻿// <copyright file="shared_state_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrsvc/shared_state.h"
+
+#include "benchmark.h"
+
+
+#if !defined(_WIN32)
+namespace {
+
+    /// <summary>
+    /// Creates a name for a shared memory object that does not collide with
+    /// the service or with tests running in parallel.
+    /// </summary>
+    std::string make_name(const char *test) {
+        return std::string("/oxrtest.") + test + "."
+            + std::to_string(::getpid());
+    }
+
+} /* namespace */
+
+
+/*
+ * shared_state.publish
+ */
+TEST(shared_state, publish) {
+    const auto name = make_name("publish");
+    state_publisher publisher(name.c_str());
+    state_reader reader(name.c_str());
+    state_snapshot snapshot;
+
+    reader.read(snapshot);
+    EXPECT_EQ(snapshot.generation, 0);
+    EXPECT_EQ(snapshot.runtime, L"");
+
+    EXPECT_TRUE(publisher.publish(L"C:\\SteamVR\\steamxr_win64.json",
+        L"C:\\SteamVR\\steamxr_win32.json"));
+    EXPECT_EQ(reader.generation(), 1);
+    reader.read(snapshot);
+    EXPECT_EQ(snapshot.generation, 1);
+    EXPECT_EQ(snapshot.runtime, L"C:\\SteamVR\\steamxr_win64.json");
+    EXPECT_EQ(snapshot.wow_runtime, L"C:\\SteamVR\\steamxr_win32.json");
+    EXPECT_FALSE(snapshot.truncated);
+    EXPECT_GT(snapshot.timestamp, 0);
+
+    // Publishing the same state again must not count as a change.
+    EXPECT_FALSE(publisher.publish(L"C:\\SteamVR\\steamxr_win64.json",
+        L"C:\\SteamVR\\steamxr_win32.json"));
+    EXPECT_EQ(reader.generation(), 1);
+
+    // A path that does not fit must be flagged rather than cut off.
+    EXPECT_TRUE(publisher.publish(std::wstring(max_state_path, L'a'), L""));
+    reader.read(snapshot);
+    EXPECT_EQ(snapshot.generation, 2);
+    EXPECT_EQ(snapshot.runtime, L"");
+    EXPECT_TRUE(snapshot.truncated);
+}
+
+
+/*
+ * shared_state.concurrent
+ */
+TEST(shared_state, concurrent) {
+    // The readers must never see the native runtime of one change combined
+    // with the WOW64 runtime of another one.
+    const auto name = make_name("concurrent");
+    state_publisher publisher(name.c_str());
+    std::atomic<bool> running(true);
+    std::atomic<std::size_t> torn(0);
+
+    std::vector<std::thread> readers;
+    for (std::size_t i = 0; i < 2; ++i) {
+        readers.emplace_back([&](void) {
+            state_reader reader(name.c_str());
+            state_snapshot snapshot;
+            while (running.load(std::memory_order_acquire)) {
+                reader.read(snapshot);
+                if (snapshot.runtime + L"-wow" != snapshot.wow_runtime) {
+                    torn += !snapshot.runtime.empty();
+                }
+            }
+        });
+    }
+
+    for (std::size_t i = 0; i < 10000; ++i) {
+        const auto runtime = std::to_wstring(i) + std::wstring(
+            (i % 2) * 500, L'x');
+        publisher.publish(runtime, runtime + L"-wow");
+    }
+
+    running.store(false, std::memory_order_release);
+    for (auto& r : readers) {
+        r.join();
+    }
+
+    EXPECT_EQ(torn, 0);
+}
+
+
+/*
+ * benchmark.state_reader
+ */
+TEST(benchmark, state_reader) {
+    // Polling the generation is what a client does to detect a change, and
+    // only a change requires reading the whole state.
+    const auto name = make_name("benchmark");
+    state_publisher publisher(name.c_str());
+    publisher.publish(L"C:\\Program Files\\Varjo\\VarjoOpenXR.json", L"");
+    state_reader reader(name.c_str());
+    state_snapshot snapshot;
+
+    const auto generation = benchmark("state_reader.generation", 100000,
+            [&](void) {
+        EXPECT_EQ(reader.generation(), 1);
+    });
+
+    const auto read = benchmark("state_reader.read", 100000, [&](void) {
+        reader.read(snapshot);
+    });
+
+    EXPECT_EQ(snapshot.runtime, L"C:\\Program Files\\Varjo\\VarjoOpenXR.json");
+    EXPECT_LT(generation, read);
+}
+#endif /* !defined(_WIN32) */
@@ -0,0 +1,334 @@
+﻿// <copyright file="socket_transport_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrsvc/protocol.h"
+#include "../oxrsvc/server.h"
+#include "../oxrsvc/socket_transport.h"
+
+#include "benchmark.h"
+#include "temp_directory.h"
+
+
+#if !defined(_WIN32)
+namespace {
+
+    /// <summary>
+    /// Activates any runtime and notifies the subscribers about it like the
+    /// switcher does after it has changed the registry.
+    /// </summary>
+    struct notifying_handler final {
+        std::wstring active;
+        socket_transport *transport;
+
+        void notify(std::vector<std::uint8_t>& output) {
+            ::write_changed(output, this->active, L"");
+        }
+
+        std::size_t process(const ring_buffer& input,
+                std::size_t& scanned,
+                std::vector<std::uint8_t>& output,
+                bool& subscribe) {
+            request req;
+            const auto retval = ::parse_request(input, scanned, req);
+            if (retval == 0) {
+                return 0;
+            }
+
+            subscribe = (req.type == message_type::subscribe);
+            if (req.type == message_type::activate) {
+                this->active = req.runtime;
+                this->transport->notify();
+            }
+
+            ::write_result(output, req, 0);
+            return retval;
+        }
+    };
+
+    /// <summary>
+    /// The server under test.
+    /// </summary>
+    typedef server<socket_transport, notifying_handler> server_type;
+
+    /// <summary>
+    /// Runs a server on a Unix domain socket in a temporary directory.
+    /// </summary>
+    class socket_server final {
+
+    public:
+
+        explicit socket_server(const std::size_t instances)
+                : path(std::filesystem::path(dir.path(L"oxrsvc.sock"))
+                    .string()),
+                transport(path.c_str(), instances),
+                loop(transport, { std::wstring(), &transport }, 4096),
+                thread([this](void) { this->loop(); }) { }
+
+        ~socket_server(void) {
+            this->transport.stop();
+            this->thread.join();
+        }
+
+        /// <summary>
+        /// Connects a new blocking client.
+        /// </summary>
+        int connect(void) const {
+            sockaddr_un address;
+            std::memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            std::copy(this->path.begin(), this->path.end(),
+                address.sun_path);
+
+            const auto retval = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC,
+                0);
+            if ((retval < 0) || (::connect(retval,
+                    reinterpret_cast<sockaddr *>(&address),
+                    sizeof(address)) != 0)) {
+                throw std::system_error(errno, std::system_category());
+            }
+
+            return retval;
+        }
+
+        temp_directory dir;
+        std::string path;
+        socket_transport transport;
+        server_type loop;
+        std::thread thread;
+    };
+
+    /// <summary>
+    /// Sends a frame of the given type with an empty payload.
+    /// </summary>
+    void send_frame(const int socket, const message_type type) {
+        frame_header header;
+        header.magic = frame_magic;
+        header.version = frame_version;
+        header.type = type;
+        header.length = 0;
+        ASSERT_EQ(::send(socket, &header, sizeof(header), MSG_NOSIGNAL),
+            sizeof(header));
+    }
+
+    /// <summary>
+    /// Sends activation requests in the format of old clients at once.
+    /// </summary>
+    void send_legacy(const int socket,
+            const std::vector<std::u16string>& runtimes) {
+        std::u16string units;
+        for (auto& r : runtimes) {
+            units += r;
+            units.append(2, u'\0');
+        }
+        const auto cnt = units.size() * sizeof(char16_t);
+        ASSERT_EQ(::send(socket, units.data(), cnt, MSG_NOSIGNAL), cnt);
+    }
+
+    /// <summary>
+    /// Receives exactly <paramref name="cnt" /> bytes.
+    /// </summary>
+    bool receive(const int socket, void *dst, std::size_t cnt) {
+        auto d = static_cast<std::uint8_t *>(dst);
+        while (cnt > 0) {
+            const auto r = ::recv(socket, d, cnt, 0);
+            if (r <= 0) {
+                return false;
+            }
+            d += r;
+            cnt -= static_cast<std::size_t>(r);
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// Receives the next message, which is either a framed result, a
+    /// change notification or the bare status of a legacy request.
+    /// </summary>
+    /// <returns>The type of the message.</returns>
+    message_type receive_message(const int socket,
+            std::u16string& runtime) {
+        frame_header header;
+        EXPECT_TRUE(receive(socket, &header, sizeof(header)));
+        EXPECT_EQ(header.magic, frame_magic);
+
+        std::vector<std::uint8_t> payload(header.length);
+        EXPECT_TRUE(receive(socket, payload.data(), payload.size()));
+
+        if (header.type == message_type::changed) {
+            std::uint32_t counts[2];
+            std::memcpy(counts, payload.data(), sizeof(counts));
+            runtime.resize(counts[0]);
+            std::memcpy(&runtime[0], payload.data() + sizeof(counts),
+                counts[0] * sizeof(char16_t));
+        }
+
+        return header.type;
+    }
+
+    /// <summary>
+    /// Answer the number of clients in the subscription benchmark, which can
+    /// be changed via the environment variable <c>OXRTEST_SUBSCRIBERS</c>.
+    /// </summary>
+    /// <remarks>
+    /// The limit of open files is raised as far as the system allows, and the
+    /// number is capped such that both ends of every connection fit into it.
+    /// </remarks>
+    std::size_t benchmark_subscribers(void) {
+        constexpr std::size_t fallback = 5000;
+        constexpr std::size_t reserved = 64;
+
+        const auto value = ::getenv("OXRTEST_SUBSCRIBERS");
+        auto retval = (value != nullptr)
+            ? static_cast<std::size_t>(std::strtoull(value, nullptr, 10))
+            : fallback;
+        if (retval == 0) {
+            retval = fallback;
+        }
+
+        rlimit limit;
+        if (::getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+            return retval;
+        }
+        if (limit.rlim_cur < limit.rlim_max) {
+            auto raised = limit;
+            raised.rlim_cur = limit.rlim_max;
+            if (::setrlimit(RLIMIT_NOFILE, &raised) == 0) {
+                limit = raised;
+            }
+        }
+
+        const auto available = (limit.rlim_cur > reserved)
+            ? static_cast<std::size_t>((limit.rlim_cur - reserved) / 2)
+            : 1;
+        if (retval > available) {
+            std::cout << "[ BENCHMARK] The number of subscribers is limited "
+                "to " << available << " by the number of open files."
+                << std::endl;
+            retval = available;
+        }
+
+        return retval;
+    }
+
+    /// <summary>
+    /// Answer the processor time the process has used so far.
+    /// </summary>
+    std::chrono::microseconds cpu_time(void) {
+        rusage usage;
+        ::getrusage(RUSAGE_SELF, &usage);
+        return std::chrono::seconds(usage.ru_utime.tv_sec
+            + usage.ru_stime.tv_sec)
+            + std::chrono::microseconds(usage.ru_utime.tv_usec
+            + usage.ru_stime.tv_usec);
+    }
+
+    /// <summary>
+    /// Subscribes a new client and consumes the result and the initial
+    /// notification.
+    /// </summary>
+    int subscribe(const socket_server& server) {
+        const auto retval = server.connect();
+        std::u16string runtime;
+        send_frame(retval, message_type::subscribe);
+        EXPECT_EQ(receive_message(retval, runtime), message_type::result);
+        EXPECT_EQ(receive_message(retval, runtime), message_type::changed);
+        return retval;
+    }
+
+} /* namespace */
+
+
+/*
+ * socket_transport.subscribe
+ */
+TEST(socket_transport, subscribe) {
+    socket_server server(3);
+    const auto subscriber = subscribe(server);
+
+    // A burst of changes must be coalesced into a single notification,
+    // which reflects the final state.
+    const auto client = server.connect();
+    std::vector<std::u16string> burst;
+    for (std::size_t i = 0; i < 20; ++i) {
+        burst.push_back(u"runtime" + std::u16string(1,
+            static_cast<char16_t>(u'a' + i)));
+    }
+    send_legacy(client, burst);
+    for (std::size_t i = 0; i < burst.size(); ++i) {
+        std::int32_t status;
+        ASSERT_TRUE(receive(client, &status, sizeof(status)));
+        EXPECT_EQ(status, 0);
+    }
+
+    std::u16string runtime;
+    std::size_t cnt = 0;
+    do {
+        EXPECT_EQ(receive_message(subscriber, runtime),
+            message_type::changed);
+        ++cnt;
+    } while (runtime != burst.back());
+    EXPECT_EQ(cnt, 1);
+
+    // An instance must be recycled once its client has gone.
+    ::close(client);
+    const auto next = server.connect();
+    send_frame(next, message_type::subscribe);
+    EXPECT_EQ(receive_message(next, runtime), message_type::result);
+    EXPECT_EQ(receive_message(next, runtime), message_type::changed);
+    EXPECT_EQ(runtime, burst.back());
+
+    ::close(next);
+    ::close(subscriber);
+}
+
+
+/*
+ * benchmark.subscription
+ */
+TEST(benchmark, subscription) {
+    const auto cnt_subscribers = benchmark_subscribers();
+    socket_server server(cnt_subscribers + 1);
+
+    std::vector<int> subscribers;
+    for (std::size_t i = 0; i < cnt_subscribers; ++i) {
+        subscribers.push_back(subscribe(server));
+    }
+
+    // Idle subscribers must not cost the server anything while it waits.
+    const auto before = cpu_time();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    const auto idle = cpu_time() - before;
+    std::cout << "[ BENCHMARK] subscription.idle_cpu: " << idle.count()
+        << " us" << std::endl;
+    ::testing::Test::RecordProperty("subscription.idle_cpu",
+        std::to_string(idle.count()));
+    EXPECT_LT(idle, std::chrono::milliseconds(20));
+
+    // Measure the time from an activation until all subscribers have been
+    // notified.
+    const auto client = server.connect();
+    std::size_t i = 0;
+    benchmark("subscription.notify_all", 10, [&](void) {
+        const std::u16string expected = (++i % 2) ? u"odd" : u"even";
+        send_legacy(client, { expected });
+        std::int32_t status;
+        ASSERT_TRUE(receive(client, &status, sizeof(status)));
+
+        for (auto s : subscribers) {
+            std::u16string runtime;
+            ASSERT_EQ(receive_message(s, runtime), message_type::changed);
+            EXPECT_EQ(runtime, expected);
+        }
+    });
+
+    ::close(client);
+    for (auto s : subscribers) {
+        ::close(s);
+    }
+}
+#endif /* !defined(_WIN32) */
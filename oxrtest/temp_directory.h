@@ -0,0 +1,78 @@
+﻿// <copyright file="temp_directory.h" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#if !defined(_OXRTEST_TEMP_DIRECTORY_H)
+#define _OXRTEST_TEMP_DIRECTORY_H
+#pragma once
+
+
+/// <summary>
+/// A uniquely named directory below the temporary directory, which is
+/// deleted with all of its content when the object goes out of scope.
+/// </summary>
+class temp_directory final {
+
+public:
+
+    /// <summary>
+    /// Creates a new directory.
+    /// </summary>
+    temp_directory(void) {
+        std::random_device rng;
+        do {
+            this->_path = std::filesystem::temp_directory_path()
+                / ("oxrtest-" + std::to_string(rng()));
+        } while (!std::filesystem::create_directory(this->_path));
+    }
+
+    temp_directory(const temp_directory&) = delete;
+
+    /// <summary>
+    /// Deletes the directory and its content.
+    /// </summary>
+    ~temp_directory(void) {
+        std::error_code error;
+        std::filesystem::remove_all(this->_path, error);
+    }
+
+    /// <summary>
+    /// Answer the path of <paramref name="child" /> in the directory.
+    /// </summary>
+    /// <param name="child">A relative path using forward slashes.</param>
+    /// <returns></returns>
+    inline std::wstring path(_In_ const std::wstring& child
+            = std::wstring()) const {
+        auto retval = this->_path;
+        if (!child.empty()) {
+            retval /= std::filesystem::path(child).make_preferred();
+        }
+        return retval.wstring();
+    }
+
+    /// <summary>
+    /// Creates the file <paramref name="child" /> with the given content,
+    /// including all directories on the way.
+    /// </summary>
+    /// <param name="child">A relative path using forward slashes.</param>
+    /// <param name="content"></param>
+    /// <returns>The full path of the file.</returns>
+    std::wstring write(_In_ const std::wstring& child,
+            _In_ const std::string& content) const {
+        const std::filesystem::path retval(this->path(child));
+        std::filesystem::create_directories(retval.parent_path());
+        std::ofstream stream(retval, std::ios::binary | std::ios::trunc);
+        stream << content;
+        return retval.wstring();
+    }
+
+    temp_directory& operator =(const temp_directory&) = delete;
+
+private:
+
+    std::filesystem::path _path;
+};
+
+#endif /* !defined(_OXRTEST_TEMP_DIRECTORY_H) */
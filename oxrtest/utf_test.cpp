@@ -0,0 +1,111 @@
+﻿// <copyright file="utf_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrswitch/util.h"
+
+#include "benchmark.h"
+
+
+/*
+ * utf.round_trip
+ */
+TEST(utf, round_trip) {
+    const std::wstring strings[] = {
+        L"",
+        L"SteamVR",
+        L"Universit\u00E4t Stuttgart",
+        L"\u041E\u0442\u043A\u0440\u044B\u0442\u0430\u044F \u0441\u0440"
+            L"\u0435\u0434\u0430",
+        L"\u4EEE\u60F3\u73FE\u5B9F",
+        std::wstring(L"VR ") + ((sizeof(wchar_t) == 2)
+            ? L"\xD83E\xDD7D" : L"\U0001F97D"),
+        std::wstring(64, L'a') + L"\u00E4" + std::wstring(17, L'b'),
+    };
+
+    for (auto& s : strings) {
+        EXPECT_EQ(::from_utf8(::to_utf8(s)), s);
+    }
+
+    EXPECT_EQ(::to_utf8(L"\u00E4"), "\xC3\xA4");
+    EXPECT_EQ(::to_utf8(L"\u20AC"), "\xE2\x82\xAC");
+    EXPECT_EQ(::from_utf8("\xF0\x9F\xA5\xBD"), (sizeof(wchar_t) == 2)
+        ? std::wstring(L"\xD83E\xDD7D") : std::wstring(L"\U0001F97D"));
+}
+
+
+/*
+ * utf.invalid_utf8
+ */
+TEST(utf, invalid_utf8) {
+    // Overlong encodings.
+    EXPECT_ANY_THROW(::from_utf8("\xC0\xAF"));
+    EXPECT_ANY_THROW(::from_utf8("\xE0\x80\xAF"));
+    // Surrogates.
+    EXPECT_ANY_THROW(::from_utf8("\xED\xA0\x80"));
+    // Beyond U+10FFFF.
+    EXPECT_ANY_THROW(::from_utf8("\xF4\x90\x80\x80"));
+    // Truncated sequences and stray continuation bytes.
+    EXPECT_ANY_THROW(::from_utf8("abc\xC3"));
+    EXPECT_ANY_THROW(::from_utf8("\xE2\x82"));
+    EXPECT_ANY_THROW(::from_utf8("\x80"));
+    EXPECT_ANY_THROW(::from_utf8(std::string(20, 'a') + "\xFF"));
+}
+
+
+/*
+ * utf.invalid_utf16
+ */
+TEST(utf, invalid_utf16) {
+    EXPECT_ANY_THROW(::to_utf8(std::wstring(1, static_cast<wchar_t>(0xD800))));
+    EXPECT_ANY_THROW(::to_utf8(std::wstring(1, static_cast<wchar_t>(0xDC00))));
+    EXPECT_ANY_THROW(::to_utf8(std::wstring(L"a")
+        + static_cast<wchar_t>(0xD800) + L"b"));
+}
+
+
+/*
+ * benchmark.from_utf8
+ */
+TEST(benchmark, from_utf8) {
+    // Manifest-like ASCII text, which is what the discovery decodes.
+    std::string text;
+    while (text.size() < (1 << 20)) {
+        text += R"({ "file_format_version": "1.0.0", "runtime": { )"
+            R"("name": "SteamVR", "library_path": )"
+            R"("C:\\Program Files (x86)\\Steam\\steamapps\\common\\SteamVR")"
+            R"(\\bin\\win64\\vrclient_x64.dll" } })";
+    }
+
+    std::size_t length = 0;
+    const auto t = benchmark("from_utf8 (1 MiB)", 20, [&]() {
+        length += ::from_utf8(text).size();
+    });
+    EXPECT_EQ(length, 20 * text.size());
+
+    const auto seconds = std::chrono::duration<double>(t).count();
+    std::cout << "[ BENCHMARK] from_utf8: "
+        << (text.size() / seconds / 1.0e9) << " GB/s" << std::endl;
+}
+
+
+/*
+ * benchmark.to_utf8
+ */
+TEST(benchmark, to_utf8) {
+    const auto text = ::from_utf8(std::string(1 << 20, 'x'));
+
+    std::size_t length = 0;
+    const auto t = benchmark("to_utf8 (1 Mi characters)", 20, [&]() {
+        length += ::to_utf8(text).size();
+    });
+    EXPECT_EQ(length, 20 * text.size());
+
+    const auto seconds = std::chrono::duration<double>(t).count();
+    std::cout << "[ BENCHMARK] to_utf8: "
+        << (text.size() / seconds / 1.0e9) << " G characters/s" << std::endl;
+}
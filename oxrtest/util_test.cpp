@@ -0,0 +1,159 @@
+﻿// <copyright file="util_test.cpp" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+
+#include "pch.h"
+
+#include "../oxrswitch/util.h"
+
+
+namespace {
+
+    /// <summary>
+    /// Characters the random strings are made of, which comprise ASCII
+    /// letters and digits, umlauts, Greek and Cyrillic letters and the
+    /// Kelvin sign, which folds to an ASCII letter.
+    /// </summary>
+    const std::wstring alphabet = L"aAbBkKzZ09_\\.\u00E4\u00C4\u00F6\u00D6"
+        L"\u00DF\u03A3\u03C3\u0416\u0436\u212A";
+
+    /// <summary>
+    /// Creates a random string of up to <paramref name="max_length" />
+    /// characters from <see cref="alphabet" />.
+    /// </summary>
+    std::wstring random_string(_Inout_ std::mt19937& rng,
+            _In_ const std::size_t max_length) {
+        std::uniform_int_distribution<std::size_t> length(0, max_length);
+        std::uniform_int_distribution<std::size_t> index(0,
+            alphabet.size() - 1);
+        std::wstring retval(length(rng), L'\0');
+        for (auto& c : retval) {
+            c = alphabet[index(rng)];
+        }
+        return retval;
+    }
+
+    /// <summary>
+    /// The scalar reference for <see cref="equals_n" />.
+    /// </summary>
+    bool reference_equals(_In_ const std::wstring& lhs,
+            _In_ const std::wstring& rhs) {
+        if (lhs.size() != rhs.size()) {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < lhs.size(); ++i) {
+            if (::fold_case(lhs[i]) != ::fold_case(rhs[i])) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+} /* namespace */
+
+
+/*
+ * util.fold_case
+ */
+TEST(util, fold_case) {
+    EXPECT_EQ(::fold_case(L'A'), L'a');
+    EXPECT_EQ(::fold_case(L'z'), L'z');
+    EXPECT_EQ(::fold_case(L'_'), L'_');
+    EXPECT_EQ(::fold_case(L'\u00C4'), L'\u00E4');
+    EXPECT_EQ(::fold_case(L'\u00E4'), L'\u00E4');
+    EXPECT_EQ(::fold_case(L'\u00DF'), L'\u00DF');
+    EXPECT_EQ(::fold_case(L'\u0100'), L'\u0101');
+    EXPECT_EQ(::fold_case(L'\u0101'), L'\u0101');
+    EXPECT_EQ(::fold_case(L'\u0130'), L'i');
+    EXPECT_EQ(::fold_case(L'\u03A3'), L'\u03C3');
+    EXPECT_EQ(::fold_case(L'\u0416'), L'\u0436');
+    EXPECT_EQ(::fold_case(L'\u212A'), L'k');
+    EXPECT_EQ(::fold_case(L'\uFF21'), L'\uFF41');
+    EXPECT_EQ(::fold_case(L'\uFFFF'), L'\uFFFF');
+}
+
+
+/*
+ * util.fold_case_locale
+ */
+TEST(util, fold_case_locale) {
+    // The classic locale does not know about umlauts, but fold_case must not
+    // depend on the locale.
+    const auto locale = std::setlocale(LC_ALL, nullptr);
+    const std::string previous((locale != nullptr) ? locale : "C");
+    std::setlocale(LC_ALL, "C");
+    EXPECT_EQ(::fold_case(L'\u00D6'), L'\u00F6');
+    EXPECT_TRUE(::equals(L"\u00C4RGER", L"\u00E4rger", false));
+    std::setlocale(LC_ALL, previous.c_str());
+}
+
+
+/*
+ * util.equals
+ */
+TEST(util, equals) {
+    EXPECT_TRUE(::equals(L"OpenXR", L"openxr", false));
+    EXPECT_FALSE(::equals(L"OpenXR", L"openxr", true));
+    EXPECT_FALSE(::equals(L"OpenXR", L"openxr1", false));
+    EXPECT_TRUE(::equals(static_cast<const wchar_t *>(nullptr), nullptr));
+    EXPECT_FALSE(::equals(L"", nullptr));
+    EXPECT_TRUE(::equals(L"C:\\Program Files\\M\u00FCller\\Runtime",
+        L"c:\\PROGRAM FILES\\M\u00DCLLER\\runtime", false));
+}
+
+
+/*
+ * util.equals_n_reference
+ */
+TEST(util, equals_n_reference) {
+    // Compare the kernel with the scalar reference on random strings, which
+    // also exercises the SIMD blocks with mixed ASCII and other characters.
+    std::mt19937 rng(42);
+    for (std::size_t i = 0; i < 200000; ++i) {
+        const auto lhs = random_string(rng, 40);
+        auto rhs = lhs;
+        for (auto& c : rhs) {
+            if ((rng() & 1) != 0) {
+                c = (::fold_case(c) == c)
+                    ? static_cast<wchar_t>(std::towupper(c))
+                    : ::fold_case(c);
+            }
+        }
+        if ((rng() % 4) == 0) {
+            rhs = random_string(rng, 40);
+        }
+
+        EXPECT_EQ(::equals(lhs, rhs, false), reference_equals(lhs, rhs))
+            << "Mismatch at iteration " << i;
+    }
+}
+
+
+/*
+ * util.contains
+ */
+TEST(util, contains) {
+    EXPECT_TRUE(::contains(L"C:\\Program Files\\Varjo\\varjo-openxr",
+        L"VARJO-OPENXR", false));
+    EXPECT_FALSE(::contains(L"C:\\Program Files\\Varjo\\varjo-openxr",
+        L"VARJO-OPENXR", true));
+    EXPECT_TRUE(::contains(L"\u00C4\u00D6\u00DC", L"\u00F6\u00FC", false));
+    EXPECT_TRUE(::contains(L"abc", L"", false));
+    EXPECT_TRUE(::contains(L"", L"", false));
+    EXPECT_FALSE(::contains(L"", L"a", false));
+    EXPECT_FALSE(::contains(L"ab", L"abc", false));
+}
+
+
+/*
+ * util.ends_with
+ */
+TEST(util, ends_with) {
+    EXPECT_TRUE(::ends_with(std::wstring(L"runtime.JSON"), L".json", false));
+    EXPECT_FALSE(::ends_with(std::wstring(L"runtime.JSON"), L".json", true));
+    EXPECT_FALSE(::ends_with(std::wstring(L"json"), L".json", false));
+}
@@ -0,0 +1,96 @@
+﻿// <copyright file="xdg_environment.h" company="Visualisierungsinstitut der Universität Stuttgart">
+// Copyright © 2025 Visualisierungsinstitut der Universität Stuttgart.
+// Licensed under the MIT licence. See LICENCE file for details.
+// </copyright>
+// <author>Christoph Müller</author>
+#if !defined(_OXRTEST_XDG_ENVIRONMENT_H)
+#define _OXRTEST_XDG_ENVIRONMENT_H
+#pragma once
+
+#include "temp_directory.h"
+
+
+#if !defined(_WIN32)
+/// <summary>
+/// Points the XDG base directories and the home directory into a
+/// temporary directory and restores the environment on destruction.
+/// </summary>
+class xdg_environment final {
+
+public:
+
+    /// <summary>
+    /// Creates the temporary directory and redirects the environment into it.
+    /// </summary>
+    xdg_environment(void) {
+        const auto root = ::to_utf8(this->_root.path());
+        this->set("HOME", root + "/home");
+        this->set("XDG_CACHE_HOME", root + "/home/.cache");
+        this->set("XDG_CONFIG_DIRS", root + "/etc/xdg");
+        this->set("XDG_CONFIG_HOME", root + "/home/.config");
+        this->set("XDG_DATA_DIRS", root + "/usr/local/share:relative:"
+            + root + "/usr/share");
+        this->set("XDG_DATA_HOME", root + "/home/.local/share");
+    }
+
+    xdg_environment(const xdg_environment&) = delete;
+
+    /// <summary>
+    /// Restores the environment and deletes the temporary directory.
+    /// </summary>
+    ~xdg_environment(void) {
+        for (auto& v : this->_saved) {
+            if (v.second) {
+                ::setenv(v.first.c_str(), v.second->c_str(), 1);
+            } else {
+                ::unsetenv(v.first.c_str());
+            }
+        }
+    }
+
+    /// <summary>
+    /// Creates a minimal runtime manifest for a runtime with the given
+    /// <paramref name="name" />.
+    /// </summary>
+    /// <param name="child">A relative path using forward slashes.</param>
+    /// <param name="name"></param>
+    /// <returns>The full path of the manifest.</returns>
+    inline std::wstring manifest(_In_ const std::wstring& child,
+            _In_ const std::string& name) const {
+        return this->_root.write(child, R"({
+            "file_format_version": "1.0.0",
+            "runtime": {
+                "name": ")" + name + R"(",
+                "library_path": "libopenxr_runtime.so"
+            }
+        })");
+    }
+
+    /// <summary>
+    /// Answer the path of <paramref name="child" /> in the temporary
+    /// directory.
+    /// </summary>
+    /// <param name="child">A relative path using forward slashes.</param>
+    /// <returns></returns>
+    inline std::wstring path(_In_ const std::wstring& child) const {
+        return this->_root.path(child);
+    }
+
+    xdg_environment& operator =(const xdg_environment&) = delete;
+
+private:
+
+    void set(_In_z_ const char *name, _In_ const std::string& value) {
+        auto old = ::getenv(name);
+        this->_saved.emplace_back(name, (old != nullptr)
+            ? std::optional<std::string>(old)
+            : std::nullopt);
+        ::setenv(name, value.c_str(), 1);
+    }
+
+    temp_directory _root;
+    std::vector<std::pair<std::string, std::optional<std::string>>> _saved;
+};
+#endif /* !defined(_WIN32) */
+
+#endif /* !defined(_OXRTEST_XDG_ENVIRONMENT_H) */